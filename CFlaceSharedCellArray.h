@@ -0,0 +1,279 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_SHARED_CELL_ARRAY_H_INCLUDED__
+#define __C_FLACE_SHARED_CELL_ARRAY_H_INCLUDED__
+
+#include "irrArray.h"
+#include "irrMath.h"
+#include <string.h>
+
+//! Grid of cells, stored in pages of whole rows. Pages are reference counted and shared between copies of
+//! the array, and a page is only copied when one of the arrays changes a cell of it (copy on write). So copying
+//! a terrain only copies pointers, and everything nobody changed stays shared.
+//! Pages may be read from any thread, but copying, changing and releasing arrays must be done on one thread.
+template <class T>
+class CFlaceSharedCellArray
+{
+public:
+
+	CFlaceSharedCellArray()
+		: Width(0), Height(0), RowsPerPage(1)
+	{
+	}
+
+	//! copy constructor, shares all pages with the other array
+	CFlaceSharedCellArray(const CFlaceSharedCellArray<T>& other)
+		: Width(0), Height(0), RowsPerPage(1)
+	{
+		*this = other;
+	}
+
+	~CFlaceSharedCellArray()
+	{
+		clear();
+	}
+
+	//! shares all pages with the other array
+	CFlaceSharedCellArray<T>& operator=(const CFlaceSharedCellArray<T>& other)
+	{
+		if (this == &other)
+			return *this;
+
+		for (irr::u32 p=0; p<other.Pages.size(); ++p)
+			++other.Pages[p]->RefCount;
+
+		clear();
+
+		Width = other.Width;
+		Height = other.Height;
+		RowsPerPage = other.RowsPerPage;
+		Pages = other.Pages;
+		Rows = other.Rows;
+
+		return *this;
+	}
+
+	//! sets the size of the grid, and all cells to a value
+	void reset(irr::s32 width, irr::s32 height, const T& value)
+	{
+		clear();
+
+		if (width <= 0 || height <= 0)
+			return;
+
+		Width = width;
+		Height = height;
+		RowsPerPage = irr::core::max_((irr::s32)PAGE_CELL_COUNT / width, 1);
+
+		const irr::s32 pageCount = (height + RowsPerPage - 1) / RowsPerPage;
+		for (irr::s32 p=0; p<pageCount; ++p)
+		{
+			// the last page only holds the remaining rows
+			SPage* page = createPage(irr::core::min_(RowsPerPage, height - p * RowsPerPage) * width);
+			for (irr::s32 i=0; i<page->CellCount; ++i)
+				page->Data[i] = value;
+
+			Pages.push_back(page);
+		}
+
+		updateRows();
+	}
+
+	//! removes all cells
+	void clear()
+	{
+		for (irr::u32 p=0; p<Pages.size(); ++p)
+			releasePage(Pages[p]);
+
+		Pages.clear();
+		Rows.clear();
+		Width = 0;
+		Height = 0;
+	}
+
+	irr::s32 getWidth() const { return Width; }
+	irr::s32 getHeight() const { return Height; }
+
+	//! returns amount of cells
+	irr::u32 size() const { return (irr::u32)(Width * Height); }
+	bool empty() const { return Pages.empty(); }
+
+	//! returns a row of cells for reading
+	const T* getRow(irr::s32 y) const { return Rows[y]; }
+
+	//! returns a cell for reading
+	const T& get(irr::s32 x, irr::s32 y) const { return Rows[y][x]; }
+
+	//! returns a row of cells for changing it. Copies the page of the row first if it is shared.
+	T* getWritableRow(irr::s32 y)
+	{
+		SPage* page = Pages[y / RowsPerPage];
+		if (page->RefCount > 1 || page->Registered)
+			makePageWritable(y / RowsPerPage);
+
+		return Rows[y];
+	}
+
+	//! returns a cell for changing it. Copies its page first if it is shared.
+	T& getWritable(irr::s32 x, irr::s32 y) { return getWritableRow(y)[x]; }
+
+	//! shares pages with pages of equal content of other arrays, for example when the same terrain is loaded
+	//! into several scenes. The pages of this array can then be shared by arrays calling this later.
+	void shareEqualPages()
+	{
+		irr::core::array<SPage*>& registry = getRegistry();
+
+		for (irr::u32 p=0; p<Pages.size(); ++p)
+		{
+			SPage* page = Pages[p];
+			if (page->Registered)
+				continue;
+
+			page->Hash = calculateHash(page);
+
+			SPage* equal = 0;
+			for (irr::u32 r=0; r<registry.size() && !equal; ++r)
+			{
+				SPage* other = registry[r];
+				if (other->Hash == page->Hash && other->CellCount == page->CellCount &&
+					!memcmp(other->Data, page->Data, page->CellCount * sizeof(T)))
+					equal = other;
+			}
+
+			if (equal)
+			{
+				++equal->RefCount;
+				releasePage(page);
+				Pages[p] = equal;
+			}
+			else
+			{
+				page->Registered = true;
+				registry.push_back(page);
+			}
+		}
+
+		updateRows();
+	}
+
+	//! returns amount of pages, and how many of them are shared with other arrays
+	irr::s32 getPageCount() const { return (irr::s32)Pages.size(); }
+	irr::s32 getSharedPageCount() const
+	{
+		irr::s32 count = 0;
+		for (irr::u32 p=0; p<Pages.size(); ++p)
+			if (Pages[p]->RefCount > 1)
+				++count;
+		return count;
+	}
+
+private:
+
+	enum { PAGE_CELL_COUNT = 65536 };
+
+	struct SPage
+	{
+		irr::s32 RefCount;
+		irr::s32 CellCount;
+		irr::u32 Hash;
+		bool Registered; // in the registry of shareEqualPages(), needs to stay unchanged
+		T* Data;
+	};
+
+	static irr::core::array<SPage*>& getRegistry()
+	{
+		static irr::core::array<SPage*> registry;
+		return registry;
+	}
+
+	static SPage* createPage(irr::s32 cellCount)
+	{
+		SPage* page = new SPage();
+		page->RefCount = 1;
+		page->CellCount = cellCount;
+		page->Hash = 0;
+		page->Registered = false;
+		page->Data = new T[cellCount];
+		return page;
+	}
+
+	static void releasePage(SPage* page)
+	{
+		if (--page->RefCount > 0)
+			return;
+
+		unregisterPage(page);
+
+		delete [] page->Data;
+		delete page;
+	}
+
+	static void unregisterPage(SPage* page)
+	{
+		if (!page->Registered)
+			return;
+
+		irr::core::array<SPage*>& registry = getRegistry();
+		for (irr::u32 r=0; r<registry.size(); ++r)
+			if (registry[r] == page)
+			{
+				registry.erase(r);
+				break;
+			}
+
+		page->Registered = false;
+	}
+
+	//! FNV-1a of the bytes of a page
+	static irr::u32 calculateHash(const SPage* page)
+	{
+		const irr::u8* p = (const irr::u8*)page->Data;
+		const irr::u32 byteCount = page->CellCount * sizeof(T);
+
+		irr::u32 hash = 2166136261u;
+		for (irr::u32 i=0; i<byteCount; ++i)
+			hash = (hash ^ p[i]) * 16777619u;
+
+		return hash;
+	}
+
+	void makePageWritable(irr::s32 pageIndex)
+	{
+		SPage* page = Pages[pageIndex];
+
+		if (page->RefCount == 1)
+		{
+			// not shared, only other arrays loaded later must not share it anymore
+			unregisterPage(page);
+			return;
+		}
+
+		SPage* copy = createPage(page->CellCount);
+		memcpy(copy->Data, page->Data, page->CellCount * sizeof(T));
+
+		releasePage(page);
+		Pages[pageIndex] = copy;
+
+		const irr::s32 endRow = irr::core::min_((pageIndex + 1) * RowsPerPage, Height);
+		for (irr::s32 y=pageIndex * RowsPerPage; y<endRow; ++y)
+			Rows[y] = copy->Data + (y - pageIndex * RowsPerPage) * Width;
+	}
+
+	void updateRows()
+	{
+		Rows.set_used(Height);
+		for (irr::s32 y=0; y<Height; ++y)
+			Rows[y] = Pages[y / RowsPerPage]->Data + (y % RowsPerPage) * Width;
+	}
+
+	irr::core::array<SPage*> Pages;
+	irr::core::array<T*> Rows; // start of each row inside of the pages
+	irr::s32 Width;
+	irr::s32 Height;
+	irr::s32 RowsPerPage;
+};
+
+#endif
+
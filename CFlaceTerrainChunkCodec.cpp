@@ -0,0 +1,159 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainChunkCodec.h"
+#include "irrMath.h"
+#include <string.h>
+
+static const irr::u32 TERRAIN_CHUNK_MIN_MATCH = 4;
+static const irr::u32 TERRAIN_CHUNK_HASH_BITS = 14;
+static const irr::u32 TERRAIN_CHUNK_MAX_OFFSET = 0xffff;
+
+
+//! writes a length which didn't fit into the 4 bits of a token
+void CFlaceTerrainChunkCodec::appendLength(irr::core::array<irr::u8>& out, irr::u32 length)
+{
+	for (; length >= 255; length -= 255)
+		out.push_back(255);
+
+	out.push_back((irr::u8)length);
+}
+
+
+//! writes literals followed by a match, or only literals at the end if matchLength is 0
+void CFlaceTerrainChunkCodec::appendSequence(irr::core::array<irr::u8>& out, const irr::u8* literals, irr::u32 literalCount, 
+											 irr::u32 matchOffset, irr::u32 matchLength)
+{
+	const irr::u32 matchCode = matchLength ? matchLength - TERRAIN_CHUNK_MIN_MATCH : 0;
+
+	out.push_back((irr::u8)((irr::core::min_(literalCount, 15u) << 4) | irr::core::min_(matchCode, 15u)));
+
+	if (literalCount >= 15)
+		appendLength(out, literalCount - 15);
+
+	for (irr::u32 i=0; i<literalCount; ++i)
+		out.push_back(literals[i]);
+
+	if (!matchLength)
+		return;
+
+	out.push_back((irr::u8)(matchOffset & 0xff));
+	out.push_back((irr::u8)(matchOffset >> 8));
+
+	if (matchCode >= 15)
+		appendLength(out, matchCode - 15);
+}
+
+
+//! compresses size bytes. Looks up each 4 byte sequence in a hash table of their last positions, and 
+//! writes a match if the sequence at that position is the same.
+void CFlaceTerrainChunkCodec::compress(const irr::u8* src, irr::u32 size, irr::core::array<irr::u8>& out)
+{
+	out.clear();
+	out.reallocate(size / 2 + 16);
+
+	irr::core::array<irr::s32> table;
+	table.set_used(1 << TERRAIN_CHUNK_HASH_BITS);
+	for (irr::u32 i=0; i<table.size(); ++i)
+		table[i] = -1;
+
+	irr::u32 anchor = 0;
+	irr::u32 pos = 0;
+
+	while (pos + TERRAIN_CHUNK_MIN_MATCH <= size)
+	{
+		const irr::u32 sequence = readU32(src + pos);
+		const irr::u32 hash = (sequence * 2654435761u) >> (32 - TERRAIN_CHUNK_HASH_BITS);
+		const irr::s32 candidate = table[hash];
+		table[hash] = (irr::s32)pos;
+
+		if (candidate < 0 || pos - candidate > TERRAIN_CHUNK_MAX_OFFSET || readU32(src + candidate) != sequence)
+		{
+			++pos;
+			continue;
+		}
+
+		irr::u32 length = TERRAIN_CHUNK_MIN_MATCH;
+		while (pos + length < size && src[candidate + length] == src[pos + length])
+			++length;
+
+		appendSequence(out, src + anchor, pos - anchor, pos - candidate, length);
+
+		pos += length;
+		anchor = pos;
+	}
+
+	appendSequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+
+//! reads a length which didn't fit into the 4 bits of a token, returns false if the data ends
+bool CFlaceTerrainChunkCodec::readLength(const irr::u8*& in, const irr::u8* end, irr::u32& length)
+{
+	irr::u8 b;
+	do
+	{
+		if (in >= end)
+			return false;
+
+		b = *in++;
+		length += b;
+	}
+	while (b == 255);
+
+	return true;
+}
+
+
+//! decompresses a chunk, every length and offset is checked against the ends of the input and output
+bool CFlaceTerrainChunkCodec::decompress(const irr::u8* src, irr::u32 srcSize, irr::u8* dest, irr::u32 destSize)
+{
+	const irr::u8* in = src;
+	const irr::u8* end = src + srcSize;
+	irr::u32 out = 0;
+
+	while (in < end)
+	{
+		const irr::u8 token = *in++;
+
+		irr::u32 literalCount = token >> 4;
+		if (literalCount == 15 && !readLength(in, end, literalCount))
+			return false;
+
+		if (literalCount > (irr::u32)(end - in) || literalCount > destSize - out)
+			return false;
+
+		memcpy(dest + out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+
+		if (in == end)
+			break; // the last sequence has no match
+
+		if (end - in < 2)
+			return false;
+
+		const irr::u32 offset = (irr::u32)in[0] | ((irr::u32)in[1] << 8);
+		in += 2;
+
+		irr::u32 matchLength = token & 15;
+		if (matchLength == 15 && !readLength(in, end, matchLength))
+			return false;
+
+		matchLength += TERRAIN_CHUNK_MIN_MATCH;
+
+		if (!offset || offset > out || matchLength > destSize - out)
+			return false;
+
+		// matches may overlap with their own output, so copy byte by byte
+
+		const irr::u8* match = dest + out - offset;
+		for (irr::u32 i=0; i<matchLength; ++i)
+			dest[out + i] = match[i];
+
+		out += matchLength;
+	}
+
+	return out == destSize;
+}
@@ -0,0 +1,57 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_CHUNK_CODEC_H_INCLUDED__
+#define __C_FLACE_TERRAIN_CHUNK_CODEC_H_INCLUDED__
+
+#include "irrTypes.h"
+#include "irrArray.h"
+
+//! Compression of the data chunk the terrain saves its cells and grass in. The codec is a small LZ77 variant 
+//! in the style of LZ4: sequences of literal bytes followed by a copy of earlier output, which decompresses at 
+//! memory speed. Each sequence starts with a token byte, with the amount of literals in the upper and the 
+//! length of the match in the lower 4 bits, longer lengths continue in following bytes. Matches are found 
+//! with a hash table of the last position of each 4 byte sequence.
+class CFlaceTerrainChunkCodec
+{
+public:
+
+	//! compresses size bytes into out
+	static void compress(const irr::u8* src, irr::u32 size, irr::core::array<irr::u8>& out);
+
+	//! decompresses srcSize bytes into dest. Returns false if the data is broken or doesn't 
+	//! decompress to exactly destSize bytes.
+	static bool decompress(const irr::u8* src, irr::u32 srcSize, irr::u8* dest, irr::u32 destSize);
+
+	//! returns the largest compressed size of size bytes, for rejecting broken sizes
+	static irr::f64 getMaxCompressedSize(irr::f64 size) { return size + size / 255.0 + 16.0; }
+
+	//! returns the smallest compressed size of size bytes, a byte expands to at most 255 bytes
+	static irr::f64 getMinCompressedSize(irr::f64 size) { return size / 255.0; }
+
+	//! reads a little endian 32 bit value
+	static inline irr::u32 readU32(const irr::u8* p)
+	{
+		return (irr::u32)p[0] | ((irr::u32)p[1] << 8) | ((irr::u32)p[2] << 16) | ((irr::u32)p[3] << 24);
+	}
+
+	//! appends a little endian 32 bit value
+	static inline void appendU32(irr::core::array<irr::u8>& out, irr::u32 value)
+	{
+		out.push_back((irr::u8)(value & 0xff));
+		out.push_back((irr::u8)((value >> 8) & 0xff));
+		out.push_back((irr::u8)((value >> 16) & 0xff));
+		out.push_back((irr::u8)((value >> 24) & 0xff));
+	}
+
+private:
+
+	static void appendLength(irr::core::array<irr::u8>& out, irr::u32 length);
+	static void appendSequence(irr::core::array<irr::u8>& out, const irr::u8* literals, irr::u32 literalCount, 
+		irr::u32 matchOffset, irr::u32 matchLength);
+	static bool readLength(const irr::u8*& in, const irr::u8* end, irr::u32& length);
+};
+
+#endif
+
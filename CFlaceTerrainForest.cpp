@@ -0,0 +1,1039 @@
+// Copyright (C) 2002-2008 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+// The forest of CFlaceTerrainSceneNode: trees placed with distributeForest(), saved with the terrain, 
+// merged per tile and drawn as impostors when far away.
+
+#include "CFlaceTerrainSceneNode.h"
+#include "IVideoDriver.h"
+#include "IMeshCache.h"
+#include "ISceneManager.h"
+#include "ICameraSceneNode.h"
+#include "os.h"
+#include "CFlaceSerializer.h"
+#include "CFlaceDeserializer.h"
+#include "CFlaceTerrainScatter.h"
+#include <math.h>
+
+using namespace irr;
+using namespace scene;
+
+
+//! writes the names of the forest meshes, the trees are loaded with the meshes of these names again
+static void writeForestMeshName(CFlaceSerializer* serializer, const irr::core::stringc& name)
+{
+	serializer->WriteS32((irr::s32)name.size());
+
+	for (irr::u32 i=0; i<name.size(); i+=4)
+	{
+		irr::u32 word = 0;
+		for (irr::u32 c=0; c<4 && i+c<name.size(); ++c)
+			word |= (irr::u32)(irr::u8)name[i+c] << (c * 8);
+
+		serializer->WriteS32((irr::s32)word);
+	}
+}
+
+
+// limits for rejecting a broken forest before reading it
+static const irr::s32 TERRAIN_FOREST_MAX_NAME_LENGTH = 4096;
+static const irr::s32 TERRAIN_FOREST_MAX_MESHES = 4096;
+static const irr::s32 TERRAIN_FOREST_MAX_INSTANCES = 0x1000000;
+
+//! reads a name written by writeForestMeshName(), returns false if the length is broken
+static bool readForestMeshName(CFlaceDeserializer* deserializer, irr::core::stringc& name)
+{
+	const irr::s32 length = deserializer->ReadS32();
+	if (length < 0 || length > TERRAIN_FOREST_MAX_NAME_LENGTH)
+		return false;
+
+	name = "";
+	name.reserve(length + 1);
+
+	for (irr::s32 i=0; i<length; i+=4)
+	{
+		const irr::u32 word = (irr::u32)deserializer->ReadS32();
+		for (irr::s32 c=0; c<4 && i+c<length; ++c)
+			name.append((irr::c8)((word >> (c * 8)) & 0xff));
+	}
+
+	return true;
+}
+
+
+//! writes the meshes and the trees of the forest
+void CFlaceTerrainSceneNode::writeForest(CFlaceSerializer* serializer)
+{
+	serializer->WriteF32(ForestViewDistance);
+
+	serializer->WriteS32((irr::s32)ForestMeshes.size());
+	for (int i=0; i<(int)ForestMeshes.size(); ++i)
+	{
+		irr::core::stringc name;
+		if (ForestMeshes[i])
+			name = SceneManager->getMeshCache()->getMeshName(ForestMeshes[i]).getPath();
+
+		// trees are saved with the file name of their mesh only
+		if (ForestMeshes[i] && name.empty())
+			irr::os::Printer::log("Forest mesh has no file name, its trees won't be loaded again", irr::ELL_WARNING);
+
+		writeForestMeshName(serializer, name);
+	}
+
+	serializer->WriteS32(getForestInstanceCount());
+	for (int b=0; b<(int)ForestBuckets.size(); ++b)
+		for (int i=0; i<(int)ForestBuckets[b].size(); ++i)
+		{
+			const SForestInstance& t = ForestBuckets[b][i];
+			serializer->WriteS32(t.MeshIndex);
+			serializer->WriteF32(t.PosX);
+			serializer->WriteF32(t.PosZ);
+			serializer->WriteF32(t.Rotation);
+			serializer->WriteF32(t.Scale);
+		}
+}
+
+
+//! reads the forest written by writeForest(), returns false if it is broken. Trees of meshes which can't 
+//! be loaded anymore are left out.
+bool CFlaceTerrainSceneNode::readForest(CFlaceDeserializer* deserializer)
+{
+	clearForest();
+
+	ForestViewDistance = irr::core::max_(deserializer->ReadF32(), 0.0f);
+
+	const irr::s32 meshCount = deserializer->ReadS32();
+	if (meshCount < 0 || meshCount > TERRAIN_FOREST_MAX_MESHES)
+		return false;
+
+	for (int i=0; i<meshCount; ++i)
+	{
+		irr::core::stringc name;
+		if (!readForestMeshName(deserializer, name))
+			return false;
+
+		irr::scene::IAnimatedMesh* mesh = 0;
+		if (!name.empty())
+			mesh = SceneManager->getMesh(name.c_str());
+
+		if (mesh)
+			mesh->grab();
+		else
+			irr::os::Printer::log("Could not load forest mesh, its trees are left out", name.c_str(), irr::ELL_WARNING);
+
+		ForestMeshes.push_back(mesh);
+	}
+
+	const irr::s32 instanceCount = deserializer->ReadS32();
+	if (instanceCount < 0 || instanceCount > TERRAIN_FOREST_MAX_INSTANCES)
+		return false;
+
+	for (int i=0; i<instanceCount; ++i)
+	{
+		SForestInstance t;
+		t.MeshIndex = deserializer->ReadS32();
+		t.PosX = deserializer->ReadF32();
+		t.PosZ = deserializer->ReadF32();
+		t.Rotation = deserializer->ReadF32();
+		t.Scale = deserializer->ReadF32();
+
+		if (t.MeshIndex >= 0 && t.MeshIndex < (irr::s32)ForestMeshes.size() && ForestMeshes[t.MeshIndex])
+			addForestInstance(t);
+	}
+
+	return true;
+}
+
+
+//! returns index of a forest mesh, grabs and adds it if the forest doesn't use it yet
+irr::s32 CFlaceTerrainSceneNode::findForestMeshIndexOrAddNewOne(irr::scene::IAnimatedMesh* mesh)
+{
+	for (int i=0; i<(int)ForestMeshes.size(); ++i)
+		if (ForestMeshes[i] == mesh)
+			return i;
+
+	mesh->grab();
+	ForestMeshes.push_back(mesh);
+
+	return (irr::s32)ForestMeshes.size() - 1;
+}
+
+
+//! makes sure there is one forest bucket and batch per tile, and sorts all trees again if the tile layout changed
+void CFlaceTerrainSceneNode::updateForestBucketLayout()
+{
+	irr::s32 nBucketCount = irr::core::max_(TileCountX * TileCountY, 1);
+
+	if ((irr::s32)ForestBatches.size() != nBucketCount)
+	{
+		clearForestBatches();
+
+		SForestBatch batch;
+		batch.Mesh = 0;
+		batch.Dirty = true;
+		batch.ImpostorMesh = 0;
+		batch.ImpostorAngle = 0.0f;
+		batch.ImpostorDirty = true;
+
+		ForestBatches.reallocate(nBucketCount);
+		for (int b=0; b<nBucketCount; ++b)
+			ForestBatches.push_back(batch);
+	}
+
+	if ((irr::s32)ForestBuckets.size() == nBucketCount)
+		return;
+
+	irr::core::array<SForestInstance> all;
+	all.reallocate(getForestInstanceCount());
+
+	for (int b=0; b<(int)ForestBuckets.size(); ++b)
+		for (int i=0; i<(int)ForestBuckets[b].size(); ++i)
+			all.push_back(ForestBuckets[b][i]);
+
+	ForestBuckets.clear();
+	ForestBuckets.reallocate(nBucketCount);
+	for (int b=0; b<nBucketCount; ++b)
+		ForestBuckets.push_back(irr::core::array<SForestInstance>());
+
+	// the buckets have the same layout as the grass buckets
+	for (int i=0; i<(int)all.size(); ++i)
+		ForestBuckets[getGrassBucketIndex(all[i].PosX, all[i].PosZ)].push_back(all[i]);
+}
+
+
+void CFlaceTerrainSceneNode::addForestInstance(const SForestInstance& instance)
+{
+	updateForestBucketLayout();
+
+	irr::s32 idx = getGrassBucketIndex(instance.PosX, instance.PosZ);
+	ForestBuckets[idx].push_back(instance);
+	markForestBatchDirty(idx);
+}
+
+
+void CFlaceTerrainSceneNode::clearForest()
+{
+	clearForestBatches();
+	clearForestImpostors();
+	ForestBuckets.clear();
+
+	for (int i=0; i<(int)ForestMeshes.size(); ++i)
+		if (ForestMeshes[i])
+			ForestMeshes[i]->drop();
+
+	ForestMeshes.clear();
+}
+
+
+irr::s32 CFlaceTerrainSceneNode::getForestInstanceCount()
+{
+	irr::s32 count = 0;
+
+	for (int b=0; b<(int)ForestBuckets.size(); ++b)
+		count += (irr::s32)ForestBuckets[b].size();
+
+	return count;
+}
+
+
+//! returns the instances of a tile in random order, the same for all batches of the tile. Drawing only the
+//! first part of the instances of a batch then still spreads them evenly over the tile. See renderForest().
+void CFlaceTerrainSceneNode::getForestInstanceOrder(irr::s32 tileIndex, irr::core::array<irr::s32>& outOrder)
+{
+	const irr::core::array<SForestInstance>& bucket = ForestBuckets[tileIndex];
+
+	outOrder.set_used(bucket.size());
+	for (int i=0; i<(int)outOrder.size(); ++i)
+		outOrder[i] = i;
+
+	irr::u32 seed = (irr::u32)tileIndex * 2654435761u + 1;
+	for (int i=(int)outOrder.size()-1; i>0; --i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		irr::s32 j = (irr::s32)((seed >> 8) % (irr::u32)(i+1));
+		irr::core::swap(outOrder[i], outOrder[j]);
+	}
+}
+
+
+//! counts the trees of each mesh of a tile. Trees of meshes which couldn't be loaded are not counted.
+void CFlaceTerrainSceneNode::updateForestInstanceCounts(irr::s32 tileIndex)
+{
+	SForestBatch& batch = ForestBatches[tileIndex];
+	const irr::core::array<SForestInstance>& bucket = ForestBuckets[tileIndex];
+
+	batch.InstancesPerMesh.set_used(ForestMeshes.size());
+	for (int m=0; m<(int)batch.InstancesPerMesh.size(); ++m)
+		batch.InstancesPerMesh[m] = 0;
+
+	for (int i=0; i<(int)bucket.size(); ++i)
+		if (getForestMesh(bucket[i].MeshIndex))
+			++batch.InstancesPerMesh[bucket[i].MeshIndex];
+}
+
+
+//! returns where a tree stands, in world space
+irr::core::vector3df CFlaceTerrainSceneNode::getForestInstancePosition(const SForestInstance& t, irr::scene::IMesh* mesh)
+{
+	irr::core::vector3df pos(t.PosX, getExactTerrainHeightClampedAtPosition(t.PosX, t.PosZ), t.PosZ);
+	pos += Displacement;
+	pos.Y -= mesh->getBoundingBox().getExtent().Y * t.Scale * 0.025f; // so that the tree doesn't float in hills
+
+	return pos;
+}
+
+
+//! returns the mesh of a forest tree, 0 if it couldn't be loaded
+irr::scene::IMesh* CFlaceTerrainSceneNode::getForestMesh(irr::s32 meshIndex)
+{
+	if (meshIndex < 0 || meshIndex >= (irr::s32)ForestMeshes.size() || !ForestMeshes[meshIndex])
+		return 0;
+
+	return ForestMeshes[meshIndex]->getMesh(0);
+}
+
+
+//! merges the trees of a tile into mesh buffers, transformed to their places. IVideoDriver has no hardware
+//! instancing, so every mesh buffer of a tree mesh gets one merged buffer per tile, split only when it
+//! reaches the 16 bit index limit. The trees of a tile are then drawn with one draw call per material.
+void CFlaceTerrainSceneNode::updateForestBatch(irr::s32 tileIndex)
+{
+	SForestBatch& batch = ForestBatches[tileIndex];
+	batch.Dirty = false;
+
+	const irr::core::array<SForestInstance>& bucket = ForestBuckets[tileIndex];
+
+	if (!batch.Mesh)
+	{
+		if (bucket.empty())
+			return;
+
+		batch.Mesh = new irr::scene::SMesh();
+	}
+
+	irr::scene::SMesh* mesh = batch.Mesh;
+
+	for (u32 im=0; im<mesh->MeshBuffers.size(); ++im)
+		if (mesh->MeshBuffers[im])
+			mesh->MeshBuffers[im]->drop();
+	mesh->MeshBuffers.clear();
+	batch.Buffers.clear();
+
+	irr::core::array<irr::s32> order;
+	getForestInstanceOrder(tileIndex, order);
+
+	// transformation of each tree
+
+	updateForestInstanceCounts(tileIndex);
+
+	irr::core::array<irr::core::matrix4> transforms;
+	transforms.set_used(bucket.size());
+
+	for (int i=0; i<(int)bucket.size(); ++i)
+	{
+		const SForestInstance& t = bucket[i];
+
+		irr::scene::IMesh* src = getForestMesh(t.MeshIndex);
+		if (!src)
+			continue;
+
+		irr::core::matrix4 scale;
+		scale.setScale(irr::core::vector3df(t.Scale, t.Scale, t.Scale));
+
+		irr::core::matrix4& transform = transforms[i];
+		transform.setRotationDegrees(irr::core::vector3df(0, t.Rotation, 0));
+		transform *= scale;
+		transform.setTranslation(getForestInstancePosition(t, src));
+	}
+
+	// copy the transformed geometry, mesh by mesh and mesh buffer by mesh buffer
+
+	for (int m=0; m<(int)ForestMeshes.size(); ++m)
+	{
+		if (!batch.InstancesPerMesh[m])
+			continue;
+
+		irr::scene::IMesh* src = getForestMesh(m);
+
+		for (u32 b=0; b<src->getMeshBufferCount(); ++b)
+		{
+			irr::scene::IMeshBuffer* srcBuf = src->getMeshBuffer(b);
+			const irr::u32 vertexCount = srcBuf->getVertexCount();
+			const irr::u32 indexCount = srcBuf->getIndexCount();
+
+			if (!vertexCount || !indexCount || vertexCount > 65536)
+				continue;
+
+			// all vertex types start with the members of S3DVertex
+			const irr::u32 pitch = irr::video::getVertexPitchFromType(srcBuf->getVertexType());
+			const irr::u8* srcVertices = (const irr::u8*)srcBuf->getVertices();
+			const bool indices16 = srcBuf->getIndexType() == irr::video::EIT_16BIT;
+
+			irr::scene::SMeshBuffer* buf = 0;
+			irr::s32 instance = 0; // counted per mesh
+
+			for (int o=0; o<(int)order.size(); ++o)
+			{
+				const irr::s32 i = order[o];
+				if (bucket[i].MeshIndex != m)
+					continue;
+
+				if (!buf || buf->Vertices.size() + vertexCount > 65536)
+				{
+					buf = new irr::scene::SMeshBuffer();
+					buf->Material = srcBuf->getMaterial();
+
+					if (LightingType == ETLT_DYNAMIC)
+						buf->Material.Lighting = true;
+
+					const irr::u32 instances = irr::core::min_((irr::u32)(batch.InstancesPerMesh[m] - instance), 65536 / vertexCount);
+					buf->Vertices.reallocate(instances * vertexCount);
+					buf->Indices.reallocate(instances * indexCount);
+
+					mesh->addMeshBuffer(buf);
+					buf->drop();
+
+					SForestBatchBuffer info;
+					info.MeshIndex = m;
+					info.FirstInstance = instance;
+					info.IndicesPerInstance = indexCount;
+					batch.Buffers.push_back(info);
+				}
+
+				++instance;
+
+				const irr::core::matrix4& transform = transforms[i];
+				const irr::u32 indexStart = buf->Vertices.size();
+
+				for (irr::u32 v=0; v<vertexCount; ++v)
+				{
+					irr::video::S3DVertex vtx = *(const irr::video::S3DVertex*)(srcVertices + v * pitch);
+
+					transform.transformVect(vtx.Pos);
+					transform.rotateVect(vtx.Normal);
+					vtx.Normal.normalize();
+
+					buf->Vertices.push_back(vtx);
+				}
+
+				for (irr::u32 n=0; n<indexCount; ++n)
+				{
+					const irr::u32 index = indices16 ? ((const irr::u16*)srcBuf->getIndices())[n] : 
+						((const irr::u32*)srcBuf->getIndices())[n];
+
+					buf->Indices.push_back((irr::u16)(indexStart + index));
+				}
+			}
+		}
+	}
+
+	for (u32 i=0; i<mesh->MeshBuffers.size(); ++i)
+		mesh->MeshBuffers[i]->recalculateBoundingBox();
+
+	mesh->recalculateBoundingBox();
+}
+
+
+// Impostors: far away trees are drawn as a single quad turned to the camera, showing a picture of the tree.
+// The pictures are rendered once per tree mesh from TERRAIN_IMPOSTOR_VIEWS sides around it into an atlas 
+// texture, and every quad shows the side of the tree which points to the camera.
+
+static const irr::s32 TERRAIN_IMPOSTOR_VIEWS = 8;
+static const irr::s32 TERRAIN_IMPOSTOR_ATLAS_COLUMNS = 4;
+static const irr::s32 TERRAIN_IMPOSTOR_VIEW_SIZE = 128; // pixels per side of the picture of one view
+
+// the quads of a tile are turned to the camera when built, and built again when the camera moved around
+// the tile by more than this angle, in degrees
+static const irr::f32 TERRAIN_IMPOSTOR_REBUILD_ANGLE = 5.0f;
+
+void CFlaceTerrainSceneNode::setForestImpostorDistance(irr::f32 distance, irr::f32 transitionDistance)
+{
+	ForestImpostorDistance = irr::core::max_(distance, 0.0f);
+	ForestImpostorTransitionDistance = irr::core::clamp(transitionDistance, 0.0f, ForestImpostorDistance);
+}
+
+
+//! renders the pictures of all forest meshes which don't have them yet, if impostors are used. 
+//! Done automatically before the forest is drawn, but can be called at load time to avoid the delay later.
+//! Returns if all meshes have their pictures. If not, all trees are drawn in full.
+bool CFlaceTerrainSceneNode::bakeForestImpostors()
+{
+	while (ForestImpostors.size() < ForestMeshes.size())
+	{
+		SForestImpostor imp;
+		imp.Atlas = 0;
+		imp.Radius = 0.0f;
+		imp.MinY = 0.0f;
+		imp.MaxY = 0.0f;
+		imp.Baked = false;
+		ForestImpostors.push_back(imp);
+	}
+
+	if (ForestImpostorDistance <= 0.0f)
+		return false;
+
+	bool available = true;
+
+	for (int m=0; m<(int)ForestImpostors.size(); ++m)
+	{
+		if (!ForestImpostors[m].Baked)
+			bakeForestImpostor(m);
+
+		if (!ForestImpostors[m].Atlas && ForestMeshes[m])
+			available = false;
+	}
+
+	return available;
+}
+
+
+//! renders the views of a forest mesh into its atlas texture. Uses render target textures, which all drivers
+//! including the software renderers support, with orthogonal projection so that the views have no perspective.
+bool CFlaceTerrainSceneNode::bakeForestImpostor(irr::s32 meshIndex)
+{
+	SForestImpostor& imp = ForestImpostors[meshIndex];
+	imp.Baked = true; // also when failing, so it isn't tried again every frame
+
+	irr::scene::IMesh* mesh = getForestMesh(meshIndex);
+	if (!mesh || !Driver || !Driver->queryFeature(irr::video::EVDF_RENDER_TO_TARGET))
+		return false;
+
+	// the quad has to be wide enough for all views around the Y axis
+
+	const irr::core::aabbox3df& box = mesh->getBoundingBox();
+	const irr::f32 maxX = irr::core::max_(fabsf(box.MinEdge.X), fabsf(box.MaxEdge.X));
+	const irr::f32 maxZ = irr::core::max_(fabsf(box.MinEdge.Z), fabsf(box.MaxEdge.Z));
+	const irr::f32 radius = sqrtf(maxX * maxX + maxZ * maxZ);
+	const irr::f32 height = box.MaxEdge.Y - box.MinEdge.Y;
+
+	if (radius <= 0.0f || height <= 0.0f)
+		return false;
+
+	const irr::s32 rows = (TERRAIN_IMPOSTOR_VIEWS + TERRAIN_IMPOSTOR_ATLAS_COLUMNS - 1) / TERRAIN_IMPOSTOR_ATLAS_COLUMNS;
+	const irr::core::dimension2du atlasSize(TERRAIN_IMPOSTOR_ATLAS_COLUMNS * TERRAIN_IMPOSTOR_VIEW_SIZE, rows * TERRAIN_IMPOSTOR_VIEW_SIZE);
+
+	irr::video::ITexture* atlas = Driver->addRenderTargetTexture(atlasSize, "flace_forest_impostor");
+	if (!atlas)
+		return false;
+
+	const irr::core::rect<irr::s32> oldViewPort = Driver->getViewPort();
+	const irr::core::matrix4 oldView = Driver->getTransform(irr::video::ETS_VIEW);
+	const irr::core::matrix4 oldProjection = Driver->getTransform(irr::video::ETS_PROJECTION);
+
+	if (!Driver->setRenderTarget(atlas, true, true, irr::video::SColor(0,0,0,0)))
+	{
+		Driver->removeTexture(atlas);
+		return false;
+	}
+
+	irr::core::matrix4 projection;
+	projection.buildProjectionMatrixOrthoLH(radius * 2.0f, height, radius * 0.5f, radius * 3.5f);
+
+	Driver->setTransform(irr::video::ETS_PROJECTION, projection);
+	Driver->setTransform(irr::video::ETS_WORLD, irr::core::IdentityMatrix);
+
+	const irr::core::vector3df target(0, (box.MinEdge.Y + box.MaxEdge.Y) * 0.5f, 0);
+
+	for (irr::s32 v=0; v<TERRAIN_IMPOSTOR_VIEWS; ++v)
+	{
+		// view v looks from the direction v * 360 / TERRAIN_IMPOSTOR_VIEWS degrees around the Y axis
+
+		const irr::f32 angle = v * (irr::core::PI * 2.0f / TERRAIN_IMPOSTOR_VIEWS);
+		const irr::core::vector3df eye = target + irr::core::vector3df(sinf(angle), 0, cosf(angle)) * (radius * 2.0f);
+
+		irr::core::matrix4 view;
+		view.buildCameraLookAtMatrixLH(eye, target, irr::core::vector3df(0,1,0));
+		Driver->setTransform(irr::video::ETS_VIEW, view);
+
+		const irr::s32 x = (v % TERRAIN_IMPOSTOR_ATLAS_COLUMNS) * TERRAIN_IMPOSTOR_VIEW_SIZE;
+		const irr::s32 y = (v / TERRAIN_IMPOSTOR_ATLAS_COLUMNS) * TERRAIN_IMPOSTOR_VIEW_SIZE;
+		Driver->setViewPort(irr::core::rect<irr::s32>(x, y, x + TERRAIN_IMPOSTOR_VIEW_SIZE, y + TERRAIN_IMPOSTOR_VIEW_SIZE));
+
+		// unlit, so the views only hold the colors of the tree. The impostors are lit like the trees.
+
+		for (u32 b=0; b<mesh->getMeshBufferCount(); ++b)
+		{
+			irr::scene::IMeshBuffer* buf = mesh->getMeshBuffer(b);
+
+			irr::video::SMaterial material = buf->getMaterial();
+			material.Lighting = false;
+
+			Driver->setMaterial(material);
+			Driver->drawMeshBuffer(buf);
+		}
+	}
+
+	Driver->setRenderTarget(0, false, false);
+	Driver->setViewPort(oldViewPort);
+	Driver->setTransform(irr::video::ETS_VIEW, oldView);
+	Driver->setTransform(irr::video::ETS_PROJECTION, oldProjection);
+
+	// render targets lose their content when the device is reset, like after resizing the window with 
+	// Direct3D. So the views are copied into a normal texture, if the driver can read the render target.
+
+	irr::video::IImage* image = Driver->createImage(atlas, irr::core::position2d<irr::s32>(0,0), atlasSize);
+	if (image)
+	{
+		irr::video::ITexture* copy = Driver->addTexture("flace_forest_impostor_views", image);
+		image->drop();
+
+		if (copy)
+		{
+			Driver->removeTexture(atlas);
+			atlas = copy;
+		}
+	}
+
+	imp.Atlas = atlas;
+	imp.Radius = radius;
+	imp.MinY = box.MinEdge.Y;
+	imp.MaxY = box.MaxEdge.Y;
+
+	return true;
+}
+
+
+void CFlaceTerrainSceneNode::clearForestImpostors()
+{
+	for (int i=0; i<(int)ForestImpostors.size(); ++i)
+		if (ForestImpostors[i].Atlas && Driver)
+			Driver->removeTexture(ForestImpostors[i].Atlas);
+
+	ForestImpostors.clear();
+}
+
+
+//! returns the direction from a tile to a position around the Y axis, in degrees
+irr::f32 CFlaceTerrainSceneNode::getTerrainTileAngleTo(irr::s32 tileIndex, const irr::core::vector3df& pos)
+{
+	const irr::s32 tileX = tileIndex % TileCountX;
+	const irr::s32 tileY = tileIndex / TileCountX;
+
+	irr::core::vector3df center = getTerrain3DPositionClamped(tileX * CellsPerTileSide + CellsPerTileSide / 2, 
+		tileY * CellsPerTileSide + CellsPerTileSide / 2);
+
+	return atan2f(pos.X - center.X, pos.Z - center.Z) * irr::core::RADTODEG;
+}
+
+
+//! builds the impostor quads of the trees of a tile, each turned to the camera position
+void CFlaceTerrainSceneNode::updateForestImpostorBatch(irr::s32 tileIndex, const irr::core::vector3df& camPos)
+{
+	SForestBatch& batch = ForestBatches[tileIndex];
+	batch.ImpostorDirty = false;
+	batch.ImpostorAngle = getTerrainTileAngleTo(tileIndex, camPos);
+
+	const irr::core::array<SForestInstance>& bucket = ForestBuckets[tileIndex];
+
+	if (!batch.ImpostorMesh)
+	{
+		if (bucket.empty())
+			return;
+
+		batch.ImpostorMesh = new irr::scene::SMesh();
+	}
+
+	irr::scene::SMesh* mesh = batch.ImpostorMesh;
+
+	for (u32 im=0; im<mesh->MeshBuffers.size(); ++im)
+		if (mesh->MeshBuffers[im])
+			mesh->MeshBuffers[im]->drop();
+	mesh->MeshBuffers.clear();
+	batch.ImpostorBuffers.clear();
+
+	// same order as the trees in the mesh batch, see renderForest()
+
+	updateForestInstanceCounts(tileIndex);
+
+	irr::core::array<irr::s32> order;
+	getForestInstanceOrder(tileIndex, order);
+
+	const irr::f32 viewAngle = 360.0f / TERRAIN_IMPOSTOR_VIEWS;
+	const irr::s32 rows = (TERRAIN_IMPOSTOR_VIEWS + TERRAIN_IMPOSTOR_ATLAS_COLUMNS - 1) / TERRAIN_IMPOSTOR_ATLAS_COLUMNS;
+
+	for (int m=0; m<(int)ForestImpostors.size() && m<(int)ForestMeshes.size(); ++m)
+	{
+		const SForestImpostor& imp = ForestImpostors[m];
+		irr::scene::IMesh* src = getForestMesh(m);
+		if (!imp.Atlas || !src)
+			continue;
+
+		irr::scene::SMeshBuffer* buf = 0;
+		irr::s32 instance = 0; // counted per mesh, like in the mesh batch
+
+		// lit when the merged trees are, so they don't change their brightness when switching. The quad 
+		// has one upwards normal, so this only matches the average lighting of the tree.
+		const bool lit = LightingType == ETLT_DYNAMIC || 
+			(src->getMeshBufferCount() && src->getMeshBuffer(0)->getMaterial().Lighting);
+
+		for (int o=0; o<(int)order.size(); ++o)
+		{
+			const SForestInstance& t = bucket[order[o]];
+			if (t.MeshIndex != m)
+				continue;
+
+			if (!buf || buf->Vertices.size() + 4 > 65536)
+			{
+				buf = new irr::scene::SMeshBuffer();
+				buf->Material.MaterialType = irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+				buf->Material.MaterialTypeParam = 0.5f;
+				buf->Material.BackfaceCulling = false;
+				buf->Material.Lighting = lit;
+				buf->Material.setTexture(0, imp.Atlas);
+
+				mesh->addMeshBuffer(buf);
+				buf->drop();
+
+				SForestBatchBuffer info;
+				info.MeshIndex = m;
+				info.FirstInstance = instance;
+				info.IndicesPerInstance = 6;
+				batch.ImpostorBuffers.push_back(info);
+			}
+
+			++instance;
+
+			const irr::core::vector3df pos = getForestInstancePosition(t, src);
+
+			// the quad faces the camera, and shows the view from the side of the tree pointing to it
+
+			const irr::f32 angle = atan2f(camPos.X - pos.X, camPos.Z - pos.Z);
+			const irr::core::vector3df right(-cosf(angle) * imp.Radius * t.Scale, 0, sinf(angle) * imp.Radius * t.Scale);
+
+			irr::f32 treeAngle = fmodf(angle * irr::core::RADTODEG - t.Rotation, 360.0f);
+			if (treeAngle < 0.0f)
+				treeAngle += 360.0f;
+
+			const irr::s32 view = (irr::s32)(treeAngle / viewAngle + 0.5f) % TERRAIN_IMPOSTOR_VIEWS;
+			const irr::f32 u0 = (view % TERRAIN_IMPOSTOR_ATLAS_COLUMNS) / (irr::f32)TERRAIN_IMPOSTOR_ATLAS_COLUMNS;
+			const irr::f32 v0 = (view / TERRAIN_IMPOSTOR_ATLAS_COLUMNS) / (irr::f32)rows;
+			const irr::f32 u1 = u0 + 1.0f / TERRAIN_IMPOSTOR_ATLAS_COLUMNS;
+			const irr::f32 v1 = v0 + 1.0f / rows;
+
+			const irr::f32 bottom = pos.Y + imp.MinY * t.Scale;
+			const irr::f32 top = pos.Y + imp.MaxY * t.Scale;
+			const irr::video::SColor white = video::DefaultWhiteColor;
+			const irr::core::vector3df up(0,1,0);
+
+			const irr::u16 indexStart = (irr::u16)buf->Vertices.size();
+
+			buf->Vertices.push_back(irr::video::S3DVertex(pos.X - right.X, bottom, pos.Z - right.Z, up.X, up.Y, up.Z, white, u0, v1));
+			buf->Vertices.push_back(irr::video::S3DVertex(pos.X + right.X, bottom, pos.Z + right.Z, up.X, up.Y, up.Z, white, u1, v1));
+			buf->Vertices.push_back(irr::video::S3DVertex(pos.X - right.X, top, pos.Z - right.Z, up.X, up.Y, up.Z, white, u0, v0));
+			buf->Vertices.push_back(irr::video::S3DVertex(pos.X + right.X, top, pos.Z + right.Z, up.X, up.Y, up.Z, white, u1, v0));
+
+			const int indices[] = {2,1,0, 2,3,1};
+			for (int ind=0; ind<6; ++ind)
+				buf->Indices.push_back(indexStart + indices[ind]);
+		}
+	}
+
+	for (u32 i=0; i<mesh->MeshBuffers.size(); ++i)
+		mesh->MeshBuffers[i]->recalculateBoundingBox();
+
+	mesh->recalculateBoundingBox();
+}
+
+
+void CFlaceTerrainSceneNode::markForestBatchDirty(irr::s32 tileIndex)
+{
+	if (tileIndex >= 0 && tileIndex < (irr::s32)ForestBatches.size())
+	{
+		ForestBatches[tileIndex].Dirty = true;
+		ForestBatches[tileIndex].ImpostorDirty = true;
+	}
+}
+
+
+//! drops the merged trees and impostors of a tile, they are built again when needed
+void CFlaceTerrainSceneNode::releaseForestBatch(irr::s32 tileIndex)
+{
+	if (tileIndex < 0 || tileIndex >= (irr::s32)ForestBatches.size())
+		return;
+
+	releaseForestMeshBatch(ForestBatches[tileIndex]);
+	releaseForestImpostorBatch(ForestBatches[tileIndex]);
+}
+
+
+void CFlaceTerrainSceneNode::releaseForestMeshBatch(SForestBatch& batch)
+{
+	if (batch.Mesh)
+		batch.Mesh->drop();
+	batch.Mesh = 0;
+	batch.Buffers.clear();
+	batch.Dirty = true;
+}
+
+
+void CFlaceTerrainSceneNode::releaseForestImpostorBatch(SForestBatch& batch)
+{
+	if (batch.ImpostorMesh)
+		batch.ImpostorMesh->drop();
+	batch.ImpostorMesh = 0;
+	batch.ImpostorBuffers.clear();
+	batch.ImpostorDirty = true;
+}
+
+
+void CFlaceTerrainSceneNode::clearForestBatches()
+{
+	for (int i=0; i<(int)ForestBatches.size(); ++i)
+		releaseForestBatch(i);
+
+	ForestBatches.clear();
+}
+
+
+//! returns the horizontal distance of a position to the nearest point of a tile
+irr::f32 CFlaceTerrainSceneNode::getTerrainTileDistanceXZ(irr::s32 tileIndex, const irr::core::vector3df& pos)
+{
+	const irr::s32 tileX = tileIndex % TileCountX;
+	const irr::s32 tileY = tileIndex / TileCountX;
+
+	irr::core::vector3df p1 = getTerrain3DPositionClamped(tileX * CellsPerTileSide, tileY * CellsPerTileSide);
+	irr::core::vector3df p2 = getTerrain3DPositionClamped((tileX+1) * CellsPerTileSide, (tileY+1) * CellsPerTileSide);
+
+	const irr::f32 dx = irr::core::clamp(pos.X, p1.X, p2.X) - pos.X;
+	const irr::f32 dz = irr::core::clamp(pos.Z, p1.Z, p2.Z) - pos.Z;
+
+	return sqrtf(dx * dx + dz * dz);
+}
+
+
+//! builds the merged trees and impostors of the tiles needing them, releases the ones of tiles too far away 
+//! for them, and returns if there are any trees to render
+bool CFlaceTerrainSceneNode::updateForestBatches()
+{
+	if (ForestMeshes.empty())
+		return false;
+
+	if ((irr::s32)TerrainHeights.size() != CellCountX * CellCountY)
+		return false; // no heights to place the trees on
+
+	updateForestBucketLayout();
+	const bool useImpostors = bakeForestImpostors();
+
+	ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera)
+		return false;
+
+	const irr::core::vector3df camPos = camera->getAbsolutePosition();
+	const irr::f32 impostorStart = ForestImpostorDistance - ForestImpostorTransitionDistance;
+
+	bool hasForest = false;
+
+	for (int i=0; i<(int)ForestBatches.size(); ++i)
+	{
+		SForestBatch& batch = ForestBatches[i];
+		if (!batch.Mesh && !batch.ImpostorMesh && ForestBuckets[i].empty())
+			continue;
+
+		// things are released only when a bit farther away than needed, like paging regions, so tiles at 
+		// a border aren't built again every frame when the camera moves a little
+
+		const irr::f32 distance = getTerrainTileDistanceXZ(i, camPos);
+
+		if (ForestViewDistance > 0.0f && distance > ForestViewDistance * TERRAIN_PAGING_RELEASE_FACTOR)
+		{
+			releaseForestBatch(i);
+			continue;
+		}
+
+		const bool visible = ForestViewDistance <= 0.0f || distance <= ForestViewDistance;
+		const bool resident = isTerrainTileResident(i);
+
+		// full trees up to the end of the impostor transition band
+
+		if (useImpostors && distance > ForestImpostorDistance * TERRAIN_PAGING_RELEASE_FACTOR)
+			releaseForestMeshBatch(batch);
+		else
+		if (resident && batch.Dirty && (batch.Mesh || (visible && (!useImpostors || distance <= ForestImpostorDistance))))
+			updateForestBatch(i);
+
+		// impostors from the start of the transition band
+
+		if (!useImpostors || distance * TERRAIN_PAGING_RELEASE_FACTOR < impostorStart)
+			releaseForestImpostorBatch(batch);
+		else
+		if (resident && (batch.ImpostorMesh || (visible && distance >= impostorStart)))
+		{
+			if (batch.ImpostorMesh && !batch.ImpostorDirty)
+			{
+				const irr::f32 turned = fabsf(fmodf(getTerrainTileAngleTo(i, camPos) - batch.ImpostorAngle + 540.0f, 360.0f) - 180.0f);
+				if (turned > TERRAIN_IMPOSTOR_REBUILD_ANGLE)
+					batch.ImpostorDirty = true;
+			}
+
+			if (batch.ImpostorDirty)
+				updateForestImpostorBatch(i, camPos);
+		}
+
+		if ((batch.Mesh && batch.Mesh->getMeshBufferCount()) || (batch.ImpostorMesh && batch.ImpostorMesh->getMeshBufferCount()))
+			hasForest = true;
+	}
+
+	return hasForest;
+}
+
+
+//! returns which part of the trees of a tile is drawn as impostors, from 0 (none) to 1 (all)
+irr::f32 CFlaceTerrainSceneNode::getForestImpostorPartForDistance(irr::f32 distance)
+{
+	if (ForestImpostorDistance <= 0.0f)
+		return 0.0f;
+
+	if (distance >= ForestImpostorDistance)
+		return 1.0f;
+
+	const irr::f32 transitionStart = ForestImpostorDistance - ForestImpostorTransitionDistance;
+
+	if (ForestImpostorTransitionDistance <= 0.0f || distance <= transitionStart)
+		return 0.0f;
+
+	return (distance - transitionStart) / ForestImpostorTransitionDistance;
+}
+
+
+//! draws the instances of a forest batch from firstPart to lastPart of the instances of each mesh, 
+//! with the parts from 0 to 1. Instances are stored in random order, so every part is an even thinned out set.
+void CFlaceTerrainSceneNode::drawForestBatchPart(irr::video::IVideoDriver* driver, irr::scene::SMesh* mesh, 
+												 const irr::core::array<SForestBatchBuffer>& buffers,
+												 const irr::core::array<irr::s32>& instancesPerMesh, 
+												 irr::f32 firstPart, irr::f32 lastPart)
+{
+	for (u32 b=0; b<mesh->MeshBuffers.size() && b<buffers.size(); ++b)
+	{
+		irr::scene::IMeshBuffer* buf = mesh->MeshBuffers[b];
+		const SForestBatchBuffer& info = buffers[b];
+
+		if (info.MeshIndex < 0 || info.MeshIndex >= (irr::s32)instancesPerMesh.size() || !info.IndicesPerInstance)
+			continue;
+
+		const irr::s32 meshInstances = instancesPerMesh[info.MeshIndex];
+		const irr::s32 bufInstances = (irr::s32)(buf->getIndexCount() / info.IndicesPerInstance);
+
+		const irr::s32 first = irr::core::clamp((irr::s32)(meshInstances * firstPart + 0.5f) - info.FirstInstance, 0, bufInstances);
+		const irr::s32 last = irr::core::clamp((irr::s32)(meshInstances * lastPart + 0.5f) - info.FirstInstance, 0, bufInstances);
+
+		if (last <= first)
+			continue;
+
+		driver->setMaterial(buf->getMaterial());
+
+		if (first == 0 && last == bufInstances)
+		{
+			driver->drawMeshBuffer(buf);
+			continue;
+		}
+
+		driver->drawVertexPrimitiveList(buf->getVertices(), buf->getVertexCount(),
+			(const irr::u16*)buf->getIndices() + first * info.IndicesPerInstance, (last - first) * info.IndicesPerInstance / 3,
+			buf->getVertexType(), irr::scene::EPT_TRIANGLES, buf->getIndexType());
+	}
+}
+
+
+void CFlaceTerrainSceneNode::renderForest(irr::video::IVideoDriver* driver, irr::scene::ICameraSceneNode* camera)
+{
+	const irr::core::aabbox3df& frustumBox = camera->getViewFrustum()->getBoundingBox();
+	const irr::core::vector3df camPos = camera->getAbsolutePosition();
+
+	for (int i=0; i<(int)ForestBatches.size(); ++i)
+	{
+		SForestBatch& batch = ForestBatches[i];
+
+		irr::scene::SMesh* mesh = batch.Mesh;
+		if (mesh && !mesh->getMeshBufferCount())
+			mesh = 0;
+
+		irr::scene::SMesh* impostors = batch.ImpostorMesh;
+		if (impostors && !impostors->getMeshBufferCount())
+			impostors = 0;
+
+		if (!mesh && !impostors)
+			continue;
+
+		irr::core::aabbox3df box = mesh ? mesh->getBoundingBox() : impostors->getBoundingBox();
+		if (mesh && impostors)
+			box.addInternalBox(impostors->getBoundingBox());
+
+		if (!frustumBox.intersectsWithBox(box))
+			continue;
+
+		irr::core::vector3df nearest(irr::core::clamp(camPos.X, box.MinEdge.X, box.MaxEdge.X),
+									 irr::core::clamp(camPos.Y, box.MinEdge.Y, box.MaxEdge.Y),
+									 irr::core::clamp(camPos.Z, box.MinEdge.Z, box.MaxEdge.Z));
+
+		const irr::f32 distance = nearest.getDistanceFrom(camPos);
+
+		if (ForestViewDistance > 0.0f && distance > ForestViewDistance)
+			continue;
+
+		// in the transition band, the first part of the trees is drawn in full and the rest as impostors.
+		// Whatever isn't built yet is replaced by the other one.
+
+		irr::f32 impostorPart = getForestImpostorPartForDistance(distance);
+		if (!impostors)
+			impostorPart = 0.0f;
+		if (!mesh)
+			impostorPart = 1.0f;
+
+		if (impostorPart < 1.0f)
+			drawForestBatchPart(driver, mesh, batch.Buffers, batch.InstancesPerMesh, 0.0f, 1.0f - impostorPart);
+
+		if (impostorPart > 0.0f)
+			drawForestBatchPart(driver, impostors, batch.ImpostorBuffers, batch.InstancesPerMesh, 1.0f - impostorPart, 1.0f);
+	}
+}
+
+
+//! places trees as forest instances. Unlike distributeMeshes() there is no limit for the amount of trees, 
+//! they don't cost a scene node each.
+void CFlaceTerrainSceneNode::distributeForest(irr::scene::IAnimatedMesh* tree, irr::f32 distribution, irr::u32 seed)
+{
+	if (!tree || distribution < 0.001f)
+		return;
+
+	irr::scene::IMesh* mesh = tree->getMesh(0);
+	if (!mesh)
+		return;
+
+	if (SideLength <= CellSize)
+		return;
+
+	irr::core::aabbox3df box = mesh->getBoundingBox();
+
+	float treeWidth = box.getExtent().X;
+	float treeDepth = box.getExtent().Z;
+
+	if (treeWidth < 1) treeWidth = 1;
+	if (treeDepth < 1) treeDepth = 1;
+
+	if (!seed)
+		seed = (irr::u32)irr::os::Randomizer::rand();
+
+	const irr::f32 size = (irr::f32)(SideLength - CellSize);
+	const irr::f32 density = distribution / (treeWidth * treeDepth);
+
+	irr::core::array<CFlaceTerrainScatter::SPoint> points;
+	CFlaceTerrainScatter::scatter(size, size, CFlaceTerrainScatter::getDistanceForDensity(density), seed, points);
+
+	if (points.empty())
+		return;
+
+	const irr::s32 meshIndex = findForestMeshIndexOrAddNewOne(tree);
+
+	for (int i=0; i<(int)points.size(); ++i)
+	{
+		SForestInstance t;
+		t.MeshIndex = meshIndex;
+		t.PosX = points[i].X;
+		t.PosZ = points[i].Z;
+		t.Rotation = (points[i].Random % 36000) / 100.0f;
+		t.Scale = 1.0f;
+
+		addForestInstance(t);
+	}
+}
@@ -0,0 +1,360 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainGenerator.h"
+#include "CFlaceWorkerPool.h"
+#include "irrMath.h"
+#include <math.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _FLACE_TERRAIN_GENERATOR_USE_SSE2_
+#include <emmintrin.h>
+#endif
+
+// stream of the random values used for the tables, the rows use their row index as stream
+static const irr::u32 TERRAIN_GENERATOR_TABLE_STREAM = 0xffffffffu;
+
+// gradients of the perlin noise, selected by the lowest 3 bits of the hash of a grid point
+static const irr::f32 PerlinGradientX[8] = { 1.0f, -1.0f,  1.0f, -1.0f, 1.0f, -1.0f, 0.0f,  0.0f };
+static const irr::f32 PerlinGradientY[8] = { 1.0f,  1.0f, -1.0f, -1.0f, 0.0f,  0.0f, 1.0f, -1.0f };
+
+
+static inline irr::f32 fadePerlin(irr::f32 t)
+{
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+
+//! 2d perlin noise, between about -1 and 1. x and y must not be negative.
+static irr::f32 getPerlinNoise(const irr::u8* perm, irr::f32 x, irr::f32 y)
+{
+	const irr::s32 ix = (irr::s32)x;
+	const irr::s32 iy = (irr::s32)y;
+	const irr::f32 fx = x - (irr::f32)ix;
+	const irr::f32 fy = y - (irr::f32)iy;
+	const irr::s32 px = ix & 255;
+	const irr::s32 py = iy & 255;
+
+	const irr::s32 g00 = perm[perm[px] + py] & 7;
+	const irr::s32 g10 = perm[perm[px + 1] + py] & 7;
+	const irr::s32 g01 = perm[perm[px] + py + 1] & 7;
+	const irr::s32 g11 = perm[perm[px + 1] + py + 1] & 7;
+
+	const irr::f32 n00 = PerlinGradientX[g00] * fx + PerlinGradientY[g00] * fy;
+	const irr::f32 n10 = PerlinGradientX[g10] * (fx - 1.0f) + PerlinGradientY[g10] * fy;
+	const irr::f32 n01 = PerlinGradientX[g01] * fx + PerlinGradientY[g01] * (fy - 1.0f);
+	const irr::f32 n11 = PerlinGradientX[g11] * (fx - 1.0f) + PerlinGradientY[g11] * (fy - 1.0f);
+
+	const irr::f32 u = fadePerlin(fx);
+	const irr::f32 v = fadePerlin(fy);
+	const irr::f32 nx0 = n00 + u * (n10 - n00);
+	const irr::f32 nx1 = n01 + u * (n11 - n01);
+
+	return nx0 + v * (nx1 - nx0);
+}
+
+
+#ifdef _FLACE_TERRAIN_GENERATOR_USE_SSE2_
+
+//! perlin noise at 4 positions of the same row. Does the same operations as getPerlinNoise(), in the same
+//! order, so the results are exactly the same. Only the gradients are read one by one, SSE2 has no gather.
+static __m128 getPerlinNoise4(const irr::u8* perm, __m128 x, irr::f32 y)
+{
+	const __m128i ix = _mm_cvttps_epi32(x);
+	const __m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(ix));
+
+	const irr::s32 iy = (irr::s32)y;
+	const irr::f32 fy = y - (irr::f32)iy;
+	const irr::s32 py = iy & 255;
+
+	irr::s32 cellX[4];
+	_mm_storeu_si128((__m128i*)cellX, ix);
+
+	irr::f32 gx00[4], gy00[4], gx10[4], gy10[4], gx01[4], gy01[4], gx11[4], gy11[4];
+	for (int k=0; k<4; ++k)
+	{
+		const irr::s32 px = cellX[k] & 255;
+		const irr::s32 g00 = perm[perm[px] + py] & 7;
+		const irr::s32 g10 = perm[perm[px + 1] + py] & 7;
+		const irr::s32 g01 = perm[perm[px] + py + 1] & 7;
+		const irr::s32 g11 = perm[perm[px + 1] + py + 1] & 7;
+
+		gx00[k] = PerlinGradientX[g00]; gy00[k] = PerlinGradientY[g00];
+		gx10[k] = PerlinGradientX[g10]; gy10[k] = PerlinGradientY[g10];
+		gx01[k] = PerlinGradientX[g01]; gy01[k] = PerlinGradientY[g01];
+		gx11[k] = PerlinGradientX[g11]; gy11[k] = PerlinGradientY[g11];
+	}
+
+	const __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.0f));
+	const __m128 vfy = _mm_set1_ps(fy);
+	const __m128 vfy1 = _mm_set1_ps(fy - 1.0f);
+
+	const __m128 n00 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx00), fx), _mm_mul_ps(_mm_loadu_ps(gy00), vfy));
+	const __m128 n10 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx10), fx1), _mm_mul_ps(_mm_loadu_ps(gy10), vfy));
+	const __m128 n01 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx01), fx), _mm_mul_ps(_mm_loadu_ps(gy01), vfy1));
+	const __m128 n11 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(gx11), fx1), _mm_mul_ps(_mm_loadu_ps(gy11), vfy1));
+
+	// fade: t * t * t * (t * (t * 6 - 15) + 10)
+
+	const __m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(fx, fx), fx),
+		_mm_add_ps(_mm_mul_ps(fx, _mm_sub_ps(_mm_mul_ps(fx, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f)));
+	const __m128 v = _mm_set1_ps(fadePerlin(fy));
+
+	const __m128 nx0 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+	const __m128 nx1 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+
+	return _mm_add_ps(nx0, _mm_mul_ps(v, _mm_sub_ps(nx1, nx0)));
+}
+
+#endif // _FLACE_TERRAIN_GENERATOR_USE_SSE2_
+
+
+//! generates bands of rows of the terrain on the worker threads
+class CFlaceTerrainGeneratorJob : public IFlaceParallelJob
+{
+public:
+
+	CFlaceTerrainGeneratorJob(const CFlaceTerrainGenerator& generator, irr::f32* const* rows, irr::s32 height, irr::s32 rowsPerPart)
+		: Generator(generator), Rows(rows), Height(height), RowsPerPart(rowsPerPart)
+	{
+	}
+
+	virtual void runJobPart(irr::s32 partIndex)
+	{
+		const irr::s32 firstRow = partIndex * RowsPerPart;
+		const irr::s32 endRow = irr::core::min_(firstRow + RowsPerPart, Height);
+
+		for (irr::s32 y=firstRow; y<endRow; ++y)
+			Generator.generateRow(Rows[y], y);
+	}
+
+private:
+
+	const CFlaceTerrainGenerator& Generator;
+	irr::f32* const* Rows;
+	irr::s32 Height;
+	irr::s32 RowsPerPart;
+};
+
+
+//! constructor
+CFlaceTerrainGenerator::CFlaceTerrainGenerator(E_TERRAIN_TOPOLOGY topology, irr::u32 seed, irr::f32 cellSize, irr::f32 maxHeight)
+: Topology(topology), Seed(seed), CellSize(cellSize), MaxHeight(maxHeight), Width(0), OctaveCount(0), AmplitudeSum(1.0f)
+{
+}
+
+
+//! calculates the heights of all cells
+void CFlaceTerrainGenerator::generate(irr::f32* const* rows, irr::s32 width, irr::s32 height)
+{
+	if (!rows || width <= 0 || height <= 0)
+		return;
+
+	Width = width;
+
+	// set up the tables used by all rows
+
+	if (Topology == ETT_HILLS || Topology == ETT_DESERT)
+	{
+		const irr::f32 oneMeter = 10.0f;
+
+		RipplesX.set_used(width);
+		HillsX.set_used(width);
+
+		for (irr::s32 x=0; x<width; ++x)
+		{
+			const irr::f32 px = x * CellSize / oneMeter;
+			RipplesX[x] = sinf(px / (1000.0f / 925.0f));
+			HillsX[x] = sinf(px / (1000.0f / 150.0f)) * MaxHeight;
+		}
+	}
+	else
+	if (Topology == ETT_NOISE_FBM || Topology == ETT_NOISE_RIDGED)
+	{
+		STerrainGeneratorRandom random(Seed, TERRAIN_GENERATOR_TABLE_STREAM);
+
+		for (irr::s32 i=0; i<256; ++i)
+			Permutation[i] = (irr::u8)i;
+
+		for (irr::s32 i=255; i>0; --i)
+		{
+			const irr::s32 j = (irr::s32)(random.next() % (irr::u32)(i + 1));
+			const irr::u8 t = Permutation[i];
+			Permutation[i] = Permutation[j];
+			Permutation[j] = t;
+		}
+
+		for (irr::s32 i=0; i<256; ++i)
+			Permutation[256 + i] = Permutation[i];
+
+		// the largest features are a third of the terrain, every octave halves them until they are smaller than two cells
+
+		irr::f32 wavelength = irr::core::max_(irr::core::max_(width, height) / 3.0f, 8.0f);
+		irr::f32 amplitude = 1.0f;
+
+		OctaveCount = 0;
+		AmplitudeSum = 0.0f;
+
+		while (OctaveCount < TERRAIN_GENERATOR_MAX_OCTAVES && wavelength >= 2.0f)
+		{
+			OctaveFrequency[OctaveCount] = 1.0f / wavelength;
+			OctaveAmplitude[OctaveCount] = amplitude;
+			OctaveOffsetX[OctaveCount] = (random.next() & 0xffff) / 256.0f;
+			OctaveOffsetY[OctaveCount] = (random.next() & 0xffff) / 256.0f;
+			AmplitudeSum += amplitude;
+
+			++OctaveCount;
+			wavelength *= 0.5f;
+			amplitude *= 0.5f;
+		}
+	}
+
+	// every row only writes its own heights, so bands of rows can be done on all cores
+
+	CFlaceWorkerPool* pool = CFlaceWorkerPool::getSharedPool();
+
+	irr::s32 partCount = 1;
+	if (width * height >= 64 * 64)
+		partCount = irr::core::min_(pool->getThreadCount() * 4, height);
+
+	const irr::s32 rowsPerPart = (height + partCount - 1) / partCount;
+	partCount = (height + rowsPerPart - 1) / rowsPerPart;
+
+	CFlaceTerrainGeneratorJob job(*this, rows, height, rowsPerPart);
+	pool->runParallel(&job, partCount);
+}
+
+
+//! calculates the heights of one row
+void CFlaceTerrainGenerator::generateRow(irr::f32* out, irr::s32 y) const
+{
+	switch(Topology)
+	{
+	case ETT_HILLS:
+	case ETT_DESERT:
+		generateWaveRow(out, y);
+		break;
+	case ETT_NOISE_FBM:
+	case ETT_NOISE_RIDGED:
+		generateNoiseRow(out, y);
+		break;
+	default:
+		for (irr::s32 x=0; x<Width; ++x)
+			out[x] = 0.0f;
+		break;
+	}
+}
+
+
+//! hills and desert, waves of two sizes along x and y
+void CFlaceTerrainGenerator::generateWaveRow(irr::f32* out, irr::s32 y) const
+{
+	const irr::f32 oneMeter = 10.0f;
+	const irr::f32 py = y * CellSize / oneMeter;
+
+	const irr::f32 rippleY = cosf(py / (1000.0f / 925.0f));
+	const irr::f32 hillY = cosf(py / (1000.0f / 150.0f)) * MaxHeight;
+
+	STerrainGeneratorRandom random(Seed, (irr::u32)y);
+
+	for (irr::s32 x=0; x<Width; ++x)
+	{
+		// tiny rippling effect and bigger hills
+		const irr::f32 ripple = (RipplesX[x] + rippleY) / 2.0f;
+		const irr::f32 hill = Topology == ETT_DESERT ? HillsX[x] + hillY / 2.0f : (HillsX[x] + hillY) / 2.0f;
+
+		irr::f32 height = irr::core::clamp(hill + ripple * oneMeter * 1.1f, 0.0f, MaxHeight);
+
+		// small bumps on the ground between the hills
+		if (height < MaxHeight / 100.0f)
+			height += ripple * oneMeter * 0.2f + ((random.next() % 1000) / oneMeter * 0.03f);
+
+		out[x] = height;
+	}
+}
+
+
+//! fbm and ridged noise, made of octaves of perlin noise
+void CFlaceTerrainGenerator::generateNoiseRow(irr::f32* out, irr::s32 y) const
+{
+	const bool ridged = Topology == ETT_NOISE_RIDGED;
+	const irr::f32 invAmplitudeSum = 1.0f / AmplitudeSum;
+
+	irr::s32 x = 0;
+
+#ifdef _FLACE_TERRAIN_GENERATOR_USE_SSE2_
+
+	// 4 cells at a time
+
+	const __m128 vZero = _mm_setzero_ps();
+	const __m128 vOne = _mm_set1_ps(1.0f);
+	const __m128 vTwo = _mm_set1_ps(2.0f);
+	const __m128 vHalf = _mm_set1_ps(0.5f);
+	const __m128 vSignMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 vInvAmplitudeSum = _mm_set1_ps(invAmplitudeSum);
+	const __m128 vMaxHeight = _mm_set1_ps(MaxHeight);
+
+	for (; x+4 <= Width; x+=4)
+	{
+		const __m128 cellX = _mm_set_ps((irr::f32)(x + 3), (irr::f32)(x + 2), (irr::f32)(x + 1), (irr::f32)x);
+
+		__m128 sum = vZero;
+		__m128 weight = vOne;
+
+		for (irr::s32 o=0; o<OctaveCount; ++o)
+		{
+			const __m128 px = _mm_add_ps(_mm_mul_ps(cellX, _mm_set1_ps(OctaveFrequency[o])), _mm_set1_ps(OctaveOffsetX[o]));
+			const __m128 n = getPerlinNoise4(Permutation, px, y * OctaveFrequency[o] + OctaveOffsetY[o]);
+
+			if (ridged)
+			{
+				__m128 r = _mm_sub_ps(vOne, _mm_andnot_ps(vSignMask, n));
+				r = _mm_mul_ps(_mm_mul_ps(r, r), weight);
+				weight = _mm_min_ps(_mm_max_ps(_mm_mul_ps(r, vTwo), vZero), vOne);
+				sum = _mm_add_ps(sum, _mm_mul_ps(r, _mm_set1_ps(OctaveAmplitude[o])));
+			}
+			else
+				sum = _mm_add_ps(sum, _mm_mul_ps(n, _mm_set1_ps(OctaveAmplitude[o])));
+		}
+
+		__m128 h = _mm_mul_ps(sum, vInvAmplitudeSum);
+		if (!ridged)
+			h = _mm_min_ps(_mm_max_ps(_mm_add_ps(h, vHalf), vZero), vOne);
+
+		_mm_storeu_ps(out + x, _mm_mul_ps(h, vMaxHeight));
+	}
+
+#endif // _FLACE_TERRAIN_GENERATOR_USE_SSE2_
+
+	// remaining cells, or all if SSE2 is not available
+
+	for (; x<Width; ++x)
+	{
+		irr::f32 sum = 0.0f;
+		irr::f32 weight = 1.0f;
+
+		for (irr::s32 o=0; o<OctaveCount; ++o)
+		{
+			const irr::f32 n = getPerlinNoise(Permutation, (irr::f32)x * OctaveFrequency[o] + OctaveOffsetX[o],
+				y * OctaveFrequency[o] + OctaveOffsetY[o]);
+
+			if (ridged)
+			{
+				irr::f32 r = 1.0f - fabsf(n);
+				r = r * r * weight;
+				weight = irr::core::min_(irr::core::max_(r * 2.0f, 0.0f), 1.0f);
+				sum += r * OctaveAmplitude[o];
+			}
+			else
+				sum += n * OctaveAmplitude[o];
+		}
+
+		irr::f32 h = sum * invAmplitudeSum;
+		if (!ridged)
+			h = irr::core::min_(irr::core::max_(h + 0.5f, 0.0f), 1.0f);
+
+		out[x] = h * MaxHeight;
+	}
+}
+
@@ -0,0 +1,107 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_GENERATOR_H_INCLUDED__
+#define __C_FLACE_TERRAIN_GENERATOR_H_INCLUDED__
+
+#include "irrTypes.h"
+#include "irrArray.h"
+
+//! topologies of CFlaceTerrainSceneNode::generateTerrain()
+enum E_TERRAIN_TOPOLOGY
+{
+	ETT_HILLS = 0,		// waves of two sizes, with small random bumps in the valleys
+	ETT_DESERT,			// like hills, but with longer dunes
+	ETT_FLAT,			// all cells at height 0
+	ETT_NOISE_FBM,		// several octaves of perlin noise, a rolling landscape
+	ETT_NOISE_RIDGED,	// ridged perlin noise, mountain ranges with sharp crests
+
+	ETT_COUNT
+};
+
+//! mixes the bits of a value, so that close values result in completely different ones
+inline irr::u32 hashTerrainGeneratorValue(irr::u32 x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+//! Small random number generator (xorshift). Every stream of a seed is independent of the others, so
+//! rows or tiles can be generated in any order, on any thread, and still get the same random values.
+struct STerrainGeneratorRandom
+{
+	STerrainGeneratorRandom(irr::u32 seed, irr::u32 stream)
+	{
+		State = hashTerrainGeneratorValue(seed ^ hashTerrainGeneratorValue(stream + 0x9e3779b9u));
+		if (!State)
+			State = 0x6d2b79f5u; // xorshift never leaves 0
+	}
+
+	irr::u32 next()
+	{
+		State ^= State << 13;
+		State ^= State >> 17;
+		State ^= State << 5;
+		return State;
+	}
+
+	//! returns a value from 0 to 1, 1 excluded
+	irr::f32 nextFloat()
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	irr::u32 State;
+};
+
+//! maximal amount of noise octaves, fine octaves smaller than two cells are left out anyway
+const irr::s32 TERRAIN_GENERATOR_MAX_OCTAVES = 10;
+
+//! Creates the heights of a terrain from a seed. The heights are calculated row by row, and the rows are split
+//! over the worker threads. Every row takes its random values from its own stream, seeded with the seed and
+//! the row, so the same seed always creates exactly the same terrain, no matter how many threads there are.
+class CFlaceTerrainGenerator
+{
+public:
+
+	//! cellSize is the distance between two cells, maxHeight the highest possible height
+	CFlaceTerrainGenerator(E_TERRAIN_TOPOLOGY topology, irr::u32 seed, irr::f32 cellSize, irr::f32 maxHeight);
+
+	//! calculates the heights of all cells. rows are pointers to the width heights of each of the height rows.
+	void generate(irr::f32* const* rows, irr::s32 width, irr::s32 height);
+
+	//! calculates the heights of one row. Called by generate() on the worker threads after the tables are set up.
+	void generateRow(irr::f32* out, irr::s32 y) const;
+
+private:
+
+	void generateWaveRow(irr::f32* out, irr::s32 y) const;
+	void generateNoiseRow(irr::f32* out, irr::s32 y) const;
+
+	E_TERRAIN_TOPOLOGY Topology;
+	irr::u32 Seed;
+	irr::f32 CellSize;
+	irr::f32 MaxHeight;
+	irr::s32 Width;
+
+	// waves, the part depending on x is the same for all rows
+	irr::core::array<irr::f32> RipplesX;
+	irr::core::array<irr::f32> HillsX;
+
+	// noise
+	irr::u8 Permutation[512];
+	irr::s32 OctaveCount;
+	irr::f32 OctaveFrequency[TERRAIN_GENERATOR_MAX_OCTAVES]; // per cell
+	irr::f32 OctaveAmplitude[TERRAIN_GENERATOR_MAX_OCTAVES];
+	irr::f32 OctaveOffsetX[TERRAIN_GENERATOR_MAX_OCTAVES]; // keeps positions positive and decorrelates the octaves
+	irr::f32 OctaveOffsetY[TERRAIN_GENERATOR_MAX_OCTAVES];
+	irr::f32 AmplitudeSum;
+};
+
+#endif
+
@@ -0,0 +1,362 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainHeightMapReader.h"
+#include "CFlaceWorkerPool.h"
+#include "IReadFile.h"
+#include "IImage.h"
+#include "irrMath.h"
+#include <string.h>
+#include <limits.h>
+
+// source values converted to floats at once, the rows of the grid are resampled in bands fitting into this
+static const irr::s32 TERRAIN_HEIGHTMAP_WINDOW_VALUES = 4 * 1024 * 1024;
+
+
+//! resamples a band of rows of the grid on the worker threads
+class CFlaceTerrainHeightMapJob : public IFlaceParallelJob
+{
+public:
+
+	CFlaceTerrainHeightMapJob(const CFlaceTerrainHeightMapReader& reader, irr::f32* const* rows, irr::s32 firstRow, 
+		irr::s32 endRow, irr::s32 rowsPerPart)
+		: Reader(reader), Rows(rows), FirstRow(firstRow), EndRow(endRow), RowsPerPart(rowsPerPart)
+	{
+	}
+
+	virtual void runJobPart(irr::s32 partIndex)
+	{
+		const irr::s32 firstRow = FirstRow + partIndex * RowsPerPart;
+		const irr::s32 endRow = irr::core::min_(firstRow + RowsPerPart, EndRow);
+
+		for (irr::s32 y=firstRow; y<endRow; ++y)
+			Reader.resampleRow(Rows[y], y);
+	}
+
+private:
+
+	const CFlaceTerrainHeightMapReader& Reader;
+	irr::f32* const* Rows;
+	irr::s32 FirstRow;
+	irr::s32 EndRow;
+	irr::s32 RowsPerPart;
+};
+
+
+static irr::s32 getTerrainHeightMapBytesPerValue(E_TERRAIN_HEIGHTMAP_FORMAT format)
+{
+	switch(format)
+	{
+	case ETHF_RAW_8:
+		return 1;
+	case ETHF_RAW_16:
+	case ETHF_RAW_16_BIG_ENDIAN:
+		return 2;
+	case ETHF_RAW_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+
+//! constructor
+CFlaceTerrainHeightMapReader::CFlaceTerrainHeightMapReader()
+: File(0), Image(0), Format(ETHF_RAW_8), SourceWidth(0), SourceHeight(0), Filter(ETHMF_BILINEAR), Taps(2),
+  Scale(1.0f), HeightScale(1.0f), Width(0), WindowFirstRow(0)
+{
+}
+
+
+CFlaceTerrainHeightMapReader::~CFlaceTerrainHeightMapReader()
+{
+	close();
+}
+
+
+void CFlaceTerrainHeightMapReader::close()
+{
+	if (File)
+		File->drop();
+	File = 0;
+
+	if (Image)
+		Image->drop();
+	Image = 0;
+
+	SourceWidth = 0;
+	SourceHeight = 0;
+}
+
+
+//! reads the heights from a RAW file
+bool CFlaceTerrainHeightMapReader::openRaw(irr::io::IReadFile* file, E_TERRAIN_HEIGHTMAP_FORMAT format, irr::s32 width, irr::s32 height)
+{
+	close();
+
+	const irr::s32 bytesPerValue = getTerrainHeightMapBytesPerValue(format);
+
+	if (!file || !bytesPerValue || width <= 0 || height <= 0)
+		return false;
+
+	if ((irr::f64)width * height * bytesPerValue > (irr::f64)file->getSize())
+		return false;
+
+	File = file;
+	File->grab();
+	Format = format;
+	SourceWidth = width;
+	SourceHeight = height;
+
+	return true;
+}
+
+
+//! reads the heights from an image
+bool CFlaceTerrainHeightMapReader::openImage(irr::video::IImage* image)
+{
+	close();
+
+	if (!image || !image->getDimension().Width || !image->getDimension().Height)
+		return false;
+
+	// the pixels are read as 8 bit colors, float formats can't be read that way
+	switch(image->getColorFormat())
+	{
+	case irr::video::ECF_A1R5G5B5:
+	case irr::video::ECF_R5G6B5:
+	case irr::video::ECF_R8G8B8:
+	case irr::video::ECF_A8R8G8B8:
+		break;
+	default:
+		return false;
+	}
+
+	Image = image;
+	Image->grab();
+	Format = ETHF_IMAGE;
+	SourceWidth = (irr::s32)image->getDimension().Width;
+	SourceHeight = (irr::s32)image->getDimension().Height;
+
+	return true;
+}
+
+
+//! resamples the height map into a grid
+bool CFlaceTerrainHeightMapReader::resample(irr::f32* const* rows, irr::s32 width, irr::s32 height, 
+											E_TERRAIN_HEIGHTMAP_FILTER filter, irr::f32 heightScale)
+{
+	if (!SourceWidth || !SourceHeight || width <= 0 || height <= 0)
+		return false;
+
+	Filter = filter;
+	Taps = (filter == ETHMF_BICUBIC) ? 4 : 2;
+	HeightScale = heightScale;
+	Width = width;
+
+	// the longer sides of the height map and the grid cover each other exactly
+
+	const irr::s32 gridSide = irr::core::max_(width, height);
+	const irr::s32 sourceSide = irr::core::max_(SourceWidth, SourceHeight);
+	Scale = (gridSide > 1) ? (sourceSide - 1) / (irr::f32)(gridSide - 1) : 0.0f;
+
+	// the filter taps of the columns are the same for all rows
+
+	ColumnIndices.set_used(width * Taps);
+	ColumnWeights.set_used(width * Taps);
+
+	for (irr::s32 x=0; x<width; ++x)
+		getFilterTaps(x * Scale, SourceWidth, &ColumnIndices[x * Taps], &ColumnWeights[x * Taps]);
+
+	// bands of grid rows, so that the source rows they need fit into the window
+
+	const irr::s32 windowRows = irr::core::max_(TERRAIN_HEIGHTMAP_WINDOW_VALUES / SourceWidth, 8);
+	irr::s32 rowsPerBand = height;
+	if (Scale > 0.0f)
+		rowsPerBand = irr::core::clamp((irr::s32)((windowRows - 4) / Scale), 1, height);
+
+	CFlaceWorkerPool* pool = CFlaceWorkerPool::getSharedPool();
+	bool complete = true;
+
+	for (irr::s32 firstRow=0; firstRow<height; firstRow+=rowsPerBand)
+	{
+		const irr::s32 endRow = irr::core::min_(firstRow + rowsPerBand, height);
+
+		// source rows of the taps of the first and the last row of the band. The positions are clamped 
+		// like getFilterTaps() does, rows below a source shorter than the grid repeat its last row.
+
+		const irr::f32 firstPos = irr::core::clamp(firstRow * Scale, 0.0f, (irr::f32)(SourceHeight - 1));
+		const irr::f32 lastPos = irr::core::clamp((endRow - 1) * Scale, 0.0f, (irr::f32)(SourceHeight - 1));
+
+		const irr::s32 firstSourceRow = irr::core::clamp((irr::s32)firstPos - 1, 0, SourceHeight - 1);
+		const irr::s32 lastSourceRow = irr::core::clamp((irr::s32)lastPos + 2, 0, SourceHeight - 1);
+
+		if (!readSourceRows(firstSourceRow, lastSourceRow - firstSourceRow + 1))
+			complete = false; // the rows which couldn't be read are 0
+
+		// every row only writes its own heights, so the band can be done on all cores
+
+		const irr::s32 bandHeight = endRow - firstRow;
+
+		irr::s32 partCount = 1;
+		if (width * bandHeight >= 64 * 64)
+			partCount = irr::core::min_(pool->getThreadCount() * 4, bandHeight);
+
+		const irr::s32 rowsPerPart = (bandHeight + partCount - 1) / partCount;
+		partCount = (bandHeight + rowsPerPart - 1) / rowsPerPart;
+
+		CFlaceTerrainHeightMapJob job(*this, rows, firstRow, endRow, rowsPerPart);
+		pool->runParallel(&job, partCount);
+	}
+
+	Window.clear();
+	WindowBytes.clear();
+
+	return complete;
+}
+
+
+//! resamples one row of the grid
+void CFlaceTerrainHeightMapReader::resampleRow(irr::f32* out, irr::s32 y) const
+{
+	irr::s32 rowIndices[4];
+	irr::f32 rowWeights[4];
+	getFilterTaps(y * Scale, SourceHeight, rowIndices, rowWeights);
+
+	const irr::f32* sourceRows[4];
+	for (irr::s32 r=0; r<Taps; ++r)
+		sourceRows[r] = &Window[(rowIndices[r] - WindowFirstRow) * SourceWidth];
+
+	const irr::s32* columnIndices = ColumnIndices.const_pointer();
+	const irr::f32* columnWeights = ColumnWeights.const_pointer();
+
+	if (Taps == 2)
+	{
+		for (irr::s32 x=0; x<Width; ++x, columnIndices+=2, columnWeights+=2)
+		{
+			const irr::f32 h0 = sourceRows[0][columnIndices[0]] * columnWeights[0] + sourceRows[0][columnIndices[1]] * columnWeights[1];
+			const irr::f32 h1 = sourceRows[1][columnIndices[0]] * columnWeights[0] + sourceRows[1][columnIndices[1]] * columnWeights[1];
+
+			out[x] = (h0 * rowWeights[0] + h1 * rowWeights[1]) * HeightScale;
+		}
+
+		return;
+	}
+
+	for (irr::s32 x=0; x<Width; ++x, columnIndices+=4, columnWeights+=4)
+	{
+		irr::f32 sum = 0.0f;
+
+		for (irr::s32 r=0; r<4; ++r)
+		{
+			const irr::f32* row = sourceRows[r];
+			const irr::f32 h = row[columnIndices[0]] * columnWeights[0] + row[columnIndices[1]] * columnWeights[1] +
+				row[columnIndices[2]] * columnWeights[2] + row[columnIndices[3]] * columnWeights[3];
+
+			sum += h * rowWeights[r];
+		}
+
+		out[x] = sum * HeightScale;
+	}
+}
+
+
+//! returns the source values and their weights for a position, positions outside of the source repeat its edge
+void CFlaceTerrainHeightMapReader::getFilterTaps(irr::f32 pos, irr::s32 size, irr::s32* outIndices, irr::f32* outWeights) const
+{
+	pos = irr::core::clamp(pos, 0.0f, (irr::f32)(size - 1));
+
+	const irr::s32 i = (irr::s32)pos;
+	const irr::f32 t = pos - (irr::f32)i;
+
+	if (Taps == 2)
+	{
+		outIndices[0] = i;
+		outIndices[1] = irr::core::min_(i + 1, size - 1);
+		outWeights[0] = 1.0f - t;
+		outWeights[1] = t;
+		return;
+	}
+
+	// catmull-rom spline through the 4 values around the position
+
+	const irr::f32 t2 = t * t;
+	const irr::f32 t3 = t2 * t;
+
+	for (irr::s32 k=0; k<4; ++k)
+		outIndices[k] = irr::core::clamp(i - 1 + k, 0, size - 1);
+
+	outWeights[0] = (-t3 + 2.0f * t2 - t) * 0.5f;
+	outWeights[1] = (3.0f * t3 - 5.0f * t2 + 2.0f) * 0.5f;
+	outWeights[2] = (-3.0f * t3 + 4.0f * t2 + t) * 0.5f;
+	outWeights[3] = (t3 - t2) * 0.5f;
+}
+
+
+//! reads source rows into the window and converts them to floats
+bool CFlaceTerrainHeightMapReader::readSourceRows(irr::s32 firstRow, irr::s32 rowCount)
+{
+	const irr::u32 valueCount = (irr::u32)(rowCount * SourceWidth);
+
+	WindowFirstRow = firstRow;
+	Window.set_used(valueCount);
+
+	if (Image)
+	{
+		for (irr::s32 y=0; y<rowCount; ++y)
+		{
+			irr::f32* out = &Window[y * SourceWidth];
+			for (irr::s32 x=0; x<SourceWidth; ++x)
+				out[x] = (irr::f32)Image->getPixel(x, firstRow + y).getAverage();
+		}
+
+		return true;
+	}
+
+	const irr::s32 bytesPerValue = getTerrainHeightMapBytesPerValue(Format);
+	const irr::s32 byteCount = (irr::s32)valueCount * bytesPerValue;
+
+	WindowBytes.set_used(byteCount);
+
+	// the offset is computed in 64 bits, seek() only takes a long, which has 32 bits on some systems
+
+	const irr::f64 offset = (irr::f64)firstRow * SourceWidth * bytesPerValue;
+
+	bool complete = File && offset <= (irr::f64)LONG_MAX && File->seek((long)offset) && 
+		File->read(WindowBytes.pointer(), byteCount) == byteCount;
+
+	if (!complete)
+		memset(WindowBytes.pointer(), 0, byteCount);
+
+	const irr::u8* in = WindowBytes.const_pointer();
+	irr::f32* out = Window.pointer();
+
+	switch(Format)
+	{
+	case ETHF_RAW_8:
+		for (irr::u32 i=0; i<valueCount; ++i)
+			out[i] = (irr::f32)in[i];
+		break;
+	case ETHF_RAW_16:
+		for (irr::u32 i=0; i<valueCount; ++i, in+=2)
+			out[i] = (irr::f32)((irr::u32)in[0] | ((irr::u32)in[1] << 8));
+		break;
+	case ETHF_RAW_16_BIG_ENDIAN:
+		for (irr::u32 i=0; i<valueCount; ++i, in+=2)
+			out[i] = (irr::f32)(((irr::u32)in[0] << 8) | (irr::u32)in[1]);
+		break;
+	case ETHF_RAW_FLOAT:
+		for (irr::u32 i=0; i<valueCount; ++i, in+=4)
+		{
+			const irr::u32 bits = (irr::u32)in[0] | ((irr::u32)in[1] << 8) | ((irr::u32)in[2] << 16) | ((irr::u32)in[3] << 24);
+			memcpy(&out[i], &bits, 4);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return complete;
+}
+
@@ -0,0 +1,103 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_HEIGHT_MAP_READER_H_INCLUDED__
+#define __C_FLACE_TERRAIN_HEIGHT_MAP_READER_H_INCLUDED__
+
+#include "irrTypes.h"
+#include "irrArray.h"
+
+namespace irr
+{
+namespace io
+{
+	class IReadFile;
+}
+namespace video
+{
+	class IImage;
+}
+}
+
+//! formats of height map files for CFlaceTerrainSceneNode::importHeightMap()
+enum E_TERRAIN_HEIGHTMAP_FORMAT
+{
+	ETHF_RAW_8 = 0,				// one unsigned byte per height, row by row
+	ETHF_RAW_16,				// unsigned 16 bit little endian values
+	ETHF_RAW_16_BIG_ENDIAN,		// unsigned 16 bit big endian values, like many survey height maps
+	ETHF_RAW_FLOAT,				// 32 bit little endian floats
+	ETHF_IMAGE,					// any image the video driver can load, like PNG. The brightness is the height,
+								// with 8 bits only: 16 bit PNGs are reduced to 8 bits when loading, use RAW for them.
+
+	ETHF_COUNT
+};
+
+//! filters for resampling height maps to the cells of a terrain
+enum E_TERRAIN_HEIGHTMAP_FILTER
+{
+	ETHMF_BILINEAR = 0,
+	ETHMF_BICUBIC,				// catmull-rom, keeps ridges and valleys sharper when scaling up
+
+	ETHMF_COUNT
+};
+
+//! Resamples a height map into the height rows of a terrain. RAW files are not read as a whole: only the
+//! source rows needed for a band of terrain rows are read and converted, the band is resampled on the worker 
+//! threads, and then the next band is read. So height maps much larger than the memory available for a float 
+//! copy of them can be imported.
+class CFlaceTerrainHeightMapReader
+{
+public:
+
+	CFlaceTerrainHeightMapReader();
+	~CFlaceTerrainHeightMapReader();
+
+	//! reads the heights from a RAW file of width x height values. The file is grabbed, and read when resampling.
+	//! Returns false if the file is too small for that size.
+	bool openRaw(irr::io::IReadFile* file, E_TERRAIN_HEIGHTMAP_FORMAT format, irr::s32 width, irr::s32 height);
+
+	//! reads the heights from an image. The image is grabbed. Only images with 8 bit color channels can be read,
+	//! so there are only 256 different heights. Returns false for other formats, like float images.
+	bool openImage(irr::video::IImage* image);
+
+	irr::s32 getWidth() const { return SourceWidth; }
+	irr::s32 getHeight() const { return SourceHeight; }
+
+	//! resamples the height map into a grid. rows are pointers to the width heights of each of the height rows.
+	//! The height map is scaled evenly so that its longer side fits the grid, cells beyond its shorter side repeat
+	//! its edge. Every value is multiplied with heightScale. Returns false if the file couldn't be read completely.
+	bool resample(irr::f32* const* rows, irr::s32 width, irr::s32 height, E_TERRAIN_HEIGHTMAP_FILTER filter, irr::f32 heightScale);
+
+	//! resamples one row of the grid from the source rows read for the current band. Called by resample() on the worker threads.
+	void resampleRow(irr::f32* out, irr::s32 y) const;
+
+private:
+
+	void close();
+	bool readSourceRows(irr::s32 firstRow, irr::s32 rowCount);
+	void getFilterTaps(irr::f32 pos, irr::s32 size, irr::s32* outIndices, irr::f32* outWeights) const;
+
+	irr::io::IReadFile* File;
+	irr::video::IImage* Image;
+	E_TERRAIN_HEIGHTMAP_FORMAT Format;
+	irr::s32 SourceWidth;
+	irr::s32 SourceHeight;
+
+	// resampling
+	E_TERRAIN_HEIGHTMAP_FILTER Filter;
+	irr::s32 Taps; // source values per direction used for one height, 2 or 4
+	irr::f32 Scale; // source values per cell
+	irr::f32 HeightScale;
+	irr::s32 Width;
+	irr::core::array<irr::s32> ColumnIndices; // Taps source columns per column of the grid, the same for all rows
+	irr::core::array<irr::f32> ColumnWeights;
+
+	// source rows of the current band, converted to floats
+	irr::core::array<irr::f32> Window;
+	irr::core::array<irr::u8> WindowBytes;
+	irr::s32 WindowFirstRow;
+};
+
+#endif
+
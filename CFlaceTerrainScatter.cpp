@@ -0,0 +1,234 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainScatter.h"
+#include "CFlaceWorkerPool.h"
+#include "irrMath.h"
+#include <math.h>
+
+// side length of a tile in grid cells. Has to be larger than the 2 cells around a point searched for neighbours,
+// so that tiles filled at the same time never touch the same cells.
+static const irr::s32 TERRAIN_SCATTER_TILE_CELLS = 32;
+
+// random points tried per tile for starting to fill it, and candidates tried around each point
+static const irr::s32 TERRAIN_SCATTER_DARTS = 16;
+static const irr::s32 TERRAIN_SCATTER_CANDIDATES = 20;
+
+// upper limit for the cells of the grid, the minimal distance is raised to stay below it
+static const irr::f32 TERRAIN_SCATTER_MAX_CELLS = 16.0f * 1024.0f * 1024.0f;
+
+// points per square unit times the square of the minimal distance, for the packing reached by filling the tiles
+static const irr::f32 TERRAIN_SCATTER_PACKING = 0.61f;
+
+
+//! fills the tiles of one of the 4 passes on the worker threads
+class CFlaceTerrainScatterJob : public IFlaceParallelJob
+{
+public:
+
+	CFlaceTerrainScatterJob(CFlaceTerrainScatter& scatter, irr::s32 firstTileX, irr::s32 firstTileY)
+		: Scatter(scatter), FirstTileX(firstTileX), FirstTileY(firstTileY)
+	{
+		TilesPerRow = (Scatter.TileCountX - FirstTileX + 1) / 2;
+	}
+
+	irr::s32 getTileCount() const
+	{
+		return TilesPerRow * ((Scatter.TileCountY - FirstTileY + 1) / 2);
+	}
+
+	virtual void runJobPart(irr::s32 partIndex)
+	{
+		Scatter.fillTile(FirstTileX + (partIndex % TilesPerRow) * 2, FirstTileY + (partIndex / TilesPerRow) * 2);
+	}
+
+private:
+
+	CFlaceTerrainScatter& Scatter;
+	irr::s32 FirstTileX;
+	irr::s32 FirstTileY;
+	irr::s32 TilesPerRow;
+};
+
+
+//! constructor
+CFlaceTerrainScatter::CFlaceTerrainScatter(irr::f32 sizeX, irr::f32 sizeZ, irr::f32 minDistance, irr::u32 seed)
+: SizeX(sizeX), SizeZ(sizeZ), MinDistance(minDistance), Seed(seed)
+{
+	// a cell can hold only one point if its diagonal is shorter than the distance
+
+	CellSize = MinDistance / sqrtf(2.0f);
+
+	const irr::f32 cellCount = (SizeX / CellSize) * (SizeZ / CellSize);
+	if (cellCount > TERRAIN_SCATTER_MAX_CELLS)
+	{
+		CellSize *= sqrtf(cellCount / TERRAIN_SCATTER_MAX_CELLS);
+		MinDistance = CellSize * sqrtf(2.0f);
+	}
+
+	GridWidth = irr::core::max_((irr::s32)ceilf(SizeX / CellSize), 1);
+	GridHeight = irr::core::max_((irr::s32)ceilf(SizeZ / CellSize), 1);
+	TileCountX = (GridWidth + TERRAIN_SCATTER_TILE_CELLS - 1) / TERRAIN_SCATTER_TILE_CELLS;
+	TileCountY = (GridHeight + TERRAIN_SCATTER_TILE_CELLS - 1) / TERRAIN_SCATTER_TILE_CELLS;
+
+	SCell empty;
+	empty.X = -1.0f;
+	empty.Z = -1.0f;
+	empty.Random = 0;
+
+	Grid.set_used(GridWidth * GridHeight);
+	for (irr::u32 i=0; i<Grid.size(); ++i)
+		Grid[i] = empty;
+}
+
+
+//! scatters points over an area
+void CFlaceTerrainScatter::scatter(irr::f32 sizeX, irr::f32 sizeZ, irr::f32 minDistance, irr::u32 seed,
+								   irr::core::array<SPoint>& outPoints)
+{
+	if (sizeX <= 0.0f || sizeZ <= 0.0f || minDistance <= 0.0f)
+		return;
+
+	CFlaceTerrainScatter scatter(sizeX, sizeZ, minDistance, seed);
+
+	// tiles next to each other read each others border cells, so they are filled in 4 passes, every
+	// pass only filling every second tile in both directions
+
+	CFlaceWorkerPool* pool = CFlaceWorkerPool::getSharedPool();
+
+	for (irr::s32 pass=0; pass<4; ++pass)
+	{
+		CFlaceTerrainScatterJob job(scatter, pass & 1, pass >> 1);
+		if (job.getTileCount() > 0)
+			pool->runParallel(&job, job.getTileCount());
+	}
+
+	// collect the points
+
+	for (irr::u32 i=0; i<scatter.Grid.size(); ++i)
+	{
+		const SCell& cell = scatter.Grid[i];
+		if (cell.X < 0.0f)
+			continue;
+
+		SPoint p;
+		p.X = cell.X;
+		p.Z = cell.Z;
+		p.Random = cell.Random;
+		outPoints.push_back(p);
+	}
+}
+
+
+//! returns the minimal distance for a density
+irr::f32 CFlaceTerrainScatter::getDistanceForDensity(irr::f32 density)
+{
+	if (density <= 0.0f)
+		return 0.0f;
+
+	return sqrtf(TERRAIN_SCATTER_PACKING / density);
+}
+
+
+//! fills a tile with points, growing outwards from random start points until there is no room anymore
+void CFlaceTerrainScatter::fillTile(irr::s32 tileX, irr::s32 tileY)
+{
+	const irr::s32 startX = tileX * TERRAIN_SCATTER_TILE_CELLS;
+	const irr::s32 startY = tileY * TERRAIN_SCATTER_TILE_CELLS;
+	const irr::s32 endX = irr::core::min_(startX + TERRAIN_SCATTER_TILE_CELLS, GridWidth);
+	const irr::s32 endY = irr::core::min_(startY + TERRAIN_SCATTER_TILE_CELLS, GridHeight);
+
+	const irr::f32 minX = startX * CellSize;
+	const irr::f32 minZ = startY * CellSize;
+	const irr::f32 maxX = irr::core::min_(endX * CellSize, SizeX);
+	const irr::f32 maxZ = irr::core::min_(endY * CellSize, SizeZ);
+
+	STerrainGeneratorRandom random(Seed, (irr::u32)(tileY * TileCountX + tileX));
+	irr::core::array<irr::s32> active; // cells of points which may still have room around them
+
+	for (irr::s32 dart=0; dart<TERRAIN_SCATTER_DARTS; ++dart)
+	{
+		const irr::f32 x = minX + random.nextFloat() * (maxX - minX);
+		const irr::f32 z = minZ + random.nextFloat() * (maxZ - minZ);
+
+		if (!tryAddPoint(x, z, startX, startY, endX, endY, random, active))
+			continue;
+
+		while (!active.empty())
+		{
+			const irr::u32 a = random.next() % active.size();
+			const irr::f32 fromX = Grid[active[a]].X;
+			const irr::f32 fromZ = Grid[active[a]].Z;
+
+			// try candidates in the ring between the distance and twice the distance around the point
+
+			bool added = false;
+			for (irr::s32 c=0; c<TERRAIN_SCATTER_CANDIDATES && !added; ++c)
+			{
+				const irr::f32 angle = random.nextFloat() * irr::core::PI * 2.0f;
+				const irr::f32 dist = MinDistance * (1.0f + random.nextFloat());
+
+				added = tryAddPoint(fromX + cosf(angle) * dist, fromZ + sinf(angle) * dist,
+					startX, startY, endX, endY, random, active);
+			}
+
+			if (!added)
+			{
+				// no room around this point anymore
+				active[a] = active[active.size()-1];
+				active.erase(active.size()-1);
+			}
+		}
+	}
+}
+
+
+//! adds a point if it is inside of the tile and no other point is too close
+bool CFlaceTerrainScatter::tryAddPoint(irr::f32 x, irr::f32 z, irr::s32 tileStartX, irr::s32 tileStartY, irr::s32 tileEndX,
+									   irr::s32 tileEndY, STerrainGeneratorRandom& random, irr::core::array<irr::s32>& active)
+{
+	if (x < 0.0f || z < 0.0f || x >= SizeX || z >= SizeZ)
+		return false;
+
+	const irr::s32 cellX = (irr::s32)(x / CellSize);
+	const irr::s32 cellY = (irr::s32)(z / CellSize);
+
+	if (cellX < tileStartX || cellY < tileStartY || cellX >= tileEndX || cellY >= tileEndY)
+		return false;
+
+	const irr::s32 idx = cellY * GridWidth + cellX;
+	if (Grid[idx].X >= 0.0f)
+		return false;
+
+	// points closer than the distance can only be in the 2 cells around
+
+	const irr::f32 minDistanceSQ = MinDistance * MinDistance;
+	const irr::s32 sy = irr::core::max_(cellY - 2, 0);
+	const irr::s32 ey = irr::core::min_(cellY + 3, GridHeight);
+	const irr::s32 sx = irr::core::max_(cellX - 2, 0);
+	const irr::s32 ex = irr::core::min_(cellX + 3, GridWidth);
+
+	for (irr::s32 y=sy; y<ey; ++y)
+	{
+		const SCell* row = &Grid[y * GridWidth];
+
+		for (irr::s32 nx=sx; nx<ex; ++nx)
+		{
+			if (row[nx].X < 0.0f)
+				continue;
+
+			const irr::f32 dx = row[nx].X - x;
+			const irr::f32 dz = row[nx].Z - z;
+			if (dx * dx + dz * dz < minDistanceSQ)
+				return false;
+		}
+	}
+
+	Grid[idx].X = x;
+	Grid[idx].Z = z;
+	Grid[idx].Random = random.next();
+	active.push_back(idx);
+	return true;
+}
+
@@ -0,0 +1,68 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_SCATTER_H_INCLUDED__
+#define __C_FLACE_TERRAIN_SCATTER_H_INCLUDED__
+
+#include "irrTypes.h"
+#include "irrArray.h"
+#include "CFlaceTerrainGenerator.h"
+
+//! Scatters points over a rectangle as blue noise (poisson disk sampling): no two points are closer than a
+//! minimal distance, and there are no larger empty gaps, so vegetation placed with it covers the ground evenly
+//! with a lot less instances than uniform random positions, which clump and leave holes.
+//! Points are stored in a grid of cells smaller than the distance, so each cell holds at most one point and
+//! neighbours are found by looking at the cells around. The area is split into tiles which are filled on the
+//! worker threads, in 4 passes so that tiles next to each other are never filled at the same time. Every tile
+//! uses its own random stream, so the same seed always gives the same points, no matter how many threads.
+class CFlaceTerrainScatter
+{
+public:
+
+	struct SPoint
+	{
+		irr::f32 X;
+		irr::f32 Z;
+		irr::u32 Random; // random value for the point, for example for its rotation
+	};
+
+	//! scatters points over the area from 0,0 to sizeX,sizeZ, with at least minDistance between them.
+	//! The points are added to outPoints ordered by rows.
+	static void scatter(irr::f32 sizeX, irr::f32 sizeZ, irr::f32 minDistance, irr::u32 seed,
+		irr::core::array<SPoint>& outPoints);
+
+	//! returns the minimal distance which scatters about density points per square unit
+	static irr::f32 getDistanceForDensity(irr::f32 density);
+
+private:
+
+	friend class CFlaceTerrainScatterJob;
+
+	CFlaceTerrainScatter(irr::f32 sizeX, irr::f32 sizeZ, irr::f32 minDistance, irr::u32 seed);
+	void fillTile(irr::s32 tileX, irr::s32 tileY);
+
+	struct SCell
+	{
+		irr::f32 X; // negative if the cell has no point
+		irr::f32 Z;
+		irr::u32 Random;
+	};
+
+	bool tryAddPoint(irr::f32 x, irr::f32 z, irr::s32 tileStartX, irr::s32 tileStartY, irr::s32 tileEndX,
+		irr::s32 tileEndY, STerrainGeneratorRandom& random, irr::core::array<irr::s32>& active);
+
+	irr::f32 SizeX;
+	irr::f32 SizeZ;
+	irr::f32 MinDistance;
+	irr::f32 CellSize;
+	irr::u32 Seed;
+	irr::s32 GridWidth;
+	irr::s32 GridHeight;
+	irr::s32 TileCountX;
+	irr::s32 TileCountY;
+	irr::core::array<SCell> Grid;
+};
+
+#endif
+
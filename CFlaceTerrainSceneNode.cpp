@@ -1,2313 +1,5670 @@
-// Copyright (C) 2002-2008 Nikolaus Gebhardt
-// This file is part of the "Irrlicht Engine".
-// For conditions of distribution and use, see copyright notice in irrlicht.h
-
-#include "CFlaceTerrainSceneNode.h"
-#include "IVideoDriver.h"
-#include "ISceneManager.h"
-#include "ICameraSceneNode.h"
-#include "os.h"
-#include "CFlaceSerializer.h"
-#include "CFlaceDeserializer.h"
-#include "CFlaceAttributeSerializationHelper.h"
-#include "irrHelpers.h"
-#include "CFlaceMeshSceneNode.h"
-#include "CFlaceAnimatedMeshSceneNode.h"
-
-using namespace irr;
-using namespace scene;
-
-//! constructor
-CFlaceTerrainSceneNode::CFlaceTerrainSceneNode(IUndoManager* undo, ISceneNode* parent, ISceneManager* mgr, irr::video::IVideoDriver* driver, s32 id)
-: ISceneNode(parent, mgr, id, irr::core::vector3df(0,0,0), 
-			 irr::core::vector3df(0,0,0), irr::core::vector3df(1,1,1), undo),
-			 Driver(driver), GrassUsesWind(true)
-{
-	#ifdef _DEBUG
-	setDebugName("CFlaceTerrainSceneNode");
-	
-	#endif
-
-	LightingType = ETLT_DYNAMIC;
-	CellCountX = 0;
-	CellCountY = 0;
-	TileCountX = 0;
-	TileCountY = 0;
-	CellSize = 0;
-	SideLength = 0;
-	CellsPerTileSide = 0;
-	TextureScale = 0.02f;
-	tTexHeightLow = 0.2f;
-	tTexHeightMed = 0.9f;
-	MaxHeight = 0;
-	texBlend = 255;
-	TileSize = 0;
-	Displacement.set(0,0,0);
-
-	recalculateBoundingBox();
-}
-
-
-
-//! destructor
-CFlaceTerrainSceneNode::~CFlaceTerrainSceneNode()
-{
-	clearCurrentTerrainMeshes();
-	clearTerrainTextures();
-}
-
-
-//! pre render event
-void CFlaceTerrainSceneNode::OnRegisterSceneNode()
-{
-	setPosition(irr::core::vector3df(0,0,0));
-	setRotation(irr::core::vector3df(0,0,0));
-	setScale(irr::core::vector3df(1,1,1));
-
-	if (IsVisible && DebugDataVisible)
-		SceneManager->registerNodeForRendering(this);
-
-	ISceneNode::OnRegisterSceneNode();
-}
-
-
-//! render
-void CFlaceTerrainSceneNode::render()
-{
-	video::IVideoDriver* driver = SceneManager->getVideoDriver();
-	ICameraSceneNode* camera = SceneManager->getActiveCamera();
-
-	if (!camera || !driver)
-		return;
-
-	driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
-}
-
-
-
-//! returns the axis aligned bounding box of this node
-const core::aabbox3d<f32>& CFlaceTerrainSceneNode::getBoundingBox() const
-{
-	return BBox;
-}
-
-
-//! Creates a clone of this scene node and its children.
-ISceneNode* CFlaceTerrainSceneNode::clone(ISceneNode* newParent, ISceneManager* newManager, IUndoManager* undo)
-{
-	if (!newParent)
-		newParent = Parent;
-	if (!newManager)
-		newManager = SceneManager;
-
-	CFlaceTerrainSceneNode* nb = new CFlaceTerrainSceneNode(undo, newParent, newManager, Driver, ID);
-
-	nb->cloneMembers(this, newManager);
-
-	nb->TerrainData = TerrainData;
-	for (int i=0; i<(int)Textures.size(); ++i)
-	{
-		nb->Textures.push_back(Textures[i]);
-		nb->Textures[i]->grab();
-	}
-
-	nb->BBox = BBox;
-
-	nb->drop();
-	return nb;
-}
-
-
-
-//! serialize
-void CFlaceTerrainSceneNode::serialize(CFlaceSerializer* serializer)
-{
-	serializer->WriteBox(BBox);
-
-	irr::s32 nFlags = 0;
-	if (GrassUsesWind)
-		nFlags |= 0x1;
-
-	serializer->WriteS32(nFlags); // flags for future use	
-
-	serializer->WriteS32(SideLength);
-	serializer->WriteS32(CellSize);
-	serializer->WriteS32(TileSize);
-	serializer->WriteS32(TileCountX);
-	serializer->WriteS32(TileCountY);
-	serializer->WriteS32(CellCountX);
-	serializer->WriteS32(CellCountY);
-	serializer->WriteS32(CellsPerTileSide);
-	serializer->WriteS32((irr::s32)LightingType);
-	serializer->Write3DVectF(Displacement);
-	serializer->WriteF32(TextureScale);
-
-	serializer->WriteS32((irr::s32)Textures.size());
-	for (int i=0; i<(int)Textures.size(); ++i)
-		serializer->WriteTextureRef(Textures[i]);
-
-	serializer->WriteS32((irr::s32)TerrainData.size());
-	for (int i=0; i<(int)TerrainData.size(); ++i)
-	{
-		STerrainData& t = TerrainData[i];
-
-		serializer->WriteF32(t.Height);
-		serializer->WriteS32(t.UserSetTextureIndex);		
-	}
-
-	serializer->WriteS32((irr::s32)GrassInstances.size());
-	for (int i=0; i<(int)GrassInstances.size(); ++i)
-	{
-		SGrassInstance& g = GrassInstances[i];
-
-		serializer->WriteF32(g.Height);
-		serializer->WriteF32(g.Width);		
-		serializer->WriteF32(g.PosX);		
-		serializer->WriteF32(g.PosZ);		
-		serializer->WriteF32(g.Rotation);		
-		serializer->WriteS32(g.TextureIndex);		
-	}
-
-	serializer->WriteS32((irr::s32)TerrainTiles.size());
-	for (int i=0; i<(int)TerrainTiles.size(); ++i)
-	{
-		irr::s32 id = -1;
-		CFlaceMeshSceneNode* tile = TerrainTiles[i];
-		if (tile)
-			id = tile->getID();
-		serializer->WriteS32(id);
-	}	
-}
-
-
-//! serialize
-void CFlaceTerrainSceneNode::deserialize(CFlaceDeserializer* deserializer)
-{
-	BBox = deserializer->ReadBox();
-	irr::s32 nFlags = deserializer->ReadS32(); // flags for future use
-
-	GrassUsesWind = (nFlags & 0x1) != 0; 
-
-	SideLength =  deserializer->ReadS32();
-	CellSize = deserializer->ReadS32();
-	TileSize = deserializer->ReadS32();
-	TileCountX = deserializer->ReadS32();
-	TileCountY = deserializer->ReadS32();
-	CellCountX = deserializer->ReadS32();
-	CellCountY = deserializer->ReadS32();
-	CellsPerTileSide = deserializer->ReadS32();
-	LightingType = (E_TERRAIN_LIGHTING_TYPE)deserializer->ReadS32();
-	Displacement = deserializer->Read3DVectF();
-	TextureScale = deserializer->ReadF32();
-
-	irr::s32 texturesSize = deserializer->ReadS32();
-	for (int i=0; i<texturesSize; ++i)
-	{
-		irr::video::ITexture* tex = deserializer->ReadTextureRef();
-		if (tex)
-			tex->grab();
-		Textures.push_back(tex);
-	}
-
-	irr::s32 terrainDataSize = deserializer->ReadS32();
-	for (int i=0; i<terrainDataSize; ++i)
-	{
-		STerrainData t;
-
-		t.Height = deserializer->ReadF32();
-		t.UserSetTextureIndex = deserializer->ReadS32();	
-
-		TerrainData.push_back(t);
-	}
-
-	irr::s32 grassDataSize = deserializer->ReadS32();
-	for (int i=0; i<grassDataSize; ++i)
-	{
-		SGrassInstance g;
-
-		g.Height = deserializer->ReadF32();
-		g.Width = deserializer->ReadF32();		
-		g.PosX = deserializer->ReadF32();		
-		g.PosZ = deserializer->ReadF32();		
-		g.Rotation = deserializer->ReadF32();		
-		g.TextureIndex = deserializer->ReadS32();	
-
-		 GrassInstances.push_back(g);
-	}
-
-	irr::s32 terrainTileCount = deserializer->ReadS32();
-	TemporaryTerrainTilesIds.clear();
-	for (int i=0; i<terrainTileCount; ++i)
-	{
-		irr::s32 id = deserializer->ReadS32();	
-		TemporaryTerrainTilesIds.push_back(id);
-	}	
-
-	// update
-
-	calculateBlendingFactors();
-}
-
-
-//! Writes attributes of the scene node.
-void CFlaceTerrainSceneNode::serializeAttributes(io::IAttributes* out, io::SAttributeReadWriteOptions* options) const
-{
-	if (options && (options->Flags & irr::io::EARWF_IRRLICHT_1_6_COMPATIBILTY))
-	{
-		return;
-	}
-
-	CFlaceAttributeSerializationHelper::serializeBaseAttributes(this, out, options);
-
-	//out->addBool("IsClosedCircle", IsClosedCircle);
-	//out->addFloat("Tightness", Tightness);
-
-	out->addFloat("TextureScale", TextureScale);
-	out->addBool("GrassUsesWind", GrassUsesWind);
-}
-
-
-//! Reads attributes of the scene node.
-void CFlaceTerrainSceneNode::deserializeAttributes(io::IAttributes* in, io::SAttributeReadWriteOptions* options)
-{
-	if (options && (options->Flags & irr::io::EARWF_IRRLICHT_1_6_COMPATIBILTY))
-	{
-		return;
-	}
-
-	CFlaceAttributeSerializationHelper::deserializeBaseAttributes(this, in, options);
-
-	//IsClosedCircle = in->getAttributeAsBool("IsClosedCircle");
-	//Tightness = in->getAttributeAsFloat("Tightness");
-
-	bool bNeedsToRegenerateMesh = false;
-
-	irr::f32 oldTextureScale = TextureScale;
-	TextureScale = in->getAttributeAsFloat("TextureScale");
-
-	if (!irr::core::equals(oldTextureScale, TextureScale))
-		bNeedsToRegenerateMesh = true;
-
-	bool bNewGrassUseswind = in->getAttributeAsBool("GrassUsesWind");
-	if (bNewGrassUseswind != GrassUsesWind)
-	{
-		bNeedsToRegenerateMesh = true;
-		GrassUsesWind = bNewGrassUseswind;
-	}
-
-	if (bNeedsToRegenerateMesh)
-		updateMeshesFromTerrainData();
-}
-
-
-void CFlaceTerrainSceneNode::recalculateBoundingBox()
-{
-	BBox.reset(0,0,0);
-
-	BBox.MaxEdge.set((irr::f32)SideLength, (irr::f32)MaxHeight, (irr::f32)SideLength);
-	BBox.MaxEdge += Displacement;
-	BBox.MinEdge += Displacement;
-}
-
-
-void CFlaceTerrainSceneNode::clearCurrentTerrainMeshes()
-{
-	for (int i=0; i<(int)TerrainTiles.size(); ++i)
-	{
-		if (TerrainTiles[i])
-		{
-			TerrainTiles[i]->remove();
-			TerrainTiles[i]->drop();
-		}
-	}
-
-	TerrainTiles.clear();
-}
-
-void CFlaceTerrainSceneNode::clearTerrainTextures()
-{
-	for (int i=0; i<(int)Textures.size(); ++i)
-	{
-		if (Textures[i])
-			Textures[i]->drop();
-	}
-
-	Textures.clear();
-}
-
-//! terrain to generate
-void CFlaceTerrainSceneNode::generateTerrain(irr::s32 sideLen, irr::s32 cellSize, irr::s32 maxHeight, int topology,
-	irr::video::ITexture* pTextureGrass, 
-	irr::video::ITexture* pTextureRock,
-	irr::video::ITexture* pTextureSand,
-	STreeDistribution* pTreeDistribution, irr::s32 nTreeDistributionCount,
-	SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount)
-{
-	clearCurrentTerrainMeshes();
-	clearTerrainTextures();
-
-	// save textures
-
-	if (pTextureGrass)
-	{
-		Textures.push_back(pTextureGrass);
-		pTextureGrass->grab();
-	}
-
-	if (pTextureRock)
-	{
-		Textures.push_back(pTextureRock);
-		pTextureRock->grab();
-	}
-
-	if (pTextureSand)
-	{
-		Textures.push_back(pTextureSand);
-		pTextureSand->grab();
-	}
-
-	// calculate sizes
-
-	SideLength = sideLen;
-	CellSize = cellSize;
-	CellsPerTileSide = 35;
-	MaxHeight = (int)maxHeight;
-	TileSize = CellSize * CellsPerTileSide;
-
-	Displacement.X = -(SideLength / 2.0f);
-	Displacement.Y = 0.0f;
-	Displacement.Z = -(SideLength / 2.0f);
-	
-
-	TileCountX = (int)(sideLen / (irr::f32)(TileSize));
-	TileCountY = (int)(sideLen / (irr::f32)(TileSize));
-
-	if (TileCountX <= 0) TileCountX = 1;
-	if (TileCountY <= 0) TileCountY = 1;
-
-	SideLength = TileCountX * TileSize;
-
-	CellCountX = TileCountX * CellsPerTileSide;
-	CellCountY = TileCountY * CellsPerTileSide;
-
-	// set initial terrain data
-
-	int nTotalCellCount = CellCountX * CellCountY;
-	TerrainData.set_used_construct(nTotalCellCount);
-
-	irr::f32 oneMeter = 10.0f;
-
-	switch(topology)
-	{
-	case 0: // = hills
-		{
-			for (int cx=0; cx<CellCountX; ++cx)
-				for (int cy=0; cy<CellCountY; ++cy)
-				{			
-					STerrainData& rTerrain = TerrainData[getTerrainCellIndex(cx,cy)];
-					float x = (cx * (irr::f32)CellSize / oneMeter);
-					float y = (cy * (irr::f32)CellSize / oneMeter);
-
-					rTerrain.Height = 0.0f;
-					rTerrain.UserSetTextureIndex = 0;
-					rTerrain.MainTextureIndex = 0;
-					rTerrain.BlendingToTextureIndex = 0;
-
-					// tiny rippling effect:
-					const irr::f32 fact = 2.0f;
-					irr::f32 hx = sin(x / (irr::f32)(1000.0f / 925.0f));
-					irr::f32 hy = cos(y / (irr::f32)(1000.0f / 925.0f));
-					irr::f32 rippling = ((hx + hy) / 2.0f) * oneMeter * 1.1f;
-					// bigger hills	
-					irr::f32 hx2 = (sin(x / (irr::f32)(1000.0f / 150.0f)) * (irr::f32)(MaxHeight* 1.0f));
-					irr::f32 hy2 = (cos(y / (irr::f32)(1000.0f / 150.0f)) * (irr::f32)(MaxHeight* 1.0f)); 
-					irr::f32 hill = (hx2 + hy2) / 2.0f;
-					rTerrain.Height = irr::core::clamp((hill + rippling), 0.0f, (irr::f32)MaxHeight);
-
-					if (rTerrain.Height < MaxHeight / 100.0f)
-					{
-						const irr::f32 fact = 2.0f;
-						irr::f32 hx = sin(x / (irr::f32)(1000.0f / 925.0f));
-						irr::f32 hy = cos(y / (irr::f32)(1000.0f / 925.0f));
-						irr::f32 smallripplingOnGround = ((hx + hy) / 2.0f) * oneMeter * 0.2f;
-
-						rTerrain.Height += smallripplingOnGround  + ((irr::os::Randomizer::rand() % 1000) / oneMeter * 0.03f);
-					}
-				}
-		}
-		break;
-	case 1: // = desert
-		{
-			for (int cx=0; cx<CellCountX; ++cx)
-				for (int cy=0; cy<CellCountY; ++cy)
-				{
-					STerrainData& rTerrain = TerrainData[getTerrainCellIndex(cx,cy)];
-					float x = (cx * (irr::f32)CellSize / oneMeter);
-					float y = (cy * (irr::f32)CellSize / oneMeter);
-
-					rTerrain.Height = 0.0f;
-					rTerrain.UserSetTextureIndex = 0;
-					rTerrain.MainTextureIndex = 0;
-					rTerrain.BlendingToTextureIndex = 0;
-
-					// tiny rippling effect:
-					const irr::f32 fact = 2.0f;
-					irr::f32 hx = sin(x / (irr::f32)(1000.0f / 925.0f));
-					irr::f32 hy = cos(y / (irr::f32)(1000.0f / 925.0f));
-					irr::f32 rippling = ((hx + hy) / 2.0f) * oneMeter * 1.1f;
-					// bigger hills	
-					irr::f32 hx2 = sin(x / (irr::f32)(1000.0f / 150.0f)) * (irr::f32)MaxHeight;
-					irr::f32 hy2 = cos(y / (irr::f32)(1000.0f / 150.0f)) * (irr::f32)MaxHeight;
-					irr::f32 hill = hx2 + hy2 / 2.0f;
-					rTerrain.Height = irr::core::clamp((hill + rippling), 0.0f, (irr::f32)MaxHeight);
-
-					if (rTerrain.Height < MaxHeight / 100.0f)
-					{
-						const irr::f32 fact = 2.0f;
-						irr::f32 hx = sin(x / (irr::f32)(1000.0f / 925.0f));
-						irr::f32 hy = cos(y / (irr::f32)(1000.0f / 925.0f));
-						irr::f32 smallripplingOnGround = ((hx + hy) / 2.0f) * oneMeter * 0.2f;
-
-						rTerrain.Height += smallripplingOnGround + ((irr::os::Randomizer::rand() % 1000) / oneMeter * 0.03f);
-					}
-				}
-		}
-		break;
-	case 2: // = flat
-		{
-			for (int x=0; x<CellCountX; ++x)
-				for (int y=0; y<CellCountY; ++y)
-				{
-					STerrainData& rTerrain = TerrainData[getTerrainCellIndex(x,y)];
-
-					rTerrain.Height = 0.0f;
-					rTerrain.UserSetTextureIndex = 0;
-					rTerrain.MainTextureIndex = 0;
-					rTerrain.BlendingToTextureIndex = 0;
-				}
-		}
-		break;
-	}
-
-
-	// paint some textures onto them
-
-	setThreeTexturesBasedOnHeight();
-
-
-	// create grass patch positions
-
-	GrassInstances.clear();
-
-	if (pGrassDistribution)
-		generateGrass(pGrassDistribution, nGrassDistributionCount);
-
-	
-	// create terrain meshes
-
-	createTerrainSceneNodes();
-	updateMeshesFromTerrainData();
-
-	recalculateBoundingBox();
-}
-
-
-void CFlaceTerrainSceneNode::generateGrass(SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount)
-{
-	if (pGrassDistribution)
-	{
-		for (int i=0; i<nGrassDistributionCount; ++i)
-		{
-			SGrassDistribution& rDist = pGrassDistribution[i];
-
-			if (irr::core::iszero(rDist.percentOfTerrainCoveredWithThis) ||
-				irr::core::iszero(rDist.height) ||
-				irr::core::iszero(rDist.width) ||
-				!rDist.Texture)
-			{
-				continue;
-			}
-
-			// find texture or add it 
-
-			irr::s32 nTexIndex = findTextureIndexOrAddNewOne(rDist.Texture);
-			
-			// calculate grass distribution
-			
-			int nGrassPatchesWanted = (int)(((SideLength * SideLength) / (rDist.width * rDist.width)) * (rDist.percentOfTerrainCoveredWithThis * 2.0f));
-
-			for (int nPatch=0; nPatch<nGrassPatchesWanted; ++nPatch)
-			{
-				const int fact = 100;
-				irr::f32 posx = ((irr::os::Randomizer::rand()) % ((SideLength - CellSize) * fact)) / (irr::f32)fact;
-				irr::f32 posy = ((irr::os::Randomizer::rand()) % ((SideLength - CellSize) * fact)) / (irr::f32)fact;
-
-				int cellX = (int)(posx / CellSize);
-				int cellY = (int)(posy / CellSize);
-
-				irr::f32 height = getTerrain3DPositionClamped(cellX, cellY).Y;
-				if (height > rDist.maxPosHeight)
-					continue;
-
-				// add grass patch
-
-				SGrassInstance instance;
-				instance.PosX = posx;
-				instance.PosZ = posy;
-				instance.Height = rDist.height;
-				instance.Width = rDist.width;
-				instance.Rotation = (irr::os::Randomizer::rand() % 1000) / 500.0f;
-				instance.TextureIndex = nTexIndex;
-
-				GrassInstances.push_back(instance);
-			}
-		}
-	}
-}
-
-// added by Robbo
-void CFlaceTerrainSceneNode::setTextureHeights(irr::f32 tTexLow, irr::f32 tTexMed)
-{
-	tTexHeightLow = tTexLow;
-	tTexHeightMed = tTexMed;
-	
-	// recalculate MaxHeight as may not be in memory
-	createTerrainDataSnapshot();
-	
-	// redo 3 textures and blending
-	setThreeTexturesBasedOnHeight();
-	updateMeshesFromTerrainData();
-	
-	// check vertex normals
-	// irr::u16 nIndexStart = buf->Vertices.size();
-	
-	if (tTexHeightLow == 0)
-	{
-		for (int vert=0; vert<Vertices.size(); ++vert)
-		{
-			irr::core::vector3df vert = buf->Vertices.normal;
-			float vLen = vert.getLength();
-			float angle = acos(vert.z/vLen);
-		}
-	}
-
-}
-
-// added by Robbo
-void CFlaceTerrainSceneNode::setTextureBlend(irr::s32 TexBlend)
-{
-	texBlend = TexBlend;
-	calculateBlendingAll(0,0,CellCountX,CellCountY);
-}
-
-
-void CFlaceTerrainSceneNode::setThreeTexturesBasedOnHeight()
-{
-	for (int x=0; x<CellCountX; ++x)
-		for (int y=0; y<CellCountY; ++y)
-		{
-			STerrainData& rTerrain = TerrainData[getTerrainCellIndex(x,y)];
-
-			if (rTerrain.Height < MaxHeight * tTexHeightLow) // RC
-				rTerrain.UserSetTextureIndex = 0;
-			else
-			if (rTerrain.Height < MaxHeight * tTexHeightMed) // RC
-				rTerrain.UserSetTextureIndex = 1;
-			else
-				rTerrain.UserSetTextureIndex = 2;
-
-			rTerrain.BlendFactorPerVertex[0] = 0;
-			rTerrain.BlendFactorPerVertex[1] = 0;
-			rTerrain.BlendFactorPerVertex[2] = 0;
-			rTerrain.BlendFactorPerVertex[3] = 0;
-		}
-
-	calculateBlendingFactors();
-}
-
-
-//! terrain to generate
-//! generates new terrain from heightmap
-void CFlaceTerrainSceneNode::loadHeightMap(irr::s32 sideLenX, irr::s32 sideLenY, irr::s32 cellSize, irr::f32* pData, 
-		irr::video::ITexture* pTextureGrass, irr::video::ITexture* pTextureRock,
-		irr::video::ITexture* pTextureSand, irr::video::ITexture* pGrassSpriteTexture)
-{
-	clearCurrentTerrainMeshes();
-	clearTerrainTextures();
-
-	// save textures
-
-	if (pTextureGrass)
-	{
-		Textures.push_back(pTextureGrass);
-		pTextureGrass->grab();
-	}
-
-	if (pTextureRock)
-	{
-		Textures.push_back(pTextureRock);
-		pTextureRock->grab();
-	}
-
-	if (pTextureSand)
-	{
-		Textures.push_back(pTextureSand);
-		pTextureSand->grab();
-	}
-
-	TextureScale = 0.006f;
-
-	// calculate sizes
-
-	CellSize = cellSize;
-	CellsPerTileSide = 35;
-	SideLength = irr::core::max_(sideLenX, sideLenY) * CellSize;	
-	MaxHeight = 0; 
-	TileSize = CellSize * CellsPerTileSide;
-
-	Displacement.X = -(SideLength / 2.0f);
-	Displacement.Y = 0.0f;
-	Displacement.Z = -(SideLength / 2.0f);
-	
-	TileCountX = (int)(SideLength / (irr::f32)(TileSize));
-	TileCountY = (int)(SideLength / (irr::f32)(TileSize));
-
-	if (TileCountX <= 0) TileCountX = 1;
-	if (TileCountY <= 0) TileCountY = 1;
-
-	SideLength = TileCountX * TileSize;
-
-	CellCountX = TileCountX * CellsPerTileSide;
-	CellCountY = TileCountY * CellsPerTileSide;
-
-	// set initial terrain data
-
-	int nTotalCellCount = CellCountX * CellCountY;
-	TerrainData.set_used_construct(nTotalCellCount);
-
-	for (int cx=0; cx<CellCountX; ++cx)
-		for (int cy=0; cy<CellCountY; ++cy)
-		{			
-			STerrainData& rTerrain = TerrainData[getTerrainCellIndex(cx,cy)];
-
-			int x = irr::core::clamp(cx, 0, sideLenX);
-			int y = irr::core::clamp(cy, 0, sideLenY);
-
-			rTerrain.Height = pData[(y * sideLenX) + x];
-			rTerrain.UserSetTextureIndex = 0;
-			rTerrain.MainTextureIndex = 0;
-			rTerrain.BlendingToTextureIndex = 0;
-
-			MaxHeight = (int)irr::core::max_((irr::f32)MaxHeight, rTerrain.Height);
-		}	
-
-	if (pTextureGrass && pTextureRock && pTextureSand)
-		setThreeTexturesBasedOnHeight();
-	else
-		calculateBlendingFactors();
-
-
-	// create grass 
-
-	GrassInstances.clear();
-
-	if (pGrassSpriteTexture)
-	{
-		SGrassDistribution GrassDistribution;
-		GrassDistribution.percentOfTerrainCoveredWithThis = 0.8f;
-		GrassDistribution.Texture = pGrassSpriteTexture;
-		GrassDistribution.height = 17.0f;
-		GrassDistribution.width = 20.0f;
-		GrassDistribution.maxPosHeight = MaxHeight * tTexHeightLow * 0.9f; // RC
-
-		generateGrass(&GrassDistribution, 1);
-	}
-	
-	// create terrain meshes
-
-	createTerrainSceneNodes();
-	updateMeshesFromTerrainData();
-
-	recalculateBoundingBox();
-}
-
-
-irr::s32 CFlaceTerrainSceneNode::getTerrainMeshIndex(irr::s32 tileX, irr::s32 tileY)
-{
-	return (tileY*TileCountX)+tileX;
-}
-
-irr::s32 CFlaceTerrainSceneNode::getTerrainCellIndex(irr::s32 cellX, irr::s32 cellY)
-{
-	return (cellY*CellCountX)+cellX;
-}
-
-irr::scene::SMesh* CFlaceTerrainSceneNode::getTerrainTileMesh(irr::s32 tileX, irr::s32 tileY)
-{
-	irr::s32 idx = getTerrainMeshIndex(tileX, tileY);
-	if (idx < 0 || idx >= (irr::s32)TerrainTiles.size())
-		return 0;
-
-	CFlaceMeshSceneNode* node = TerrainTiles[idx];
-	if (!node)
-		return 0;
-
-	return node->getOwnedMesh();
-}
-
-CFlaceMeshSceneNode* CFlaceTerrainSceneNode::getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(irr::f32 pixelX, irr::f32 pixelZ)
-{
-	int tilex = (irr::core::clamp((int)((pixelX - Displacement.X) / (irr::f32)TileSize), 0, TileCountX-1));
-	int tiley = (irr::core::clamp((int)((pixelZ - Displacement.Z) / (irr::f32)TileSize), 0, TileCountY-1));
-
-	return getTerrainTileMeshSceneNode(tilex, tiley);
-}
-
-
-CFlaceMeshSceneNode* CFlaceTerrainSceneNode::getTerrainTileMeshSceneNode(irr::s32 tileX, irr::s32 tileY)
-{
-	irr::s32 idx = getTerrainMeshIndex(tileX, tileY);
-	if (idx < 0 || idx >= (irr::s32)TerrainTiles.size())
-		return 0;
-
-	return TerrainTiles[idx];
-}
-
-
-CFlaceTerrainSceneNode::STerrainData* CFlaceTerrainSceneNode::getTerrainData(irr::s32 globalCellX, irr::s32 globalCellY)
-{
-	if (globalCellX < 0 || globalCellY < 0 || globalCellX > CellCountX-1 || globalCellY > CellCountX-1)
-		return 0;
-
-	irr::s32 idx = getTerrainCellIndex(globalCellX, globalCellY);
-	if (idx < 0 || idx >= (int)TerrainData.size())
-		return 0;
-
-	return &TerrainData[idx];
-}
-
-
-CFlaceTerrainSceneNode::STerrainData* CFlaceTerrainSceneNode::getTerrainDataClamped(irr::s32 globalCellX, irr::s32 globalCellY)
-{
-	return getTerrainData(irr::core::clamp(globalCellX, 0, CellCountX-1), 
-						  irr::core::clamp(globalCellY, 0, CellCountY-1));
-}
-
-
-irr::f32 CFlaceTerrainSceneNode::getTerrainDataHeightClamped(irr::s32 globalCellX, irr::s32 globalCellY)
-{	
-	STerrainData* t = getTerrainDataClamped(globalCellX, globalCellY);
-	if (t)
-		return t->Height;
-
-	return 0.0f;
-}
-
-//! returns the exact height of a position in the terrain, even if the position is not exactly at the vertex of a polygon. 
-//! It is very fast for querying the height, as opposed to using Irrlicht's collision methods (which would have to iterate all triangles).
-//! Also, if the position given is outside of the terrain, a height at the nearest border is returned.
-irr::f32 CFlaceTerrainSceneNode::getExactTerrainHeightClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY, irr::core::vector3df* outNormal)
-{
-	if (!CellSize)
-		return 0.0f;
-
-	int vertexCellx = (int)(globalPixelX / CellSize);
-	int vertexCelly = (int)(globalPixelY / CellSize);	
-
-	irr::core::vector3df posx1 = getTerrain3DPositionClamped(vertexCellx, vertexCelly) - Displacement;
-	irr::core::vector3df posx2 = getTerrain3DPositionClamped(vertexCellx+1, vertexCelly) - Displacement;
-	irr::core::vector3df posy2 = getTerrain3DPositionClamped(vertexCellx, vertexCelly+1) - Displacement;
-
-	irr::core::vector3df linepoint(globalPixelX, 0, globalPixelY);
-	irr::core::vector3df collision;
-
-	irr::core::triangle3df tri(posx1, posx2, posy2);
-	if (tri.getIntersectionOfPlaneWithLine(linepoint, irr::core::vector3df(0,1,0), collision))
-	{
-		irr::core::vector3df c = tri.closestPointOnTriangle(collision);
-
-		if (!irr::core::equals(c.X, globalPixelX) || !irr::core::equals(c.Z, globalPixelY))
-		{
-			// the resulting collision point is not on the triangle anymore, so use the other triangle for collision
-
-			irr::core::vector3df posy3 = getTerrain3DPositionClamped(vertexCellx+1, vertexCelly+1) - Displacement;
-			tri.set(posx1, posx2, posy3);
-
-			if (tri.getIntersectionOfPlaneWithLine(linepoint, irr::core::vector3df(0,1,0), collision))
-			{
-				if (outNormal)
-					*outNormal = tri.getPlane().Normal;
-
-				irr::core::vector3df c2 = tri.closestPointOnTriangle(collision);
-
-				return c2.Y;
-			}
-		}
-
-		if (outNormal)
-			*outNormal = tri.getPlane().Normal;
-
-		return c.Y;
-	}
-
-	return 0.0f;
-}
-
-
-irr::core::vector3df CFlaceTerrainSceneNode::getTerrain3DPositionClamped(irr::s32 globalCellX, irr::s32 globalCellY)
-{
-	irr::core::vector3df v(0,0,0);
-
-	irr::s32 cx = irr::core::clamp(globalCellX, 0, CellCountX-1);
-	irr::s32 cy = irr::core::clamp(globalCellY, 0, CellCountY-1);
-
-	v.Y = TerrainData[getTerrainCellIndex(cx, cy)].Height;
-
-	v.X = (irr::f32)(cx) * CellSize;
-	v.Z = (irr::f32)(cy) * CellSize;		
-
-	v += Displacement;
-
-	return v;
-}
-
-
-void CFlaceTerrainSceneNode::createTerrainSceneNodes()
-{
-	irr::s32 nTileCount = TileCountX * TileCountY;
-
-	if (TerrainTiles.size() != nTileCount)
-	{
-		clearCurrentTerrainMeshes();
-
-		for (int i=0; i<nTileCount; ++i)
-		{
-			CFlaceMeshSceneNode* meshNode = new CFlaceMeshSceneNode(0, 0, this, SceneManager, -1);
-			meshNode->setAutomaticCulling(irr::scene::EAC_FRUSTUM_BOX);
-			meshNode->setUseOwnedMesh(true);
-			meshNode->setReceivesStaticShadows(false);
-			setUniqueIdForSceneNode(meshNode, SceneManager);
-			TerrainTiles.push_back(meshNode);
-		}
-	}
-}
-
-void CFlaceTerrainSceneNode::clearCachedCollisionTrianglesFromTerrainMeshes()
-{
-	for (int i=0; i<(int)TerrainTiles.size(); ++i)
-	{
-		if (TerrainTiles[i])
-			TerrainTiles[i]->setTriangleSelector(0);
-	}
-}
-
-void CFlaceTerrainSceneNode::createCollisionTrianglesForTerrainMeshes()
-{
-	for (int i=0; i<(int)TerrainTiles.size(); ++i)
-	{
-		CFlaceMeshSceneNode* mesh = TerrainTiles[i];
-		if (mesh && !mesh->getTriangleSelector())
-		{
-			irr::scene::ITriangleSelector* selector = SceneManager->createTriangleSelector(mesh->getMesh(), mesh, true);
-			if (selector)
-			{
-				mesh->setTriangleSelector(selector);
-				selector->drop();
-			}
-		}
-	}
-}
-
-irr::scene::SMeshBuffer* CFlaceTerrainSceneNode::getOrCreateMeshBuffer(irr::scene::SMesh* mesh, 
-																	   irr::s32 mainTextureIndex, 
-																	   irr::s32 blendingToTextureIndex,
-																	   irr::s32 nWithFreeVertices, 
-																	   irr::s32 nWithFreeIndices,
-																	   bool forGrass)
-{
-	if (!mesh)
-		return 0;
-
-	irr::video::ITexture* tex1 = 0;
-	irr::video::ITexture* tex2 = 0;
-
-	if (mainTextureIndex >= 0 && mainTextureIndex < (int)Textures.size())
-		tex1 = Textures[mainTextureIndex];
-	if (blendingToTextureIndex >= 0 && blendingToTextureIndex < (int)Textures.size())
-		tex2 = Textures[blendingToTextureIndex];
-
-	if (tex1 == tex2)
-		tex2 = 0;
-
-	irr::video::E_MATERIAL_TYPE grassMat =  GrassUsesWind ? 
-												irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF_MOVING_GRASS : 
-												irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
-
-	for (int i=0; i<(int)mesh->MeshBuffers.size(); ++i)
-	{
-		if (mesh->MeshBuffers[i]->getVertexType() != irr::video::EVT_STANDARD)
-			continue; // probably created by the light mapper, we ignore those now
-
-		irr::scene::SMeshBuffer* buf = (irr::scene::SMeshBuffer*)mesh->MeshBuffers[i];
-
-		if (buf->Material.getTexture(0) == tex1 &&
-			buf->Material.getTexture(1) == tex2 &&
-			( (  forGrass && buf->Material.MaterialType == grassMat ) ||
-			  ( !forGrass && buf->Material.MaterialType != grassMat ) )
-		   )
-		{
-			if (buf->getVertexCount() + nWithFreeVertices < 65536 &&
-				buf->getIndexCount()  + nWithFreeIndices  < 65536 )
-			{
-				return buf;
-			}
-		}
-	}
-
-	// not found, create new one
-
-	irr::scene::SMeshBuffer* buffer = new irr::scene::SMeshBuffer();
-
-	if (forGrass)
-	{
-		buffer->Material.MaterialType = GrassUsesWind ?
-			irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF_MOVING_GRASS :
-			irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
-		buffer->Material.MaterialTypeParam = 0.5f;
-		buffer->Material.BackfaceCulling = false; // grass is double sided
-	}
-	else
-		if (tex2 == 0)
-			buffer->Material.MaterialType = irr::video::EMT_SOLID;
-		else
-			buffer->Material.MaterialType = irr::video::EMT_SOLID_VERTEX_ALPHA_TWO_TEXTURE_BLEND;
-
-	buffer->Material.setTexture(0, tex1);
-	buffer->Material.setTexture(1, tex2);
-	
-	if (LightingType == ETLT_DYNAMIC)
-		buffer->Material.Lighting = true;
-	else
-		buffer->Material.Lighting = false;
-	
-	mesh->addMeshBuffer(buffer);
-
-	buffer->drop();
-
-	return buffer;
-}
-
-void CFlaceTerrainSceneNode::updateMeshesFromTerrainData()
-{
-	updateMeshesFromTerrainData(0, 0, CellCountX, CellCountY);	
-}
-
-
-void CFlaceTerrainSceneNode::updateMeshesFromTerrainData(int startCellX, int startCellY, int endCellX, int endCellY)
-{
-	createTerrainSceneNodes();
-
-	irr::core::rect<irr::s32> rectAffected(startCellX, startCellY, endCellX, endCellY);
-
-	irr::video::SColor clr = video::DefaultWhiteColor;
-
-	// update tiles
-
-	for (int tileX=0; tileX<TileCountX; ++tileX)
-	{
-		for (int tileY=0; tileY<TileCountY; ++tileY)
-		{
-			// check if this tile is actually affected. If not, we can skip it
-
-			irr::core::rect<irr::s32> rectContainedByTile(tileX * CellsPerTileSide, tileY * CellsPerTileSide, (tileX+1) * CellsPerTileSide, (tileY+1) * CellsPerTileSide);
-			if (!rectContainedByTile.isRectCollided(rectAffected))
-				continue;
-
-			// clear cached collision geometry
-
-			CFlaceMeshSceneNode* node = getTerrainTileMeshSceneNode(tileX, tileY);
-			if (node)
-				node->setTriangleSelector(0); 
-
-			// create new geometry
-
-			irr::scene::SMesh* mesh = getTerrainTileMesh(tileX, tileY);
-			if (mesh)
-			{
-				// clear mesh buffers
-
-				for (u32 im=0; im<mesh->MeshBuffers.size(); ++im)
-					if (mesh->MeshBuffers[im])
-						mesh->MeshBuffers[im]->drop();
-				mesh->MeshBuffers.clear();
-
-				// now go through all cells of this tile and create vertices for them
-
-				for (int x=0; x<CellsPerTileSide; ++x)
-				{
-					for (int y=0; y<CellsPerTileSide; ++y)
-					{
-						irr::s32 globalCellX = (tileX*CellsPerTileSide) + x;
-						irr::s32 globalCellY = (tileY*CellsPerTileSide) + y;
-
-						STerrainData* terrainData = getTerrainData(globalCellX, globalCellY);
-
-						irr::scene::SMeshBuffer* buf = getOrCreateMeshBuffer(mesh, terrainData->MainTextureIndex, terrainData->BlendingToTextureIndex, 4, 6, false);
-						if (buf)
-						{
-							irr::video::S3DVertex vtx;
-
-							// the height for each cell is not in the center of the tile. Otherwise we would get steps in the terrain.
-							// so the height is in the upper left corner = the first vertex. The height of the other vertices needs to be 
-							// taken from the neighbouring terrain datas.
-							//
-							// vertices are this:
-							//
-							// 0 ------ 1
-							// | \      |
-							// |   \    |
-							// |     \  |
-							// 2 ------ 3
-
-							irr::u16 nIndexStart = buf->Vertices.size();
-
-							irr::s32 displaceX[4] = {0,1,0,1};
-							irr::s32 displaceY[4] = {0,0,1,1};
-
-							for (int vertex=0; vertex<4; ++vertex)
-							{
-								int vertexCellx = globalCellX+displaceX[vertex];
-								int vertexCelly = globalCellY+displaceY[vertex];
-
-								vtx.Pos = getTerrain3DPositionClamped(vertexCellx, vertexCelly);
-
-								vtx.TCoords.X = vtx.Pos.X * TextureScale;
-								vtx.TCoords.Y = vtx.Pos.Z * TextureScale;
-
-								vtx.Color.set(terrainData->BlendFactorPerVertex[vertex], clr.getRed(), clr.getGreen(), clr.getBlue());
-
-								// calculate normal
-
-								irr::core::vector3df posTop = getTerrain3DPositionClamped(vertexCellx, vertexCelly-1);
-								irr::core::vector3df posBottom = getTerrain3DPositionClamped(vertexCellx, vertexCelly+1);
-								irr::core::vector3df posLeft = getTerrain3DPositionClamped(vertexCellx-1, vertexCelly);
-								irr::core::vector3df posRight = getTerrain3DPositionClamped(vertexCellx+1, vertexCelly);
-
-								core::vector3df normal;
-								normal += core::plane3d<f32>(posTop, vtx.Pos, posLeft).Normal;
-								normal += core::plane3d<f32>(posTop, posRight, vtx.Pos).Normal;
-								normal += core::plane3d<f32>(vtx.Pos, posRight, posBottom).Normal;
-								normal += core::plane3d<f32>(vtx.Pos, posBottom, posLeft).Normal;
-
-								normal.normalize();
-								vtx.Normal = normal * -1.0f;
-
-								// add vertex
-
-								buf->Vertices.push_back(vtx);
-							}
-							
-							buf->Indices.push_back(nIndexStart);
-							buf->Indices.push_back(nIndexStart + 3);
-							buf->Indices.push_back(nIndexStart + 1);
-
-							buf->Indices.push_back(nIndexStart);
-							buf->Indices.push_back(nIndexStart + 2);
-							buf->Indices.push_back(nIndexStart + 3);
-						}
-
-					} // end for y cells
-				}	// end for x cells
-
-
-				// TODO: recalculating bounding box can be done in O(1) by using the cell sizes
-
-				for (u32 i=0; i<mesh->MeshBuffers.size(); ++i)
-					mesh->MeshBuffers[i]->recalculateBoundingBox();
-
-				mesh->recalculateBoundingBox();
-				
-			} // end if mesh
-
-		} // end for y tiles
-
-	} // end for x tiles
-
-
-	// update grass patches
-
-	irr::video::SColor clrGrass = video::DefaultWhiteColor;
-
-	for (int i=0; i<(int)GrassInstances.size(); ++i)
-	{
-		SGrassInstance& g = GrassInstances[i];
-
-		int tileX = (int)(g.PosX / TileSize);
-		int tileY = (int)(g.PosZ / TileSize);
-
-		// check if this tile is actually affected. If not, we can skip it
-
-		irr::core::rect<irr::s32> rectContainedByTile(tileX * CellsPerTileSide, tileY * CellsPerTileSide, (tileX+1) * CellsPerTileSide, (tileY+1) * CellsPerTileSide);
-		if (!rectContainedByTile.isRectCollided(rectAffected))
-			continue;
-
-		irr::scene::SMesh* mesh = getTerrainTileMesh(tileX, tileY);
-		if (mesh)
-		{
-			int vertexCellx = (int)(g.PosX / CellSize);
-			int vertexCelly = (int)(g.PosZ / CellSize);
-
-			irr::core::vector3df normal;
-			irr::f32 height = getExactTerrainHeightClampedAtPosition(g.PosX, g.PosZ, &normal);
-
-			if (normal.getLength() > 0)
-			{
-				normal.normalize();
-				normal *= -1.0f;
-			}
-			else
-				normal.set(0,1,0);
-
-			irr::scene::SMeshBuffer* buf = getOrCreateMeshBuffer(mesh, g.TextureIndex, g.TextureIndex, 16, 24, true);
-			if (buf)
-			{		
-				irr::core::vector3df pos(g.PosX + Displacement.X, height, g.PosZ + Displacement.Z);
-
-				for (int axis=0; axis<2; ++axis)
-				{
-					for (int backface=0; backface<1; ++backface)
-					{
-						irr::u16 nIndexStart = buf->Vertices.size();
-
-						irr::f32 r = g.Rotation;
-						if (axis == 1) r += 1.34f;
-
-						irr::video::S3DVertex vtx1;
-						vtx1.Color = clrGrass;
-						vtx1.TCoords.X = 0.0f;
-						vtx1.TCoords.Y = 1.0f;
-						vtx1.Pos.X = pos.X + sin(r) * g.Width * 0.5f;
-						vtx1.Pos.Y = height;
-						vtx1.Pos.Z = pos.Z + cos(r) * g.Width * 0.5f;
-						
-						irr::video::S3DVertex vtx2;
-						vtx2.Color = clrGrass;
-						vtx2.TCoords.X = 1.0f;
-						vtx2.TCoords.Y = 1.0f;
-						vtx2.Pos.X = pos.X - sin(r) * g.Width * 0.5f;
-						vtx2.Pos.Y = height;
-						vtx2.Pos.Z = pos.Z - cos(r) * g.Width * 0.5f;
-						
-						irr::video::S3DVertex vtx3;
-						vtx3.Color = clrGrass;
-						vtx3.TCoords.X = 0.0f;
-						vtx3.TCoords.Y = 0.0f;
-						vtx3.Pos.X = pos.X + sin(r) * g.Width * 0.5f;
-						vtx3.Pos.Y = height + g.Height;
-						vtx3.Pos.Z = pos.Z + cos(r) * g.Width * 0.5f;
-						
-						irr::video::S3DVertex vtx4;
-						vtx4.Color = clrGrass;
-						vtx4.TCoords.X = 1.0f;
-						vtx4.TCoords.Y = 0.0f;
-						vtx4.Pos.X = pos.X - sin(r) * g.Width * 0.5f;
-						vtx4.Pos.Y = height + g.Height;
-						vtx4.Pos.Z = pos.Z - cos(r) * g.Width * 0.5f;				
-
-						vtx1.Normal = normal;
-						vtx2.Normal = normal;
-						vtx3.Normal = normal;
-						vtx4.Normal = normal;
-
-						buf->Vertices.push_back(vtx1);
-						buf->Vertices.push_back(vtx2);
-						buf->Vertices.push_back(vtx3);
-						buf->Vertices.push_back(vtx4);
-						
-						const int indicesFront[] = {2,1,0, 2,3,1};
-						const int indicesBack[]  = {2,0,1, 2,1,3};
-						int* indices = (int*)indicesFront;
-						if (backface > 0)
-							indices = (int*)indicesBack;
-
-						for (int ind=0; ind<6; ++ind)
-							buf->Indices.push_back(nIndexStart + indices[ind]);
-					}
-				}
-			}
-		}
-	}
-}
-
-void CFlaceTerrainSceneNode::calculateBlendingFactors()
-{
-	calculateBlendingFactors(0, 0, CellCountX, CellCountY);	
-}
-
-void CFlaceTerrainSceneNode::calculateBlendingFactors(int startCellX, int startCellY, int endCellX, int endCellY)
-{
-	if (startCellX < 0)
-		startCellX = 0;
-
-	if (startCellY < 0)
-		startCellY = 0;
-
-	if (endCellX > CellCountX)
-		endCellX = CellCountX;
-
-	if (endCellY > CellCountY)
-		endCellY = CellCountY;
-
-	// for all terrain data points,
-	// calculate best target texture to blend to from the main texture, 
-	// and also at what vertex and with what blending factor
-	// 0 ------ 1
-	// | \      |
-	// |   \    |
-	// |     \  |
-	// 2 ------ 3
-
-	// it works like this:
-	// we always look at 4 tiles at the same time, and blend between what the user set there, to make it
-	// look as close as possible to what the user wanted to have.
-
-	// clear to defaults, if the terrain has no factor of 4 size
-
-	for (int x=startCellX; x<endCellX; ++x)
-		for (int y=startCellY; y<endCellY; ++y)
-		{
-			STerrainData* current = &TerrainData[getTerrainCellIndex(x,y)]; 
-			current->MainTextureIndex = current->UserSetTextureIndex;
-			current->BlendingToTextureIndex = current->UserSetTextureIndex;
-			current->BlendFactorPerVertex[0] = 0;
-			current->BlendFactorPerVertex[1] = 0;
-			current->BlendFactorPerVertex[2] = 0;
-			current->BlendFactorPerVertex[3] = 0;
-		}
-
-	for (int x=startCellX; x<endCellX; ++x)
-	{
-		for (int y=startCellY; y<endCellY; ++y)
-		{
-			STerrainData& current = TerrainData[getTerrainCellIndex(x,y)];
-
-			// check if this is a border element
-			
-			int otherTexture = current.UserSetTextureIndex;
-			bool isBorderElement = false;
-			irr::core::position2di posFound(0,0);
-
-			for (int nx=x-1; nx<x+2; ++nx)
-				for (int ny=y-1; ny<y+2; ++ny)
-				{
-					STerrainData* pOther = getTerrainDataClamped(nx,ny);
-					if (pOther->UserSetTextureIndex > current.UserSetTextureIndex)
-					{
-						otherTexture = pOther->UserSetTextureIndex;
-						isBorderElement = true;
-						break;
-					}
-				}
-
-			// based on where the other texture is, set blending factors
-			// vertices: 
-			// 0 ------ 1
-			// | \      |
-			// |   \    |
-			// |     \  |
-			// 2 ------ 3
-
-			// indices to set to blending if a border element is set,
-			// based on location of other target. If any entry is 1,
-			// blending needs to be set for this vertex.
-
-				
-			irr::s32 indicesToSetToBlending[9][4] = 
-				{{1,0,0,0}, {1,1,0,0}, {0,1,0,0},
-				 {1,0,1,0}, {0,0,0,0}, {0,1,0,1},
-				 {0,0,1,0}, {0,0,1,1}, {0,0,0,1}};
-
-			if (isBorderElement)
-			{
-				irr::s32 idx = -1;
-				for (int ny=y-1; ny<y+2; ++ny)
-					for (int nx=x-1; nx<x+2; ++nx)					
-					{
-						++idx;
-
-						STerrainData* pOther = getTerrainDataClamped(nx,ny);
-
-						if (pOther->UserSetTextureIndex != current.UserSetTextureIndex)
-						{
-							irr::s32* indicesToSet = indicesToSetToBlending[idx];
-
-							for (int vtxidx=0; vtxidx<4; ++vtxidx)
-							{
-								if (indicesToSet[vtxidx] != 0)
-									current.BlendFactorPerVertex[vtxidx] = 255;
-							}
-						}
-					}
-
-				current.MainTextureIndex = current.UserSetTextureIndex;
-				current.BlendingToTextureIndex = otherTexture;
-			}
-			else
-			{
-				// no blending necessary
-				current.BlendFactorPerVertex[0] = 0; 
-				current.BlendFactorPerVertex[1] = 0; 
-				current.BlendFactorPerVertex[2] = 0; 
-				current.BlendFactorPerVertex[3] = 0; 
-				current.BlendingToTextureIndex = current.MainTextureIndex;
-			}
-		}
-	}
-}
-
-
-
-void CFlaceTerrainSceneNode::calculateBlendingAll(int startCellX, int startCellY, int endCellX, int endCellY)
-{
-	
-	for (int x=startCellX; x<endCellX; ++x)
-	{
-		for (int y=startCellY; y<endCellY; ++y)
-		{
-			STerrainData& current = TerrainData[getTerrainCellIndex(x,y)];
-
-			int otherTexture = current.UserSetTextureIndex;
-			irr::core::position2di posFound(0,0);
-
-			for (int nx=x-1; nx<x+2; ++nx)
-				for (int ny=y-1; ny<y+2; ++ny)
-				{
-					STerrainData* pOther = getTerrainDataClamped(nx,ny);
-				}
-
-			irr::s32 indicesToSetToBlending[9][4] = 
-				{{1,0,0,0}, {1,1,0,0}, {0,1,0,0},
-				 {1,0,1,0}, {0,0,0,0}, {0,1,0,1},
-				 {0,0,1,0}, {0,0,1,1}, {0,0,0,1}};
-
-				irr::s32 idx = -1;
-				for (int ny=y-1; ny<y+2; ++ny)
-					for (int nx=x-1; nx<x+2; ++nx)					
-					{
-						++idx;
-
-						STerrainData* pOther = getTerrainDataClamped(nx,ny);
-
-						if (pOther->UserSetTextureIndex != current.UserSetTextureIndex)
-						{
-							irr::s32* indicesToSet = indicesToSetToBlending[idx];
-
-							for (int vtxidx=0; vtxidx<4; ++vtxidx)
-							{
-								if (indicesToSet[vtxidx] != 0)
-									current.BlendFactorPerVertex[vtxidx] = texBlend;
-							}
-						}
-					}
-				current.MainTextureIndex = current.UserSetTextureIndex;
-				current.BlendingToTextureIndex = otherTexture;
-		}
-	}
-}
-
-
-
-
-//! Returns the material based on the zero based index i.
-irr::video::SMaterial& CFlaceTerrainSceneNode::getMaterial(u32 num)
-{
-	syncMaterials();
-
-	if (num >= 0 && num < DummyMaterials.size())
-		return DummyMaterials[num];
-
-	return *((video::SMaterial*)0);
-}
-
-//! Get amount of materials used by this scene node.
-irr::u32 CFlaceTerrainSceneNode::getMaterialCount() const
-{
-	return (irr::u32)Textures.size();
-}
-
-//! ensures data shown in dummy material array is the same as in the textures
-void CFlaceTerrainSceneNode::syncMaterials()
-{
-	while(Textures.size() > DummyMaterials.size())
-		DummyMaterials.push_back(irr::video::SMaterial());
-
-	while(Textures.size() < DummyMaterials.size())
-		DummyMaterials.erase(DummyMaterials.size() - 1);
-
-	for (int i=0; i<(int)Textures.size(); ++i)
-	{
-		irr::video::SMaterial& rMatDummy = DummyMaterials[i];
-		if (rMatDummy.getTexture(0) != Textures[i])
-			rMatDummy.setTexture(0, Textures[i]);
-	}
-}
-
-void CFlaceTerrainSceneNode::replaceTexture(int idx, irr::video::ITexture* newtexture, IUndoManager* undo)
-{
-	if (idx < 0 || idx >= (int)Textures.size())
-		return;	
-
-	// record material change
-
-	irr::video::ITexture* texBefore = Textures[idx];
-	
-	if (newtexture == texBefore)
-		return;		
-
-	if (undo)
-	{
-		undo->addUndoPartChangeTerrainTexture(this, texBefore, newtexture, idx);
-	}
-
-	if (Textures[idx])
-		Textures[idx]->drop();
-
-	Textures[idx] = newtexture;
-
-	if (Textures[idx])
-		Textures[idx]->grab();
-
-	// set textures
-
-	syncMaterials();
-
-	// also change for all terrain meshes
-
-	updateMeshesFromTerrainData();
-}
-
-
-CFlaceTerrainSceneNode::E_TERRAIN_LIGHTING_TYPE CFlaceTerrainSceneNode::getLightingType()
-{
-	return ETLT_DYNAMIC;
-}
-
-
-void CFlaceTerrainSceneNode::setLightingType(E_TERRAIN_LIGHTING_TYPE nType, IUndoManager* undo)
-{
-	if (nType != LightingType)
-	{
-		if (undo)
-			undo->addUndoPartChangeTerrainLighting(this, LightingType, nType);
-
-		LightingType = nType;
-
-		updateMeshesFromTerrainData();
-	}
-}
-
-void CFlaceTerrainSceneNode::distributeMeshes(irr::scene::IAnimatedMesh* tree, irr::f32 distribution, 
-											  IUndoManager* undo, const irr::c8* basename)
-{
-	if (!tree || distribution < 0.001f)
-		return;
-
-	irr::scene::IMesh* mesh = tree->getMesh(0);
-	if (!mesh)
-		return;
-
-	irr::core::aabbox3df box = mesh->getBoundingBox();
-
-	float treeWidth = box.getExtent().X;
-	float treeDepth = box.getExtent().Z;
-	float treeHeight = box.getExtent().Y;
-
-	if (treeWidth < 1) treeWidth = 1;
-	if (treeDepth < 1) treeDepth = 1;
-
-	int nTreesWanted = (int)(((SideLength * SideLength) / (treeWidth * treeDepth)) * distribution);
-	if (nTreesWanted > 500)
-		nTreesWanted = 500;
-
-	for (int nTree=0; nTree<nTreesWanted; ++nTree)
-	{
-		irr::core::vector3df pos;
-		irr::core::vector3df rot;
-
-		rot.Y = irr::os::Randomizer::randFloat() * 360.0f;
-
-		const int fact = 100;
-		pos.X = ((irr::os::Randomizer::rand()) % ((SideLength - CellSize) * fact)) / (irr::f32)fact;
-		pos.Z = ((irr::os::Randomizer::rand()) % ((SideLength - CellSize) * fact)) / (irr::f32)fact;
-
-		pos.Y = getExactTerrainHeightClampedAtPosition(pos.X, pos.Z);
-
-		pos += Displacement;
-		pos.Y -= treeHeight * 0.025f; // so that the tree doesn't float in hills
-
-		CFlaceMeshSceneNode* tileNode = getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(pos.X, pos.Z);
-		if (!tileNode)
-		{
-			// something went wrong
-			continue;
-		}
-
-		CFlaceAnimatedMeshSceneNode* node = new CFlaceAnimatedMeshSceneNode(undo, tree, tileNode, 
-				getSceneManager(), -1, pos, rot);		
-
-		setUniqueIdForSceneNode(node, getSceneManager());
-		setUniqueNameForSceneNode(node, basename, getSceneManager());
-
-		if (getLightingType() == ETLT_DYNAMIC)
-		{
-			for (int i=0; i<(int)node->getMaterialCount(); ++i)
-				node->getMaterial(i).Lighting = true;
-		}
-
-		node->drop();
-	}
-}
-
-
-bool CFlaceTerrainSceneNode::getSelectedTerrainTileFromScreenCoords(int x, int y, irr::core::vector2di& rOut)
-{
-	irr::core::line3df line = 
-		SceneManager->getSceneCollisionManager()->getRayFromScreenCoordinates(irr::core::position2di(x,y), SceneManager->getActiveCamera());
-
-	if (line.start.equals(irr::core::vector3df(0,0,0)))
-		return false;
-
-	createCollisionTrianglesForTerrainMeshes();	
-
-	irr::core::vector3df closestCollisionPoint;
-	irr::f32 nearestDistance = 9999999999.9f;
-	bool collisionFound = false;
-
-	for (int i=0; i<(int)TerrainTiles.size(); ++i)
-	{
-		CFlaceMeshSceneNode* mesh = TerrainTiles[i];
-		if (mesh && mesh->getTriangleSelector() &&
-			mesh->getBoundingBox().intersectsWithLine(line)) // <- we can safely check if the line collides with 
-															 // the non transformed bounding box, because terrain
-															 // always is at position (0,0,0) with no transformation
-															 // applied
-		{
-			irr::core::vector3df collisionPoint;
-			irr::core::triangle3df tri;
-
-			if (SceneManager->getSceneCollisionManager()->getCollisionPoint(line, 
-						mesh->getTriangleSelector(), collisionPoint, tri, true))
-			{
-				irr::f32 distance = collisionPoint.getDistanceFrom(line.start);
-
-				if (distance < nearestDistance)
-				{
-					nearestDistance = distance;
-					closestCollisionPoint = collisionPoint;
-					collisionFound = true;
-				}				
-			}
-		}
-	}
-
-	if (!collisionFound)
-		return false;
-
-	// now get all tiles starting with this collision point
-
-	int tileX = (int)((closestCollisionPoint.X - Displacement.X) / CellSize);
-	int tileY = (int)((closestCollisionPoint.Z - Displacement.Z) / CellSize);
-
-	rOut.set(tileX, tileY);
-	return true;
-}
-
-
-void CFlaceTerrainSceneNode::drawEditBrushSelection(irr::core::vector2di tile,
-													irr::video::SColor clr, irr::f32 brushSize)
-{
-	video::SMaterial m;
-	m.Lighting = false;
-	m.ZBuffer = false;
-	Driver->setMaterial(m);
-
-	irr::core::matrix4 mat;
-	Driver->setTransform(video::ETS_WORLD, mat);
-
-
-	for (int x=0; x<(int)brushSize; ++x)
-	{
-		for (int y=0; y<(int)brushSize; ++y)
-		{
-			int cTileX = tile.X + x - (int)(brushSize/2);
-			int cTileY = tile.Y + y - (int)(brushSize/2);
-
-			irr::core::vector2di displacements[4] = { 
-				irr::core::vector2di(0,0), irr::core::vector2di(1,0), irr::core::vector2di(0,1), irr::core::vector2di(1,1) };
-			irr::core::vector3df vects[4];
-
-			for (int i=0; i<4; ++i)
-			{
-				STerrainData* pData = getTerrainDataClamped(cTileX + displacements[i].X, cTileY + displacements[i].Y);
-
-				vects[i].X = ((cTileX + displacements[i].X) * CellSize) + Displacement.X;
-				vects[i].Y = pData->Height + Displacement.Y;
-				vects[i].Z = ((cTileY + displacements[i].Y) * CellSize) + Displacement.Z;
-			}	
-
-			Driver->draw3DLine(vects[0], vects[1], clr);
-			Driver->draw3DLine(vects[1], vects[3], clr);
-
-			if (y == (int)brushSize-1)
-				Driver->draw3DLine(vects[2], vects[3], clr);
-
-			if (x == 0)
-				Driver->draw3DLine(vects[0], vects[2], clr);
-		}
-	}	
-}
-
-
-void CFlaceTerrainSceneNode::getMinMaxHeightOfTerrainDataInBrush(irr::core::vector2di tile, irr::s32 brushSize, 
-											  irr::f32& rOutMinValue, irr::f32& rOutMaxValue)
-{
-	bool bFirstValue = true;
-
-	for (int x=0; x<(int)brushSize; ++x)
-	{
-		for (int y=0; y<(int)brushSize; ++y)
-		{
-			int cTileX = tile.X + x - (int)(brushSize/2);
-			int cTileY = tile.Y + y - (int)(brushSize/2);
-
-			STerrainData* data = getTerrainData(cTileX, cTileY);
-			if (data)
-			{
-				if (bFirstValue)
-				{
-					rOutMinValue = data->Height;
-					rOutMaxValue = data->Height;
-					bFirstValue = false;
-				}
-				else
-				{
-					rOutMinValue = irr::core::min_(rOutMinValue, data->Height);
-					rOutMaxValue = irr::core::max_(rOutMaxValue, data->Height);
-				}
-			}
-		}
-	}
-}
-
-void CFlaceTerrainSceneNode::drawEditBrushSelectionMountainValleyTool(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize, irr::f32 additionalHeight)
-{
-	drawEditBrushSelectionRaiseTool(tile, clr, brushSize, additionalHeight, CellSize * brushSize * 0.03f * additionalHeight);
-}
-
-void CFlaceTerrainSceneNode::drawEditBrushSelectionRaiseTool(irr::core::vector2di tile,
-													irr::video::SColor clr, irr::f32 brushSize, 
-													irr::f32 additionalHeight,
-													irr::f32 sphereFactor)
-{
-	// go transforming
-
-	video::SMaterial m;
-	m.Lighting = false;
-	m.ZBuffer = false;
-	Driver->setMaterial(m);
-
-	irr::core::matrix4 mat;
-	Driver->setTransform(video::ETS_WORLD, mat);
-
-	irr::f32 minValue = 0.0f;
-	irr::f32 maxValue = 0.0f;
-	getMinMaxHeightOfTerrainDataInBrush(tile, (irr::s32)brushSize, minValue, maxValue);
-	bool enableSmoothRaising = !irr::core::equals(minValue, maxValue);
-
-	for (int x=0; x<(int)brushSize; ++x)
-	{
-		for (int y=0; y<(int)brushSize; ++y)
-		{
-			int cTileX = tile.X + x - (int)(brushSize/2);
-			int cTileY = tile.Y + y - (int)(brushSize/2);
-
-			irr::core::vector2di displacements[4] = { 
-				irr::core::vector2di(0,0), irr::core::vector2di(1,0), irr::core::vector2di(0,1), irr::core::vector2di(1,1) };
-			irr::core::vector3df vects[4];
-
-			for (int i=0; i<4; ++i)
-			{
-				STerrainData* pData = getTerrainDataClamped(cTileX + displacements[i].X, cTileY + displacements[i].Y);
-
-				vects[i].X = ((cTileX + displacements[i].X) * CellSize) + Displacement.X;
-				vects[i].Z = ((cTileY + displacements[i].Y) * CellSize) + Displacement.Z;
-
-				irr::f32 h = pData->Height;
-
-				if (!irr::core::iszero(sphereFactor))
-				{
-					float mountain = (sin((x+displacements[i].X) / (float)(brushSize * 1.00f) * irr::core::PI) 
-						* sin((y+displacements[i].Y) / (float)(brushSize * 1.00f) * irr::core::PI))
-						* sphereFactor * 0.01f;
-
-					if (additionalHeight > 0.0f)
-						h += additionalHeight * mountain;
-					else
-						h -= additionalHeight * mountain;
-				}
-				else
-				if (enableSmoothRaising)
-				{
-					// scale height addition by distance from max value
-					irr::f32 fact = (maxValue - pData->Height) / (maxValue - minValue);
-					if (fact > 1.0f) fact = 1.0f;
-
-					if (additionalHeight < 0.0f)
-						fact = 1.0f - fact;
-
-					h += additionalHeight * fact;
-				}
-				else
-					h += additionalHeight;	
-				
-
-				vects[i].Y = h + Displacement.Y;
-			}	
-
-			Driver->draw3DLine(vects[0], vects[1], clr);
-			Driver->draw3DLine(vects[1], vects[3], clr);
-
-			if (y == (int)brushSize-1)
-				Driver->draw3DLine(vects[2], vects[3], clr);
-
-			if (x == 0)
-				Driver->draw3DLine(vects[0], vects[2], clr);
-		}
-	}
-}
-
-
-irr::s32 CFlaceTerrainSceneNode::findTextureIndexOrAddNewOne(irr::video::ITexture* tex)
-{
-	if (!tex)
-		return -1;
-
-	irr::s32 nTexIndex = -1;
-	for (int t=0; t<(int)Textures.size(); ++t)
-		if (Textures[t] == tex)
-		{
-			nTexIndex = t;
-			break;
-		}
-
-	if (nTexIndex == -1)
-	{
-		nTexIndex = (irr::s32)Textures.size();
-
-		Textures.push_back(tex);
-		tex->grab();				
-	}
-
-	return nTexIndex;
-}
-
-
-void CFlaceTerrainSceneNode::paintTexture(int screenCoord2DX, int screenCoord2DY, irr::f32 brushSize, irr::video::ITexture* texture, IUndoManager* undo)
-{
-	irr::core::vector2di tile;
-
-	if (!texture || brushSize < 1 || !getSelectedTerrainTileFromScreenCoords(screenCoord2DX, screenCoord2DY, tile))
-		return;
-
-	bool changeDone = false;
-	irr::f32* pSnaphshotOld = 0;
-
-	irr::s32 texIndex = findTextureIndexOrAddNewOne(texture);
-
-	// paint
-
-	for (int x=0; x<(int)brushSize; ++x)
-	{
-		for (int y=0; y<(int)brushSize; ++y)
-		{
-			int cTileX = tile.X + x - (int)(brushSize/2);
-			int cTileY = tile.Y + y - (int)(brushSize/2);
-
-			STerrainData* data = getTerrainData(cTileX, cTileY);
-			if (data && data->UserSetTextureIndex != texIndex)
-			{
-				data->UserSetTextureIndex = texIndex;
-				changeDone = true;
-
-				if (undo && !pSnaphshotOld)
-					pSnaphshotOld = createTerrainDataSnapshot();
-			}
-		}
-	}
-
-	// rebuild terrain
-
-	if (changeDone)
-	{
-		if (undo)
-		{
-			irr::f32* pSnapsotNew = createTerrainDataSnapshot();
-			undo->addUndoPartChangeTerrainData(this, pSnaphshotOld, pSnapsotNew);
-		}
-		
-		const int border = 2;
-		int brushSizeHalf = (int)(brushSize/2.0f);
-		calculateBlendingFactors(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
-								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
-		updateMeshesFromTerrainData(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
-								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
-	}
-}
-
-
-void CFlaceTerrainSceneNode::resetTerrainDataFromSnapshot(irr::f32* pTerrainData)
-{
-	if (!TerrainData.size())
-		return;
-
-	for (int i=0; i<(int)TerrainData.size(); ++i)
-	{
-		TerrainData[i].Height = pTerrainData[i*2 +0];
-		TerrainData[i].UserSetTextureIndex = (int)pTerrainData[i*2 +1];
-	}
-
-	calculateBlendingFactors();
-	updateMeshesFromTerrainData();
-}
-
-
-irr::f32* CFlaceTerrainSceneNode::createTerrainDataSnapshot()
-{
-	if (!TerrainData.size())
-		return 0;
-
-	irr::f32* data = new irr::f32[TerrainData.size() * 2];
-
-	for (int i=0; i<(int)TerrainData.size(); ++i)
-	{
-		data[i*2 +0] = TerrainData[i].Height;
-		data[i*2 +1] = (irr::f32)TerrainData[i].UserSetTextureIndex;
-		MaxHeight = (int)irr::core::max_((irr::f32)MaxHeight, TerrainData[i].Height); // Robbo
-	}
-	return data;
-}
-
-
-void CFlaceTerrainSceneNode::resetTerrainGrassDataFromSnapshot(irr::f32* pTerrainData)
-{
-	GrassInstances.clear();
-
-	int sz = *(irr::s32*)((void*)&pTerrainData[0]);
-	const int headerSize = 1;
-
-	for (int i=0; i<sz; ++i)
-	{
-		SGrassInstance instance;
-		instance.Height =				pTerrainData[i*6 +0 + headerSize];
-		instance.Width =				pTerrainData[i*6 +1 + headerSize];
-		instance.PosX =					pTerrainData[i*6 +2 + headerSize];
-		instance.PosZ =					pTerrainData[i*6 +3 + headerSize];
-		instance.Rotation =				pTerrainData[i*6 +4 + headerSize];
-		instance.TextureIndex = (int)	pTerrainData[i*6 +5 + headerSize];
-
-		GrassInstances.push_back(instance);
-	}
-
-	updateMeshesFromTerrainData();
-}
-
-
-irr::f32* CFlaceTerrainSceneNode::createTerrainGrassDataSnapshot()
-{
-	if (!TerrainData.size())
-		return 0;
-
-	irr::f32* data = new irr::f32[(GrassInstances.size() * 6) + 1];
-
-	const int headerSize = 1;
-	int sz = GrassInstances.size();
-	data[0] = *(irr::f32*)((void*)&sz);
-
-	for (int i=0; i<(int)GrassInstances.size(); ++i)
-	{
-		data[i*6 +0 + headerSize] = GrassInstances[i].Height;
-		data[i*6 +1 + headerSize] = GrassInstances[i].Width;
-		data[i*6 +2 + headerSize] = GrassInstances[i].PosX;
-		data[i*6 +3 + headerSize] = GrassInstances[i].PosZ;
-		data[i*6 +4 + headerSize] = GrassInstances[i].Rotation;
-		data[i*6 +5 + headerSize] = (irr::f32)GrassInstances[i].TextureIndex;
-	}
-
-	return data;
-}
-
-
-void CFlaceTerrainSceneNode::mountainValleyTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 additionalHeight, IUndoManager* undo)
-{
-	raiseLowerTerrain(tile, brushSize, additionalHeight, undo, CellSize * brushSize * 0.03f * additionalHeight);
-}
-
-void CFlaceTerrainSceneNode::raiseLowerTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 additionalHeight, IUndoManager* undo, irr::f32 sphereFactor)
-{
-	if (irr::core::equals(additionalHeight, 0.0f) || brushSize < 1)
-		return;
-
-	bool changeDone = false;
-	irr::f32* pSnaphshotOld = 0;
-
-	// calculate min and max values for raising
-
-	irr::f32 minValue = 0.0f;
-	irr::f32 maxValue = 0.0f;
-	getMinMaxHeightOfTerrainDataInBrush(tile, (irr::s32)brushSize, minValue, maxValue);
-	bool enableSmoothRaising = !irr::core::equals(minValue, maxValue);
-
-
-	// precalculations for embedded mesh movement
-
-	irr::core::array<SOldMeshPositionsInTerrain> embeddedMeshOldPositions;
-	getEmbeddedMeshPositionsInTerrain(embeddedMeshOldPositions, tile, (irr::s32)brushSize);
-
-	// raise
-
-	for (int x=0; x<(int)brushSize; ++x)
-	{
-		for (int y=0; y<(int)brushSize; ++y)
-		{
-			int cTileX = tile.X + x - (int)(brushSize/2);
-			int cTileY = tile.Y + y - (int)(brushSize/2);
-
-			STerrainData* pData = getTerrainData(cTileX, cTileY);
-			if (pData)
-			{
-				if (undo && !pSnaphshotOld)
-					pSnaphshotOld = createTerrainDataSnapshot();
-
-				if (!irr::core::iszero(sphereFactor))
-				{
-					float mountain = (sin((x) / (float)(brushSize * 1.00f) * irr::core::PI) 
-						* sin((y) / (float)(brushSize * 1.00f) * irr::core::PI))
-						* sphereFactor * 0.01f;
-					
-					if (additionalHeight > 0.0f)
-						pData->Height += additionalHeight * mountain;
-					else
-						pData->Height -= additionalHeight * mountain;
-				}
-				else
-				if (enableSmoothRaising)
-				{
-					irr::f32 fact = (maxValue - pData->Height) / (maxValue - minValue);
-					if (fact > 1.0f) fact = 1.0f;
-
-					if (additionalHeight < 0.0f)
-						fact = 1.0f - fact;
-
-					pData->Height += additionalHeight * fact;
-				}
-				else
-					pData->Height += additionalHeight;
-
-				changeDone = true;
-			}
-		}
-	}
-
-	// rebuild terrain
-
-	if (changeDone)
-	{
-		if (undo)
-		{
-			irr::f32* pSnapsotNew = createTerrainDataSnapshot();
-			undo->addUndoPartChangeTerrainData(this, pSnaphshotOld, pSnapsotNew);
-		}
-
-		// move embedded meshes
-
-		adjustEmbeddedMeshHeights(embeddedMeshOldPositions, undo);
-
-		// update terrain
-
-		const int border = 2;
-		int brushSizeHalf = (int)(brushSize/2.0f);
-		updateMeshesFromTerrainData(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
-								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
-	}	
-}
-
-
-void CFlaceTerrainSceneNode::modifyTerrain(irr::core::vector2di tile, irr::f32 brushSize, bool smooth, bool noise, bool flatten, IUndoManager* undo)
-{
-	if (brushSize < 1)
-		return;
-
-	bool changeDone = false;
-	irr::f32* pSnaphshotOld = 0;
-
-	// calculate min and max values for smoothing
-
-	irr::f32 minValue = 0.0f;
-	irr::f32 maxValue = 0.0f;
-	getMinMaxHeightOfTerrainDataInBrush(tile, (irr::s32)brushSize, minValue, maxValue);
-	bool enableSmoothing = !irr::core::equals(minValue, maxValue);
-
-	if (!enableSmoothing)
-		return;
-
-	// precalculations for embedded mesh movement
-
-	irr::core::array<SOldMeshPositionsInTerrain> embeddedMeshOldPositions;
-	getEmbeddedMeshPositionsInTerrain(embeddedMeshOldPositions, tile, (irr::s32)brushSize);
-
-	// smooth
-
-	irr::f32 average = minValue + ((maxValue - minValue) * 0.5f);
-
-	for (int x=0; x<(int)brushSize; ++x)
-	{
-		for (int y=0; y<(int)brushSize; ++y)
-		{
-			int cTileX = tile.X + x - (int)(brushSize/2);
-			int cTileY = tile.Y + y - (int)(brushSize/2);
-
-			STerrainData* pData = getTerrainData(cTileX, cTileY);
-			if (pData)
-			{
-				if (undo && !pSnaphshotOld)
-					pSnaphshotOld = createTerrainDataSnapshot();
-
-				if (smooth)
-				{
-					irr::f32 distanceFromAverage = pData->Height - average;
-					pData->Height -= distanceFromAverage * 0.5f;
-				}
-				else
-				if (flatten)
-				{
-					pData->Height = minValue;
-				}
-				else
-				if (noise)
-				{
-					pData->Height += (irr::os::Randomizer::randFloat() - 0.5f) * (CellSize);
-				}			
-				
-				changeDone = true;
-			}
-		}
-	}
-
-	// rebuild terrain
-
-	if (changeDone)
-	{
-		if (undo)
-		{
-			irr::f32* pSnapsotNew = createTerrainDataSnapshot();
-			undo->addUndoPartChangeTerrainData(this, pSnaphshotOld, pSnapsotNew);
-		}
-
-		// move embedded meshes
-
-		adjustEmbeddedMeshHeights(embeddedMeshOldPositions, undo);
-
-		// update terrain
-
-		const int border = 2;
-		int brushSizeHalf = (int)(brushSize/2.0f);
-		updateMeshesFromTerrainData(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
-								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
-	}	
-}
-
-
-void CFlaceTerrainSceneNode::paintGrass(irr::core::vector2di tile, irr::f32 brushSize,
-										bool removeGrass, irr::video::ITexture* tex, 
-										irr::f32 width, irr::f32 height, IUndoManager* undo)
-{
-	const int border = 0;
-	int brushSizeHalf = (int)(brushSize/2.0f);
-	irr::core::rect<irr::s32> rectAffected(tile.X - border - brushSizeHalf, 
-											tile.Y - border - brushSizeHalf, 
-										   tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);	
-
-	bool changeDone = false;
-	irr::f32* pSnaphshotOld = 0;
-
-	int nTexIndex = -1;
-	if (!removeGrass)
-	{
-		nTexIndex = findTextureIndexOrAddNewOne(tex);
-
-		if (nTexIndex == -1)
-			return;
-	}
-
-	if (removeGrass)
-	{
-		// remove grass
-
-		for (int i=0; i<(int)GrassInstances.size(); )
-		{
-			int cellX = (int)(GrassInstances[i].PosX / CellSize);
-			int cellY = (int)(GrassInstances[i].PosZ/ CellSize);
-
-			if (rectAffected.isPointInside(irr::core::position2di(cellX, cellY)))
-			{
-				if (undo && !pSnaphshotOld)
-					pSnaphshotOld = createTerrainGrassDataSnapshot();
-
-				changeDone = true;
-
-				GrassInstances.erase(i);
-			}
-			else
-				++i;
-		}
-	}
-	else
-	{
-		// add grass
-
-		int grassPatchesToAdd = (int)brushSize;
-
-		for (int g=0; g<grassPatchesToAdd; ++g)
-		{
-			if (undo && !pSnaphshotOld)
-				pSnaphshotOld = createTerrainGrassDataSnapshot();
-
-			changeDone = true;
-
-			const int fact = 100;
-			irr::f32 posx = (rectAffected.UpperLeftCorner.X * CellSize) + ((irr::os::Randomizer::randFloat() * CellSize) * ((rectAffected.getWidth()-1)));
-			irr::f32 posy = (rectAffected.UpperLeftCorner.Y * CellSize) + ((irr::os::Randomizer::randFloat() * CellSize) * ((rectAffected.getHeight()-1)));
-			
-			int cellX = (int)(posx / CellSize);
-			int cellY = (int)(posy / CellSize);
-
-			// add grass patch
-
-			SGrassInstance instance;
-			instance.PosX = posx;
-			instance.PosZ = posy;
-			instance.Height = height;
-			instance.Width = width;
-			instance.Rotation = (irr::os::Randomizer::rand() % 1000) / 500.0f;
-			instance.TextureIndex = nTexIndex;
-
-			GrassInstances.push_back(instance);
-		}
-	}
-
-	if (changeDone)
-	{
-		if (undo)
-		{
-			irr::f32* pSnapsotNew = createTerrainGrassDataSnapshot();
-			undo->addUndoPartChangeTerrainGrassData(this, pSnaphshotOld, pSnapsotNew);
-		}
-
-		updateMeshesFromTerrainData(rectAffected.UpperLeftCorner.X, rectAffected.UpperLeftCorner.Y,
-									rectAffected.LowerRightCorner.X, rectAffected.LowerRightCorner.Y);
-	}	
-}
-
-void CFlaceTerrainSceneNode::getEmbeddedMeshPositionsInTerrain(irr::core::array<SOldMeshPositionsInTerrain>& outArr, irr::core::vector2di tile, irr::s32 brushSize)
-{
-	const int border = 1;
-	int brushSizeHalf = (int)(brushSize/2.0f);
-	irr::core::rect<irr::f32> rectAffected((irr::f32)(tile.X - border - brushSizeHalf) * CellSize, 
-										   (irr::f32)(tile.Y - border - brushSizeHalf) * CellSize, 
-										   (irr::f32)(tile.X + brushSizeHalf + border + 1) * CellSize,
-										   (irr::f32)(tile.Y + brushSizeHalf + border + 1) * CellSize);
-
-	for (int i=0; i<(int)TerrainTiles.size(); ++i)
-	{
-		if (TerrainTiles[i])
-		{
-			const core::list<ISceneNode*>& children = TerrainTiles[i]->getChildren();
-
-			for (core::list<ISceneNode*>::ConstIterator it = children.begin();
-				 it != children.end(); ++it)
-			{
-				irr::scene::ISceneNode* node = *it;
-
-				irr::core::position2df posInTerrain(node->getPosition().X - Displacement.X, node->getPosition().Z - Displacement.Z);
-
-				if (rectAffected.isPointInside(posInTerrain))
-				{
-					SOldMeshPositionsInTerrain pos;
-					pos.node = node;
-					pos.oldHeight = getExactTerrainHeightClampedAtPosition(node->getPosition().X - Displacement.X, node->getPosition().Z - Displacement.Z);
-
-					outArr.push_back(pos);
-				}				
-			}
-		}
-	}
-	
-}
-
-void CFlaceTerrainSceneNode::adjustEmbeddedMeshHeights(irr::core::array<SOldMeshPositionsInTerrain>& positions, IUndoManager* undo)
-{
-	for (int i=0; i<(int)positions.size(); ++i)
-	{
-		irr::scene::ISceneNode* node = positions[i].node;
-
-		irr::f32 newHeight = getExactTerrainHeightClampedAtPosition(node->getPosition().X - Displacement.X, node->getPosition().Z - Displacement.Z);
-		irr::f32 delta = positions[i].oldHeight - newHeight;
-
-		if (!irr::core::iszero(delta))
-		{			
-			irr::core::vector3df posnew = node->getPosition();
-			posnew.Y -= delta;
-
-			node->setPositionWithUndo(posnew, undo);
-		}		
-	}
-}
-
-void CFlaceTerrainSceneNode::resortChildIntoCorrectTerrainTileMesh(irr::scene::ISceneNode* node, IUndoManager* undo)
-{
-	if (!node)
-		return;
-
-	irr::core::vector3df pos = node->getPosition();
-
-	CFlaceMeshSceneNode* tileNode = getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(pos.X, pos.Z);
-	
-	if (tileNode && node->getParent() != tileNode)
-	{
-		node->grab();
-
-		node->getParent()->removeChild(node, undo);
-		tileNode->addChild(node, undo);
-
-		node->drop();
-	}
-}
-
-// called when the node and its children were read, so the node is able to link with its children if necessary
-void CFlaceTerrainSceneNode::onDeserializedWithChildren()
-{
-	clearCurrentTerrainMeshes();
-
-	for (int i=0; i<(int)TemporaryTerrainTilesIds.size(); ++i)
-	{
-		irr::s32 id = TemporaryTerrainTilesIds[i];
-		irr::scene::ISceneNode* node = getSceneManager()->getSceneNodeFromId(id, this);
-		if (node)
-			node->grab();
-
-		CFlaceMeshSceneNode* fmesh = (CFlaceMeshSceneNode*)node;
-		TerrainTiles.push_back(fmesh);
-	}
-
-	TemporaryTerrainTilesIds.clear();
+// Copyright (C) 2002-2008 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainSceneNode.h"
+#include "IVideoDriver.h"
+#include "ISceneManager.h"
+#include "ICameraSceneNode.h"
+#include "os.h"
+#include "CFlaceSerializer.h"
+#include "CFlaceDeserializer.h"
+#include "CFlaceAttributeSerializationHelper.h"
+#include "irrHelpers.h"
+#include "CFlaceMeshSceneNode.h"
+#include "CFlaceAnimatedMeshSceneNode.h"
+#include "CFlaceWorkerPool.h"
+#include "CFlaceTerrainTriangleSelector.h"
+#include "CFlaceTerrainSplatShader.h"
+#include "CFlaceTerrainGenerator.h"
+#include "CFlaceTerrainScatter.h"
+#include "CFlaceTerrainHeightMapReader.h"
+#include "CFlaceTerrainChunkCodec.h"
+#include "IFileSystem.h"
+#include "IReadFile.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _FLACE_TERRAIN_USE_SSE2_
+#include <emmintrin.h>
+#endif
+
+using namespace irr;
+using namespace scene;
+
+// texture index of cells drawn with the splat map, all of them end up in the same mesh buffer
+static const irr::s32 TERRAIN_SPLAT_TEXTURE_INDEX = -2;
+
+//! constructor
+CFlaceTerrainSceneNode::CFlaceTerrainSceneNode(IUndoManager* undo, ISceneNode* parent, ISceneManager* mgr, irr::video::IVideoDriver* driver, s32 id)
+: ISceneNode(parent, mgr, id, irr::core::vector3df(0,0,0), 
+			 irr::core::vector3df(0,0,0), irr::core::vector3df(1,1,1), undo),
+			 Driver(driver), GrassUsesWind(true)
+{
+	#ifdef _DEBUG
+	setDebugName("CFlaceTerrainSceneNode");
+	
+	#endif
+
+	LightingType = ETLT_DYNAMIC;
+	CellCountX = 0;
+	CellCountY = 0;
+	TileCountX = 0;
+	TileCountY = 0;
+	CellSize = 0;
+	SideLength = 0;
+	CellsPerTileSide = 0;
+	TextureScale = 0.02f;
+	tTexHeightLow = 0.2f;
+	tTexHeightMed = 0.9f;
+	MaxHeight = 0;
+	texBlend = 255;
+	TileSize = 0;
+	LODLevelCount = TERRAIN_MAX_LOD_LEVELS;
+	LODMaxScreenError = 2.0f;
+	GrassViewDistance = 0.0f;
+	GrassFadeDistance = 0.0f;
+	ForestViewDistance = 0.0f;
+	ForestImpostorDistance = 0.0f;
+	ForestImpostorTransitionDistance = 0.0f;
+	UseSplatMap = false;
+	CompressTerrainData = true;
+	SplatMap = 0;
+	PagingRegionSize = 0;
+	PagingDistance = 0.0f;
+	PagingMemoryBudget = 0;
+	PagingRegionCountX = 0;
+	PagingRegionCountY = 0;
+	PagingJob = 0;
+	PagingLoadingRegion = -1;
+	EditStrokeUndo = 0;
+	EditStrokeTouchedCount = 0;
+	EditStrokeLastStampTime = 0;
+	Displacement.set(0,0,0);
+
+	recalculateBoundingBox();
+}
+
+
+
+//! destructor
+CFlaceTerrainSceneNode::~CFlaceTerrainSceneNode()
+{
+	clearCurrentTerrainMeshes();
+	clearGrassBatches();
+	clearForest();
+	clearSplatMap();
+	clearTerrainTextures();
+}
+
+
+//! pre render event
+void CFlaceTerrainSceneNode::OnRegisterSceneNode()
+{
+	setPosition(irr::core::vector3df(0,0,0));
+	setRotation(irr::core::vector3df(0,0,0));
+	setScale(irr::core::vector3df(1,1,1));
+
+	if (IsVisible)
+	{
+		updateTerrainPaging();
+		updateTerrainTileLODs();
+
+		const bool hasGrass = updateGrassBatches();
+		const bool hasForest = updateForestBatches();
+
+		if (hasGrass || hasForest || DebugDataVisible)
+			SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_SOLID);
+	}
+
+	ISceneNode::OnRegisterSceneNode();
+}
+
+
+//! render
+void CFlaceTerrainSceneNode::render()
+{
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	ICameraSceneNode* camera = SceneManager->getActiveCamera();
+
+	if (!camera || !driver)
+		return;
+
+	driver->setTransform(video::ETS_WORLD, core::IdentityMatrix);
+
+	renderGrass(driver, camera);
+	renderForest(driver, camera);
+}
+
+
+
+//! returns the axis aligned bounding box of this node
+const core::aabbox3d<f32>& CFlaceTerrainSceneNode::getBoundingBox() const
+{
+	return BBox;
+}
+
+
+//! Creates a clone of this scene node and its children.
+ISceneNode* CFlaceTerrainSceneNode::clone(ISceneNode* newParent, ISceneManager* newManager, IUndoManager* undo)
+{
+	if (!newParent)
+		newParent = Parent;
+	if (!newManager)
+		newManager = SceneManager;
+
+	CFlaceTerrainSceneNode* nb = new CFlaceTerrainSceneNode(undo, newParent, newManager, Driver, ID);
+
+	nb->cloneMembers(this, newManager);
+
+	// the cells and the data derived from them are shared, and only copied page by page when 
+	// one of the terrains is edited
+	nb->TerrainHeights = TerrainHeights;
+	nb->TerrainTextureIndices = TerrainTextureIndices;
+	nb->TerrainBlending = TerrainBlending;
+	nb->TerrainNormals = TerrainNormals;
+	nb->HeightPyramid = HeightPyramid;
+	nb->TileHeightRanges = TileHeightRanges;
+	for (int i=0; i<(int)Textures.size(); ++i)
+	{
+		nb->Textures.push_back(Textures[i]);
+		nb->Textures[i]->grab();
+	}
+
+	nb->ForestMeshes = ForestMeshes;
+	for (int i=0; i<(int)ForestMeshes.size(); ++i)
+		if (ForestMeshes[i])
+			ForestMeshes[i]->grab();
+
+	nb->ForestBuckets = ForestBuckets;
+
+	nb->BBox = BBox;
+	nb->LODLevelCount = LODLevelCount;
+	nb->LODMaxScreenError = LODMaxScreenError;
+	nb->GrassViewDistance = GrassViewDistance;
+	nb->GrassFadeDistance = GrassFadeDistance;
+	nb->ForestViewDistance = ForestViewDistance;
+	nb->ForestImpostorDistance = ForestImpostorDistance;
+	nb->ForestImpostorTransitionDistance = ForestImpostorTransitionDistance;
+	nb->UseSplatMap = UseSplatMap;
+	nb->CompressTerrainData = CompressTerrainData;
+	nb->PagingRegionSize = PagingRegionSize;
+	nb->PagingDistance = PagingDistance;
+	nb->PagingMemoryBudget = PagingMemoryBudget;
+
+	nb->drop();
+	return nb;
+}
+
+
+
+// The cells and the grass of a terrain are written as one chunk compressed with CFlaceTerrainChunkCodec.
+// Heights are stored byte plane by byte plane, so the exponents and high bytes of neighbouring heights 
+// end up next to each other and repeat.
+
+static const irr::u32 TERRAIN_CHUNK_MAX_GRASS_PER_CELL = 64; // only used for rejecting broken sizes
+
+static inline irr::u32 getFloatBits(irr::f32 f)
+{
+	irr::u32 bits;
+	memcpy(&bits, &f, 4);
+	return bits;
+}
+
+static inline irr::f32 getFloatFromBits(irr::u32 bits)
+{
+	irr::f32 f;
+	memcpy(&f, &bits, 4);
+	return f;
+}
+
+//! writes bytes as little endian 32 bit words, the last one padded with zeros. The serializer
+//! has no method for raw bytes, this is the only place writing the chunk, so it can use one.
+static void writeTerrainChunkBytes(CFlaceSerializer* serializer, const irr::u8* data, irr::u32 size)
+{
+	const irr::u32 fullWords = size / 4;
+
+	for (irr::u32 i=0; i<fullWords; ++i, data+=4)
+		serializer->WriteS32((irr::s32)CFlaceTerrainChunkCodec::readU32(data));
+
+	if (size % 4)
+	{
+		irr::u8 last[4] = { 0, 0, 0, 0 };
+		memcpy(last, data, size % 4);
+		serializer->WriteS32((irr::s32)CFlaceTerrainChunkCodec::readU32(last));
+	}
+}
+
+//! reads bytes written by writeTerrainChunkBytes(), dest needs space for size rounded up to 4 bytes.
+//! If dest is 0, the bytes are only skipped.
+static void readTerrainChunkBytes(CFlaceDeserializer* deserializer, irr::u8* dest, irr::u32 size)
+{
+	const irr::u32 wordCount = (size + 3) / 4;
+
+	for (irr::u32 i=0; i<wordCount; ++i)
+	{
+		const irr::u32 word = (irr::u32)deserializer->ReadS32();
+
+		if (dest)
+		{
+			dest[0] = (irr::u8)(word & 0xff);
+			dest[1] = (irr::u8)((word >> 8) & 0xff);
+			dest[2] = (irr::u8)((word >> 16) & 0xff);
+			dest[3] = (irr::u8)((word >> 24) & 0xff);
+			dest += 4;
+		}
+	}
+}
+
+
+//! serialize
+void CFlaceTerrainSceneNode::serialize(CFlaceSerializer* serializer)
+{
+	serializer->WriteBox(BBox);
+
+	irr::s32 nFlags = 0;
+	if (GrassUsesWind)
+		nFlags |= 0x1;
+
+	nFlags |= 0x2; // has extended data at the end
+
+	if (CompressTerrainData)
+		nFlags |= 0x4; // cells and grass are in the compressed chunk of the extended data
+
+	serializer->WriteS32(nFlags); // flags for future use	
+
+	serializer->WriteS32(SideLength);
+	serializer->WriteS32(CellSize);
+	serializer->WriteS32(TileSize);
+	serializer->WriteS32(TileCountX);
+	serializer->WriteS32(TileCountY);
+	serializer->WriteS32(CellCountX);
+	serializer->WriteS32(CellCountY);
+	serializer->WriteS32(CellsPerTileSide);
+	serializer->WriteS32((irr::s32)LightingType);
+	serializer->Write3DVectF(Displacement);
+	serializer->WriteF32(TextureScale);
+
+	serializer->WriteS32((irr::s32)Textures.size());
+	for (int i=0; i<(int)Textures.size(); ++i)
+		serializer->WriteTextureRef(Textures[i]);
+
+	// cells and grass are written as compressed chunk with the extended data if CompressTerrainData is set.
+	// Older versions find an empty terrain here then instead of misreading the chunk.
+
+	if (CompressTerrainData)
+	{
+		serializer->WriteS32(0); // cell count
+		serializer->WriteS32(0); // grass instance count
+	}
+	else
+	{
+		serializer->WriteS32((irr::s32)TerrainHeights.size());
+		for (irr::s32 y=0; y<TerrainHeights.getHeight(); ++y)
+		{
+			const irr::f32* heights = TerrainHeights.getRow(y);
+			const irr::u8* textureIndices = TerrainTextureIndices.getRow(y);
+
+			for (irr::s32 x=0; x<TerrainHeights.getWidth(); ++x)
+			{
+				serializer->WriteF32(heights[x]);
+				serializer->WriteS32(textureIndices[x]);
+			}
+		}
+
+		serializer->WriteS32(getGrassInstanceCount());
+		for (int b=0; b<(int)GrassBuckets.size(); ++b)
+		{
+			for (int i=0; i<(int)GrassBuckets[b].size(); ++i)
+			{
+				const SGrassInstance& g = GrassBuckets[b][i];
+
+				serializer->WriteF32(g.Height);
+				serializer->WriteF32(g.Width);		
+				serializer->WriteF32(g.PosX);		
+				serializer->WriteF32(g.PosZ);		
+				serializer->WriteF32(g.Rotation);		
+				serializer->WriteS32(g.TextureIndex);		
+			}
+		}
+	}
+
+	serializer->WriteS32((irr::s32)TerrainTiles.size());
+	for (int i=0; i<(int)TerrainTiles.size(); ++i)
+	{
+		irr::s32 id = -1;
+		CFlaceMeshSceneNode* tile = TerrainTiles[i];
+		if (tile)
+			id = tile->getID();
+		serializer->WriteS32(id);
+	}	
+
+	// extended data, written at the end so that the start stays readable by older versions
+
+	serializer->WriteS32(8); // version of extended data
+	serializer->WriteS32(LODLevelCount);
+	serializer->WriteF32(LODMaxScreenError);
+	serializer->WriteF32(GrassViewDistance);
+	serializer->WriteF32(GrassFadeDistance);
+	serializer->WriteS32(UseSplatMap ? 1 : 0);
+	if (CompressTerrainData)
+		writeTerrainDataChunk(serializer);
+	serializer->WriteS32(PagingRegionSize);
+	serializer->WriteF32(PagingDistance);
+	serializer->WriteS32(PagingMemoryBudget);
+	writeForest(serializer);
+	serializer->WriteF32(ForestImpostorDistance);
+	serializer->WriteF32(ForestImpostorTransitionDistance);
+}
+
+
+//! writes heights, texture indices and grass instances as one compressed chunk
+void CFlaceTerrainSceneNode::writeTerrainDataChunk(CFlaceSerializer* serializer)
+{
+	const irr::u32 cellCount = TerrainHeights.size();
+	const irr::s32 width = TerrainHeights.getWidth();
+	const irr::s32 height = TerrainHeights.getHeight();
+
+	irr::core::array<irr::u8> raw;
+	raw.reallocate(cellCount * 4 + 64);
+
+	// heights, byte plane by byte plane
+
+	CFlaceTerrainChunkCodec::appendU32(raw, cellCount);
+
+	for (irr::u32 plane=0; plane<4; ++plane)
+		for (irr::s32 y=0; y<height; ++y)
+		{
+			const irr::f32* row = TerrainHeights.getRow(y);
+			for (irr::s32 x=0; x<width; ++x)
+				raw.push_back((irr::u8)((getFloatBits(row[x]) >> (plane * 8)) & 0xff));
+		}
+
+	// texture indices, run length encoded. Runs continue over the ends of the rows.
+
+	irr::core::array<irr::u8> runs;
+	irr::u32 runCount = 0;
+	irr::u32 runLength = 0;
+	irr::u8 runTextureIndex = 0;
+
+	for (irr::s32 y=0; y<height; ++y)
+	{
+		const irr::u8* row = TerrainTextureIndices.getRow(y);
+
+		for (irr::s32 x=0; x<width; ++x)
+		{
+			if (runLength && row[x] == runTextureIndex)
+			{
+				++runLength;
+				continue;
+			}
+
+			if (runLength)
+			{
+				runs.push_back(runTextureIndex);
+				CFlaceTerrainChunkCodec::appendU32(runs, runLength);
+				++runCount;
+			}
+
+			runTextureIndex = row[x];
+			runLength = 1;
+		}
+	}
+
+	if (runLength)
+	{
+		runs.push_back(runTextureIndex);
+		CFlaceTerrainChunkCodec::appendU32(runs, runLength);
+		++runCount;
+	}
+
+	CFlaceTerrainChunkCodec::appendU32(raw, runCount);
+	for (irr::u32 i=0; i<runs.size(); ++i)
+		raw.push_back(runs[i]);
+
+	// grass instances
+
+	CFlaceTerrainChunkCodec::appendU32(raw, (irr::u32)getGrassInstanceCount());
+
+	for (int b=0; b<(int)GrassBuckets.size(); ++b)
+	{
+		for (int i=0; i<(int)GrassBuckets[b].size(); ++i)
+		{
+			const SGrassInstance& g = GrassBuckets[b][i];
+
+			CFlaceTerrainChunkCodec::appendU32(raw, getFloatBits(g.Height));
+			CFlaceTerrainChunkCodec::appendU32(raw, getFloatBits(g.Width));
+			CFlaceTerrainChunkCodec::appendU32(raw, getFloatBits(g.PosX));
+			CFlaceTerrainChunkCodec::appendU32(raw, getFloatBits(g.PosZ));
+			CFlaceTerrainChunkCodec::appendU32(raw, getFloatBits(g.Rotation));
+			CFlaceTerrainChunkCodec::appendU32(raw, (irr::u32)g.TextureIndex);
+		}
+	}
+
+	// compress and write
+
+	irr::core::array<irr::u8> compressed;
+	CFlaceTerrainChunkCodec::compress(raw.const_pointer(), raw.size(), compressed);
+
+	serializer->WriteS32((irr::s32)raw.size());
+	serializer->WriteS32((irr::s32)compressed.size());
+	writeTerrainChunkBytes(serializer, compressed.const_pointer(), compressed.size());
+}
+
+
+//! reads a chunk written by writeTerrainDataChunk(), returns false if it is broken
+bool CFlaceTerrainSceneNode::readTerrainDataChunk(CFlaceDeserializer* deserializer)
+{
+	const irr::s32 rawSize = deserializer->ReadS32();
+	const irr::s32 compressedSize = deserializer->ReadS32();
+
+	// check the sizes before allocating anything. The chunk holds the cells of the terrain, the texture 
+	// index runs and the grass, see CFlaceTerrainChunkCodec for the limits of the compressed size.
+
+	const irr::f64 expectedCells = CellCountX > 0 && CellCountY > 0 ? (irr::f64)CellCountX * CellCountY : 0.0;
+	const irr::f64 maxRawSize = 12.0 + expectedCells * 9.0 + 
+		irr::core::max_(expectedCells, 1.0) * TERRAIN_CHUNK_MAX_GRASS_PER_CELL * 24.0;
+
+	if (rawSize < 12 || rawSize > maxRawSize || rawSize > 0x7ffffff0 ||
+		compressedSize <= 0 || compressedSize > CFlaceTerrainChunkCodec::getMaxCompressedSize(rawSize) || 
+		compressedSize < CFlaceTerrainChunkCodec::getMinCompressedSize(rawSize))
+	{
+		// the data written after the chunk is still readable if the compressed bytes are skipped
+		if (compressedSize > 0)
+			readTerrainChunkBytes(deserializer, 0, (irr::u32)compressedSize);
+
+		return false;
+	}
+
+	irr::core::array<irr::u8> compressed;
+	compressed.set_used(((irr::u32)compressedSize + 3) & ~3u);
+	readTerrainChunkBytes(deserializer, compressed.pointer(), (irr::u32)compressedSize);
+
+	irr::core::array<irr::u8> raw;
+	raw.set_used(rawSize);
+
+	if (!CFlaceTerrainChunkCodec::decompress(compressed.const_pointer(), compressedSize, raw.pointer(), rawSize))
+		return false;
+
+	const irr::u8* in = raw.const_pointer();
+	const irr::u8* end = in + rawSize;
+
+	// heights
+
+	const irr::u32 cellCount = CFlaceTerrainChunkCodec::readU32(in);
+	in += 4;
+
+	if (cellCount > (irr::u32)(end - in) / 4)
+		return false;
+
+	if (!cellCount)
+		clearTerrainCells(); // terrain without data
+	else
+	if (cellCount == (irr::u32)(CellCountX * CellCountY))
+		resetTerrainCells();
+	else
+		return false;
+
+	for (irr::s32 y=0; y<TerrainHeights.getHeight(); ++y)
+	{
+		irr::f32* row = TerrainHeights.getWritableRow(y);
+		const irr::u8* src = in + y * CellCountX;
+
+		for (irr::s32 x=0; x<CellCountX; ++x)
+			row[x] = getFloatFromBits((irr::u32)src[x] | ((irr::u32)src[cellCount + x] << 8) | 
+				((irr::u32)src[cellCount*2 + x] << 16) | ((irr::u32)src[cellCount*3 + x] << 24));
+	}
+
+	in += cellCount * 4;
+
+	// texture indices
+
+	if (end - in < 4)
+		return false;
+
+	const irr::u32 runCount = CFlaceTerrainChunkCodec::readU32(in);
+	in += 4;
+
+	if (runCount > (irr::u32)(end - in) / 5)
+		return false;
+
+	irr::u32 cell = 0;
+	for (irr::u32 r=0; r<runCount; ++r, in+=5)
+	{
+		irr::u32 length = CFlaceTerrainChunkCodec::readU32(in + 1);
+		if (length > cellCount - cell)
+			return false;
+
+		while (length)
+		{
+			const irr::u32 x = cell % CellCountX;
+			const irr::u32 count = irr::core::min_(length, CellCountX - x);
+
+			memset(TerrainTextureIndices.getWritableRow(cell / CellCountX) + x, in[0], count);
+			cell += count;
+			length -= count;
+		}
+	}
+
+	if (cell != cellCount)
+		return false;
+
+	// grass instances
+
+	if (end - in < 4)
+		return false;
+
+	const irr::u32 grassCount = CFlaceTerrainChunkCodec::readU32(in);
+	in += 4;
+
+	if (grassCount > (irr::u32)(end - in) / 24)
+		return false;
+
+	for (irr::u32 i=0; i<grassCount; ++i, in+=24)
+	{
+		SGrassInstance g;
+
+		g.Height = getFloatFromBits(CFlaceTerrainChunkCodec::readU32(in));
+		g.Width = getFloatFromBits(CFlaceTerrainChunkCodec::readU32(in + 4));
+		g.PosX = getFloatFromBits(CFlaceTerrainChunkCodec::readU32(in + 8));
+		g.PosZ = getFloatFromBits(CFlaceTerrainChunkCodec::readU32(in + 12));
+		g.Rotation = getFloatFromBits(CFlaceTerrainChunkCodec::readU32(in + 16));
+		g.TextureIndex = (irr::s32)CFlaceTerrainChunkCodec::readU32(in + 20);
+
+		addGrassInstance(g);
+	}
+
+	return true;
+}
+
+
+//! serialize
+void CFlaceTerrainSceneNode::deserialize(CFlaceDeserializer* deserializer)
+{
+	BBox = deserializer->ReadBox();
+	irr::s32 nFlags = deserializer->ReadS32(); // flags for future use
+
+	GrassUsesWind = (nFlags & 0x1) != 0; 
+
+	SideLength =  deserializer->ReadS32();
+	CellSize = deserializer->ReadS32();
+	TileSize = deserializer->ReadS32();
+	TileCountX = deserializer->ReadS32();
+	TileCountY = deserializer->ReadS32();
+	CellCountX = deserializer->ReadS32();
+	CellCountY = deserializer->ReadS32();
+	CellsPerTileSide = deserializer->ReadS32();
+	LightingType = (E_TERRAIN_LIGHTING_TYPE)deserializer->ReadS32();
+	Displacement = deserializer->Read3DVectF();
+	TextureScale = deserializer->ReadF32();
+
+	irr::s32 texturesSize = deserializer->ReadS32();
+	for (int i=0; i<texturesSize; ++i)
+	{
+		irr::video::ITexture* tex = deserializer->ReadTextureRef();
+		if (tex)
+			tex->grab();
+		Textures.push_back(tex);
+	}
+
+	irr::s32 terrainDataSize = deserializer->ReadS32();
+	if (terrainDataSize > 0 && terrainDataSize == CellCountX * CellCountY)
+		resetTerrainCells();
+	else
+		clearTerrainCells(); // doesn't fit to the size of the terrain, the data is only skipped
+
+	if (!TerrainHeights.empty())
+	{
+		for (int y=0; y<CellCountY; ++y)
+		{
+			irr::f32* heights = TerrainHeights.getWritableRow(y);
+			irr::u8* textureIndices = TerrainTextureIndices.getWritableRow(y);
+
+			for (int x=0; x<CellCountX; ++x)
+			{
+				heights[x] = deserializer->ReadF32();
+				textureIndices[x] = (irr::u8)irr::core::clamp(deserializer->ReadS32(), 0, TERRAIN_MAX_TEXTURES-1);
+			}
+		}
+	}
+	else
+	{
+		for (int i=0; i<terrainDataSize; ++i)
+		{
+			deserializer->ReadF32();
+			deserializer->ReadS32();
+		}
+	}
+
+	irr::s32 grassDataSize = deserializer->ReadS32();
+	for (int i=0; i<grassDataSize; ++i)
+	{
+		SGrassInstance g;
+
+		g.Height = deserializer->ReadF32();
+		g.Width = deserializer->ReadF32();		
+		g.PosX = deserializer->ReadF32();		
+		g.PosZ = deserializer->ReadF32();		
+		g.Rotation = deserializer->ReadF32();		
+		g.TextureIndex = deserializer->ReadS32();	
+
+		addGrassInstance(g);
+	}
+
+	irr::s32 terrainTileCount = deserializer->ReadS32();
+	TemporaryTerrainTilesIds.clear();
+	for (int i=0; i<terrainTileCount; ++i)
+	{
+		irr::s32 id = deserializer->ReadS32();	
+		TemporaryTerrainTilesIds.push_back(id);
+	}	
+
+	if (nFlags & 0x2)
+	{
+		// extended data
+
+		irr::s32 extendedVersion = deserializer->ReadS32();
+
+		if (extendedVersion >= 1)
+		{
+			LODLevelCount = irr::core::clamp(deserializer->ReadS32(), 1, TERRAIN_MAX_LOD_LEVELS);
+			LODMaxScreenError = irr::core::max_(deserializer->ReadF32(), TERRAIN_MIN_LOD_SCREEN_ERROR);
+		}
+
+		if (extendedVersion >= 2)
+		{
+			GrassViewDistance = deserializer->ReadF32();
+			GrassFadeDistance = deserializer->ReadF32();
+		}
+
+		if (extendedVersion >= 3)
+			UseSplatMap = deserializer->ReadS32() != 0;
+
+		// version 4 to 7 always have the chunk, later versions only if flag 0x4 is set
+
+		CompressTerrainData = extendedVersion >= 8 ? (nFlags & 0x4) != 0 : extendedVersion >= 4;
+
+		if (CompressTerrainData && !readTerrainDataChunk(deserializer))
+		{
+			// broken data, keep the terrain usable
+			irr::os::Printer::log("Terrain data is broken, the terrain was reset to flat ground.", irr::ELL_WARNING);
+			resetTerrainCells();
+			clearGrassInstances();
+		}
+
+		if (extendedVersion >= 5)
+		{
+			PagingRegionSize = irr::core::max_(deserializer->ReadS32(), 0);
+			PagingDistance = irr::core::max_(deserializer->ReadF32(), 0.0f);
+			PagingMemoryBudget = irr::core::max_(deserializer->ReadS32(), 0);
+		}
+
+		if (extendedVersion >= 6 && !readForest(deserializer))
+		{
+			irr::os::Printer::log("Forest data of the terrain is broken, the forest was removed.", irr::ELL_WARNING);
+			clearForest();
+		}
+
+		if (extendedVersion >= 7)
+		{
+			const irr::f32 impostorDistance = deserializer->ReadF32();
+			setForestImpostorDistance(impostorDistance, deserializer->ReadF32());
+		}
+	}
+	else
+	{
+		LODLevelCount = 1; // created before terrain LOD existed, keep the meshes as they were
+		CompressTerrainData = false;
+	}
+
+	// share the cells with equal terrains loaded before, like the same scene loaded twice
+
+	TerrainHeights.shareEqualPages();
+	TerrainTextureIndices.shareEqualPages();
+
+	// update
+
+	onTerrainHeightsChanged();
+	calculateBlendingFactors();
+}
+
+
+//! Writes attributes of the scene node.
+void CFlaceTerrainSceneNode::serializeAttributes(io::IAttributes* out, io::SAttributeReadWriteOptions* options) const
+{
+	if (options && (options->Flags & irr::io::EARWF_IRRLICHT_1_6_COMPATIBILTY))
+	{
+		return;
+	}
+
+	CFlaceAttributeSerializationHelper::serializeBaseAttributes(this, out, options);
+
+	//out->addBool("IsClosedCircle", IsClosedCircle);
+	//out->addFloat("Tightness", Tightness);
+
+	out->addFloat("TextureScale", TextureScale);
+	out->addBool("GrassUsesWind", GrassUsesWind);
+	out->addInt("LODLevels", LODLevelCount);
+	out->addFloat("LODMaxScreenError", LODMaxScreenError);
+	out->addFloat("GrassViewDistance", GrassViewDistance);
+	out->addFloat("GrassFadeDistance", GrassFadeDistance);
+	out->addBool("UseSplatMap", UseSplatMap);
+	out->addBool("CompressTerrainData", CompressTerrainData);
+	out->addInt("PagingRegionSize", PagingRegionSize);
+	out->addFloat("PagingDistance", PagingDistance);
+	out->addInt("PagingMemoryBudget", PagingMemoryBudget);
+}
+
+
+//! Reads attributes of the scene node.
+void CFlaceTerrainSceneNode::deserializeAttributes(io::IAttributes* in, io::SAttributeReadWriteOptions* options)
+{
+	if (options && (options->Flags & irr::io::EARWF_IRRLICHT_1_6_COMPATIBILTY))
+	{
+		return;
+	}
+
+	CFlaceAttributeSerializationHelper::deserializeBaseAttributes(this, in, options);
+
+	//IsClosedCircle = in->getAttributeAsBool("IsClosedCircle");
+	//Tightness = in->getAttributeAsFloat("Tightness");
+
+	bool bNeedsToRegenerateMesh = false;
+
+	irr::f32 oldTextureScale = TextureScale;
+	TextureScale = in->getAttributeAsFloat("TextureScale");
+
+	if (!irr::core::equals(oldTextureScale, TextureScale))
+		bNeedsToRegenerateMesh = true;
+
+	bool bNewGrassUseswind = in->getAttributeAsBool("GrassUsesWind");
+	if (bNewGrassUseswind != GrassUsesWind)
+	{
+		bNeedsToRegenerateMesh = true;
+		GrassUsesWind = bNewGrassUseswind;
+	}
+
+	if (in->existsAttribute("LODLevels"))
+	{
+		irr::s32 newLODLevelCount = irr::core::clamp(in->getAttributeAsInt("LODLevels"), 1, TERRAIN_MAX_LOD_LEVELS);
+		if (newLODLevelCount != LODLevelCount)
+		{
+			bNeedsToRegenerateMesh = true;
+			LODLevelCount = newLODLevelCount;
+		}
+	}
+
+	if (in->existsAttribute("LODMaxScreenError"))
+		setLODMaxScreenError(in->getAttributeAsFloat("LODMaxScreenError"));
+
+	if (in->existsAttribute("GrassViewDistance"))
+		setGrassViewDistance(in->getAttributeAsFloat("GrassViewDistance"));
+
+	if (in->existsAttribute("GrassFadeDistance"))
+		setGrassFadeDistance(in->getAttributeAsFloat("GrassFadeDistance"));
+
+	if (in->existsAttribute("UseSplatMap"))
+	{
+		bool bNewUseSplatMap = in->getAttributeAsBool("UseSplatMap");
+		if (bNewUseSplatMap != UseSplatMap)
+		{
+			bNeedsToRegenerateMesh = true;
+			UseSplatMap = bNewUseSplatMap;
+		}
+	}
+
+	if (in->existsAttribute("CompressTerrainData"))
+		CompressTerrainData = in->getAttributeAsBool("CompressTerrainData");
+
+	irr::s32 nPagingRegionSize = PagingRegionSize;
+	irr::f32 fPagingDistance = PagingDistance;
+	irr::s32 nPagingMemoryBudget = PagingMemoryBudget;
+
+	if (in->existsAttribute("PagingRegionSize"))
+		nPagingRegionSize = in->getAttributeAsInt("PagingRegionSize");
+
+	if (in->existsAttribute("PagingDistance"))
+		fPagingDistance = in->getAttributeAsFloat("PagingDistance");
+
+	if (in->existsAttribute("PagingMemoryBudget"))
+		nPagingMemoryBudget = in->getAttributeAsInt("PagingMemoryBudget");
+
+	setTerrainPaging(nPagingRegionSize, fPagingDistance, nPagingMemoryBudget);
+
+	if (bNeedsToRegenerateMesh)
+		updateMeshesFromTerrainData();
+}
+
+
+void CFlaceTerrainSceneNode::recalculateBoundingBox()
+{
+	BBox.reset(0,0,0);
+
+	BBox.MaxEdge.set((irr::f32)SideLength, (irr::f32)MaxHeight, (irr::f32)SideLength);
+	BBox.MaxEdge += Displacement;
+	BBox.MinEdge += Displacement;
+}
+
+
+void CFlaceTerrainSceneNode::clearCurrentTerrainMeshes()
+{
+	cancelTerrainPaging();
+
+	// selectors may still be used somewhere else, like in the collision world
+	detachTriangleSelectors();
+
+	for (int i=0; i<(int)TerrainTiles.size(); ++i)
+	{
+		if (TerrainTiles[i])
+		{
+			TerrainTiles[i]->remove();
+			TerrainTiles[i]->drop();
+		}
+	}
+
+	TerrainTiles.clear();
+	clearTerrainTileLODs();
+	TileLODs.clear();
+	PagingRegions.clear();
+}
+
+void CFlaceTerrainSceneNode::clearTerrainTextures()
+{
+	for (int i=0; i<(int)Textures.size(); ++i)
+	{
+		if (Textures[i])
+			Textures[i]->drop();
+	}
+
+	Textures.clear();
+}
+
+//! terrain to generate
+void CFlaceTerrainSceneNode::generateTerrain(irr::s32 sideLen, irr::s32 cellSize, irr::s32 maxHeight, int topology,
+	irr::video::ITexture* pTextureGrass, 
+	irr::video::ITexture* pTextureRock,
+	irr::video::ITexture* pTextureSand,
+	STreeDistribution* pTreeDistribution, irr::s32 nTreeDistributionCount,
+	SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount, irr::u32 seed)
+{
+	clearCurrentTerrainMeshes();
+	clearTerrainTextures();
+
+	// save textures
+
+	if (pTextureGrass)
+	{
+		Textures.push_back(pTextureGrass);
+		pTextureGrass->grab();
+	}
+
+	if (pTextureRock)
+	{
+		Textures.push_back(pTextureRock);
+		pTextureRock->grab();
+	}
+
+	if (pTextureSand)
+	{
+		Textures.push_back(pTextureSand);
+		pTextureSand->grab();
+	}
+
+	// calculate sizes
+
+	SideLength = sideLen;
+	CellSize = cellSize;
+	CellsPerTileSide = 35;
+	MaxHeight = (int)maxHeight;
+	TileSize = CellSize * CellsPerTileSide;
+
+	Displacement.X = -(SideLength / 2.0f);
+	Displacement.Y = 0.0f;
+	Displacement.Z = -(SideLength / 2.0f);
+	
+
+	TileCountX = (int)(sideLen / (irr::f32)(TileSize));
+	TileCountY = (int)(sideLen / (irr::f32)(TileSize));
+
+	if (TileCountX <= 0) TileCountX = 1;
+	if (TileCountY <= 0) TileCountY = 1;
+
+	SideLength = TileCountX * TileSize;
+
+	CellCountX = TileCountX * CellsPerTileSide;
+	CellCountY = TileCountY * CellsPerTileSide;
+
+	// set initial terrain data
+
+	resetTerrainCells();
+
+	// generate the heights row by row on all cores. The same seed always creates the same terrain.
+
+	if (!seed)
+		seed = (irr::u32)irr::os::Randomizer::rand();
+
+	irr::core::array<irr::f32*> rows;
+	rows.set_used(CellCountY);
+	for (int y=0; y<CellCountY; ++y)
+		rows[y] = TerrainHeights.getWritableRow(y);
+
+	CFlaceTerrainGenerator generator((E_TERRAIN_TOPOLOGY)topology, seed, (irr::f32)CellSize, (irr::f32)MaxHeight);
+	generator.generate(rows.const_pointer(), CellCountX, CellCountY);
+
+	onTerrainHeightsChanged();
+
+	// paint some textures onto them
+
+	setThreeTexturesBasedOnHeight();
+
+
+	// create grass patch positions
+
+	clearGrassInstances();
+
+	if (pGrassDistribution)
+		generateGrass(pGrassDistribution, nGrassDistributionCount, seed);
+
+	// trees, as instances drawn by the terrain
+
+	clearForest();
+
+	for (int i=0; pTreeDistribution && i<nTreeDistributionCount; ++i)
+		distributeForest(pTreeDistribution[i].Mesh, pTreeDistribution[i].percentOfTerrainCoveredWithThis, 
+			hashTerrainGeneratorValue(seed + 0x7265u + i));
+
+	
+	// create terrain meshes
+
+	createTerrainSceneNodes();
+	updateMeshesFromTerrainData();
+
+	recalculateBoundingBox();
+}
+
+
+//! returns index of the grass bucket for a grass position, same layout as TerrainTiles
+irr::s32 CFlaceTerrainSceneNode::getGrassBucketIndex(irr::f32 posX, irr::f32 posZ)
+{
+	if (TileSize <= 0 || TileCountX <= 0 || TileCountY <= 0)
+		return 0;
+
+	int tileX = irr::core::clamp((int)(posX / TileSize), 0, TileCountX-1);
+	int tileY = irr::core::clamp((int)(posZ / TileSize), 0, TileCountY-1);
+
+	return getTerrainMeshIndex(tileX, tileY);
+}
+
+
+//! makes sure there is one grass bucket per tile, and sorts all instances again if the tile layout changed
+void CFlaceTerrainSceneNode::updateGrassBucketLayout()
+{
+	irr::s32 nBucketCount = irr::core::max_(TileCountX * TileCountY, 1);
+
+	if ((irr::s32)GrassBatches.size() != nBucketCount)
+	{
+		clearGrassBatches();
+
+		SGrassBatch batch;
+		batch.Mesh = 0;
+		batch.Dirty = true;
+
+		GrassBatches.reallocate(nBucketCount);
+		for (int b=0; b<nBucketCount; ++b)
+			GrassBatches.push_back(batch);
+	}
+
+	if ((irr::s32)GrassBuckets.size() == nBucketCount)
+		return;
+
+	irr::core::array<SGrassInstance> all;
+	all.reallocate(getGrassInstanceCount());
+
+	for (int b=0; b<(int)GrassBuckets.size(); ++b)
+		for (int i=0; i<(int)GrassBuckets[b].size(); ++i)
+			all.push_back(GrassBuckets[b][i]);
+
+	GrassBuckets.clear();
+	GrassBuckets.reallocate(nBucketCount);
+	for (int b=0; b<nBucketCount; ++b)
+		GrassBuckets.push_back(irr::core::array<SGrassInstance>());
+
+	for (int i=0; i<(int)all.size(); ++i)
+		GrassBuckets[getGrassBucketIndex(all[i].PosX, all[i].PosZ)].push_back(all[i]);
+}
+
+
+void CFlaceTerrainSceneNode::addGrassInstance(const SGrassInstance& instance)
+{
+	updateGrassBucketLayout();
+
+	irr::s32 idx = getGrassBucketIndex(instance.PosX, instance.PosZ);
+	GrassBuckets[idx].push_back(instance);
+	markGrassBatchDirty(idx);
+}
+
+
+void CFlaceTerrainSceneNode::clearGrassInstances()
+{
+	for (int b=0; b<(int)GrassBuckets.size(); ++b)
+	{
+		GrassBuckets[b].clear();
+		markGrassBatchDirty(b);
+	}
+}
+
+
+irr::s32 CFlaceTerrainSceneNode::getGrassInstanceCount()
+{
+	irr::s32 count = 0;
+
+	for (int b=0; b<(int)GrassBuckets.size(); ++b)
+		count += (irr::s32)GrassBuckets[b].size();
+
+	return count;
+}
+
+
+//! places grass as blue noise: evenly spread, without clumps and holes, so less patches cover the same ground.
+//! The same seed always places the same grass, 0 for a random one.
+void CFlaceTerrainSceneNode::generateGrass(SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount, irr::u32 seed)
+{
+	if (!pGrassDistribution || SideLength <= CellSize)
+		return;
+
+	if (!seed)
+		seed = (irr::u32)irr::os::Randomizer::rand();
+
+	for (int i=0; i<nGrassDistributionCount; ++i)
+	{
+		SGrassDistribution& rDist = pGrassDistribution[i];
+
+		if (irr::core::iszero(rDist.percentOfTerrainCoveredWithThis) ||
+			irr::core::iszero(rDist.height) ||
+			irr::core::iszero(rDist.width) ||
+			!rDist.Texture)
+		{
+			continue;
+		}
+
+		// find texture or add it 
+
+		irr::s32 nTexIndex = findTextureIndexOrAddNewOne(rDist.Texture);
+		if (nTexIndex == -1)
+			continue;
+
+		// scatter the patches. Random placement needed twice the patches for the wanted coverage because of
+		// the overlaps, evenly spread ones don't.
+
+		const irr::f32 density = rDist.percentOfTerrainCoveredWithThis / (rDist.width * rDist.width);
+		const irr::f32 size = (irr::f32)(SideLength - CellSize);
+
+		irr::core::array<CFlaceTerrainScatter::SPoint> points;
+		CFlaceTerrainScatter::scatter(size, size, CFlaceTerrainScatter::getDistanceForDensity(density), 
+			hashTerrainGeneratorValue(seed + i), points);
+
+		if (points.empty())
+			continue;
+
+		// masks for height and slope
+
+		irr::core::array<irr::f32> positions;
+		positions.set_used(points.size() * 2);
+		for (irr::u32 p=0; p<points.size(); ++p)
+		{
+			positions[p*2] = points[p].X;
+			positions[p*2 + 1] = points[p].Z;
+		}
+
+		irr::core::array<irr::f32> heights;
+		irr::core::array<irr::core::vector3df> normals;
+		heights.set_used(points.size());
+		normals.set_used(points.size());
+		getExactTerrainHeightsClampedAtPositions(positions.const_pointer(), (irr::s32)points.size(), heights.pointer(), normals.pointer());
+
+		const irr::f32 minNormalY = rDist.maxSlope > 0.0f && rDist.maxSlope < 90.0f ? 
+			cosf(rDist.maxSlope * irr::core::DEGTORAD) : -1.0f;
+
+		for (irr::u32 p=0; p<points.size(); ++p)
+		{
+			if (heights[p] > rDist.maxPosHeight || heights[p] < rDist.minPosHeight || normals[p].Y < minNormalY)
+				continue;
+
+			// add grass patch
+
+			SGrassInstance instance;
+			instance.PosX = points[p].X;
+			instance.PosZ = points[p].Z;
+			instance.Height = rDist.height;
+			instance.Width = rDist.width;
+			instance.Rotation = (points[p].Random % 1000) / 500.0f;
+			instance.TextureIndex = nTexIndex;
+
+			addGrassInstance(instance);
+		}
+	}
+}
+
+// added by Robbo
+void CFlaceTerrainSceneNode::setTextureHeights(irr::f32 tTexLow, irr::f32 tTexMed)
+{
+	tTexHeightLow = tTexLow;
+	tTexHeightMed = tTexMed;
+	
+	// recalculate MaxHeight as may not be in memory
+
+	irr::f32 minHeight, maxHeight;
+	if (getTerrainHeightRange(0, 0, CellCountX, CellCountY, minHeight, maxHeight))
+		MaxHeight = (int)irr::core::max_((irr::f32)MaxHeight, maxHeight);
+	
+	// redo 3 textures and blending
+	setThreeTexturesBasedOnHeight();
+	updateMeshesFromTerrainData();
+}
+
+// added by Robbo
+void CFlaceTerrainSceneNode::setTextureBlend(irr::s32 TexBlend)
+{
+	texBlend = TexBlend;
+	calculateBlendingAll(0,0,CellCountX,CellCountY);
+}
+
+
+void CFlaceTerrainSceneNode::setThreeTexturesBasedOnHeight()
+{
+	cancelTerrainPaging();
+
+	for (int y=0; y<TerrainHeights.getHeight(); ++y)
+	{
+		const irr::f32* heights = TerrainHeights.getRow(y);
+		irr::u8* textureIndices = TerrainTextureIndices.getWritableRow(y);
+
+		for (int x=0; x<TerrainHeights.getWidth(); ++x)
+		{
+			if (heights[x] < MaxHeight * tTexHeightLow) // RC
+				textureIndices[x] = 0;
+			else
+			if (heights[x] < MaxHeight * tTexHeightMed) // RC
+				textureIndices[x] = 1;
+			else
+				textureIndices[x] = 2;
+		}
+	}
+
+	calculateBlendingFactors();
+}
+
+
+//! terrain to generate
+//! generates new terrain from heightmap
+void CFlaceTerrainSceneNode::loadHeightMap(irr::s32 sideLenX, irr::s32 sideLenY, irr::s32 cellSize, irr::f32* pData, 
+		irr::video::ITexture* pTextureGrass, irr::video::ITexture* pTextureRock,
+		irr::video::ITexture* pTextureSand, irr::video::ITexture* pGrassSpriteTexture)
+{
+	beginHeightMapTerrain(irr::core::max_(sideLenX, sideLenY), cellSize, pTextureGrass, pTextureRock, pTextureSand);
+
+	// cells beyond the height map repeat its last row and column
+
+	for (int cy=0; cy<CellCountY; ++cy)
+	{
+		irr::f32* row = TerrainHeights.getWritableRow(cy);
+		const irr::f32* src = pData + irr::core::clamp(cy, 0, sideLenY-1) * sideLenX;
+
+		for (int cx=0; cx<CellCountX; ++cx)
+			row[cx] = src[irr::core::clamp(cx, 0, sideLenX-1)];
+	}
+
+	finishHeightMapTerrain(pTextureGrass && pTextureRock && pTextureSand, pGrassSpriteTexture);
+}
+
+
+//! imports a height map file, resampled to the cells of a new terrain
+bool CFlaceTerrainSceneNode::importHeightMap(const irr::c8* filename, int format, irr::s32 rawWidth, irr::s32 rawHeight, 
+		irr::s32 sideLen, irr::s32 cellSize, irr::f32 heightScale, int filter,
+		irr::video::ITexture* pTextureGrass, irr::video::ITexture* pTextureRock,
+		irr::video::ITexture* pTextureSand, irr::video::ITexture* pGrassSpriteTexture)
+{
+	if (!filename || cellSize <= 0 || format < 0 || format >= ETHF_COUNT)
+		return false;
+
+	CFlaceTerrainHeightMapReader reader;
+
+	if (format == ETHF_IMAGE)
+	{
+		irr::video::IImage* image = Driver ? Driver->createImageFromFile(filename) : 0;
+		if (!image)
+			return false;
+
+		const bool opened = reader.openImage(image);
+		image->drop();
+
+		if (!opened)
+			return false;
+	}
+	else
+	{
+		irr::io::IReadFile* file = SceneManager->getFileSystem()->createAndOpenFile(filename);
+		if (!file)
+			return false;
+
+		const bool opened = reader.openRaw(file, (E_TERRAIN_HEIGHTMAP_FORMAT)format, rawWidth, rawHeight);
+		file->drop();
+
+		if (!opened)
+			return false;
+	}
+
+	if (sideLen <= 0)
+		sideLen = irr::core::max_(reader.getWidth(), reader.getHeight());
+
+	beginHeightMapTerrain(sideLen, cellSize, pTextureGrass, pTextureRock, pTextureSand);
+
+	irr::core::array<irr::f32*> rows;
+	rows.set_used(CellCountY);
+	for (int y=0; y<CellCountY; ++y)
+		rows[y] = TerrainHeights.getWritableRow(y);
+
+	const bool complete = reader.resample(rows.const_pointer(), CellCountX, CellCountY, 
+		filter == ETHMF_BICUBIC ? ETHMF_BICUBIC : ETHMF_BILINEAR, heightScale);
+
+	finishHeightMapTerrain(pTextureGrass && pTextureRock && pTextureSand, pGrassSpriteTexture);
+
+	return complete;
+}
+
+
+//! clears the terrain and creates flat cells for a height map of sideLen x sideLen heights
+void CFlaceTerrainSceneNode::beginHeightMapTerrain(irr::s32 sideLen, irr::s32 cellSize, irr::video::ITexture* pTextureGrass, 
+		irr::video::ITexture* pTextureRock, irr::video::ITexture* pTextureSand)
+{
+	clearCurrentTerrainMeshes();
+	clearTerrainTextures();
+
+	// save textures
+
+	if (pTextureGrass)
+	{
+		Textures.push_back(pTextureGrass);
+		pTextureGrass->grab();
+	}
+
+	if (pTextureRock)
+	{
+		Textures.push_back(pTextureRock);
+		pTextureRock->grab();
+	}
+
+	if (pTextureSand)
+	{
+		Textures.push_back(pTextureSand);
+		pTextureSand->grab();
+	}
+
+	TextureScale = 0.006f;
+
+	// calculate sizes
+
+	CellSize = cellSize;
+	CellsPerTileSide = 35;
+	SideLength = sideLen * CellSize;	
+	MaxHeight = 0; 
+	TileSize = CellSize * CellsPerTileSide;
+
+	Displacement.X = -(SideLength / 2.0f);
+	Displacement.Y = 0.0f;
+	Displacement.Z = -(SideLength / 2.0f);
+	
+	TileCountX = (int)(SideLength / (irr::f32)(TileSize));
+	TileCountY = (int)(SideLength / (irr::f32)(TileSize));
+
+	if (TileCountX <= 0) TileCountX = 1;
+	if (TileCountY <= 0) TileCountY = 1;
+
+	SideLength = TileCountX * TileSize;
+
+	CellCountX = TileCountX * CellsPerTileSide;
+	CellCountY = TileCountY * CellsPerTileSide;
+
+	// set initial terrain data
+
+	resetTerrainCells();
+}
+
+
+//! creates everything else of a terrain after the heights of a height map were set
+void CFlaceTerrainSceneNode::finishHeightMapTerrain(bool useThreeTextures, irr::video::ITexture* pGrassSpriteTexture)
+{
+	onTerrainHeightsChanged();
+
+	irr::f32 minHeight, maxHeight;
+	if (getTerrainHeightRange(0, 0, CellCountX, CellCountY, minHeight, maxHeight))
+		MaxHeight = (int)irr::core::max_(maxHeight, 0.0f);
+
+	if (useThreeTextures)
+		setThreeTexturesBasedOnHeight();
+	else
+		calculateBlendingFactors();
+
+
+	// trees of the old terrain don't fit anymore
+
+	clearForest();
+
+	// create grass 
+
+	clearGrassInstances();
+
+	if (pGrassSpriteTexture)
+	{
+		SGrassDistribution GrassDistribution;
+		GrassDistribution.setDefaults();
+		GrassDistribution.percentOfTerrainCoveredWithThis = 0.8f;
+		GrassDistribution.Texture = pGrassSpriteTexture;
+		GrassDistribution.height = 17.0f;
+		GrassDistribution.width = 20.0f;
+		GrassDistribution.maxPosHeight = MaxHeight * tTexHeightLow * 0.9f; // RC
+
+		generateGrass(&GrassDistribution, 1);
+	}
+	
+	// create terrain meshes
+
+	createTerrainSceneNodes();
+	updateMeshesFromTerrainData();
+
+	recalculateBoundingBox();
+}
+
+
+irr::s32 CFlaceTerrainSceneNode::getTerrainMeshIndex(irr::s32 tileX, irr::s32 tileY)
+{
+	return (tileY*TileCountX)+tileX;
+}
+
+irr::s32 CFlaceTerrainSceneNode::getTerrainCellIndex(irr::s32 cellX, irr::s32 cellY)
+{
+	return (cellY*CellCountX)+cellX;
+}
+
+irr::scene::SMesh* CFlaceTerrainSceneNode::getTerrainTileMesh(irr::s32 tileX, irr::s32 tileY)
+{
+	irr::s32 idx = getTerrainMeshIndex(tileX, tileY);
+	if (idx < 0 || idx >= (irr::s32)TerrainTiles.size())
+		return 0;
+
+	CFlaceMeshSceneNode* node = TerrainTiles[idx];
+	if (!node)
+		return 0;
+
+	return node->getOwnedMesh();
+}
+
+CFlaceMeshSceneNode* CFlaceTerrainSceneNode::getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(irr::f32 pixelX, irr::f32 pixelZ)
+{
+	int tilex = (irr::core::clamp((int)((pixelX - Displacement.X) / (irr::f32)TileSize), 0, TileCountX-1));
+	int tiley = (irr::core::clamp((int)((pixelZ - Displacement.Z) / (irr::f32)TileSize), 0, TileCountY-1));
+
+	return getTerrainTileMeshSceneNode(tilex, tiley);
+}
+
+
+CFlaceMeshSceneNode* CFlaceTerrainSceneNode::getTerrainTileMeshSceneNode(irr::s32 tileX, irr::s32 tileY)
+{
+	irr::s32 idx = getTerrainMeshIndex(tileX, tileY);
+	if (idx < 0 || idx >= (irr::s32)TerrainTiles.size())
+		return 0;
+
+	return TerrainTiles[idx];
+}
+
+
+//! resizes the cell arrays of the terrain to CellCountX * CellCountY, and resets all cells to height 0 and the first texture
+void CFlaceTerrainSceneNode::resetTerrainCells()
+{
+	clearTerrainCells();
+
+	if (CellCountX <= 0 || CellCountY <= 0)
+		return;
+
+	TerrainHeights.reset(CellCountX, CellCountY, 0.0f);
+	TerrainTextureIndices.reset(CellCountX, CellCountY, 0);
+
+	STerrainCellBlending noBlending;
+	noBlending.BlendingToTextureIndex = 0;
+	for (int v=0; v<4; ++v)
+		noBlending.BlendFactorPerVertex[v] = 0;
+
+	TerrainBlending.reset(CellCountX, CellCountY, noBlending);
+}
+
+
+//! removes all cells of the terrain, releasing pages shared with other terrains
+void CFlaceTerrainSceneNode::clearTerrainCells()
+{
+	cancelTerrainPaging();
+	finishTerrainEditStroke();
+
+	TerrainHeights.clear();
+	TerrainTextureIndices.clear();
+	TerrainBlending.clear();
+}
+
+
+bool CFlaceTerrainSceneNode::isValidTerrainCell(irr::s32 globalCellX, irr::s32 globalCellY)
+{
+	if (globalCellX < 0 || globalCellY < 0 || globalCellX > CellCountX-1 || globalCellY > CellCountY-1)
+		return false;
+
+	return globalCellX < TerrainHeights.getWidth() && globalCellY < TerrainHeights.getHeight();
+}
+
+
+irr::f32 CFlaceTerrainSceneNode::getTerrainDataHeightClamped(irr::s32 globalCellX, irr::s32 globalCellY)
+{	
+	globalCellX = irr::core::clamp(globalCellX, 0, CellCountX-1);
+	globalCellY = irr::core::clamp(globalCellY, 0, CellCountY-1);
+
+	if (isValidTerrainCell(globalCellX, globalCellY))
+		return TerrainHeights.get(globalCellX, globalCellY);
+
+	return 0.0f;
+}
+
+//! returns the exact height of a position in the terrain, even if the position is not exactly at the vertex of a polygon. 
+//! It is very fast for querying the height, as opposed to using Irrlicht's collision methods (which would have to iterate all triangles).
+//! Also, if the position given is outside of the terrain, a height at the nearest border is returned.
+irr::f32 CFlaceTerrainSceneNode::getExactTerrainHeightClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY, irr::core::vector3df* outNormal)
+{
+	// same triangles as the batch query and the tile meshes
+
+	const irr::f32 positionXZ[2] = { globalPixelX, globalPixelY };
+	irr::f32 height = 0.0f;
+
+	getExactTerrainHeightsClampedAtPositions(positionXZ, 1, &height, outNormal);
+
+	// this method always returned the normal of the triangle in its winding, which faces down. 
+	// Callers negate it, so keep it that way.
+	if (outNormal)
+		*outNormal = -(*outNormal);
+
+	return height;
+}
+
+
+//! returns the height and the face normal of the terrain surface at a position inside a cell, with the same
+//! triangles as the tile meshes. cellU and cellV are the position inside the cell, from 0 to 1.
+static inline irr::f32 interpolateTerrainCellHeight(irr::f32 h00, irr::f32 h10, irr::f32 h01, irr::f32 h11, 
+												   irr::f32 cellU, irr::f32 cellV, irr::f32& outSlopeU, irr::f32& outSlopeV)
+{
+	if (cellV <= cellU)
+	{
+		// triangle 0,3,1
+		outSlopeU = h10 - h00;
+		outSlopeV = h11 - h10;
+	}
+	else
+	{
+		// triangle 0,2,3
+		outSlopeU = h11 - h01;
+		outSlopeV = h01 - h00;
+	}
+
+	return h00 + outSlopeU * cellU + outSlopeV * cellV;
+}
+
+
+//! Like getExactTerrainHeightClampedAtPosition(), but for many positions at once. The heights are 
+//! interpolated directly inside the cell, on the triangles of the tile meshes. positionsXZ has count pairs of 
+//! X and Z coordinates in the same space as getExactTerrainHeightClampedAtPosition(). outNormals receives the 
+//! upwards facing normals if not 0.
+void CFlaceTerrainSceneNode::getExactTerrainHeightsClampedAtPositions(const irr::f32* positionsXZ, irr::s32 count, 
+																	  irr::f32* outHeights, irr::core::vector3df* outNormals)
+{
+	if (!positionsXZ || !outHeights || count <= 0)
+		return;
+
+	if (!CellSize || CellCountX < 2 || CellCountY < 2 || (irr::s32)TerrainHeights.size() != CellCountX * CellCountY)
+	{
+		for (int i=0; i<count; ++i)
+		{
+			outHeights[i] = 0.0f;
+			if (outNormals)
+				outNormals[i].set(0,1,0);
+		}
+		return;
+	}
+
+	const irr::f32 invCellSize = 1.0f / CellSize;
+	const irr::f32 maxGridX = (irr::f32)(CellCountX - 1);
+	const irr::f32 maxGridY = (irr::f32)(CellCountY - 1);
+
+	irr::s32 i = 0;
+
+#ifdef _FLACE_TERRAIN_USE_SSE2_
+
+	// 4 positions at a time. Only reading the heights is done one by one, SSE2 has no gather.
+
+	const __m128 vInvCellSize = _mm_set1_ps(invCellSize);
+	const __m128 vZero = _mm_setzero_ps();
+	const __m128 vOne = _mm_set1_ps(1.0f);
+	const __m128 vMaxGridX = _mm_set1_ps(maxGridX);
+	const __m128 vMaxGridY = _mm_set1_ps(maxGridY);
+	const __m128i vMaxCellX = _mm_set1_epi32(CellCountX - 2);
+	const __m128i vMaxCellY = _mm_set1_epi32(CellCountY - 2);
+
+	for (; i+4 <= count; i+=4)
+	{
+		const __m128 a = _mm_loadu_ps(positionsXZ + i*2);		// x0 z0 x1 z1
+		const __m128 b = _mm_loadu_ps(positionsXZ + i*2 + 4);	// x2 z2 x3 z3
+
+		// position in the grid, clamped to the terrain
+
+		__m128 gx = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+		__m128 gy = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+		gx = _mm_min_ps(_mm_max_ps(_mm_mul_ps(gx, vInvCellSize), vZero), vMaxGridX);
+		gy = _mm_min_ps(_mm_max_ps(_mm_mul_ps(gy, vInvCellSize), vZero), vMaxGridY);
+
+		// cell and position inside of it. The last grid point has no own cell, it is the end of the one before.
+
+		__m128i cx = _mm_cvttps_epi32(gx);
+		__m128i cy = _mm_cvttps_epi32(gy);
+		__m128i maskX = _mm_cmpgt_epi32(cx, vMaxCellX);
+		__m128i maskY = _mm_cmpgt_epi32(cy, vMaxCellY);
+		cx = _mm_or_si128(_mm_andnot_si128(maskX, cx), _mm_and_si128(maskX, vMaxCellX));
+		cy = _mm_or_si128(_mm_andnot_si128(maskY, cy), _mm_and_si128(maskY, vMaxCellY));
+
+		const __m128 u = _mm_sub_ps(gx, _mm_cvtepi32_ps(cx));
+		const __m128 v = _mm_sub_ps(gy, _mm_cvtepi32_ps(cy));
+
+		irr::s32 cellX[4];
+		irr::s32 cellY[4];
+		_mm_storeu_si128((__m128i*)cellX, cx);
+		_mm_storeu_si128((__m128i*)cellY, cy);
+
+		irr::f32 h00[4], h10[4], h01[4], h11[4];
+		for (int k=0; k<4; ++k)
+		{
+			const irr::f32* t0 = TerrainHeights.getRow(cellY[k]) + cellX[k];
+			const irr::f32* t1 = TerrainHeights.getRow(cellY[k] + 1) + cellX[k];
+			h00[k] = t0[0];
+			h10[k] = t0[1];
+			h01[k] = t1[0];
+			h11[k] = t1[1];
+		}
+
+		const __m128 vh00 = _mm_loadu_ps(h00);
+		const __m128 vh10 = _mm_loadu_ps(h10);
+		const __m128 vh01 = _mm_loadu_ps(h01);
+		const __m128 vh11 = _mm_loadu_ps(h11);
+
+		// triangle 0,3,1 where v <= u, otherwise 0,2,3. See interpolateTerrainCellHeight().
+
+		const __m128 first = _mm_cmple_ps(v, u);
+		const __m128 slopeU = _mm_or_ps(_mm_and_ps(first, _mm_sub_ps(vh10, vh00)), _mm_andnot_ps(first, _mm_sub_ps(vh11, vh01)));
+		const __m128 slopeV = _mm_or_ps(_mm_and_ps(first, _mm_sub_ps(vh11, vh10)), _mm_andnot_ps(first, _mm_sub_ps(vh01, vh00)));
+
+		_mm_storeu_ps(outHeights + i, _mm_add_ps(vh00, _mm_add_ps(_mm_mul_ps(slopeU, u), _mm_mul_ps(slopeV, v))));
+
+		if (outNormals)
+		{
+			// normal of the plane y = slopeU * x/CellSize + slopeV * z/CellSize
+
+			const __m128 nx = _mm_mul_ps(_mm_sub_ps(vZero, slopeU), vInvCellSize);
+			const __m128 nz = _mm_mul_ps(_mm_sub_ps(vZero, slopeV), vInvCellSize);
+			const __m128 invLen = _mm_div_ps(vOne, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(nz, nz)), vOne)));
+
+			irr::f32 fx[4], fy[4], fz[4];
+			_mm_storeu_ps(fx, _mm_mul_ps(nx, invLen));
+			_mm_storeu_ps(fy, invLen);
+			_mm_storeu_ps(fz, _mm_mul_ps(nz, invLen));
+
+			for (int k=0; k<4; ++k)
+				outNormals[i+k].set(fx[k], fy[k], fz[k]);
+		}
+	}
+
+#endif // _FLACE_TERRAIN_USE_SSE2_
+
+	// remaining positions, or all if SSE2 is not available
+
+	for (; i<count; ++i)
+	{
+		const irr::f32 gx = irr::core::clamp(positionsXZ[i*2] * invCellSize, 0.0f, maxGridX);
+		const irr::f32 gy = irr::core::clamp(positionsXZ[i*2 + 1] * invCellSize, 0.0f, maxGridY);
+
+		const irr::s32 cx = irr::core::min_((irr::s32)gx, CellCountX - 2);
+		const irr::s32 cy = irr::core::min_((irr::s32)gy, CellCountY - 2);
+
+		const irr::f32* t0 = TerrainHeights.getRow(cy) + cx;
+		const irr::f32* t1 = TerrainHeights.getRow(cy + 1) + cx;
+
+		irr::f32 slopeU, slopeV;
+		outHeights[i] = interpolateTerrainCellHeight(t0[0], t0[1], t1[0], t1[1],
+			gx - cx, gy - cy, slopeU, slopeV);
+
+		if (outNormals)
+		{
+			outNormals[i].set(-slopeU * invCellSize, 1.0f, -slopeV * invCellSize);
+			outNormals[i].normalize();
+		}
+	}
+}
+
+
+//! returns the smooth, upwards facing terrain normal at a position, interpolated from the cached vertex normals.
+irr::core::vector3df CFlaceTerrainSceneNode::getTerrainNormalClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY)
+{
+	if (!CellSize || TerrainNormals.empty())
+		return irr::core::vector3df(0,1,0);
+
+	irr::f32 fx = irr::core::clamp(globalPixelX / CellSize, 0.0f, (irr::f32)(CellCountX-1));
+	irr::f32 fy = irr::core::clamp(globalPixelY / CellSize, 0.0f, (irr::f32)(CellCountY-1));
+
+	int cx = (int)fx;
+	int cy = (int)fy;
+	fx -= cx;
+	fy -= cy;
+
+	irr::core::vector3df n0 = getTerrainNormalClamped(cx, cy).getInterpolated(getTerrainNormalClamped(cx+1, cy), 1.0f - fx);
+	irr::core::vector3df n1 = getTerrainNormalClamped(cx, cy+1).getInterpolated(getTerrainNormalClamped(cx+1, cy+1), 1.0f - fx);
+
+	irr::core::vector3df normal = n0.getInterpolated(n1, 1.0f - fy);
+	if (normal.getLengthSQ() > 0.0f)
+		normal.normalize();
+	else
+		normal.set(0,1,0);
+
+	return normal;
+}
+
+
+//! returns the slope of the terrain at a position in degrees, 0 is flat and 90 is a vertical wall.
+irr::f32 CFlaceTerrainSceneNode::getTerrainSlopeClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY)
+{
+	irr::core::vector3df normal = getTerrainNormalClampedAtPosition(globalPixelX, globalPixelY);
+
+	return acosf(irr::core::clamp(normal.Y, -1.0f, 1.0f)) * irr::core::RADTODEG;
+}
+
+
+irr::core::vector3df CFlaceTerrainSceneNode::getTerrainNormalClamped(irr::s32 globalCellX, irr::s32 globalCellY)
+{
+	if (TerrainNormals.empty())
+		return irr::core::vector3df(0,1,0);
+
+	irr::s32 cx = irr::core::clamp(globalCellX, 0, CellCountX-1);
+	irr::s32 cy = irr::core::clamp(globalCellY, 0, CellCountY-1);
+
+	return TerrainNormals.get(cx, cy);
+}
+
+
+//! needs to be called after heights of the terrain data have been changed, to update all data
+//! which is cached based on them. The rectangle is in cells, with the end exclusive.
+void CFlaceTerrainSceneNode::onTerrainHeightsChanged(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	// normals of a vertex also depend on the heights of its direct neighbours
+
+	updateTerrainNormals(startCellX - 1, startCellY - 1, endCellX + 1, endCellY + 1);
+
+	// cells also use the heights of their right and lower neighbours
+
+	updateHeightPyramid(startCellX - 1, startCellY - 1, endCellX, endCellY);
+}
+
+
+//! updates the min/max height pyramid inside a rectangle of cells, and the height ranges of the tiles there.
+//! Level 0 has the height range of the 4 corners of each cell, each next level combines 2x2 blocks of the 
+//! previous one, up to a single range for the whole terrain.
+void CFlaceTerrainSceneNode::updateHeightPyramid(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	if (CellCountX <= 0 || CellCountY <= 0 || (irr::s32)TerrainHeights.size() != CellCountX * CellCountY)
+	{
+		HeightPyramid.clear();
+		TileHeightRanges.clear();
+		return;
+	}
+
+	if (HeightPyramid.empty() || (irr::s32)HeightPyramid[0].size() != CellCountX * CellCountY)
+	{
+		// terrain size changed, create all levels again
+
+		HeightPyramid.clear();
+
+		int sizeX = CellCountX;
+		int sizeY = CellCountY;
+
+		while(true)
+		{
+			SHeightRange empty;
+			empty.Min = 0.0f;
+			empty.Max = 0.0f;
+
+			HeightPyramid.push_back(CFlaceSharedCellArray<SHeightRange>());
+			HeightPyramid.getLast().reset(sizeX, sizeY, empty);
+
+			if (sizeX == 1 && sizeY == 1)
+				break;
+
+			sizeX = (sizeX + 1) / 2;
+			sizeY = (sizeY + 1) / 2;
+		}
+
+		startCellX = 0;
+		startCellY = 0;
+		endCellX = CellCountX;
+		endCellY = CellCountY;
+	}
+
+	startCellX = irr::core::max_(startCellX, 0);
+	startCellY = irr::core::max_(startCellY, 0);
+	endCellX = irr::core::min_(endCellX, CellCountX);
+	endCellY = irr::core::min_(endCellY, CellCountY);
+
+	if (startCellX >= endCellX || startCellY >= endCellY)
+		return;
+
+	// level 0
+
+	CFlaceSharedCellArray<SHeightRange>& cells = HeightPyramid[0];
+
+	for (int y=startCellY; y<endCellY; ++y)
+	{
+		SHeightRange* row = cells.getWritableRow(y);
+
+		for (int x=startCellX; x<endCellX; ++x)
+		{
+			const irr::f32 h00 = getTerrainDataHeightClamped(x, y);
+			const irr::f32 h10 = getTerrainDataHeightClamped(x+1, y);
+			const irr::f32 h01 = getTerrainDataHeightClamped(x, y+1);
+			const irr::f32 h11 = getTerrainDataHeightClamped(x+1, y+1);
+
+			SHeightRange& r = row[x];
+			r.Min = irr::core::min_(irr::core::min_(h00, h10), irr::core::min_(h01, h11));
+			r.Max = irr::core::max_(irr::core::max_(h00, h10), irr::core::max_(h01, h11));
+		}
+	}
+
+	// upper levels
+
+	int sizeX = CellCountX;
+	int sizeY = CellCountY;
+	int sx = startCellX;
+	int sy = startCellY;
+	int ex = endCellX;
+	int ey = endCellY;
+
+	for (int level=1; level<(int)HeightPyramid.size(); ++level)
+	{
+		const CFlaceSharedCellArray<SHeightRange>& below = HeightPyramid[level-1];
+		const int belowSizeX = sizeX;
+		const int belowSizeY = sizeY;
+
+		sizeX = (sizeX + 1) / 2;
+		sizeY = (sizeY + 1) / 2;
+		sx /= 2;
+		sy /= 2;
+		ex = (ex + 1) / 2;
+		ey = (ey + 1) / 2;
+
+		CFlaceSharedCellArray<SHeightRange>& current = HeightPyramid[level];
+
+		for (int y=sy; y<ey; ++y)
+		{
+			SHeightRange* row = current.getWritableRow(y);
+
+			for (int x=sx; x<ex; ++x)
+			{
+				SHeightRange r = below.get(x*2, y*2);
+
+				for (int i=1; i<4; ++i)
+				{
+					const int bx = x*2 + (i & 1);
+					const int by = y*2 + (i >> 1);
+
+					if (bx < belowSizeX && by < belowSizeY)
+					{
+						const SHeightRange& b = below.get(bx, by);
+						r.Min = irr::core::min_(r.Min, b.Min);
+						r.Max = irr::core::max_(r.Max, b.Max);
+					}
+				}
+
+				row[x] = r;
+			}
+		}
+	}
+
+	// height ranges of the tiles
+
+	const irr::s32 nTileCount = TileCountX * TileCountY;
+	if ((irr::s32)TileHeightRanges.size() != nTileCount)
+	{
+		TileHeightRanges.set_used(nTileCount);
+		startCellX = 0;
+		startCellY = 0;
+		endCellX = CellCountX;
+		endCellY = CellCountY;
+	}
+
+	if (CellsPerTileSide <= 0)
+		return;
+
+	const int startTileX = startCellX / CellsPerTileSide;
+	const int startTileY = startCellY / CellsPerTileSide;
+	const int endTileX = irr::core::min_((endCellX + CellsPerTileSide - 1) / CellsPerTileSide, TileCountX);
+	const int endTileY = irr::core::min_((endCellY + CellsPerTileSide - 1) / CellsPerTileSide, TileCountY);
+
+	for (int tileY=startTileY; tileY<endTileY; ++tileY)
+	{
+		for (int tileX=startTileX; tileX<endTileX; ++tileX)
+		{
+			SHeightRange& r = TileHeightRanges[getTerrainMeshIndex(tileX, tileY)];
+
+			getTerrainHeightRange(tileX * CellsPerTileSide, tileY * CellsPerTileSide, 
+				(tileX+1) * CellsPerTileSide, (tileY+1) * CellsPerTileSide, r.Min, r.Max);
+		}
+	}
+}
+
+
+//! returns the lowest and highest height of the terrain surface inside a rectangle of cells (end exclusive),
+//! using the min/max height pyramid.
+bool CFlaceTerrainSceneNode::getTerrainHeightRange(int startCellX, int startCellY, int endCellX, int endCellY, 
+												   irr::f32& outMin, irr::f32& outMax)
+{
+	irr::core::rect<irr::s32> cells(irr::core::max_(startCellX, 0), irr::core::max_(startCellY, 0),
+									irr::core::min_(endCellX, CellCountX), irr::core::min_(endCellY, CellCountY));
+
+	if (HeightPyramid.empty() || cells.UpperLeftCorner.X >= cells.LowerRightCorner.X ||
+		cells.UpperLeftCorner.Y >= cells.LowerRightCorner.Y)
+		return false;
+
+	outMin = FLT_MAX;
+	outMax = -FLT_MAX;
+
+	addHeightPyramidRange((irr::s32)HeightPyramid.size() - 1, 0, 0, cells, outMin, outMax);
+	return true;
+}
+
+
+//! adds the height range of the part of a block of the pyramid inside a rectangle of cells
+void CFlaceTerrainSceneNode::addHeightPyramidRange(irr::s32 level, irr::s32 blockX, irr::s32 blockY, 
+												   const irr::core::rect<irr::s32>& cells, irr::f32& outMin, irr::f32& outMax)
+{
+	const irr::s32 blockSize = 1 << level;
+	const irr::s32 x0 = blockX * blockSize;
+	const irr::s32 y0 = blockY * blockSize;
+	const irr::s32 x1 = irr::core::min_(x0 + blockSize, CellCountX);
+	const irr::s32 y1 = irr::core::min_(y0 + blockSize, CellCountY);
+
+	if (x0 >= x1 || y0 >= y1 ||
+		x1 <= cells.UpperLeftCorner.X || x0 >= cells.LowerRightCorner.X ||
+		y1 <= cells.UpperLeftCorner.Y || y0 >= cells.LowerRightCorner.Y)
+		return;
+
+	if (level == 0 ||
+		(x0 >= cells.UpperLeftCorner.X && x1 <= cells.LowerRightCorner.X &&
+		 y0 >= cells.UpperLeftCorner.Y && y1 <= cells.LowerRightCorner.Y))
+	{
+		// completely inside
+
+		const SHeightRange& r = HeightPyramid[level].get(blockX, blockY);
+
+		outMin = irr::core::min_(outMin, r.Min);
+		outMax = irr::core::max_(outMax, r.Max);
+		return;
+	}
+
+	for (int i=0; i<4; ++i)
+		addHeightPyramidRange(level-1, blockX*2 + (i & 1), blockY*2 + (i >> 1), cells, outMin, outMax);
+}
+
+
+void CFlaceTerrainSceneNode::onTerrainHeightsChanged()
+{
+	onTerrainHeightsChanged(0, 0, CellCountX, CellCountY);
+}
+
+
+// calculates the normal of a terrain vertex from the heights of its four neighbours. 
+// Same as summing up the normals of the planes (top,center,left), (top,right,center),
+// (center,right,bottom) and (center,bottom,left), but without creating positions.
+// Distances are 0 where a neighbour was clamped at the border of the terrain.
+static inline irr::core::vector3df calculateTerrainVertexNormal(irr::f32 hCenter, 
+	irr::f32 hTop, irr::f32 hBottom, irr::f32 hLeft, irr::f32 hRight,
+	irr::f32 distTop, irr::f32 distBottom, irr::f32 distLeft, irr::f32 distRight)
+{
+	const irr::core::vector3df top(0, hTop, -distTop);
+	const irr::core::vector3df center(0, hCenter, 0);
+	const irr::core::vector3df bottom(0, hBottom, distBottom);
+	const irr::core::vector3df left(-distLeft, hLeft, 0);
+	const irr::core::vector3df right(distRight, hRight, 0);
+
+	irr::core::vector3df n1 = (center - top).crossProduct(left - top);
+	irr::core::vector3df n2 = (right - top).crossProduct(center - top);
+	irr::core::vector3df n3 = (right - center).crossProduct(bottom - center);
+	irr::core::vector3df n4 = (bottom - center).crossProduct(left - center);
+
+	irr::core::vector3df normal = n1.normalize() + n2.normalize() + n3.normalize() + n4.normalize();
+	normal.normalize();
+
+	return normal * -1.0f;
+}
+
+
+//! recalculates the cached vertex normals inside a rectangle of cells (end exclusive).
+//! Works row by row directly on three rows of height data, instead of looking up and clamping
+//! a 3D position for every neighbour of every vertex.
+void CFlaceTerrainSceneNode::updateTerrainNormals(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	const irr::s32 nTotalCellCount = CellCountX * CellCountY;
+	if (!nTotalCellCount || (irr::s32)TerrainHeights.size() != nTotalCellCount)
+	{
+		TerrainNormals.clear();
+		return;
+	}
+
+	if (TerrainNormals.getWidth() != CellCountX || TerrainNormals.getHeight() != CellCountY)
+	{
+		TerrainNormals.reset(CellCountX, CellCountY, irr::core::vector3df(0,1,0));
+		startCellX = 0;
+		startCellY = 0;
+		endCellX = CellCountX;
+		endCellY = CellCountY;
+	}
+
+	startCellX = irr::core::max_(startCellX, 0);
+	startCellY = irr::core::max_(startCellY, 0);
+	endCellX = irr::core::min_(endCellX, CellCountX);
+	endCellY = irr::core::min_(endCellY, CellCountY);
+
+	const irr::f32 cs = (irr::f32)CellSize;
+
+	for (int y=startCellY; y<endCellY; ++y)
+	{
+		const irr::f32* rowTop = TerrainHeights.getRow(irr::core::max_(y-1, 0));
+		const irr::f32* row = TerrainHeights.getRow(y);
+		const irr::f32* rowBottom = TerrainHeights.getRow(irr::core::min_(y+1, CellCountY-1));
+		irr::core::vector3df* outRow = TerrainNormals.getWritableRow(y);
+
+		const irr::f32 distTop = y > 0 ? cs : 0.0f;
+		const irr::f32 distBottom = y < CellCountY-1 ? cs : 0.0f;
+
+		for (int x=startCellX; x<endCellX; ++x)
+		{
+			const int left = x > 0 ? x-1 : x;
+			const int right = x < CellCountX-1 ? x+1 : x;
+
+			outRow[x] = calculateTerrainVertexNormal(row[x], 
+				rowTop[x], rowBottom[x], row[left], row[right],
+				distTop, distBottom, (irr::f32)(x-left) * cs, (irr::f32)(right-x) * cs);
+		}
+	}
+}
+
+
+irr::core::vector3df CFlaceTerrainSceneNode::getTerrain3DPositionClamped(irr::s32 globalCellX, irr::s32 globalCellY)
+{
+	irr::core::vector3df v(0,0,0);
+
+	irr::s32 cx = irr::core::clamp(globalCellX, 0, CellCountX-1);
+	irr::s32 cy = irr::core::clamp(globalCellY, 0, CellCountY-1);
+
+	v.Y = TerrainHeights.get(cx, cy);
+
+	v.X = (irr::f32)(cx) * CellSize;
+	v.Z = (irr::f32)(cy) * CellSize;		
+
+	v += Displacement;
+
+	return v;
+}
+
+
+void CFlaceTerrainSceneNode::createTerrainSceneNodes()
+{
+	irr::s32 nTileCount = TileCountX * TileCountY;
+
+	if (TerrainTiles.size() != nTileCount)
+	{
+		clearCurrentTerrainMeshes();
+
+		for (int i=0; i<nTileCount; ++i)
+		{
+			CFlaceMeshSceneNode* meshNode = new CFlaceMeshSceneNode(0, 0, this, SceneManager, -1);
+			meshNode->setAutomaticCulling(irr::scene::EAC_FRUSTUM_BOX);
+			meshNode->setUseOwnedMesh(true);
+			meshNode->setReceivesStaticShadows(false);
+			setUniqueIdForSceneNode(meshNode, SceneManager);
+			TerrainTiles.push_back(meshNode);
+		}
+	}
+
+	updateGrassBucketLayout();
+
+	if (TileLODs.size() != nTileCount)
+	{
+		STerrainTileLOD lod;
+		lod.LevelCount = 1;
+		lod.CurrentLevel = 0;
+
+		clearTerrainTileLODs();
+		TileLODs.clear();
+		for (int i=0; i<nTileCount; ++i)
+			TileLODs.push_back(lod);
+	}
+}
+
+void CFlaceTerrainSceneNode::clearCachedCollisionTrianglesFromTerrainMeshes()
+{
+	for (int i=0; i<(int)TerrainTiles.size(); ++i)
+		clearCachedCollisionTrianglesFromTerrainTile(TerrainTiles[i]);
+}
+
+//! removes a triangle selector storing copies of the triangles of a tile mesh, which would be outdated after 
+//! changing the mesh. Selectors created by the terrain itself are kept, they read the terrain data directly.
+void CFlaceTerrainSceneNode::clearCachedCollisionTrianglesFromTerrainTile(CFlaceMeshSceneNode* node)
+{
+	if (!node || !node->getTriangleSelector())
+		return;
+
+	for (int i=0; i<(int)TriangleSelectors.size(); ++i)
+		if (TriangleSelectors[i] == node->getTriangleSelector())
+			return;
+
+	node->setTriangleSelector(0);
+}
+
+//! sets a triangle selector for each tile which creates the triangles from the terrain data when needed. 
+//! As opposed to a selector created from the mesh, this doesn't use memory for all the triangles, and 
+//! doesn't need to be recreated when the terrain is edited.
+void CFlaceTerrainSceneNode::createCollisionTrianglesForTerrainMeshes()
+{
+	for (int i=0; i<(int)TerrainTiles.size(); ++i)
+	{
+		CFlaceMeshSceneNode* mesh = TerrainTiles[i];
+		if (!mesh)
+			continue;
+
+		clearCachedCollisionTrianglesFromTerrainTile(mesh);
+
+		if (!mesh->getTriangleSelector())
+		{
+			irr::scene::ITriangleSelector* selector = createTerrainTriangleSelector(i % TileCountX, i / TileCountX, mesh);
+			mesh->setTriangleSelector(selector);
+			selector->drop();
+		}
+	}
+}
+
+//! creates a triangle selector for a tile, which the terrain detaches again when the tiles are removed
+CFlaceTerrainTriangleSelector* CFlaceTerrainSceneNode::createTerrainTriangleSelector(irr::s32 tileX, irr::s32 tileY, 
+																					 irr::scene::ISceneNode* node)
+{
+	CFlaceTerrainTriangleSelector* selector = new CFlaceTerrainTriangleSelector(this, node, tileX, tileY);
+	TriangleSelectors.push_back(selector);
+	return selector;
+}
+
+void CFlaceTerrainSceneNode::onTriangleSelectorDeleted(CFlaceTerrainTriangleSelector* selector)
+{
+	for (int i=0; i<(int)TriangleSelectors.size(); ++i)
+		if (TriangleSelectors[i] == selector)
+		{
+			TriangleSelectors[i] = TriangleSelectors.getLast();
+			TriangleSelectors.erase(TriangleSelectors.size()-1);
+			return;
+		}
+}
+
+void CFlaceTerrainSceneNode::detachTriangleSelectors()
+{
+	for (int i=0; i<(int)TriangleSelectors.size(); ++i)
+		TriangleSelectors[i]->detachFromTerrain();
+
+	TriangleSelectors.clear();
+}
+
+//! returns the cells of a tile which have collision triangles. The last row and column of 
+//! grid points has no cells anymore, the terrain surface ends there.
+bool CFlaceTerrainSceneNode::getTerrainTileCollisionCells(irr::s32 tileX, irr::s32 tileY, irr::core::rect<irr::s32>& outCells)
+{
+	if (tileX < 0 || tileY < 0 || tileX >= TileCountX || tileY >= TileCountY || CellsPerTileSide <= 0 ||
+		(irr::s32)TerrainHeights.size() != CellCountX * CellCountY)
+		return false;
+
+	outCells.UpperLeftCorner.X = tileX * CellsPerTileSide;
+	outCells.UpperLeftCorner.Y = tileY * CellsPerTileSide;
+	outCells.LowerRightCorner.X = irr::core::min_(outCells.UpperLeftCorner.X + CellsPerTileSide, CellCountX-1);
+	outCells.LowerRightCorner.Y = irr::core::min_(outCells.UpperLeftCorner.Y + CellsPerTileSide, CellCountY-1);
+
+	return outCells.UpperLeftCorner.X < outCells.LowerRightCorner.X && 
+		   outCells.UpperLeftCorner.Y < outCells.LowerRightCorner.Y;
+}
+
+//! writes the two triangles of each cell in a rectangle of cells into an array, in the same triangulation 
+//! as the tile meshes. If box is not 0 (in the coordinates of the tile meshes), only cells touching the box 
+//! are written, and cells above or below it are skipped using the height pyramid. Returns amount written.
+irr::s32 CFlaceTerrainSceneNode::getTerrainTriangles(const irr::core::rect<irr::s32>& cells, const irr::core::aabbox3df* box, 
+													 irr::core::triangle3df* triangles, irr::s32 arraySize, 
+													 const irr::core::matrix4& transform)
+{
+	if (!triangles || arraySize < 2 || CellSize <= 0)
+		return 0;
+
+	irr::s32 sx = cells.UpperLeftCorner.X;
+	irr::s32 sy = cells.UpperLeftCorner.Y;
+	irr::s32 ex = cells.LowerRightCorner.X;
+	irr::s32 ey = cells.LowerRightCorner.Y;
+
+	if (box)
+	{
+		sx = irr::core::max_(sx, irr::core::floor32((box->MinEdge.X - Displacement.X) / CellSize));
+		sy = irr::core::max_(sy, irr::core::floor32((box->MinEdge.Z - Displacement.Z) / CellSize));
+		ex = irr::core::min_(ex, irr::core::floor32((box->MaxEdge.X - Displacement.X) / CellSize) + 1);
+		ey = irr::core::min_(ey, irr::core::floor32((box->MaxEdge.Z - Displacement.Z) / CellSize) + 1);
+
+		irr::f32 minHeight = 0.0f;
+		irr::f32 maxHeight = 0.0f;
+		if (!getTerrainHeightRange(sx, sy, ex, ey, minHeight, maxHeight) ||
+			minHeight + Displacement.Y > box->MaxEdge.Y || maxHeight + Displacement.Y < box->MinEdge.Y)
+			return 0;
+	}
+
+	const bool identity = transform.isIdentity();
+	irr::s32 count = 0;
+
+	for (int y=sy; y<ey; ++y)
+	{
+		for (int x=sx; x<ex; ++x)
+		{
+			if (count + 2 > arraySize)
+				return count;
+
+			if (box)
+			{
+				const SHeightRange& r = HeightPyramid[0].get(x, y);
+				if (r.Min + Displacement.Y > box->MaxEdge.Y || r.Max + Displacement.Y < box->MinEdge.Y)
+					continue;
+			}
+
+			// 0 ------ 1
+			// | \      |
+			// |   \    |
+			// |     \  |
+			// 2 ------ 3
+
+			const irr::f32 x0 = (x * CellSize) + Displacement.X;
+			const irr::f32 x1 = x0 + CellSize;
+			const irr::f32 z0 = (y * CellSize) + Displacement.Z;
+			const irr::f32 z1 = z0 + CellSize;
+
+			const irr::core::vector3df p0(x0, TerrainHeights.get(x, y) + Displacement.Y, z0);
+			const irr::core::vector3df p1(x1, TerrainHeights.get(x+1, y) + Displacement.Y, z0);
+			const irr::core::vector3df p2(x0, TerrainHeights.get(x, y+1) + Displacement.Y, z1);
+			const irr::core::vector3df p3(x1, TerrainHeights.get(x+1, y+1) + Displacement.Y, z1);
+
+			triangles[count].set(p0, p3, p1);
+			triangles[count+1].set(p0, p2, p3);
+
+			if (!identity)
+			{
+				for (int i=count; i<count+2; ++i)
+				{
+					transform.transformVect(triangles[i].pointA);
+					transform.transformVect(triangles[i].pointB);
+					transform.transformVect(triangles[i].pointC);
+				}
+			}
+
+			count += 2;
+		}
+	}
+
+	return count;
+}
+
+//! hash table from (texture, texture, grass) to the mesh buffer currently being filled with that material,
+//! used while building a mesh from scratch so that finding the buffer doesn't need to scan the whole mesh
+struct CFlaceTerrainSceneNode::SMeshBufferLookup
+{
+	struct SEntry
+	{
+		irr::video::ITexture* Texture1;
+		irr::video::ITexture* Texture2;
+		bool ForGrass;
+		irr::scene::SMeshBuffer* Buffer; // 0 if the slot is free
+	};
+
+	SMeshBufferLookup()
+		: Used(0)
+	{
+		resize(16);
+	}
+
+	static irr::u32 hash(irr::video::ITexture* tex1, irr::video::ITexture* tex2, bool forGrass)
+	{
+		irr::u32 h = (irr::u32)((size_t)tex1 >> 4) * 2654435761u;
+		h ^= (irr::u32)((size_t)tex2 >> 4) * 2246822519u;
+		return forGrass ? ~h : h;
+	}
+
+	SEntry& find(irr::video::ITexture* tex1, irr::video::ITexture* tex2, bool forGrass)
+	{
+		const irr::u32 mask = Entries.size() - 1;
+		irr::u32 i = hash(tex1, tex2, forGrass) & mask;
+
+		// linear probing, there is always a free slot since the table is kept at most half full
+		while (Entries[i].Buffer &&
+			   !(Entries[i].Texture1 == tex1 && Entries[i].Texture2 == tex2 && Entries[i].ForGrass == forGrass))
+			i = (i + 1) & mask;
+
+		return Entries[i];
+	}
+
+	void set(irr::video::ITexture* tex1, irr::video::ITexture* tex2, bool forGrass, irr::scene::SMeshBuffer* buffer)
+	{
+		SEntry& e = find(tex1, tex2, forGrass);
+
+		if (!e.Buffer)
+		{
+			e.Texture1 = tex1;
+			e.Texture2 = tex2;
+			e.ForGrass = forGrass;
+			++Used;
+		}
+
+		e.Buffer = buffer;
+
+		if (Used * 2 > (irr::s32)Entries.size())
+			resize(Entries.size() * 2);
+	}
+
+	void resize(irr::u32 size)
+	{
+		irr::core::array<SEntry> old = Entries;
+
+		SEntry empty;
+		empty.Texture1 = 0;
+		empty.Texture2 = 0;
+		empty.ForGrass = false;
+		empty.Buffer = 0;
+
+		Entries.set_used(size);
+		for (irr::u32 i=0; i<size; ++i)
+			Entries[i] = empty;
+
+		for (irr::u32 i=0; i<old.size(); ++i)
+			if (old[i].Buffer)
+				find(old[i].Texture1, old[i].Texture2, old[i].ForGrass) = old[i];
+	}
+
+	irr::core::array<SEntry> Entries; // size is always a power of two
+	irr::s32 Used;
+};
+
+
+//! returns a mesh buffer with the given textures and space for the given amount of vertices and indices.
+//! If a lookup is passed, the mesh must only contain buffers created using that lookup, it is then used 
+//! instead of searching all mesh buffers. Full buffers are replaced by a new one in the lookup.
+irr::scene::SMeshBuffer* CFlaceTerrainSceneNode::getOrCreateMeshBuffer(irr::scene::SMesh* mesh, 
+																	   irr::s32 mainTextureIndex, 
+																	   irr::s32 blendingToTextureIndex,
+																	   irr::s32 nWithFreeVertices, 
+																	   irr::s32 nWithFreeIndices,
+																	   bool forGrass,
+																	   SMeshBufferLookup* lookup)
+{
+	if (!mesh)
+		return 0;
+
+	irr::video::ITexture* tex1 = mainTextureIndex == TERRAIN_SPLAT_TEXTURE_INDEX ? SplatMap : getTerrainTexture(mainTextureIndex);
+	irr::video::ITexture* tex2 = blendingToTextureIndex == TERRAIN_SPLAT_TEXTURE_INDEX ? SplatMap : getTerrainTexture(blendingToTextureIndex);
+
+	if (tex1 == tex2)
+		tex2 = 0;
+
+	if (lookup)
+	{
+		irr::scene::SMeshBuffer* buf = lookup->find(tex1, tex2, forGrass).Buffer;
+
+		if (buf &&
+			buf->getVertexCount() + nWithFreeVertices < 65536 &&
+			buf->getIndexCount()  + nWithFreeIndices  < 65536 )
+		{
+			return buf;
+		}
+
+		// not created yet, or full: start a new one
+		buf = createMeshBuffer(mesh, tex1, tex2, forGrass);
+		lookup->set(tex1, tex2, forGrass, buf);
+		return buf;
+	}
+
+	irr::video::E_MATERIAL_TYPE grassMat =  GrassUsesWind ? 
+												irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF_MOVING_GRASS : 
+												irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+
+	for (int i=0; i<(int)mesh->MeshBuffers.size(); ++i)
+	{
+		if (mesh->MeshBuffers[i]->getVertexType() != irr::video::EVT_STANDARD)
+			continue; // probably created by the light mapper, we ignore those now
+
+		irr::scene::SMeshBuffer* buf = (irr::scene::SMeshBuffer*)mesh->MeshBuffers[i];
+
+		if (buf->Material.getTexture(0) == tex1 &&
+			buf->Material.getTexture(1) == tex2 &&
+			( (  forGrass && buf->Material.MaterialType == grassMat ) ||
+			  ( !forGrass && buf->Material.MaterialType != grassMat ) )
+		   )
+		{
+			if (buf->getVertexCount() + nWithFreeVertices < 65536 &&
+				buf->getIndexCount()  + nWithFreeIndices  < 65536 )
+			{
+				return buf;
+			}
+		}
+	}
+
+	// not found, create new one
+
+	return createMeshBuffer(mesh, tex1, tex2, forGrass);
+}
+
+
+irr::scene::SMeshBuffer* CFlaceTerrainSceneNode::createMeshBuffer(irr::scene::SMesh* mesh, irr::video::ITexture* tex1, 
+																  irr::video::ITexture* tex2, bool forGrass)
+{
+	irr::scene::SMeshBuffer* buffer = new irr::scene::SMeshBuffer();
+
+	if (forGrass)
+	{
+		buffer->Material.MaterialType = GrassUsesWind ?
+			irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF_MOVING_GRASS :
+			irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF;
+		buffer->Material.MaterialTypeParam = 0.5f;
+		buffer->Material.BackfaceCulling = false; // grass is double sided
+	}
+	else
+		if (tex2 == 0)
+			buffer->Material.MaterialType = irr::video::EMT_SOLID;
+		else
+			buffer->Material.MaterialType = irr::video::EMT_SOLID_VERTEX_ALPHA_TWO_TEXTURE_BLEND;
+
+	buffer->Material.setTexture(0, tex1);
+	buffer->Material.setTexture(1, tex2);
+
+	if (!forGrass && tex1 && tex1 == SplatMap)
+	{
+		// splat map in the first texture, followed by the textures of the layers
+
+		buffer->Material.MaterialType = (irr::video::E_MATERIAL_TYPE)CFlaceTerrainSplatShader::getMaterialType(Driver);
+
+		for (int l=0; l<(int)SplatLayers.size(); ++l)
+			buffer->Material.setTexture(l+1, getTerrainTexture(SplatLayers[l]));
+	}
+	
+	if (LightingType == ETLT_DYNAMIC)
+		buffer->Material.Lighting = true;
+	else
+		buffer->Material.Lighting = false;
+	
+	mesh->addMeshBuffer(buffer);
+
+	buffer->drop();
+
+	return buffer;
+}
+
+irr::video::ITexture* CFlaceTerrainSceneNode::getTerrainTexture(irr::s32 idx)
+{
+	if (idx >= 0 && idx < (int)Textures.size())
+		return Textures[idx];
+
+	return 0;
+}
+
+
+irr::video::S3DVertex CFlaceTerrainSceneNode::createTerrainVertex(irr::s32 globalCellX, irr::s32 globalCellY, irr::u8 blendFactor, irr::f32 heightOffset)
+{
+	irr::video::S3DVertex vtx;
+	irr::video::SColor clr = video::DefaultWhiteColor;
+
+	vtx.Pos = getTerrain3DPositionClamped(globalCellX, globalCellY);
+	vtx.Pos.Y += heightOffset;
+
+	vtx.TCoords.X = vtx.Pos.X * TextureScale;
+	vtx.TCoords.Y = vtx.Pos.Z * TextureScale;
+
+	vtx.Color.set(blendFactor, clr.getRed(), clr.getGreen(), clr.getBlue());
+
+	vtx.Normal = getTerrainNormalClamped(globalCellX, globalCellY);
+
+	return vtx;
+}
+
+
+//! Creates the geometry of a terrain tile as indexed grid, for all LOD levels. Each grid point is only 
+//! created once per mesh buffer and shared by all cells using the same texture pair. Only where the blend 
+//! factor of a grid point differs between two cells (at texture seams), the vertex is duplicated.
+//! Lower LOD levels only use every 2nd/4th/8th grid point, and get skirts along the tile border
+//! so that no cracks are visible between neighbouring tiles using different levels.
+//! This only reads the terrain data and only writes into the staging data, so it is called
+//! on worker threads for several tiles at the same time. See commitTerrainTileStaging().
+void CFlaceTerrainSceneNode::buildTerrainTileStaging(STerrainTileStaging& staging)
+{
+	// the height for each cell is not in the center of the tile. Otherwise we would get steps in the terrain.
+	// so the height is in the upper left corner = the first vertex. The height of the other vertices needs to be 
+	// taken from the neighbouring terrain datas.
+	//
+	// vertices of a cell (or a group of cells in lower LOD levels) are this:
+	//
+	// 0 ------ 1
+	// | \      |
+	// |   \    |
+	// |     \  |
+	// 2 ------ 3
+
+	const irr::s32 cellIndices[6] = {0,3,1, 0,2,3};
+
+	const irr::s32 tileX = staging.TileX;
+	const irr::s32 tileY = staging.TileY;
+	const irr::s32 gridSide = CellsPerTileSide + 1;
+	const irr::s32 firstCellX = tileX * CellsPerTileSide;
+	const irr::s32 firstCellY = tileY * CellsPerTileSide;
+
+	staging.LevelCount = irr::core::clamp(LODLevelCount, 1, TERRAIN_MAX_LOD_LEVELS);
+	staging.Buffers.clear();
+
+	// counting pre-pass: find all texture pairs used in this tile and how many cells use them
+
+	irr::core::array<STileBuildBuffer> pairs;
+	irr::core::array<irr::s32> cellPairIndex;
+	cellPairIndex.set_used(CellsPerTileSide * CellsPerTileSide);
+
+	for (int y=0; y<CellsPerTileSide; ++y)
+	{
+		for (int x=0; x<CellsPerTileSide; ++x)
+		{
+			irr::s32 mainTex = TerrainTextureIndices.get(firstCellX + x, firstCellY + y);
+			irr::s32 blendTex = TerrainBlending.get(firstCellX + x, firstCellY + y).BlendingToTextureIndex;
+
+			// pairs blending to the same texture end up in the same mesh buffer. With the splat 
+			// map, all cells are in one buffer and the shader selects the textures.
+
+			if (SplatMap)
+			{
+				mainTex = TERRAIN_SPLAT_TEXTURE_INDEX;
+				blendTex = TERRAIN_SPLAT_TEXTURE_INDEX;
+			}
+			else
+			if (getTerrainTexture(mainTex) == getTerrainTexture(blendTex))
+				blendTex = mainTex;
+
+			irr::s32 found = -1;
+			for (int p=0; p<(int)pairs.size(); ++p)
+				if (pairs[p].MainTextureIndex == mainTex && pairs[p].BlendingToTextureIndex == blendTex)
+				{
+					found = p;
+					break;
+				}
+
+			if (found == -1)
+			{
+				found = (irr::s32)pairs.size();
+				pairs.push_back(STileBuildBuffer());
+
+				STileBuildBuffer& pair = pairs.getLast();
+				pair.MainTextureIndex = mainTex;
+				pair.BlendingToTextureIndex = blendTex;
+				pair.CellCount = 0;
+				pair.GridVertexIndex.set_used(gridSide * gridSide * 2);
+				pair.GridVertexBlend.set_used(gridSide * gridSide * 2);
+
+				for (int i=0; i<(int)pair.GridVertexIndex.size(); ++i)
+					pair.GridVertexIndex[i] = -1;
+			}
+
+			++pairs[found].CellCount;
+			cellPairIndex[(y*CellsPerTileSide) + x] = found;
+		}
+	}
+
+	// find out how much the lower levels differ from the full resolution, needed 
+	// for selecting the level at runtime and for the depth of the skirts
+
+	irr::f32 maxError = 0.0f;
+	for (int l=0; l<staging.LevelCount; ++l)
+	{
+		staging.GeometricError[l] = calculateTileLODError(tileX, tileY, 1 << l);
+		maxError = irr::core::max_(maxError, staging.GeometricError[l]);
+	}
+
+	const irr::f32 skirtDepth = maxError * 2.0f + CellSize;
+	const bool createSkirts = staging.LevelCount > 1;
+
+	// the splat map doesn't use the blend factors, then grid vertices never need to be duplicated
+	const irr::u8 blendMask = SplatMap ? 0 : 0xff;
+
+	// create indexed geometry of all levels
+
+	for (int level=0; level<staging.LevelCount; ++level)
+	{
+		const irr::s32 step = 1 << level;
+
+		for (int y0=0; y0<CellsPerTileSide; y0+=step)
+		{
+			const irr::s32 y1 = irr::core::min_(y0 + step, CellsPerTileSide);
+
+			for (int x0=0; x0<CellsPerTileSide; x0+=step)
+			{
+				const irr::s32 x1 = irr::core::min_(x0 + step, CellsPerTileSide);
+
+				// the group of cells is drawn with the textures of its upper left cell, the blend
+				// factors of the corners are taken from the cells at the corners
+
+				STileBuildBuffer& buf = pairs[cellPairIndex[(y0*CellsPerTileSide) + x0]];
+
+				irr::s32 v[4];
+				v[0] = addTileGridVertex(buf, x0, y0, (irr::u8)(TerrainBlending.get(firstCellX + x0, firstCellY + y0).BlendFactorPerVertex[0] & blendMask), false);
+				v[1] = addTileGridVertex(buf, x1, y0, (irr::u8)(TerrainBlending.get(firstCellX + x1-1, firstCellY + y0).BlendFactorPerVertex[1] & blendMask), false);
+				v[2] = addTileGridVertex(buf, x0, y1, (irr::u8)(TerrainBlending.get(firstCellX + x0, firstCellY + y1-1).BlendFactorPerVertex[2] & blendMask), false);
+				v[3] = addTileGridVertex(buf, x1, y1, (irr::u8)(TerrainBlending.get(firstCellX + x1-1, firstCellY + y1-1).BlendFactorPerVertex[3] & blendMask), false);
+
+				for (int ind=0; ind<6; ++ind)
+					buf.Indices[level].push_back(v[cellIndices[ind]]);
+
+				// skirts along the tile border, always from the first to the second vertex seen from outside
+
+				if (createSkirts)
+				{
+					if (y0 == 0)
+						addTileSkirt(buf, level, v[0], v[1]);
+					if (x1 == CellsPerTileSide)
+						addTileSkirt(buf, level, v[1], v[3]);
+					if (y1 == CellsPerTileSide)
+						addTileSkirt(buf, level, v[3], v[2]);
+					if (x0 == 0)
+						addTileSkirt(buf, level, v[2], v[0]);
+				}
+			}
+		}
+	}
+
+	// create the final vertices and indices. The exact sizes are known now, so allocate only once
+
+	staging.Buffers.reallocate(pairs.size());
+
+	for (int p=0; p<(int)pairs.size(); ++p)
+	{
+		const STileBuildBuffer& pair = pairs[p];
+
+		staging.Buffers.push_back(STileStagingBuffer());
+		STileStagingBuffer& buf = staging.Buffers.getLast();
+
+		buf.MainTextureIndex = pair.MainTextureIndex;
+		buf.BlendingToTextureIndex = pair.BlendingToTextureIndex;
+
+		buf.Vertices.reallocate(pair.Vertices.size());
+		for (int v=0; v<(int)pair.Vertices.size(); ++v)
+		{
+			const STileGridVertexRef& ref = pair.Vertices[v];
+			buf.Vertices.push_back(createTerrainVertex(firstCellX + ref.GridX, firstCellY + ref.GridY, ref.BlendFactor, 
+				ref.IsSkirt ? -skirtDepth : 0.0f));
+
+			if (v == 0)
+				buf.BoundingBox.reset(buf.Vertices[v].Pos);
+			else
+				buf.BoundingBox.addInternalPoint(buf.Vertices[v].Pos);
+		}
+
+		for (int l=0; l<staging.LevelCount; ++l)
+		{
+			buf.Indices[l].reallocate(pair.Indices[l].size());
+
+			for (int i=0; i<(int)pair.Indices[l].size(); ++i)
+				buf.Indices[l].push_back((irr::u16)pair.Indices[l][i]);
+		}
+	}
+}
+
+
+//! copies the geometry created by buildTerrainTileStaging() into the mesh of the tile. 
+//! Needs to be called on the main thread, after the old mesh buffers have been removed.
+void CFlaceTerrainSceneNode::commitTerrainTileStaging(const STerrainTileStaging& staging, irr::scene::SMesh* mesh)
+{
+	STerrainTileLOD& lod = TileLODs[getTerrainMeshIndex(staging.TileX, staging.TileY)];
+	clearTerrainTileLOD(lod);
+	lod.LevelCount = staging.LevelCount;
+	for (int l=0; l<TERRAIN_MAX_LOD_LEVELS; ++l)
+		lod.GeometricError[l] = l < staging.LevelCount ? staging.GeometricError[l] : 0.0f;
+
+	SMeshBufferLookup lookup;
+
+	for (int p=0; p<(int)staging.Buffers.size(); ++p)
+	{
+		const STileStagingBuffer& staged = staging.Buffers[p];
+
+		irr::scene::SMeshBuffer* buf = getOrCreateMeshBuffer(mesh, staged.MainTextureIndex, staged.BlendingToTextureIndex, 
+			(irr::s32)staged.Vertices.size(), (irr::s32)staged.Indices[0].size(), false, &lookup);
+		if (!buf)
+			continue;
+
+		const irr::s32 nVertexStart = (irr::s32)buf->Vertices.size();
+
+		if (nVertexStart == 0)
+		{
+			buf->Vertices = staged.Vertices;
+			buf->BoundingBox = staged.BoundingBox;
+		}
+		else
+		{
+			buf->Vertices.reallocate(buf->Vertices.size() + staged.Vertices.size());
+			for (int v=0; v<(int)staged.Vertices.size(); ++v)
+				buf->Vertices.push_back(staged.Vertices[v]);
+
+			buf->BoundingBox.addInternalBox(staged.BoundingBox);
+		}
+
+		// two texture pairs may share a mesh buffer if the textures are the same
+
+		irr::s32 slot = lod.Buffers.linear_search(buf);
+		if (slot == -1)
+		{
+			slot = (irr::s32)lod.Buffers.size();
+			lod.Buffers.push_back(buf);
+			buf->grab();
+
+			for (int l=0; l<lod.LevelCount; ++l)
+				lod.Indices[l].push_back(irr::core::array<irr::u16>());
+		}
+
+		for (int l=0; l<lod.LevelCount; ++l)
+		{
+			irr::core::array<irr::u16>& indices = lod.Indices[l][slot];
+			indices.reallocate(indices.size() + staged.Indices[l].size());
+
+			for (int i=0; i<(int)staged.Indices[l].size(); ++i)
+				indices.push_back((irr::u16)(nVertexStart + staged.Indices[l][i]));
+		}
+	}
+
+	// start with the full resolution
+
+	for (int b=0; b<(int)lod.Buffers.size(); ++b)
+		lod.Buffers[b]->Indices = lod.Indices[0][b];
+
+	if (lod.LevelCount < 2)
+	{
+		// LOD disabled, no need to keep a copy of the indices
+		clearTerrainTileLOD(lod);
+	}
+}
+
+
+//! returns the index of a vertex at a grid point of a tile, creates it if not existing yet
+irr::s32 CFlaceTerrainSceneNode::addTileGridVertex(STileBuildBuffer& buf, irr::s32 gridX, irr::s32 gridY, irr::u8 blendFactor, bool skirt)
+{
+	const irr::s32 gridSide = CellsPerTileSide + 1;
+
+	irr::s32 gridIdx = (gridY * gridSide) + gridX;
+	if (skirt)
+		gridIdx += gridSide * gridSide;
+
+	const irr::s32 existing = buf.GridVertexIndex[gridIdx];
+	if (existing != -1 && buf.GridVertexBlend[gridIdx] == blendFactor)
+		return existing;
+
+	// grid point not created yet or on a texture seam with a different blend factor
+
+	STileGridVertexRef ref;
+	ref.GridX = (irr::s16)gridX;
+	ref.GridY = (irr::s16)gridY;
+	ref.BlendFactor = blendFactor;
+	ref.IsSkirt = skirt;
+
+	const irr::s32 idx = (irr::s32)buf.Vertices.size();
+	buf.Vertices.push_back(ref);
+
+	if (existing == -1)
+	{
+		buf.GridVertexIndex[gridIdx] = idx;
+		buf.GridVertexBlend[gridIdx] = blendFactor;
+	}
+
+	return idx;
+}
+
+
+//! adds a skirt hanging down from the edge between two vertices of the border of a tile.
+//! The vertices need to be ordered so that the skirt faces outwards of the tile.
+void CFlaceTerrainSceneNode::addTileSkirt(STileBuildBuffer& buf, irr::s32 level, irr::s32 topVertex1, irr::s32 topVertex2)
+{
+	const STileGridVertexRef ref1 = buf.Vertices[topVertex1];
+	const STileGridVertexRef ref2 = buf.Vertices[topVertex2];
+
+	irr::s32 bottomVertex1 = addTileGridVertex(buf, ref1.GridX, ref1.GridY, ref1.BlendFactor, true);
+	irr::s32 bottomVertex2 = addTileGridVertex(buf, ref2.GridX, ref2.GridY, ref2.BlendFactor, true);
+
+	buf.Indices[level].push_back(topVertex1);
+	buf.Indices[level].push_back(topVertex2);
+	buf.Indices[level].push_back(bottomVertex1);
+
+	buf.Indices[level].push_back(topVertex2);
+	buf.Indices[level].push_back(bottomVertex2);
+	buf.Indices[level].push_back(bottomVertex1);
+}
+
+
+//! returns the maximal height difference between the full resolution of a tile and
+//! the geometry using only every 'step'th grid point
+irr::f32 CFlaceTerrainSceneNode::calculateTileLODError(irr::s32 tileX, irr::s32 tileY, irr::s32 step)
+{
+	if (step <= 1)
+		return 0.0f;
+
+	const irr::s32 firstCellX = tileX * CellsPerTileSide;
+	const irr::s32 firstCellY = tileY * CellsPerTileSide;
+
+	irr::f32 maxError = 0.0f;
+
+	for (int y0=0; y0<CellsPerTileSide; y0+=step)
+	{
+		const irr::s32 y1 = irr::core::min_(y0 + step, CellsPerTileSide);
+
+		for (int x0=0; x0<CellsPerTileSide; x0+=step)
+		{
+			const irr::s32 x1 = irr::core::min_(x0 + step, CellsPerTileSide);
+
+			const irr::f32 h00 = getTerrainDataHeightClamped(firstCellX + x0, firstCellY + y0);
+			const irr::f32 h10 = getTerrainDataHeightClamped(firstCellX + x1, firstCellY + y0);
+			const irr::f32 h01 = getTerrainDataHeightClamped(firstCellX + x0, firstCellY + y1);
+			const irr::f32 h11 = getTerrainDataHeightClamped(firstCellX + x1, firstCellY + y1);
+
+			for (int y=y0; y<=y1; ++y)
+			{
+				const irr::f32 fy = (y - y0) / (irr::f32)(y1 - y0);
+
+				for (int x=x0; x<=x1; ++x)
+				{
+					const irr::f32 fx = (x - x0) / (irr::f32)(x1 - x0);
+
+					// height on the two triangles of the group of cells, split from corner 0 to 3
+
+					irr::f32 h;
+					if (fx >= fy)
+						h = h00 + (h10 - h00) * fx + (h11 - h10) * fy;
+					else
+						h = h00 + (h01 - h00) * fy + (h11 - h01) * fx;
+
+					const irr::f32 err = irr::core::abs_(getTerrainDataHeightClamped(firstCellX + x, firstCellY + y) - h);
+					maxError = irr::core::max_(maxError, err);
+				}
+			}
+		}
+	}
+
+	return maxError;
+}
+
+
+//! selects the LOD level for each terrain tile, based on the distance to the camera and
+//! the error on the screen this would cause.
+void CFlaceTerrainSceneNode::updateTerrainTileLODs()
+{
+	ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera || !Driver)
+		return;
+
+	const irr::core::vector3df camPos = camera->getAbsolutePosition();
+	const irr::f32 screenHeight = (irr::f32)Driver->getCurrentRenderTargetSize().Height;
+	const irr::f32 pixelsPerUnitAtDistanceOne = screenHeight / (2.0f * tanf(camera->getFOV() * 0.5f));
+
+	for (int i=0; i<(int)TileLODs.size() && i<(int)TerrainTiles.size(); ++i)
+	{
+		STerrainTileLOD& lod = TileLODs[i];
+		if (lod.LevelCount < 2 || !TerrainTiles[i])
+			continue;
+
+		// distance to the nearest point of the tile
+
+		const irr::core::aabbox3df& box = TerrainTiles[i]->getBoundingBox();
+		irr::core::vector3df nearest(irr::core::clamp(camPos.X, box.MinEdge.X, box.MaxEdge.X),
+									 irr::core::clamp(camPos.Y, box.MinEdge.Y, box.MaxEdge.Y),
+									 irr::core::clamp(camPos.Z, box.MinEdge.Z, box.MaxEdge.Z));
+
+		const irr::f32 distance = nearest.getDistanceFrom(camPos);
+
+		irr::s32 level = 0;
+		if (distance > 0.0f)
+		{
+			for (int l=lod.LevelCount-1; l>0; --l)
+			{
+				if (lod.GeometricError[l] * pixelsPerUnitAtDistanceOne / distance <= LODMaxScreenError)
+				{
+					level = l;
+					break;
+				}
+			}
+		}
+
+		setTerrainTileLOD(i, level);
+	}
+}
+
+
+void CFlaceTerrainSceneNode::setTerrainTileLOD(irr::s32 tileIndex, irr::s32 level)
+{
+	if (tileIndex < 0 || tileIndex >= (irr::s32)TileLODs.size())
+		return;
+
+	STerrainTileLOD& lod = TileLODs[tileIndex];
+	if (lod.CurrentLevel == level || level < 0 || level >= lod.LevelCount)
+		return;
+
+	// the buffers of the tile mesh may have been replaced since, by lightmapping for example
+
+	const irr::scene::SMesh* mesh = tileIndex < (irr::s32)TerrainTiles.size() && TerrainTiles[tileIndex] ? 
+		TerrainTiles[tileIndex]->getOwnedMesh() : 0;
+
+	for (int b=0; b<(int)lod.Buffers.size(); ++b)
+	{
+		if (!mesh || mesh->MeshBuffers.linear_search(lod.Buffers[b]) == -1)
+		{
+			clearTerrainTileLOD(lod);
+			return;
+		}
+	}
+
+	for (int b=0; b<(int)lod.Buffers.size(); ++b)
+	{
+		lod.Buffers[b]->Indices = lod.Indices[level][b];
+		lod.Buffers[b]->setDirty(irr::scene::EBT_INDEX);
+	}
+
+	lod.CurrentLevel = level;
+}
+
+
+//! disables the LOD of a tile and releases its buffers, the buffers keep their current indices
+void CFlaceTerrainSceneNode::clearTerrainTileLOD(STerrainTileLOD& lod)
+{
+	for (int b=0; b<(int)lod.Buffers.size(); ++b)
+		lod.Buffers[b]->drop();
+	lod.Buffers.clear();
+
+	for (int l=0; l<TERRAIN_MAX_LOD_LEVELS; ++l)
+		lod.Indices[l].clear();
+
+	lod.LevelCount = 1;
+	lod.CurrentLevel = 0;
+}
+
+
+void CFlaceTerrainSceneNode::clearTerrainTileLODs()
+{
+	for (int i=0; i<(int)TileLODs.size(); ++i)
+		clearTerrainTileLOD(TileLODs[i]);
+}
+
+
+void CFlaceTerrainSceneNode::setLODLevelCount(irr::s32 count)
+{
+	count = irr::core::clamp(count, 1, TERRAIN_MAX_LOD_LEVELS);
+
+	if (count != LODLevelCount)
+	{
+		LODLevelCount = count;
+		updateMeshesFromTerrainData();
+	}
+}
+
+
+//! builds the staging geometry of several terrain tiles on the worker threads
+class CFlaceTerrainTileBuildJob : public IFlaceParallelJob
+{
+public:
+
+	CFlaceTerrainTileBuildJob(CFlaceTerrainSceneNode* terrain, 
+							  irr::core::array<CFlaceTerrainSceneNode::STerrainTileStaging>& staging, irr::s32 first)
+		: Terrain(terrain), Staging(staging), First(first)
+	{
+	}
+
+	virtual void runJobPart(irr::s32 partIndex)
+	{
+		Terrain->buildTerrainTileStaging(Staging[First + partIndex]);
+	}
+
+private:
+
+	CFlaceTerrainSceneNode* Terrain;
+	irr::core::array<CFlaceTerrainSceneNode::STerrainTileStaging>& Staging;
+	irr::s32 First;
+};
+
+
+void CFlaceTerrainSceneNode::updateMeshesFromTerrainData()
+{
+	updateMeshesFromTerrainData(0, 0, CellCountX, CellCountY);	
+}
+
+
+void CFlaceTerrainSceneNode::updateMeshesFromTerrainData(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	// a region meshed in the background may have read the old data, it is meshed again later
+	cancelTerrainPaging();
+
+	createTerrainSceneNodes();
+
+	// the splat map follows the textures set by the user. If the set of painted textures changed,
+	// the layers of the splat map changed, or it can't be used anymore: then all tiles need an update
+
+	if (updateSplatMap(startCellX - 1, startCellY - 1, endCellX + 1, endCellY + 1))
+	{
+		startCellX = 0;
+		startCellY = 0;
+		endCellX = CellCountX;
+		endCellY = CellCountY;
+	}
+
+	irr::core::rect<irr::s32> rectAffected(startCellX, startCellY, endCellX, endCellY);
+
+	// find affected tiles
+
+	irr::core::array<STerrainTileStaging> staging;
+
+	for (int tileX=0; tileX<TileCountX; ++tileX)
+	{
+		for (int tileY=0; tileY<TileCountY; ++tileY)
+		{
+			// check if this tile is actually affected. If not, we can skip it
+
+			irr::core::rect<irr::s32> rectContainedByTile(tileX * CellsPerTileSide, tileY * CellsPerTileSide, (tileX+1) * CellsPerTileSide, (tileY+1) * CellsPerTileSide);
+			if (!rectContainedByTile.isRectCollided(rectAffected))
+				continue;
+
+			if (!getTerrainTileMesh(tileX, tileY))
+				continue;
+
+			// released tiles are meshed from the new data when their region is loaded again
+			if (!isTerrainTileResident(getTerrainMeshIndex(tileX, tileY)))
+				continue;
+
+			staging.push_back(STerrainTileStaging());
+			staging.getLast().TileX = tileX;
+			staging.getLast().TileY = tileY;
+		}
+	}
+
+	// update tiles. Generating the vertices and indices only reads the terrain data, so it is 
+	// done on all cores. Creating mesh buffers and changing the scene is done here afterwards.
+	// Tiles are processed in batches, to not keep the geometry of the whole terrain twice in memory.
+
+	CFlaceWorkerPool* pool = CFlaceWorkerPool::getSharedPool();
+	const irr::s32 batchSize = pool->getThreadCount() * 4;
+
+	for (irr::s32 first=0; first<(irr::s32)staging.size(); first+=batchSize)
+	{
+		const irr::s32 count = irr::core::min_(batchSize, (irr::s32)staging.size() - first);
+
+		CFlaceTerrainTileBuildJob job(this, staging, first);
+		pool->runParallel(&job, count);
+
+		for (irr::s32 t=first; t<first+count; ++t)
+			applyTerrainTileStaging(staging[t]);
+	}
+}
+
+
+//! replaces the geometry of a tile with the geometry built on a worker thread
+void CFlaceTerrainSceneNode::applyTerrainTileStaging(STerrainTileStaging& staging)
+{
+	irr::scene::SMesh* mesh = getTerrainTileMesh(staging.TileX, staging.TileY);
+	if (!mesh)
+		return;
+
+	// clear cached collision geometry. Terrain triangle selectors don't cache anything and stay.
+
+	clearCachedCollisionTrianglesFromTerrainTile(getTerrainTileMeshSceneNode(staging.TileX, staging.TileY));
+
+	// replace geometry
+
+	for (u32 im=0; im<mesh->MeshBuffers.size(); ++im)
+		if (mesh->MeshBuffers[im])
+			mesh->MeshBuffers[im]->drop();
+	mesh->MeshBuffers.clear();
+
+	commitTerrainTileStaging(staging, mesh);
+
+	// bounding boxes of the buffers were already calculated on the worker threads,
+	// the box of the tile is known from the height pyramid. It doesn't include the LOD skirts, 
+	// but they only fill cracks and don't need to keep the tile from being culled.
+
+	irr::f32 minHeight, maxHeight;
+	if (getTerrainTileHeightRange(staging.TileX, staging.TileY, minHeight, maxHeight))
+	{
+		irr::core::vector3df p1 = getTerrain3DPositionClamped(staging.TileX * CellsPerTileSide, staging.TileY * CellsPerTileSide);
+		irr::core::vector3df p2 = getTerrain3DPositionClamped((staging.TileX+1) * CellsPerTileSide, (staging.TileY+1) * CellsPerTileSide);
+
+		mesh->BoundingBox.reset(p1.X, minHeight + Displacement.Y, p1.Z);
+		mesh->BoundingBox.addInternalPoint(p2.X, maxHeight + Displacement.Y, p2.Z);
+	}
+	else
+		mesh->recalculateBoundingBox();
+
+	// free memory early
+	staging.Buffers.clear();
+
+	// grass and trees standing on the rebuilt tile need to follow the new heights
+	markGrassBatchDirty(getTerrainMeshIndex(staging.TileX, staging.TileY));
+	markForestBatchDirty(getTerrainMeshIndex(staging.TileX, staging.TileY));
+}
+
+
+// Paging of very large terrains. The cells of the terrain stay in memory, they are compact and needed for
+// the height queries and the collision anyway. What is paged is the geometry created from them, which is
+// many times bigger: the tile meshes with their LOD index sets, and the grass batches. Regions near the camera
+// are meshed on a background thread by the worker pool, and the result is put into the scene when done.
+
+
+
+void CFlaceTerrainSceneNode::setTerrainPaging(irr::s32 regionSize, irr::f32 distance, irr::s32 budgetMB)
+{
+	regionSize = irr::core::max_(regionSize, 0);
+	distance = irr::core::max_(distance, 0.0f);
+	budgetMB = irr::core::max_(budgetMB, 0);
+
+	if (regionSize == PagingRegionSize && distance == PagingDistance && budgetMB == PagingMemoryBudget)
+		return;
+
+	PagingDistance = distance;
+	PagingMemoryBudget = budgetMB;
+
+	if (regionSize == PagingRegionSize)
+		return;
+
+	cancelTerrainPaging();
+
+	bool hasReleasedRegions = false;
+	for (int r=0; r<(int)PagingRegions.size(); ++r)
+		if (PagingRegions[r].State != EPRS_RESIDENT)
+			hasReleasedRegions = true;
+
+	PagingRegionSize = regionSize;
+
+	// the layout is recreated from the tiles which currently have geometry. Without paging, 
+	// the released tiles need to be meshed again.
+
+	PagingRegions.clear();
+	PagingRegionCountX = 0;
+	PagingRegionCountY = 0;
+
+	if (hasReleasedRegions && !isPagingActive())
+		updateMeshesFromTerrainData();
+}
+
+
+//! returns the amount of bytes used by the geometry of the currently loaded paging regions
+irr::s32 CFlaceTerrainSceneNode::getPagedGeometryMemory()
+{
+	irr::s32 memory = 0;
+
+	for (int r=0; r<(int)PagingRegions.size(); ++r)
+		if (PagingRegions[r].State == EPRS_RESIDENT)
+			memory += PagingRegions[r].Memory;
+
+	return memory;
+}
+
+
+//! returns if paging is enabled and possible for the current terrain
+bool CFlaceTerrainSceneNode::isPagingActive()
+{
+	return PagingRegionSize > 0 && LightingType != ETLT_LIGHTMAP_VERTEX_COLORS && TileCountX > 0 && TileCountY > 0 &&
+		(irr::s32)TerrainHeights.size() == CellCountX * CellCountY && 
+		(irr::s32)TerrainTiles.size() == TileCountX * TileCountY;
+}
+
+
+//! creates the paging regions if the size of the terrain or of the regions changed. Regions
+//! of which all tiles have geometry start as loaded, the others are released completely.
+void CFlaceTerrainSceneNode::updatePagingRegionLayout()
+{
+	const irr::s32 countX = (TileCountX + PagingRegionSize - 1) / PagingRegionSize;
+	const irr::s32 countY = (TileCountY + PagingRegionSize - 1) / PagingRegionSize;
+
+	if (countX == PagingRegionCountX && countY == PagingRegionCountY && 
+		(irr::s32)PagingRegions.size() == countX * countY)
+		return;
+
+	cancelTerrainPaging();
+
+	PagingRegionCountX = countX;
+	PagingRegionCountY = countY;
+
+	SPagingRegion region;
+	region.State = EPRS_RESIDENT;
+	region.Memory = 0;
+
+	PagingRegions.clear();
+	PagingRegions.set_used(countX * countY);
+
+	for (int r=0; r<(int)PagingRegions.size(); ++r)
+	{
+		PagingRegions[r] = region;
+
+		const irr::s32 startTileX = (r % countX) * PagingRegionSize;
+		const irr::s32 startTileY = (r / countX) * PagingRegionSize;
+		bool hasAllGeometry = true;
+
+		for (int tileY=startTileY; tileY<startTileY+PagingRegionSize && tileY<TileCountY; ++tileY)
+			for (int tileX=startTileX; tileX<startTileX+PagingRegionSize && tileX<TileCountX; ++tileX)
+			{
+				irr::scene::SMesh* mesh = getTerrainTileMesh(tileX, tileY);
+				if (mesh && !mesh->getMeshBufferCount())
+					hasAllGeometry = false;
+			}
+
+		if (hasAllGeometry)
+			PagingRegions[r].Memory = getPagingRegionMemory(r);
+		else
+			releaseTerrainPagingRegion(r);
+	}
+}
+
+
+//! loads and releases paging regions depending on the distance to the camera, called once per frame
+void CFlaceTerrainSceneNode::updateTerrainPaging()
+{
+	if (!isPagingActive())
+	{
+		cancelTerrainPaging();
+		return;
+	}
+
+	updatePagingRegionLayout();
+	finishTerrainPagingJob();
+
+	ICameraSceneNode* camera = SceneManager->getActiveCamera();
+	if (!camera)
+		return;
+
+	const irr::core::vector3df camPos = camera->getAbsolutePosition();
+	const irr::s32 regionCount = (irr::s32)PagingRegions.size();
+	const bool unlimitedDistance = PagingDistance <= 0.0f;
+
+	irr::core::array<irr::f32> distances;
+	distances.set_used(regionCount);
+	for (int r=0; r<regionCount; ++r)
+		distances[r] = getPagingRegionDistance(r, camPos);
+
+	// release regions which are too far away
+
+	irr::f64 memory = 0;
+	irr::s32 largestRegionMemory = 0;
+	irr::s32 residentCount = 0;
+
+	for (int r=0; r<regionCount; ++r)
+	{
+		SPagingRegion& region = PagingRegions[r];
+		if (region.State != EPRS_RESIDENT)
+			continue;
+
+		if (!unlimitedDistance && distances[r] > PagingDistance * TERRAIN_PAGING_RELEASE_FACTOR)
+		{
+			releaseTerrainPagingRegion(r);
+			continue;
+		}
+
+		// grass batches are built after loading a region, so the size is updated every frame
+		region.Memory = getPagingRegionMemory(r);
+
+		memory += region.Memory;
+		largestRegionMemory = irr::core::max_(largestRegionMemory, region.Memory);
+		++residentCount;
+	}
+
+	// keep the memory budget by releasing the farthest regions, but always keep the nearest one
+
+	const irr::f64 budget = (irr::f64)PagingMemoryBudget * 1024.0 * 1024.0;
+
+	while (PagingMemoryBudget > 0 && memory > budget && residentCount > 1)
+	{
+		irr::s32 farthest = -1;
+		for (int r=0; r<regionCount; ++r)
+			if (PagingRegions[r].State == EPRS_RESIDENT && (farthest == -1 || distances[r] > distances[farthest]))
+				farthest = r;
+
+		memory -= PagingRegions[farthest].Memory;
+		releaseTerrainPagingRegion(farthest);
+		--residentCount;
+	}
+
+	// start meshing the nearest missing region. Only one region is loaded at a time, and only
+	// if it would fit into the budget, estimated from the largest region loaded.
+
+	if (PagingJob)
+		return;
+
+	if (PagingMemoryBudget > 0 && residentCount && memory + largestRegionMemory > budget)
+		return;
+
+	irr::s32 nearest = -1;
+	for (int r=0; r<regionCount; ++r)
+		if (PagingRegions[r].State == EPRS_RELEASED && (unlimitedDistance || distances[r] <= PagingDistance) &&
+			(nearest == -1 || distances[r] < distances[nearest]))
+			nearest = r;
+
+	if (nearest == -1)
+		return;
+
+	const irr::s32 startTileX = (nearest % PagingRegionCountX) * PagingRegionSize;
+	const irr::s32 startTileY = (nearest / PagingRegionCountX) * PagingRegionSize;
+
+	PagingStaging.clear();
+
+	for (int tileY=startTileY; tileY<startTileY+PagingRegionSize && tileY<TileCountY; ++tileY)
+		for (int tileX=startTileX; tileX<startTileX+PagingRegionSize && tileX<TileCountX; ++tileX)
+		{
+			if (!getTerrainTileMesh(tileX, tileY))
+				continue;
+
+			PagingStaging.push_back(STerrainTileStaging());
+			PagingStaging.getLast().TileX = tileX;
+			PagingStaging.getLast().TileY = tileY;
+		}
+
+	PagingJob = new CFlaceTerrainTileBuildJob(this, PagingStaging, 0);
+
+	if (!CFlaceWorkerPool::getSharedPool()->startInBackground(PagingJob, (irr::s32)PagingStaging.size()))
+	{
+		// the pool is busy with the job of another terrain, try again next frame
+		delete PagingJob;
+		PagingJob = 0;
+		PagingStaging.clear();
+		return;
+	}
+
+	PagingLoadingRegion = nearest;
+	PagingRegions[nearest].State = EPRS_LOADING;
+
+	// without worker threads, the job is already done
+	finishTerrainPagingJob();
+}
+
+
+//! puts the geometry of the region meshed in the background into the scene, if the job is done
+void CFlaceTerrainSceneNode::finishTerrainPagingJob()
+{
+	if (!PagingJob || !CFlaceWorkerPool::getSharedPool()->isBackgroundJobDone(PagingJob))
+		return;
+
+	delete PagingJob;
+	PagingJob = 0;
+
+	for (int t=0; t<(int)PagingStaging.size(); ++t)
+		applyTerrainTileStaging(PagingStaging[t]);
+
+	PagingStaging.clear();
+
+	if (PagingLoadingRegion >= 0 && PagingLoadingRegion < (irr::s32)PagingRegions.size())
+	{
+		PagingRegions[PagingLoadingRegion].State = EPRS_RESIDENT;
+		PagingRegions[PagingLoadingRegion].Memory = getPagingRegionMemory(PagingLoadingRegion);
+	}
+
+	PagingLoadingRegion = -1;
+}
+
+
+//! waits for the region meshed in the background and throws its geometry away. Needs to be called before 
+//! changing anything the meshing reads, like the cells or the textures. The region is meshed again later.
+void CFlaceTerrainSceneNode::cancelTerrainPaging()
+{
+	if (!PagingJob)
+		return;
+
+	CFlaceWorkerPool::getSharedPool()->waitForBackgroundJob(PagingJob);
+
+	delete PagingJob;
+	PagingJob = 0;
+	PagingStaging.clear();
+
+	if (PagingLoadingRegion >= 0 && PagingLoadingRegion < (irr::s32)PagingRegions.size())
+		PagingRegions[PagingLoadingRegion].State = EPRS_RELEASED;
+
+	PagingLoadingRegion = -1;
+}
+
+
+//! drops the geometry of all tiles of a region. The tile scene nodes and their triangle selectors stay,
+//! the selectors create their triangles from the cells.
+void CFlaceTerrainSceneNode::releaseTerrainPagingRegion(irr::s32 regionIndex)
+{
+	const irr::s32 startTileX = (regionIndex % PagingRegionCountX) * PagingRegionSize;
+	const irr::s32 startTileY = (regionIndex / PagingRegionCountX) * PagingRegionSize;
+
+	for (int tileY=startTileY; tileY<startTileY+PagingRegionSize && tileY<TileCountY; ++tileY)
+		for (int tileX=startTileX; tileX<startTileX+PagingRegionSize && tileX<TileCountX; ++tileX)
+		{
+			const irr::s32 tileIndex = getTerrainMeshIndex(tileX, tileY);
+
+			clearCachedCollisionTrianglesFromTerrainTile(getTerrainTileMeshSceneNode(tileX, tileY));
+
+			irr::scene::SMesh* mesh = getTerrainTileMesh(tileX, tileY);
+			if (mesh)
+			{
+				// the bounding box is kept, it is still right
+				for (u32 im=0; im<mesh->MeshBuffers.size(); ++im)
+					if (mesh->MeshBuffers[im])
+						mesh->MeshBuffers[im]->drop();
+				mesh->MeshBuffers.clear();
+			}
+
+			if (tileIndex < (irr::s32)TileLODs.size())
+				clearTerrainTileLOD(TileLODs[tileIndex]);
+
+			if (tileIndex < (irr::s32)GrassBatches.size())
+			{
+				SGrassBatch& batch = GrassBatches[tileIndex];
+				if (batch.Mesh)
+					batch.Mesh->drop();
+				batch.Mesh = 0;
+				batch.Dirty = true;
+			}
+
+			releaseForestBatch(tileIndex);
+		}
+
+	PagingRegions[regionIndex].State = EPRS_RELEASED;
+	PagingRegions[regionIndex].Memory = 0;
+}
+
+
+//! returns if a tile has its geometry loaded. Always true if paging is not used.
+bool CFlaceTerrainSceneNode::isTerrainTileResident(irr::s32 tileIndex)
+{
+	if (!isPagingActive())
+		return true;
+
+	const irr::s32 regionIndex = getPagingRegionIndexOfTile(tileIndex);
+	if (regionIndex < 0 || regionIndex >= (irr::s32)PagingRegions.size())
+		return true; // regions not created yet, they start with the geometry there is
+
+	return PagingRegions[regionIndex].State == EPRS_RESIDENT;
+}
+
+
+irr::s32 CFlaceTerrainSceneNode::getPagingRegionIndexOfTile(irr::s32 tileIndex)
+{
+	if (PagingRegionSize <= 0 || TileCountX <= 0 || tileIndex < 0)
+		return -1;
+
+	const irr::s32 tileX = tileIndex % TileCountX;
+	const irr::s32 tileY = tileIndex / TileCountX;
+
+	return (tileY / PagingRegionSize) * PagingRegionCountX + (tileX / PagingRegionSize);
+}
+
+
+//! returns the distance of a position to the nearest point of the terrain surface box of a region
+irr::f32 CFlaceTerrainSceneNode::getPagingRegionDistance(irr::s32 regionIndex, const irr::core::vector3df& pos)
+{
+	const irr::s32 cellsPerRegion = PagingRegionSize * CellsPerTileSide;
+	const irr::s32 startCellX = (regionIndex % PagingRegionCountX) * cellsPerRegion;
+	const irr::s32 startCellY = (regionIndex / PagingRegionCountX) * cellsPerRegion;
+
+	irr::core::vector3df p1 = getTerrain3DPositionClamped(startCellX, startCellY);
+	irr::core::vector3df p2 = getTerrain3DPositionClamped(startCellX + cellsPerRegion, startCellY + cellsPerRegion);
+
+	irr::core::aabbox3df box(p1);
+	box.addInternalPoint(p2);
+
+	irr::f32 minHeight, maxHeight;
+	if (getTerrainHeightRange(startCellX, startCellY, startCellX + cellsPerRegion, startCellY + cellsPerRegion, minHeight, maxHeight))
+	{
+		box.MinEdge.Y = minHeight + Displacement.Y;
+		box.MaxEdge.Y = maxHeight + Displacement.Y;
+	}
+
+	irr::core::vector3df nearest(irr::core::clamp(pos.X, box.MinEdge.X, box.MaxEdge.X),
+								 irr::core::clamp(pos.Y, box.MinEdge.Y, box.MaxEdge.Y),
+								 irr::core::clamp(pos.Z, box.MinEdge.Z, box.MaxEdge.Z));
+
+	return nearest.getDistanceFrom(pos);
+}
+
+
+//! returns the bytes used by the tile meshes, LOD index sets, grass and forest batches of a region
+irr::s32 CFlaceTerrainSceneNode::getPagingRegionMemory(irr::s32 regionIndex)
+{
+	const irr::s32 startTileX = (regionIndex % PagingRegionCountX) * PagingRegionSize;
+	const irr::s32 startTileY = (regionIndex / PagingRegionCountX) * PagingRegionSize;
+
+	irr::s32 memory = 0;
+
+	for (int tileY=startTileY; tileY<startTileY+PagingRegionSize && tileY<TileCountY; ++tileY)
+		for (int tileX=startTileX; tileX<startTileX+PagingRegionSize && tileX<TileCountX; ++tileX)
+		{
+			const irr::s32 tileIndex = getTerrainMeshIndex(tileX, tileY);
+
+			irr::scene::SMesh* mesh = getTerrainTileMesh(tileX, tileY);
+			for (u32 im=0; mesh && im<mesh->MeshBuffers.size(); ++im)
+			{
+				irr::scene::IMeshBuffer* buf = mesh->MeshBuffers[im];
+				memory += (irr::s32)(buf->getVertexCount() * sizeof(irr::video::S3DVertex) + buf->getIndexCount() * sizeof(irr::u16));
+			}
+
+			if (tileIndex < (irr::s32)TileLODs.size())
+			{
+				const STerrainTileLOD& lod = TileLODs[tileIndex];
+				for (int l=0; l<TERRAIN_MAX_LOD_LEVELS; ++l)
+					for (int b=0; b<(int)lod.Indices[l].size(); ++b)
+						memory += (irr::s32)(lod.Indices[l][b].size() * sizeof(irr::u16));
+			}
+
+			if (tileIndex < (irr::s32)GrassBatches.size() && GrassBatches[tileIndex].Mesh)
+			{
+				irr::scene::SMesh* grass = GrassBatches[tileIndex].Mesh;
+				for (u32 im=0; im<grass->MeshBuffers.size(); ++im)
+				{
+					irr::scene::IMeshBuffer* buf = grass->MeshBuffers[im];
+					memory += (irr::s32)(buf->getVertexCount() * sizeof(irr::video::S3DVertex) + buf->getIndexCount() * sizeof(irr::u16));
+				}
+			}
+
+			for (int f=0; f<2 && tileIndex < (irr::s32)ForestBatches.size(); ++f)
+			{
+				irr::scene::SMesh* forest = f ? ForestBatches[tileIndex].ImpostorMesh : ForestBatches[tileIndex].Mesh;
+				for (u32 im=0; forest && im<forest->MeshBuffers.size(); ++im)
+				{
+					irr::scene::IMeshBuffer* buf = forest->MeshBuffers[im];
+					memory += (irr::s32)(buf->getVertexCount() * sizeof(irr::video::S3DVertex) + buf->getIndexCount() * sizeof(irr::u16));
+				}
+			}
+		}
+
+	return memory;
+}
+
+
+//! expands the grass instances of a tile into a batch of quads. IVideoDriver has no hardware
+//! instancing, so all instances of a tile are put into shared mesh buffers, one per texture.
+//! The batch is kept separate from the tile mesh, so editing grass doesn't change the terrain geometry.
+void CFlaceTerrainSceneNode::updateGrassBatch(irr::s32 tileIndex)
+{
+	SGrassBatch& batch = GrassBatches[tileIndex];
+	batch.Dirty = false;
+
+	const irr::core::array<SGrassInstance>& bucket = GrassBuckets[tileIndex];
+
+	if (!batch.Mesh)
+	{
+		if (bucket.empty())
+			return;
+
+		batch.Mesh = new irr::scene::SMesh();
+	}
+
+	irr::scene::SMesh* mesh = batch.Mesh;
+
+	for (u32 im=0; im<mesh->MeshBuffers.size(); ++im)
+		if (mesh->MeshBuffers[im])
+			mesh->MeshBuffers[im]->drop();
+	mesh->MeshBuffers.clear();
+
+	irr::video::SColor clrGrass = video::DefaultWhiteColor;
+
+	// add the instances in random order, so that drawing only the first part of a mesh buffer
+	// still spreads the grass evenly over the whole tile. See renderGrass().
+
+	irr::core::array<irr::s32> order;
+	order.set_used(bucket.size());
+	for (int i=0; i<(int)order.size(); ++i)
+		order[i] = i;
+
+	irr::u32 seed = (irr::u32)tileIndex * 2654435761u + 1;
+	for (int i=(int)order.size()-1; i>0; --i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		irr::s32 j = (irr::s32)((seed >> 8) % (irr::u32)(i+1));
+		irr::core::swap(order[i], order[j]);
+	}
+
+	// count instances per texture, to reserve the memory of the mesh buffers only once
+
+	irr::core::array<irr::s32> remainingPerTexture;
+	remainingPerTexture.set_used(Textures.size());
+	for (int t=0; t<(int)remainingPerTexture.size(); ++t)
+		remainingPerTexture[t] = 0;
+
+	for (int i=0; i<(int)bucket.size(); ++i)
+		if (bucket[i].TextureIndex >= 0 && bucket[i].TextureIndex < (irr::s32)remainingPerTexture.size())
+			++remainingPerTexture[bucket[i].TextureIndex];
+
+	SMeshBufferLookup lookup;
+
+	for (int i=0; i<(int)order.size(); ++i)
+	{
+		const SGrassInstance& g = bucket[order[i]];
+
+		irr::f32 height = getExactTerrainHeightClampedAtPosition(g.PosX, g.PosZ);
+		irr::core::vector3df normal = getTerrainNormalClampedAtPosition(g.PosX, g.PosZ);
+
+		irr::scene::SMeshBuffer* buf = getOrCreateMeshBuffer(mesh, g.TextureIndex, g.TextureIndex, 8, 12, true, &lookup);
+		if (buf)
+		{		
+			if (buf->Vertices.empty() && g.TextureIndex >= 0 && g.TextureIndex < (irr::s32)remainingPerTexture.size())
+			{
+				// new buffer, reserve space for all remaining instances using this texture
+				const irr::u32 instances = irr::core::min_(remainingPerTexture[g.TextureIndex], 65536 / 8);
+				buf->Vertices.reallocate(instances * 8);
+				buf->Indices.reallocate(instances * 12);
+			}
+
+			if (g.TextureIndex >= 0 && g.TextureIndex < (irr::s32)remainingPerTexture.size())
+				--remainingPerTexture[g.TextureIndex];
+
+			irr::core::vector3df pos(g.PosX + Displacement.X, height, g.PosZ + Displacement.Z);
+
+			for (int axis=0; axis<2; ++axis)
+			{
+				for (int backface=0; backface<1; ++backface)
+				{
+					irr::u16 nIndexStart = buf->Vertices.size();
+
+					irr::f32 r = g.Rotation;
+					if (axis == 1) r += 1.34f;
+
+					irr::video::S3DVertex vtx1;
+					vtx1.Color = clrGrass;
+					vtx1.TCoords.X = 0.0f;
+					vtx1.TCoords.Y = 1.0f;
+					vtx1.Pos.X = pos.X + sin(r) * g.Width * 0.5f;
+					vtx1.Pos.Y = height;
+					vtx1.Pos.Z = pos.Z + cos(r) * g.Width * 0.5f;
+
+					irr::video::S3DVertex vtx2;
+					vtx2.Color = clrGrass;
+					vtx2.TCoords.X = 1.0f;
+					vtx2.TCoords.Y = 1.0f;
+					vtx2.Pos.X = pos.X - sin(r) * g.Width * 0.5f;
+					vtx2.Pos.Y = height;
+					vtx2.Pos.Z = pos.Z - cos(r) * g.Width * 0.5f;
+
+					irr::video::S3DVertex vtx3;
+					vtx3.Color = clrGrass;
+					vtx3.TCoords.X = 0.0f;
+					vtx3.TCoords.Y = 0.0f;
+					vtx3.Pos.X = pos.X + sin(r) * g.Width * 0.5f;
+					vtx3.Pos.Y = height + g.Height;
+					vtx3.Pos.Z = pos.Z + cos(r) * g.Width * 0.5f;
+
+					irr::video::S3DVertex vtx4;
+					vtx4.Color = clrGrass;
+					vtx4.TCoords.X = 1.0f;
+					vtx4.TCoords.Y = 0.0f;
+					vtx4.Pos.X = pos.X - sin(r) * g.Width * 0.5f;
+					vtx4.Pos.Y = height + g.Height;
+					vtx4.Pos.Z = pos.Z - cos(r) * g.Width * 0.5f;				
+
+					vtx1.Normal = normal;
+					vtx2.Normal = normal;
+					vtx3.Normal = normal;
+					vtx4.Normal = normal;
+
+					buf->Vertices.push_back(vtx1);
+					buf->Vertices.push_back(vtx2);
+					buf->Vertices.push_back(vtx3);
+					buf->Vertices.push_back(vtx4);
+
+					const int indicesFront[] = {2,1,0, 2,3,1};
+					const int indicesBack[]  = {2,0,1, 2,1,3};
+					int* indices = (int*)indicesFront;
+					if (backface > 0)
+						indices = (int*)indicesBack;
+
+					for (int ind=0; ind<6; ++ind)
+						buf->Indices.push_back(nIndexStart + indices[ind]);
+				}
+			}
+		}
+	}
+
+	for (u32 i=0; i<mesh->MeshBuffers.size(); ++i)
+		mesh->MeshBuffers[i]->recalculateBoundingBox();
+
+	mesh->recalculateBoundingBox();
+}
+
+
+void CFlaceTerrainSceneNode::markGrassBatchDirty(irr::s32 tileIndex)
+{
+	if (tileIndex >= 0 && tileIndex < (irr::s32)GrassBatches.size())
+		GrassBatches[tileIndex].Dirty = true;
+}
+
+
+void CFlaceTerrainSceneNode::clearGrassBatches()
+{
+	for (int i=0; i<(int)GrassBatches.size(); ++i)
+		if (GrassBatches[i].Mesh)
+			GrassBatches[i].Mesh->drop();
+
+	GrassBatches.clear();
+}
+
+
+//! rebuilds the grass batches changed since the last frame, and returns if there is any grass to render
+bool CFlaceTerrainSceneNode::updateGrassBatches()
+{
+	if ((irr::s32)TerrainHeights.size() != CellCountX * CellCountY)
+		return false; // no heights to place the grass on
+
+	updateGrassBucketLayout();
+
+	bool hasGrass = false;
+
+	for (int i=0; i<(int)GrassBatches.size(); ++i)
+	{
+		if (GrassBatches[i].Dirty && isTerrainTileResident(i))
+			updateGrassBatch(i);
+
+		if (GrassBatches[i].Mesh && GrassBatches[i].Mesh->getMeshBufferCount())
+			hasGrass = true;
+	}
+
+	return hasGrass;
+}
+
+
+//! returns which part of the grass of a tile should be drawn, from 0 (culled) to 1 (all)
+irr::f32 CFlaceTerrainSceneNode::getGrassDensityForDistance(irr::f32 distance)
+{
+	if (GrassViewDistance <= 0.0f)
+		return 1.0f; // no view distance set, draw everything
+
+	if (distance >= GrassViewDistance)
+		return 0.0f;
+
+	const irr::f32 fadeStart = GrassViewDistance - GrassFadeDistance;
+
+	if (GrassFadeDistance <= 0.0f || distance <= fadeStart)
+		return 1.0f;
+
+	return (GrassViewDistance - distance) / GrassFadeDistance;
+}
+
+
+void CFlaceTerrainSceneNode::renderGrass(irr::video::IVideoDriver* driver, irr::scene::ICameraSceneNode* camera)
+{
+	const irr::core::aabbox3df& frustumBox = camera->getViewFrustum()->getBoundingBox();
+	const irr::core::vector3df camPos = camera->getAbsolutePosition();
+
+	// each grass instance is 2 quads: 8 vertices and 4 triangles
+	const irr::u32 verticesPerInstance = 8;
+	const irr::u32 trianglesPerInstance = 4;
+
+	for (int i=0; i<(int)GrassBatches.size(); ++i)
+	{
+		irr::scene::SMesh* mesh = GrassBatches[i].Mesh;
+		if (!mesh || !mesh->getMeshBufferCount())
+			continue;
+
+		const irr::core::aabbox3df& box = mesh->getBoundingBox();
+
+		if (!frustumBox.intersectsWithBox(box))
+			continue;
+
+		// distance from the camera to the nearest point of the tile
+
+		irr::core::vector3df nearest(irr::core::clamp(camPos.X, box.MinEdge.X, box.MaxEdge.X),
+									 irr::core::clamp(camPos.Y, box.MinEdge.Y, box.MaxEdge.Y),
+									 irr::core::clamp(camPos.Z, box.MinEdge.Z, box.MaxEdge.Z));
+
+		const irr::f32 density = getGrassDensityForDistance(nearest.getDistanceFrom(camPos));
+		if (density <= 0.0f)
+			continue;
+
+		for (u32 b=0; b<mesh->MeshBuffers.size(); ++b)
+		{
+			irr::scene::IMeshBuffer* buf = mesh->MeshBuffers[b];
+			driver->setMaterial(buf->getMaterial());
+
+			if (density >= 1.0f)
+			{
+				driver->drawMeshBuffer(buf);
+				continue;
+			}
+
+			// instances are stored in random order, so the first part is an even thinned out set
+
+			const irr::u32 instanceCount = buf->getVertexCount() / verticesPerInstance;
+			const irr::u32 instancesToDraw = (irr::u32)(instanceCount * density);
+			if (!instancesToDraw)
+				continue;
+
+			driver->drawVertexPrimitiveList(buf->getVertices(), instancesToDraw * verticesPerInstance,
+				buf->getIndices(), instancesToDraw * trianglesPerInstance,
+				buf->getVertexType(), irr::scene::EPT_TRIANGLES, buf->getIndexType());
+		}
+	}
+}
+
+
+//! terrain tiles saved by older versions have the grass quads baked into their meshes,
+//! remove them since the grass is now rendered from the grass batches.
+void CFlaceTerrainSceneNode::removeBakedGrassFromTileMeshes()
+{
+	for (int t=0; t<(int)TerrainTiles.size(); ++t)
+	{
+		if (!TerrainTiles[t])
+			continue;
+
+		irr::scene::SMesh* mesh = TerrainTiles[t]->getOwnedMesh();
+		if (!mesh)
+			continue;
+
+		bool removed = false;
+
+		for (int i=0; i<(int)mesh->MeshBuffers.size(); )
+		{
+			irr::video::E_MATERIAL_TYPE type = mesh->MeshBuffers[i]->getMaterial().MaterialType;
+
+			if (type == irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF_MOVING_GRASS ||
+				type == irr::video::EMT_TRANSPARENT_ALPHA_CHANNEL_REF)
+			{
+				mesh->MeshBuffers[i]->drop();
+				mesh->MeshBuffers.erase(i);
+				removed = true;
+			}
+			else
+				++i;
+		}
+
+		if (removed)
+		{
+			clearCachedCollisionTrianglesFromTerrainTile(TerrainTiles[t]);
+			mesh->recalculateBoundingBox();
+		}
+	}
+}
+
+
+void CFlaceTerrainSceneNode::setUseSplatMap(bool use)
+{
+	if (use == UseSplatMap)
+		return;
+
+	UseSplatMap = use;
+	updateMeshesFromTerrainData();
+}
+
+
+//! returns the layer of the splat map showing a texture, or -1 if none does
+irr::s32 CFlaceTerrainSceneNode::getSplatLayer(const irr::core::array<irr::s32>& layers, irr::s32 textureIndex)
+{
+	irr::video::ITexture* tex = getTerrainTexture(textureIndex);
+
+	for (int l=0; l<(int)layers.size(); ++l)
+		if (layers[l] == textureIndex || getTerrainTexture(layers[l]) == tex)
+			return l;
+
+	return -1;
+}
+
+
+//! adds the textures painted onto a rectangle of cells (end exclusive) to the layers of the splat map, 
+//! if they don't have a layer yet. Returns false if there are more textures than the shader can blend.
+bool CFlaceTerrainSceneNode::addSplatLayers(irr::core::array<irr::s32>& layers, int startCellX, int startCellY, 
+											 int endCellX, int endCellY)
+{
+	irr::s32 lastTextureIndex = TERRAIN_SPLAT_TEXTURE_INDEX;
+
+	for (int y=startCellY; y<endCellY; ++y)
+	{
+		const irr::u8* row = TerrainTextureIndices.getRow(y);
+
+		for (int x=startCellX; x<endCellX; ++x)
+		{
+			const irr::s32 idx = row[x];
+			if (idx == lastTextureIndex)
+				continue;
+
+			lastTextureIndex = idx;
+
+			if (getSplatLayer(layers, idx) == -1)
+			{
+				if ((irr::s32)layers.size() >= TERRAIN_SPLAT_MAX_LAYERS)
+					return false;
+
+				layers.push_back(idx);
+			}
+		}
+	}
+
+	return true;
+}
+
+
+//! updates the weights in the splat map for a rectangle of grid points. Each different texture painted 
+//! onto the terrain is a layer of the splat map, and the weight of a layer at a grid point is the amount 
+//! of the 4 cells around the grid point using its texture. Creates or removes the splat map if needed.
+//! Only the cells and texels inside of the rectangle are touched, unless the layers need to be sorted out again.
+//! Returns true if all tiles need to be rebuilt, because the layers changed or the splat map was removed.
+bool CFlaceTerrainSceneNode::updateSplatMap(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	bool possible = UseSplatMap && CellSize > 0 && CellCountX > 0 && CellCountY > 0 && Driver &&
+		(irr::s32)TerrainHeights.size() == CellCountX * CellCountY &&
+		(irr::s32)TerrainTextureIndices.size() == CellCountX * CellCountY &&
+		CFlaceTerrainSplatShader::getMaterialType(Driver) != -1;
+
+	startCellX = irr::core::max_(startCellX, 0);
+	startCellY = irr::core::max_(startCellY, 0);
+	endCellX = irr::core::min_(endCellX, CellCountX);
+	endCellY = irr::core::min_(endCellY, CellCountY);
+
+	const bool wholeTerrain = startCellX == 0 && startCellY == 0 && endCellX == CellCountX && endCellY == CellCountY;
+
+	// keep the existing layers and add the textures painted inside of the rectangle. Only if there are
+	// too many then, search the whole terrain again, to drop the layers of textures not painted anymore.
+
+	irr::core::array<irr::s32> layers;
+
+	if (possible)
+	{
+		if (SplatMap && !wholeTerrain)
+			layers = SplatLayers;
+
+		if (!addSplatLayers(layers, startCellX, startCellY, endCellX, endCellY))
+		{
+			layers.clear();
+			possible = !wholeTerrain && addSplatLayers(layers, 0, 0, CellCountX, CellCountY);
+		}
+	}
+
+	if (!possible)
+	{
+		const bool wasUsed = SplatMap != 0;
+		clearSplatMap();
+		return wasUsed;
+	}
+
+	// the weights already in the splat map stay valid if layers were only added after the existing ones
+
+	bool layersChanged = layers.size() != SplatLayers.size();
+	bool weightsValid = SplatMap && layers.size() >= SplatLayers.size() &&
+		SplatMap->getOriginalSize() == irr::core::dimension2d<irr::u32>(CellCountX, CellCountY);
+
+	for (int l=0; l<(int)SplatLayers.size() && l<(int)layers.size(); ++l)
+	{
+		if (layers[l] != SplatLayers[l])
+		{
+			layersChanged = true;
+			weightsValid = false;
+		}
+	}
+
+	bool recreated = false;
+
+	if (!SplatMap || SplatMap->getOriginalSize() != irr::core::dimension2d<irr::u32>(CellCountX, CellCountY))
+	{
+		clearSplatMap();
+
+		static irr::s32 splatMapCount = 0;
+		irr::core::stringc name = "#terrain_splatmap_";
+		name += irr::core::stringc(++splatMapCount);
+
+		SplatMap = Driver->addTexture(irr::core::dimension2d<irr::u32>(CellCountX, CellCountY), name.c_str(), 
+			irr::video::ECF_A8R8G8B8);
+
+		if (!SplatMap || SplatMap->getColorFormat() != irr::video::ECF_A8R8G8B8 ||
+			SplatMap->getSize().Width < (irr::u32)CellCountX || SplatMap->getSize().Height < (irr::u32)CellCountY)
+		{
+			// terrain too large for a texture
+			clearSplatMap();
+			return true;
+		}
+
+		recreated = true;
+	}
+
+	SplatLayers = layers;
+
+	if (!weightsValid)
+	{
+		startCellX = 0;
+		startCellY = 0;
+		endCellX = CellCountX;
+		endCellY = CellCountY;
+	}
+
+	// the driver may have created a larger texture than wanted, like if it only supports power of two sizes.
+	// Grid points are in the centers of the texels.
+
+	const irr::core::dimension2d<irr::u32> size = SplatMap->getSize();
+
+	irr::f32 transform[4];
+	transform[0] = 1.0f / (CellSize * (irr::f32)size.Width);
+	transform[1] = 1.0f / (CellSize * (irr::f32)size.Height);
+	transform[2] = (0.5f - (Displacement.X / CellSize)) / (irr::f32)size.Width;
+	transform[3] = (0.5f - (Displacement.Z / CellSize)) / (irr::f32)size.Height;
+
+	CFlaceTerrainSplatShader::setSplatMapInfo(SplatMap, transform, SceneManager);
+
+	if (startCellX >= endCellX || startCellY >= endCellY)
+		return layersChanged || recreated;
+
+	// layer of each texture index, instead of comparing the textures for each cell
+
+	irr::s32 layerOfTexture[TERRAIN_MAX_TEXTURES];
+	for (int t=0; t<TERRAIN_MAX_TEXTURES; ++t)
+		layerOfTexture[t] = getSplatLayer(SplatLayers, t);
+
+	// set weights
+
+	irr::u32* pixels = (irr::u32*)SplatMap->lock();
+	if (!pixels)
+	{
+		clearSplatMap();
+		return true;
+	}
+
+	const irr::u32 pitch = SplatMap->getPitch() / 4;
+
+	for (int y=startCellY; y<endCellY; ++y)
+	{
+		const irr::u8* rows[2] = { TerrainTextureIndices.getRow(irr::core::max_(y - 1, 0)), TerrainTextureIndices.getRow(y) };
+
+		for (int x=startCellX; x<endCellX; ++x)
+		{
+			irr::u32 counts[4] = { 0, 0, 0, 0 };
+
+			for (int i=0; i<4; ++i)
+			{
+				const irr::s32 cellX = irr::core::clamp(x - 1 + (i & 1), 0, CellCountX-1);
+				const irr::s32 layer = layerOfTexture[rows[i >> 1][cellX]];
+				if (layer >= 0)
+					++counts[layer];
+			}
+
+			// red, green, blue and alpha are layer 0 to 3
+
+			pixels[(y * pitch) + x] = (((counts[3] * 255) / 4) << 24) | (((counts[0] * 255) / 4) << 16) |
+									  (((counts[1] * 255) / 4) << 8) | ((counts[2] * 255) / 4);
+		}
+	}
+
+	SplatMap->unlock();
+	SplatMap->regenerateMipMapLevels();
+
+	return layersChanged || recreated;
+}
+
+
+void CFlaceTerrainSceneNode::clearSplatMap()
+{
+	if (SplatMap)
+	{
+		CFlaceTerrainSplatShader::removeSplatMapInfo(SplatMap);
+
+		if (Driver)
+			Driver->removeTexture(SplatMap);
+
+		SplatMap = 0;
+	}
+
+	SplatLayers.clear();
+}
+
+
+// vertices of a cell which need blending if the neighbour at that index of the 3x3 neighbourhood 
+// (row by row, the cell itself in the center) uses a different texture:
+// 0 ------ 1
+// | \      |
+// |   \    |
+// |     \  |
+// 2 ------ 3
+static const irr::u32 BlendNeighbourMaskPerVertex[4] = 
+	{ (1<<0) | (1<<1) | (1<<3), 
+	  (1<<1) | (1<<2) | (1<<5),
+	  (1<<3) | (1<<6) | (1<<7),
+	  (1<<5) | (1<<7) | (1<<8) };
+
+// order in which neighbours with a higher texture index are chosen as texture to blend to: the right 
+// column first, then the center and the left one, each from top to bottom
+static const irr::s32 BlendTargetNeighbourOrder[8] = { 2, 5, 8, 1, 7, 0, 3, 6 };
+
+
+//! calculates the blending of one cell from the texture indices set by the user in its 3x3 neighbourhood.
+//! above, center and below point to the texture index of the cell and of the cells above and below it.
+//! If allWithBlend is true, the vertices next to a different texture are set to blend with the given 
+//! factor and the others are kept, like calculateBlendingAll() does. Otherwise, the cell blends to the 
+//! first higher texture around it, like calculateBlendingFactors() does.
+static inline void calculateTerrainCellBlending(const irr::s32* above, const irr::s32* center, const irr::s32* below,
+												CFlaceTerrainSceneNode::STerrainCellBlending& cell, bool allWithBlend, irr::u8 blend)
+{
+	const irr::s32 n[9] = { above[-1],  above[0],  above[1],
+							center[-1], center[0], center[1],
+							below[-1],  below[0],  below[1] };
+
+	const irr::s32 c = n[4];
+
+	irr::u32 differing = 0;
+	for (int k=0; k<9; ++k)
+		if (n[k] != c)
+			differing |= 1 << k;
+
+	if (allWithBlend)
+	{
+		for (int v=0; v<4; ++v)
+			if (differing & BlendNeighbourMaskPerVertex[v])
+				cell.BlendFactorPerVertex[v] = blend;
+
+		cell.BlendingToTextureIndex = (irr::u8)c;
+		return;
+	}
+
+	// only cells next to a higher texture index blend, so that exactly one of two neighbours does
+
+	irr::s32 other = c;
+	bool isBorderElement = false;
+
+	for (int i=0; i<8; ++i)
+		if (n[BlendTargetNeighbourOrder[i]] > c)
+		{
+			other = n[BlendTargetNeighbourOrder[i]];
+			isBorderElement = true;
+			break;
+		}
+
+	for (int v=0; v<4; ++v)
+		cell.BlendFactorPerVertex[v] = (isBorderElement && (differing & BlendNeighbourMaskPerVertex[v])) ? 255 : 0;
+
+	cell.BlendingToTextureIndex = (irr::u8)other;
+}
+
+
+//! calculates the blending of a row of cells, see calculateTerrainCellBlending(). With SSE2, 
+//! the neighbourhoods of 4 cells are compared at once.
+static void calculateTerrainRowBlending(const irr::s32* above, const irr::s32* center, const irr::s32* below, irr::s32 count,
+										CFlaceTerrainSceneNode::STerrainCellBlending* cells, bool allWithBlend, irr::u8 blend)
+{
+	irr::s32 x = 0;
+
+#ifdef _FLACE_TERRAIN_USE_SSE2_
+	for (; x+4 <= count; x+=4)
+	{
+		__m128i n[9];
+		n[0] = _mm_loadu_si128((const __m128i*)(above + x - 1));
+		n[1] = _mm_loadu_si128((const __m128i*)(above + x));
+		n[2] = _mm_loadu_si128((const __m128i*)(above + x + 1));
+		n[3] = _mm_loadu_si128((const __m128i*)(center + x - 1));
+		n[4] = _mm_loadu_si128((const __m128i*)(center + x));
+		n[5] = _mm_loadu_si128((const __m128i*)(center + x + 1));
+		n[6] = _mm_loadu_si128((const __m128i*)(below + x - 1));
+		n[7] = _mm_loadu_si128((const __m128i*)(below + x));
+		n[8] = _mm_loadu_si128((const __m128i*)(below + x + 1));
+
+		const __m128i c = n[4];
+
+		__m128i equal[9];
+		for (int k=0; k<9; ++k)
+			equal[k] = _mm_cmpeq_epi32(n[k], c);
+
+		// per vertex: all lanes set where no neighbour touching the vertex differs
+
+		irr::s32 vertexEqual[4][4];
+		_mm_storeu_si128((__m128i*)vertexEqual[0], _mm_and_si128(_mm_and_si128(equal[0], equal[1]), equal[3]));
+		_mm_storeu_si128((__m128i*)vertexEqual[1], _mm_and_si128(_mm_and_si128(equal[1], equal[2]), equal[5]));
+		_mm_storeu_si128((__m128i*)vertexEqual[2], _mm_and_si128(_mm_and_si128(equal[3], equal[6]), equal[7]));
+		_mm_storeu_si128((__m128i*)vertexEqual[3], _mm_and_si128(_mm_and_si128(equal[5], equal[7]), equal[8]));
+
+		irr::s32 centerValue[4];
+		_mm_storeu_si128((__m128i*)centerValue, c);
+
+		if (allWithBlend)
+		{
+			for (int lane=0; lane<4; ++lane)
+			{
+				CFlaceTerrainSceneNode::STerrainCellBlending& cell = cells[x + lane];
+
+				for (int v=0; v<4; ++v)
+					if (!vertexEqual[v][lane])
+						cell.BlendFactorPerVertex[v] = blend;
+
+				cell.BlendingToTextureIndex = (irr::u8)centerValue[lane];
+			}
+
+			continue;
+		}
+
+		// select the texture to blend to, going from the lowest to the highest priority
+		// so that the neighbour coming first in BlendTargetNeighbourOrder wins
+
+		__m128i other = c;
+		__m128i isBorderElement = _mm_setzero_si128();
+
+		for (int i=7; i>=0; --i)
+		{
+			const __m128i neighbour = n[BlendTargetNeighbourOrder[i]];
+			const __m128i greater = _mm_cmpgt_epi32(neighbour, c);
+
+			other = _mm_or_si128(_mm_and_si128(greater, neighbour), _mm_andnot_si128(greater, other));
+			isBorderElement = _mm_or_si128(isBorderElement, greater);
+		}
+
+		irr::s32 otherValue[4];
+		irr::s32 borderValue[4];
+		_mm_storeu_si128((__m128i*)otherValue, other);
+		_mm_storeu_si128((__m128i*)borderValue, isBorderElement);
+
+		for (int lane=0; lane<4; ++lane)
+		{
+			CFlaceTerrainSceneNode::STerrainCellBlending& cell = cells[x + lane];
+
+			for (int v=0; v<4; ++v)
+				cell.BlendFactorPerVertex[v] = (borderValue[lane] && !vertexEqual[v][lane]) ? 255 : 0;
+
+			cell.BlendingToTextureIndex = (irr::u8)otherValue[lane];
+		}
+	}
+#endif
+
+	for (; x<count; ++x)
+		calculateTerrainCellBlending(above + x, center + x, below + x, cells[x], allWithBlend, blend);
+}
+
+
+//! calculates the blending of bands of rows of terrain cells on the worker threads
+class CFlaceTerrainBlendingJob : public IFlaceParallelJob
+{
+public:
+
+	CFlaceTerrainBlendingJob(CFlaceTerrainSceneNode* terrain, const irr::core::array<irr::s32>& paddedUserIndices, 
+							 const irr::core::rect<irr::s32>& cells, irr::s32 rowsPerPart, bool allWithBlend, irr::u8 blend)
+		: Terrain(terrain), PaddedUserIndices(paddedUserIndices), Cells(cells), RowsPerPart(rowsPerPart), 
+		  AllWithBlend(allWithBlend), Blend(blend)
+	{
+	}
+
+	virtual void runJobPart(irr::s32 partIndex)
+	{
+		const irr::s32 width = Cells.getWidth();
+		const irr::s32 pitch = width + 2;
+		const irr::s32 firstRow = partIndex * RowsPerPart;
+		const irr::s32 endRow = irr::core::min_(firstRow + RowsPerPart, Cells.getHeight());
+
+		for (irr::s32 row=firstRow; row<endRow; ++row)
+		{
+			const irr::s32* center = PaddedUserIndices.const_pointer() + ((row + 1) * pitch) + 1;
+			CFlaceTerrainSceneNode::STerrainCellBlending* cells = 
+				Terrain->TerrainBlending.getWritableRow(Cells.UpperLeftCorner.Y + row) + Cells.UpperLeftCorner.X;
+
+			calculateTerrainRowBlending(center - pitch, center, center + pitch, width, cells, AllWithBlend, Blend);
+		}
+	}
+
+private:
+
+	CFlaceTerrainSceneNode* Terrain;
+	const irr::core::array<irr::s32>& PaddedUserIndices;
+	irr::core::rect<irr::s32> Cells;
+	irr::s32 RowsPerPart;
+	bool AllWithBlend;
+	irr::u8 Blend;
+};
+
+
+void CFlaceTerrainSceneNode::calculateBlendingFactors()
+{
+	calculateBlendingFactors(0, 0, CellCountX, CellCountY);	
+}
+
+void CFlaceTerrainSceneNode::calculateBlendingFactors(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	// for all terrain data points,
+	// calculate best target texture to blend to from the main texture, 
+	// and also at what vertex and with what blending factor
+
+	calculateBlending(startCellX, startCellY, endCellX, endCellY, false);
+}
+
+
+void CFlaceTerrainSceneNode::calculateBlendingAll(int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	calculateBlending(startCellX, startCellY, endCellX, endCellY, true);
+}
+
+
+void CFlaceTerrainSceneNode::calculateBlending(int startCellX, int startCellY, int endCellX, int endCellY, bool allWithBlend)
+{
+	cancelTerrainPaging();
+
+	if (startCellX < 0)
+		startCellX = 0;
+
+	if (startCellY < 0)
+		startCellY = 0;
+
+	if (endCellX > CellCountX)
+		endCellX = CellCountX;
+
+	if (endCellY > CellCountY)
+		endCellY = CellCountY;
+
+	if (startCellX >= endCellX || startCellY >= endCellY)
+		return;
+
+	const irr::s32 width = endCellX - startCellX;
+	const irr::s32 height = endCellY - startCellY;
+	const irr::s32 pitch = width + 2;
+
+	// copy the texture indices set by the user row by row, with a border of one cell around
+	// clamped to the terrain, so that every cell can read its neighbours without any checks
+
+	irr::core::array<irr::s32> paddedUserIndices;
+	paddedUserIndices.set_used(pitch * (height + 2));
+
+	for (irr::s32 y=0; y<height+2; ++y)
+	{
+		const irr::s32 cellY = irr::core::clamp(startCellY + y - 1, 0, CellCountY-1);
+		const irr::u8* row = TerrainTextureIndices.getRow(cellY);
+		irr::s32* padded = &paddedUserIndices[y * pitch];
+
+		padded[0] = row[irr::core::max_(startCellX - 1, 0)];
+
+		for (irr::s32 x=0; x<width; ++x)
+			padded[x + 1] = row[startCellX + x];
+
+		padded[width + 1] = row[irr::core::min_(endCellX, CellCountX-1)];
+	}
+
+	// every row only writes its own cells, so bands of rows can be done on all cores.
+	// Small areas, like when painting with a brush, aren't worth waking up the threads.
+	// Pages shared with clones are copied here before, the threads only get rows already writable.
+
+	for (irr::s32 y=startCellY; y<endCellY; ++y)
+		TerrainBlending.getWritableRow(y);
+
+	CFlaceWorkerPool* pool = CFlaceWorkerPool::getSharedPool();
+
+	irr::s32 partCount = 1;
+	if (width * height >= 64 * 64)
+		partCount = irr::core::min_(pool->getThreadCount() * 4, height);
+
+	const irr::s32 rowsPerPart = (height + partCount - 1) / partCount;
+	partCount = (height + rowsPerPart - 1) / rowsPerPart;
+
+	CFlaceTerrainBlendingJob job(this, paddedUserIndices, irr::core::rect<irr::s32>(startCellX, startCellY, endCellX, endCellY),
+								 rowsPerPart, allWithBlend, (irr::u8)texBlend);
+	pool->runParallel(&job, partCount);
+}
+
+
+
+
+//! Returns the material based on the zero based index i.
+irr::video::SMaterial& CFlaceTerrainSceneNode::getMaterial(u32 num)
+{
+	syncMaterials();
+
+	if (num >= 0 && num < DummyMaterials.size())
+		return DummyMaterials[num];
+
+	return *((video::SMaterial*)0);
+}
+
+//! Get amount of materials used by this scene node.
+irr::u32 CFlaceTerrainSceneNode::getMaterialCount() const
+{
+	return (irr::u32)Textures.size();
+}
+
+//! ensures data shown in dummy material array is the same as in the textures
+void CFlaceTerrainSceneNode::syncMaterials()
+{
+	while(Textures.size() > DummyMaterials.size())
+		DummyMaterials.push_back(irr::video::SMaterial());
+
+	while(Textures.size() < DummyMaterials.size())
+		DummyMaterials.erase(DummyMaterials.size() - 1);
+
+	for (int i=0; i<(int)Textures.size(); ++i)
+	{
+		irr::video::SMaterial& rMatDummy = DummyMaterials[i];
+		if (rMatDummy.getTexture(0) != Textures[i])
+			rMatDummy.setTexture(0, Textures[i]);
+	}
+}
+
+void CFlaceTerrainSceneNode::replaceTexture(int idx, irr::video::ITexture* newtexture, IUndoManager* undo)
+{
+	cancelTerrainPaging();
+
+	if (idx < 0 || idx >= (int)Textures.size())
+		return;	
+
+	// record material change
+
+	irr::video::ITexture* texBefore = Textures[idx];
+	
+	if (newtexture == texBefore)
+		return;		
+
+	if (undo)
+	{
+		undo->addUndoPartChangeTerrainTexture(this, texBefore, newtexture, idx);
+	}
+
+	if (Textures[idx])
+		Textures[idx]->drop();
+
+	Textures[idx] = newtexture;
+
+	if (Textures[idx])
+		Textures[idx]->grab();
+
+	// set textures
+
+	syncMaterials();
+
+	// also change for all terrain meshes
+
+	updateMeshesFromTerrainData();
+}
+
+
+CFlaceTerrainSceneNode::E_TERRAIN_LIGHTING_TYPE CFlaceTerrainSceneNode::getLightingType()
+{
+	return ETLT_DYNAMIC;
+}
+
+
+void CFlaceTerrainSceneNode::setLightingType(E_TERRAIN_LIGHTING_TYPE nType, IUndoManager* undo)
+{
+	if (nType != LightingType)
+	{
+		if (undo)
+			undo->addUndoPartChangeTerrainLighting(this, LightingType, nType);
+
+		LightingType = nType;
+
+		updateMeshesFromTerrainData();
+	}
+}
+
+void CFlaceTerrainSceneNode::distributeMeshes(irr::scene::IAnimatedMesh* tree, irr::f32 distribution, 
+											  IUndoManager* undo, const irr::c8* basename)
+{
+	if (!tree || distribution < 0.001f)
+		return;
+
+	irr::scene::IMesh* mesh = tree->getMesh(0);
+	if (!mesh)
+		return;
+
+	irr::core::aabbox3df box = mesh->getBoundingBox();
+
+	float treeWidth = box.getExtent().X;
+	float treeDepth = box.getExtent().Z;
+	float treeHeight = box.getExtent().Y;
+
+	if (treeWidth < 1) treeWidth = 1;
+	if (treeDepth < 1) treeDepth = 1;
+
+	if (SideLength <= CellSize)
+		return;
+
+	// trees are scattered as blue noise, evenly spread without clumps and holes. Every tree is a scene node,
+	// so there are at most 500 of them: the distance between them grows instead of leaving out trees.
+	// Large forests are placed with distributeForest(), which has no limit.
+
+	const irr::s32 maxTrees = 500;
+	const irr::f32 size = (irr::f32)(SideLength - CellSize);
+	const irr::f32 density = irr::core::min_(distribution / (treeWidth * treeDepth), maxTrees / (size * size));
+	const irr::u32 seed = (irr::u32)irr::os::Randomizer::rand();
+
+	irr::f32 minDistance = CFlaceTerrainScatter::getDistanceForDensity(density);
+	irr::core::array<CFlaceTerrainScatter::SPoint> points;
+
+	for (int attempt=0; attempt<4; ++attempt)
+	{
+		points.clear();
+		CFlaceTerrainScatter::scatter(size, size, minDistance, seed, points);
+
+		if ((irr::s32)points.size() <= maxTrees)
+			break;
+
+		minDistance *= sqrtf(points.size() / (irr::f32)maxTrees) * 1.02f;
+	}
+
+	for (int nTree=0; nTree<(int)points.size() && nTree<maxTrees; ++nTree)
+	{
+		irr::core::vector3df pos;
+		irr::core::vector3df rot;
+
+		rot.Y = (points[nTree].Random % 36000) / 100.0f;
+
+		pos.X = points[nTree].X;
+		pos.Z = points[nTree].Z;
+
+		pos.Y = getExactTerrainHeightClampedAtPosition(pos.X, pos.Z);
+
+		pos += Displacement;
+		pos.Y -= treeHeight * 0.025f; // so that the tree doesn't float in hills
+
+		CFlaceMeshSceneNode* tileNode = getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(pos.X, pos.Z);
+		if (!tileNode)
+		{
+			// something went wrong
+			continue;
+		}
+
+		CFlaceAnimatedMeshSceneNode* node = new CFlaceAnimatedMeshSceneNode(undo, tree, tileNode, 
+				getSceneManager(), -1, pos, rot);		
+
+		setUniqueIdForSceneNode(node, getSceneManager());
+		setUniqueNameForSceneNode(node, basename, getSceneManager());
+
+		if (getLightingType() == ETLT_DYNAMIC)
+		{
+			for (int i=0; i<(int)node->getMaterialCount(); ++i)
+				node->getMaterial(i).Lighting = true;
+		}
+
+		node->drop();
+	}
+}
+
+
+bool CFlaceTerrainSceneNode::getSelectedTerrainTileFromScreenCoords(int x, int y, irr::core::vector2di& rOut)
+{
+	irr::core::line3df line = 
+		SceneManager->getSceneCollisionManager()->getRayFromScreenCoordinates(irr::core::position2di(x,y), SceneManager->getActiveCamera());
+
+	if (line.start.equals(irr::core::vector3df(0,0,0)))
+		return false;
+
+	// terrain always is at position (0,0,0) with no transformation applied, so the ray can be used directly
+
+	irr::core::vector3df closestCollisionPoint;
+	if (!getTerrainCollisionPointWithLine(line, closestCollisionPoint))
+		return false;
+
+	// now get all tiles starting with this collision point
+
+	int tileX = (int)((closestCollisionPoint.X - Displacement.X) / CellSize);
+	int tileY = (int)((closestCollisionPoint.Z - Displacement.Z) / CellSize);
+
+	rOut.set(tileX, tileY);
+	return true;
+}
+
+
+//! clips the part of a ray moving along one axis to the range [minValue, maxValue]. 
+//! Returns false if nothing of the ray is left.
+static bool clipRayToRange(irr::f32 start, irr::f32 dir, irr::f32 minValue, irr::f32 maxValue, irr::f32& tEnter, irr::f32& tExit)
+{
+	if (irr::core::iszero(dir))
+		return start >= minValue && start <= maxValue && tEnter <= tExit;
+
+	irr::f32 t1 = (minValue - start) / dir;
+	irr::f32 t2 = (maxValue - start) / dir;
+	if (t1 > t2)
+		irr::core::swap(t1, t2);
+
+	tEnter = irr::core::max_(tEnter, t1);
+	tExit = irr::core::min_(tExit, t2);
+
+	return tEnter <= tExit;
+}
+
+
+//! returns the range of heights of a terrain tile, kept up to date with the min/max height pyramid
+bool CFlaceTerrainSceneNode::getTerrainTileHeightRange(irr::s32 tileX, irr::s32 tileY, irr::f32& outMin, irr::f32& outMax)
+{
+	if (tileX < 0 || tileY < 0 || tileX >= TileCountX || tileY >= TileCountY)
+		return false;
+
+	irr::s32 idx = getTerrainMeshIndex(tileX, tileY);
+	if (idx >= (irr::s32)TileHeightRanges.size())
+		return false;
+
+	outMin = TileHeightRanges[idx].Min;
+	outMax = TileHeightRanges[idx].Max;
+	return true;
+}
+
+
+//! Casts a ray against the height field by walking through the cells crossed by the ray from above (2D DDA), 
+//! and testing the two triangles of each cell. Tiles and cells the ray passes above or below are skipped 
+//! without testing their triangles. Doesn't need triangle selectors.
+bool CFlaceTerrainSceneNode::getTerrainCollisionPointWithLine(const irr::core::line3df& line, irr::core::vector3df& outPoint, 
+															   irr::core::vector2di* outCell)
+{
+	if (CellCountX < 2 || CellCountY < 2 || CellSize <= 0 || CellsPerTileSide <= 0 ||
+		(irr::s32)TerrainHeights.size() != CellCountX * CellCountY)
+		return false;
+
+	// ray in grid coordinates, one unit per cell. t goes from 0 at line.start to 1 at line.end
+
+	const irr::f32 sx = (line.start.X - Displacement.X) / CellSize;
+	const irr::f32 sz = (line.start.Z - Displacement.Z) / CellSize;
+	const irr::f32 dx = (line.end.X - line.start.X) / CellSize;
+	const irr::f32 dz = (line.end.Z - line.start.Z) / CellSize;
+	const irr::f32 sy = line.start.Y;
+	const irr::f32 dy = line.end.Y - line.start.Y;
+
+	// the last grid point has no cell anymore, the terrain surface ends there
+
+	irr::f32 tStart = 0.0f;
+	irr::f32 tEnd = 1.0f;
+	if (!clipRayToRange(sx, dx, 0.0f, (irr::f32)(CellCountX-1), tStart, tEnd) ||
+		!clipRayToRange(sz, dz, 0.0f, (irr::f32)(CellCountY-1), tStart, tEnd))
+		return false;
+
+	const irr::s32 stepX = dx > 0.0f ? 1 : -1;
+	const irr::s32 stepY = dz > 0.0f ? 1 : -1;
+	const irr::f32 tDeltaX = irr::core::iszero(dx) ? FLT_MAX : irr::core::abs_(1.0f / dx);
+	const irr::f32 tDeltaY = irr::core::iszero(dz) ? FLT_MAX : irr::core::abs_(1.0f / dz);
+
+	// small step in t, for moving from the border of a skipped tile into the next one
+	const irr::f32 tNudge = 0.001f / irr::core::max_(irr::core::max_(irr::core::abs_(dx), irr::core::abs_(dz)), 1.0f);
+
+	irr::f32 t = tStart;
+	irr::s32 cx = 0;
+	irr::s32 cy = 0;
+	irr::f32 tMaxX = FLT_MAX;
+	irr::f32 tMaxY = FLT_MAX;
+	irr::s32 checkedTile = -1;
+	bool enterCell = true;
+
+	while (t <= tEnd)
+	{
+		if (enterCell)
+		{
+			// find the cell at t, and when the ray leaves it
+
+			enterCell = false;
+			cx = irr::core::clamp(irr::core::floor32(sx + dx * t), 0, CellCountX-2);
+			cy = irr::core::clamp(irr::core::floor32(sz + dz * t), 0, CellCountY-2);
+
+			tMaxX = irr::core::iszero(dx) ? FLT_MAX : ((cx + (dx > 0.0f ? 1 : 0)) - sx) / dx;
+			tMaxY = irr::core::iszero(dz) ? FLT_MAX : ((cy + (dz > 0.0f ? 1 : 0)) - sz) / dz;
+		}
+
+		// skip whole tiles the ray doesn't touch
+
+		const irr::s32 tileX = cx / CellsPerTileSide;
+		const irr::s32 tileY = cy / CellsPerTileSide;
+		const irr::s32 tileIndex = getTerrainMeshIndex(tileX, tileY);
+
+		if (tileIndex != checkedTile)
+		{
+			checkedTile = tileIndex;
+
+			irr::f32 tileMin, tileMax;
+			irr::f32 tTileEnter = t;
+			irr::f32 tTileExit = tEnd;
+
+			if (getTerrainTileHeightRange(tileX, tileY, tileMin, tileMax) &&
+				clipRayToRange(sx, dx, (irr::f32)(tileX * CellsPerTileSide), (irr::f32)((tileX+1) * CellsPerTileSide), tTileEnter, tTileExit) &&
+				clipRayToRange(sz, dz, (irr::f32)(tileY * CellsPerTileSide), (irr::f32)((tileY+1) * CellsPerTileSide), tTileEnter, tTileExit))
+			{
+				// tile height ranges are stored without the displacement of the terrain, the ray is in world space
+
+				const irr::f32 y1 = sy + dy * tTileEnter - Displacement.Y;
+				const irr::f32 y2 = sy + dy * tTileExit - Displacement.Y;
+
+				if (irr::core::min_(y1, y2) > tileMax || irr::core::max_(y1, y2) < tileMin)
+				{
+					t = tTileExit + tNudge;
+					enterCell = true;
+					continue;
+				}
+			}
+		}
+
+		// test the cell if the ray passes through its height range
+
+		const irr::f32 tCellExit = irr::core::min_(irr::core::min_(tMaxX, tMaxY), tEnd);
+		const irr::f32 y1 = sy + dy * t;
+		const irr::f32 y2 = sy + dy * tCellExit;
+
+		const irr::core::vector3df v0 = getTerrain3DPositionClamped(cx, cy);
+		const irr::core::vector3df v1 = getTerrain3DPositionClamped(cx+1, cy);
+		const irr::core::vector3df v2 = getTerrain3DPositionClamped(cx, cy+1);
+		const irr::core::vector3df v3 = getTerrain3DPositionClamped(cx+1, cy+1);
+
+		const irr::f32 cellMin = irr::core::min_(irr::core::min_(v0.Y, v1.Y), irr::core::min_(v2.Y, v3.Y));
+		const irr::f32 cellMax = irr::core::max_(irr::core::max_(v0.Y, v1.Y), irr::core::max_(v2.Y, v3.Y));
+
+		if (irr::core::min_(y1, y2) <= cellMax && irr::core::max_(y1, y2) >= cellMin)
+		{
+			// same triangles as the tile meshes use
+
+			const irr::core::triangle3df tris[2] = { irr::core::triangle3df(v0, v3, v1), irr::core::triangle3df(v0, v2, v3) };
+
+			bool found = false;
+			irr::f32 nearest = FLT_MAX;
+
+			for (int i=0; i<2; ++i)
+			{
+				irr::core::vector3df p;
+				if (tris[i].getIntersectionWithLimitedLine(line, p))
+				{
+					const irr::f32 dist = p.getDistanceFromSQ(line.start);
+					if (dist < nearest)
+					{
+						nearest = dist;
+						outPoint = p;
+						found = true;
+					}
+				}
+			}
+
+			if (found)
+			{
+				if (outCell)
+					outCell->set(cx, cy);
+				return true;
+			}
+		}
+
+		// step to the next cell
+
+		if (tMaxX < tMaxY)
+		{
+			cx += stepX;
+			t = tMaxX;
+			tMaxX += tDeltaX;
+		}
+		else
+		{
+			cy += stepY;
+			t = tMaxY;
+			tMaxY += tDeltaY;
+		}
+
+		if (cx < 0 || cx > CellCountX-2 || cy < 0 || cy > CellCountY-2)
+			break;
+	}
+
+	return false;
+}
+
+
+void CFlaceTerrainSceneNode::drawEditBrushSelection(irr::core::vector2di tile,
+													irr::video::SColor clr, irr::f32 brushSize)
+{
+	video::SMaterial m;
+	m.Lighting = false;
+	m.ZBuffer = false;
+	Driver->setMaterial(m);
+
+	irr::core::matrix4 mat;
+	Driver->setTransform(video::ETS_WORLD, mat);
+
+
+	for (int x=0; x<(int)brushSize; ++x)
+	{
+		for (int y=0; y<(int)brushSize; ++y)
+		{
+			int cTileX = tile.X + x - (int)(brushSize/2);
+			int cTileY = tile.Y + y - (int)(brushSize/2);
+
+			irr::core::vector2di displacements[4] = { 
+				irr::core::vector2di(0,0), irr::core::vector2di(1,0), irr::core::vector2di(0,1), irr::core::vector2di(1,1) };
+			irr::core::vector3df vects[4];
+
+			for (int i=0; i<4; ++i)
+			{
+				const irr::f32 height = getTerrainDataHeightClamped(cTileX + displacements[i].X, cTileY + displacements[i].Y);
+
+				vects[i].X = ((cTileX + displacements[i].X) * CellSize) + Displacement.X;
+				vects[i].Y = height + Displacement.Y;
+				vects[i].Z = ((cTileY + displacements[i].Y) * CellSize) + Displacement.Z;
+			}	
+
+			Driver->draw3DLine(vects[0], vects[1], clr);
+			Driver->draw3DLine(vects[1], vects[3], clr);
+
+			if (y == (int)brushSize-1)
+				Driver->draw3DLine(vects[2], vects[3], clr);
+
+			if (x == 0)
+				Driver->draw3DLine(vects[0], vects[2], clr);
+		}
+	}	
+}
+
+
+void CFlaceTerrainSceneNode::getMinMaxHeightOfTerrainDataInBrush(irr::core::vector2di tile, irr::s32 brushSize, 
+											  irr::f32& rOutMinValue, irr::f32& rOutMaxValue)
+{
+	bool bFirstValue = true;
+
+	for (int x=0; x<(int)brushSize; ++x)
+	{
+		for (int y=0; y<(int)brushSize; ++y)
+		{
+			int cTileX = tile.X + x - (int)(brushSize/2);
+			int cTileY = tile.Y + y - (int)(brushSize/2);
+
+			if (isValidTerrainCell(cTileX, cTileY))
+			{
+				const irr::f32 height = TerrainHeights.get(cTileX, cTileY);
+
+				if (bFirstValue)
+				{
+					rOutMinValue = height;
+					rOutMaxValue = height;
+					bFirstValue = false;
+				}
+				else
+				{
+					rOutMinValue = irr::core::min_(rOutMinValue, height);
+					rOutMaxValue = irr::core::max_(rOutMaxValue, height);
+				}
+			}
+		}
+	}
+}
+
+void CFlaceTerrainSceneNode::drawEditBrushSelectionMountainValleyTool(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize, irr::f32 additionalHeight)
+{
+	drawEditBrushSelectionRaiseTool(tile, clr, brushSize, additionalHeight, CellSize * brushSize * 0.03f * additionalHeight);
+}
+
+void CFlaceTerrainSceneNode::drawEditBrushSelectionRaiseTool(irr::core::vector2di tile,
+													irr::video::SColor clr, irr::f32 brushSize, 
+													irr::f32 additionalHeight,
+													irr::f32 sphereFactor)
+{
+	// go transforming
+
+	video::SMaterial m;
+	m.Lighting = false;
+	m.ZBuffer = false;
+	Driver->setMaterial(m);
+
+	irr::core::matrix4 mat;
+	Driver->setTransform(video::ETS_WORLD, mat);
+
+	irr::f32 minValue = 0.0f;
+	irr::f32 maxValue = 0.0f;
+	getMinMaxHeightOfTerrainDataInBrush(tile, (irr::s32)brushSize, minValue, maxValue);
+	bool enableSmoothRaising = !irr::core::equals(minValue, maxValue);
+
+	for (int x=0; x<(int)brushSize; ++x)
+	{
+		for (int y=0; y<(int)brushSize; ++y)
+		{
+			int cTileX = tile.X + x - (int)(brushSize/2);
+			int cTileY = tile.Y + y - (int)(brushSize/2);
+
+			irr::core::vector2di displacements[4] = { 
+				irr::core::vector2di(0,0), irr::core::vector2di(1,0), irr::core::vector2di(0,1), irr::core::vector2di(1,1) };
+			irr::core::vector3df vects[4];
+
+			for (int i=0; i<4; ++i)
+			{
+				const irr::f32 height = getTerrainDataHeightClamped(cTileX + displacements[i].X, cTileY + displacements[i].Y);
+
+				vects[i].X = ((cTileX + displacements[i].X) * CellSize) + Displacement.X;
+				vects[i].Z = ((cTileY + displacements[i].Y) * CellSize) + Displacement.Z;
+
+				irr::f32 h = height;
+
+				if (!irr::core::iszero(sphereFactor))
+				{
+					float mountain = (sin((x+displacements[i].X) / (float)(brushSize * 1.00f) * irr::core::PI) 
+						* sin((y+displacements[i].Y) / (float)(brushSize * 1.00f) * irr::core::PI))
+						* sphereFactor * 0.01f;
+
+					if (additionalHeight > 0.0f)
+						h += additionalHeight * mountain;
+					else
+						h -= additionalHeight * mountain;
+				}
+				else
+				if (enableSmoothRaising)
+				{
+					// scale height addition by distance from max value
+					irr::f32 fact = (maxValue - height) / (maxValue - minValue);
+					if (fact > 1.0f) fact = 1.0f;
+
+					if (additionalHeight < 0.0f)
+						fact = 1.0f - fact;
+
+					h += additionalHeight * fact;
+				}
+				else
+					h += additionalHeight;	
+				
+
+				vects[i].Y = h + Displacement.Y;
+			}	
+
+			Driver->draw3DLine(vects[0], vects[1], clr);
+			Driver->draw3DLine(vects[1], vects[3], clr);
+
+			if (y == (int)brushSize-1)
+				Driver->draw3DLine(vects[2], vects[3], clr);
+
+			if (x == 0)
+				Driver->draw3DLine(vects[0], vects[2], clr);
+		}
+	}
+}
+
+
+irr::s32 CFlaceTerrainSceneNode::findTextureIndexOrAddNewOne(irr::video::ITexture* tex)
+{
+	cancelTerrainPaging();
+
+	if (!tex)
+		return -1;
+
+	irr::s32 nTexIndex = -1;
+	for (int t=0; t<(int)Textures.size(); ++t)
+		if (Textures[t] == tex)
+		{
+			nTexIndex = t;
+			break;
+		}
+
+	if (nTexIndex == -1 && (irr::s32)Textures.size() < TERRAIN_MAX_TEXTURES)
+	{
+		nTexIndex = (irr::s32)Textures.size();
+
+		Textures.push_back(tex);
+		tex->grab();				
+	}
+
+	return nTexIndex;
+}
+
+
+void CFlaceTerrainSceneNode::paintTexture(int screenCoord2DX, int screenCoord2DY, irr::f32 brushSize, irr::video::ITexture* texture, IUndoManager* undo)
+{
+	cancelTerrainPaging();
+
+	irr::core::vector2di tile;
+
+	if (!texture || brushSize < 1 || !getSelectedTerrainTileFromScreenCoords(screenCoord2DX, screenCoord2DY, tile))
+		return;
+
+	bool changeDone = false;
+
+	irr::s32 texIndex = findTextureIndexOrAddNewOne(texture);
+	if (texIndex == -1)
+		return;
+
+	int brushStart = (int)(brushSize/2);
+	beginTerrainEditStamp(undo, tile.X - brushStart, tile.Y - brushStart, 
+		tile.X - brushStart + (int)brushSize, tile.Y - brushStart + (int)brushSize);
+
+	// paint
+
+	for (int x=0; x<(int)brushSize; ++x)
+	{
+		for (int y=0; y<(int)brushSize; ++y)
+		{
+			int cTileX = tile.X + x - (int)(brushSize/2);
+			int cTileY = tile.Y + y - (int)(brushSize/2);
+
+			if (!isValidTerrainCell(cTileX, cTileY))
+				continue;
+
+			// only changed cells are written, so pages shared with other terrains stay shared
+
+			if (TerrainTextureIndices.get(cTileX, cTileY) != texIndex)
+			{
+				TerrainTextureIndices.getWritable(cTileX, cTileY) = (irr::u8)texIndex;
+				changeDone = true;
+			}
+		}
+	}
+
+	// rebuild terrain
+
+	if (changeDone)
+	{
+		const int border = 2;
+		int brushSizeHalf = (int)(brushSize/2.0f);
+		calculateBlendingFactors(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
+								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
+		updateMeshesFromTerrainData(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
+								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
+	}
+}
+
+
+// Undo snapshots of the cells are arrays of floats, with a height and a texture index per cell. Snapshots of
+// the whole terrain contain nothing else. Snapshots of a rectangle start with a header: a NaN, which a height
+// never is, and then start x, start y, width and height of the rectangle as integer bits.
+
+static const irr::u32 TERRAIN_SNAPSHOT_RECT_MARK = 0x7fc0de17;
+static const irr::s32 TERRAIN_SNAPSHOT_RECT_HEADER_SIZE = 5;
+
+// time without brush stamps after which the next stamp starts a new stroke
+static const irr::u32 TERRAIN_EDIT_STROKE_PAUSE_MS = 500;
+
+
+void CFlaceTerrainSceneNode::resetTerrainDataFromSnapshot(irr::f32* pTerrainData)
+{
+	cancelTerrainPaging();
+
+	// a stroke being recorded can't be continued on restored data
+	finishTerrainEditStroke();
+
+	if (!TerrainHeights.size() || !pTerrainData)
+		return;
+
+	if (getFloatBits(pTerrainData[0]) == TERRAIN_SNAPSHOT_RECT_MARK)
+	{
+		const irr::s32 startX = (irr::s32)getFloatBits(pTerrainData[1]);
+		const irr::s32 startY = (irr::s32)getFloatBits(pTerrainData[2]);
+		const irr::s32 width = (irr::s32)getFloatBits(pTerrainData[3]);
+		const irr::s32 height = (irr::s32)getFloatBits(pTerrainData[4]);
+
+		if (startX < 0 || startY < 0 || width < 0 || height < 0 || 
+			startX + width > CellCountX || startY + height > CellCountY)
+			return; // terrain was recreated with another size since
+
+		const irr::f32* cell = pTerrainData + TERRAIN_SNAPSHOT_RECT_HEADER_SIZE;
+
+		for (int y=startY; y<startY+height; ++y)
+			for (int x=startX; x<startX+width; ++x, cell+=2)
+				restoreTerrainCell(x, y, cell);
+
+		// only the rectangle and the cells blending with it need an update
+
+		const int border = 2;
+		onTerrainHeightsChanged(startX, startY, startX + width, startY + height);
+		calculateBlendingFactors(startX - border, startY - border, startX + width + border, startY + height + border);
+		updateMeshesFromTerrainData(startX - border, startY - border, startX + width + border, startY + height + border);
+		return;
+	}
+
+	const irr::f32* cell = pTerrainData;
+
+	for (int y=0; y<CellCountY; ++y)
+		for (int x=0; x<CellCountX; ++x, cell+=2)
+			restoreTerrainCell(x, y, cell);
+
+	onTerrainHeightsChanged();
+	calculateBlendingFactors();
+	updateMeshesFromTerrainData();
+}
+
+
+//! sets a cell to the height and texture index stored in a snapshot. Unchanged cells aren't written, so 
+//! undoing doesn't copy pages shared with other terrains.
+void CFlaceTerrainSceneNode::restoreTerrainCell(irr::s32 cellX, irr::s32 cellY, const irr::f32* snapshotCell)
+{
+	const irr::u8 textureIndex = (irr::u8)snapshotCell[1];
+
+	if (TerrainHeights.get(cellX, cellY) != snapshotCell[0])
+		TerrainHeights.getWritable(cellX, cellY) = snapshotCell[0];
+
+	if (TerrainTextureIndices.get(cellX, cellY) != textureIndex)
+		TerrainTextureIndices.getWritable(cellX, cellY) = textureIndex;
+}
+
+
+irr::f32* CFlaceTerrainSceneNode::createTerrainDataSnapshot()
+{
+	if (!TerrainHeights.size())
+		return 0;
+
+	irr::f32* data = new irr::f32[TerrainHeights.size() * 2];
+	irr::f32* cell = data;
+
+	for (int y=0; y<TerrainHeights.getHeight(); ++y)
+		for (int x=0; x<TerrainHeights.getWidth(); ++x, cell+=2)
+		{
+			cell[0] = TerrainHeights.get(x, y);
+			cell[1] = (irr::f32)TerrainTextureIndices.get(x, y);
+			MaxHeight = (int)irr::core::max_((irr::f32)MaxHeight, cell[0]); // Robbo
+		}
+
+	return data;
+}
+
+
+//! creates a snapshot of only a rectangle of cells, which needs to be inside the terrain
+irr::f32* CFlaceTerrainSceneNode::createTerrainDataSnapshot(const irr::core::rect<irr::s32>& cells)
+{
+	const irr::s32 width = cells.getWidth();
+	const irr::s32 height = cells.getHeight();
+
+	irr::f32* data = new irr::f32[TERRAIN_SNAPSHOT_RECT_HEADER_SIZE + width * height * 2];
+
+	data[0] = getFloatFromBits(TERRAIN_SNAPSHOT_RECT_MARK);
+	data[1] = getFloatFromBits((irr::u32)cells.UpperLeftCorner.X);
+	data[2] = getFloatFromBits((irr::u32)cells.UpperLeftCorner.Y);
+	data[3] = getFloatFromBits((irr::u32)width);
+	data[4] = getFloatFromBits((irr::u32)height);
+
+	irr::f32* cell = data + TERRAIN_SNAPSHOT_RECT_HEADER_SIZE;
+
+	for (int y=cells.UpperLeftCorner.Y; y<cells.LowerRightCorner.Y; ++y)
+		for (int x=cells.UpperLeftCorner.X; x<cells.LowerRightCorner.X; ++x, cell+=2)
+		{
+			cell[0] = TerrainHeights.get(x, y);
+			cell[1] = (irr::f32)TerrainTextureIndices.get(x, y);
+			MaxHeight = (int)irr::core::max_((irr::f32)MaxHeight, cell[0]); // Robbo
+		}
+
+	return data;
+}
+
+
+//! called by the brushes before changing a rectangle of cells (end exclusive). Remembers the cells as they were 
+//! before the stroke, growing the rectangle of the stroke. Cells outside of the rectangle so far weren't changed 
+//! by the stroke, so their current values are the ones from before.
+void CFlaceTerrainSceneNode::beginTerrainEditStamp(IUndoManager* undo, int startCellX, int startCellY, int endCellX, int endCellY)
+{
+	if (!undo)
+		return;
+
+	// a pause between two stamps ends the stroke, the mouse button was released in between
+	const irr::u32 now = irr::os::Timer::getRealTime();
+
+	if (EditStrokeUndo && (EditStrokeUndo != undo || now - EditStrokeLastStampTime > TERRAIN_EDIT_STROKE_PAUSE_MS))
+		finishTerrainEditStroke();
+
+	irr::core::rect<irr::s32> cells(irr::core::max_(startCellX, 0), irr::core::max_(startCellY, 0),
+									irr::core::min_(endCellX, CellCountX), irr::core::min_(endCellY, CellCountY));
+
+	if (cells.UpperLeftCorner.X >= cells.LowerRightCorner.X || cells.UpperLeftCorner.Y >= cells.LowerRightCorner.Y)
+		return;
+
+	EditStrokeLastStampTime = now;
+
+	irr::core::rect<irr::s32> grown(cells);
+	if (EditStrokeUndo)
+	{
+		grown.addInternalPoint(EditStrokeCells.UpperLeftCorner);
+		grown.addInternalPoint(EditStrokeCells.LowerRightCorner);
+
+		if (grown == EditStrokeCells)
+		{
+			markTerrainEditStrokeCells(cells);
+			return;
+		}
+
+		// a long diagonal stroke would grow the rectangle to much more than the touched cells, 
+		// record the part so far and start a new one
+
+		irr::s32 touched = EditStrokeTouchedCount;
+		for (int y=cells.UpperLeftCorner.Y; y<cells.LowerRightCorner.Y; ++y)
+			for (int x=cells.UpperLeftCorner.X; x<cells.LowerRightCorner.X; ++x)
+				if (x < EditStrokeCells.UpperLeftCorner.X || x >= EditStrokeCells.LowerRightCorner.X ||
+					y < EditStrokeCells.UpperLeftCorner.Y || y >= EditStrokeCells.LowerRightCorner.Y ||
+					!EditStrokeTouched[getTerrainEditStrokeCellIndex(x, y)])
+					++touched;
+
+		if (grown.getWidth() * grown.getHeight() > touched * 4)
+		{
+			finishTerrainEditStroke();
+			grown = cells;
+		}
+	}
+
+	irr::core::array<irr::f32> before;
+	irr::core::array<irr::u8> touchedCells;
+	before.set_used(grown.getWidth() * grown.getHeight() * 2);
+	touchedCells.set_used(grown.getWidth() * grown.getHeight());
+
+	irr::s32 i = 0;
+	for (int y=grown.UpperLeftCorner.Y; y<grown.LowerRightCorner.Y; ++y)
+		for (int x=grown.UpperLeftCorner.X; x<grown.LowerRightCorner.X; ++x, i+=2)
+		{
+			if (EditStrokeUndo && x >= EditStrokeCells.UpperLeftCorner.X && x < EditStrokeCells.LowerRightCorner.X &&
+				y >= EditStrokeCells.UpperLeftCorner.Y && y < EditStrokeCells.LowerRightCorner.Y)
+			{
+				const irr::s32 old = getTerrainEditStrokeCellIndex(x, y);
+
+				before[i] = EditStrokeBefore[old*2];
+				before[i+1] = EditStrokeBefore[old*2 + 1];
+				touchedCells[i/2] = EditStrokeTouched[old];
+			}
+			else
+			{
+				before[i] = TerrainHeights.get(x, y);
+				before[i+1] = (irr::f32)TerrainTextureIndices.get(x, y);
+				touchedCells[i/2] = 0;
+			}
+		}
+
+	if (!EditStrokeUndo)
+		EditStrokeTouchedCount = 0;
+
+	EditStrokeUndo = undo;
+	EditStrokeCells = grown;
+	EditStrokeBefore = before;
+	EditStrokeTouched = touchedCells;
+
+	markTerrainEditStrokeCells(cells);
+}
+
+
+//! marks the cells of a stamp as touched by the current stroke, they need to be inside of EditStrokeCells
+void CFlaceTerrainSceneNode::markTerrainEditStrokeCells(const irr::core::rect<irr::s32>& cells)
+{
+	for (int y=cells.UpperLeftCorner.Y; y<cells.LowerRightCorner.Y; ++y)
+	{
+		irr::u8* touched = EditStrokeTouched.pointer() + getTerrainEditStrokeCellIndex(cells.UpperLeftCorner.X, y);
+
+		for (int x=0; x<cells.getWidth(); ++x)
+		{
+			if (!touched[x])
+			{
+				touched[x] = 1;
+				++EditStrokeTouchedCount;
+			}
+		}
+	}
+}
+
+
+//! records the current brush stroke as one undo part, with the changed rectangle before and after
+void CFlaceTerrainSceneNode::finishTerrainEditStroke()
+{
+	if (!EditStrokeUndo)
+		return;
+
+	IUndoManager* undo = EditStrokeUndo;
+	EditStrokeUndo = 0;
+	EditStrokeTouched.clear();
+	EditStrokeTouchedCount = 0;
+
+	const irr::core::rect<irr::s32>& cells = EditStrokeCells;
+	const irr::s32 valueCount = cells.getWidth() * cells.getHeight() * 2;
+
+	if ((irr::s32)EditStrokeBefore.size() != valueCount || cells.LowerRightCorner.X > CellCountX || 
+		cells.LowerRightCorner.Y > CellCountY)
+	{
+		EditStrokeBefore.clear();
+		return;
+	}
+
+	irr::f32* pSnapshotNew = createTerrainDataSnapshot(cells);
+
+	if (!memcmp(pSnapshotNew + TERRAIN_SNAPSHOT_RECT_HEADER_SIZE, EditStrokeBefore.const_pointer(), valueCount * sizeof(irr::f32)))
+	{
+		// the stroke didn't change anything
+		delete [] pSnapshotNew;
+		EditStrokeBefore.clear();
+		return;
+	}
+
+	irr::f32* pSnapshotOld = new irr::f32[TERRAIN_SNAPSHOT_RECT_HEADER_SIZE + valueCount];
+	memcpy(pSnapshotOld, pSnapshotNew, TERRAIN_SNAPSHOT_RECT_HEADER_SIZE * sizeof(irr::f32));
+	memcpy(pSnapshotOld + TERRAIN_SNAPSHOT_RECT_HEADER_SIZE, EditStrokeBefore.const_pointer(), valueCount * sizeof(irr::f32));
+
+	EditStrokeBefore.clear();
+
+	undo->addUndoPartChangeTerrainData(this, pSnapshotOld, pSnapshotNew);
+}
+
+
+void CFlaceTerrainSceneNode::resetTerrainGrassDataFromSnapshot(irr::f32* pTerrainData)
+{
+	clearGrassInstances();
+
+	int sz = *(irr::s32*)((void*)&pTerrainData[0]);
+	const int headerSize = 1;
+
+	for (int i=0; i<sz; ++i)
+	{
+		SGrassInstance instance;
+		instance.Height =				pTerrainData[i*6 +0 + headerSize];
+		instance.Width =				pTerrainData[i*6 +1 + headerSize];
+		instance.PosX =					pTerrainData[i*6 +2 + headerSize];
+		instance.PosZ =					pTerrainData[i*6 +3 + headerSize];
+		instance.Rotation =				pTerrainData[i*6 +4 + headerSize];
+		instance.TextureIndex = (int)	pTerrainData[i*6 +5 + headerSize];
+
+		addGrassInstance(instance);
+	}
+}
+
+
+irr::f32* CFlaceTerrainSceneNode::createTerrainGrassDataSnapshot()
+{
+	if (!TerrainHeights.size())
+		return 0;
+
+	int sz = getGrassInstanceCount();
+	irr::f32* data = new irr::f32[(sz * 6) + 1];
+
+	const int headerSize = 1;
+	data[0] = *(irr::f32*)((void*)&sz);
+
+	// same flat format as before the grass was stored per tile
+
+	int i = 0;
+	for (int b=0; b<(int)GrassBuckets.size(); ++b)
+	{
+		for (int j=0; j<(int)GrassBuckets[b].size(); ++j, ++i)
+		{
+			const SGrassInstance& g = GrassBuckets[b][j];
+
+			data[i*6 +0 + headerSize] = g.Height;
+			data[i*6 +1 + headerSize] = g.Width;
+			data[i*6 +2 + headerSize] = g.PosX;
+			data[i*6 +3 + headerSize] = g.PosZ;
+			data[i*6 +4 + headerSize] = g.Rotation;
+			data[i*6 +5 + headerSize] = (irr::f32)g.TextureIndex;
+		}
+	}
+
+	return data;
+}
+
+
+void CFlaceTerrainSceneNode::mountainValleyTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 additionalHeight, IUndoManager* undo)
+{
+	raiseLowerTerrain(tile, brushSize, additionalHeight, undo, CellSize * brushSize * 0.03f * additionalHeight);
+}
+
+void CFlaceTerrainSceneNode::raiseLowerTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 additionalHeight, IUndoManager* undo, irr::f32 sphereFactor)
+{
+	cancelTerrainPaging();
+
+	if (irr::core::equals(additionalHeight, 0.0f) || brushSize < 1)
+		return;
+
+	bool changeDone = false;
+
+	// calculate min and max values for raising
+
+	irr::f32 minValue = 0.0f;
+	irr::f32 maxValue = 0.0f;
+	getMinMaxHeightOfTerrainDataInBrush(tile, (irr::s32)brushSize, minValue, maxValue);
+	bool enableSmoothRaising = !irr::core::equals(minValue, maxValue);
+
+
+	// precalculations for embedded mesh movement
+
+	irr::core::array<SOldMeshPositionsInTerrain> embeddedMeshOldPositions;
+	getEmbeddedMeshPositionsInTerrain(embeddedMeshOldPositions, tile, (irr::s32)brushSize);
+
+	int brushStart = (int)(brushSize/2);
+	beginTerrainEditStamp(undo, tile.X - brushStart, tile.Y - brushStart, 
+		tile.X - brushStart + (int)brushSize, tile.Y - brushStart + (int)brushSize);
+
+	// raise
+
+	for (int x=0; x<(int)brushSize; ++x)
+	{
+		for (int y=0; y<(int)brushSize; ++y)
+		{
+			int cTileX = tile.X + x - (int)(brushSize/2);
+			int cTileY = tile.Y + y - (int)(brushSize/2);
+
+			if (isValidTerrainCell(cTileX, cTileY))
+			{
+				irr::f32& rHeight = TerrainHeights.getWritable(cTileX, cTileY);
+
+				if (!irr::core::iszero(sphereFactor))
+				{
+					float mountain = (sin((x) / (float)(brushSize * 1.00f) * irr::core::PI) 
+						* sin((y) / (float)(brushSize * 1.00f) * irr::core::PI))
+						* sphereFactor * 0.01f;
+					
+					if (additionalHeight > 0.0f)
+						rHeight += additionalHeight * mountain;
+					else
+						rHeight -= additionalHeight * mountain;
+				}
+				else
+				if (enableSmoothRaising)
+				{
+					irr::f32 fact = (maxValue - rHeight) / (maxValue - minValue);
+					if (fact > 1.0f) fact = 1.0f;
+
+					if (additionalHeight < 0.0f)
+						fact = 1.0f - fact;
+
+					rHeight += additionalHeight * fact;
+				}
+				else
+					rHeight += additionalHeight;
+
+				changeDone = true;
+			}
+		}
+	}
+
+	// rebuild terrain
+
+	if (changeDone)
+	{
+		// update cached data depending on the heights
+
+		onTerrainHeightsChanged(tile.X - brushStart, tile.Y - brushStart, 
+								tile.X - brushStart + (int)brushSize, tile.Y - brushStart + (int)brushSize);
+
+		// move embedded meshes
+
+		adjustEmbeddedMeshHeights(embeddedMeshOldPositions, undo);
+
+		// update terrain
+
+		const int border = 2;
+		int brushSizeHalf = (int)(brushSize/2.0f);
+		updateMeshesFromTerrainData(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
+								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
+	}	
+}
+
+
+void CFlaceTerrainSceneNode::modifyTerrain(irr::core::vector2di tile, irr::f32 brushSize, bool smooth, bool noise, bool flatten, IUndoManager* undo)
+{
+	cancelTerrainPaging();
+
+	if (brushSize < 1)
+		return;
+
+	bool changeDone = false;
+
+	// calculate min and max values for smoothing
+
+	irr::f32 minValue = 0.0f;
+	irr::f32 maxValue = 0.0f;
+	getMinMaxHeightOfTerrainDataInBrush(tile, (irr::s32)brushSize, minValue, maxValue);
+	bool enableSmoothing = !irr::core::equals(minValue, maxValue);
+
+	if (!enableSmoothing)
+		return;
+
+	// precalculations for embedded mesh movement
+
+	irr::core::array<SOldMeshPositionsInTerrain> embeddedMeshOldPositions;
+	getEmbeddedMeshPositionsInTerrain(embeddedMeshOldPositions, tile, (irr::s32)brushSize);
+
+	// smooth
+
+	irr::f32 average = minValue + ((maxValue - minValue) * 0.5f);
+
+	int brushStart = (int)(brushSize/2);
+	beginTerrainEditStamp(undo, tile.X - brushStart, tile.Y - brushStart, 
+		tile.X - brushStart + (int)brushSize, tile.Y - brushStart + (int)brushSize);
+
+	for (int x=0; x<(int)brushSize; ++x)
+	{
+		for (int y=0; y<(int)brushSize; ++y)
+		{
+			int cTileX = tile.X + x - (int)(brushSize/2);
+			int cTileY = tile.Y + y - (int)(brushSize/2);
+
+			if (isValidTerrainCell(cTileX, cTileY))
+			{
+				irr::f32& rHeight = TerrainHeights.getWritable(cTileX, cTileY);
+
+				if (smooth)
+				{
+					irr::f32 distanceFromAverage = rHeight - average;
+					rHeight -= distanceFromAverage * 0.5f;
+				}
+				else
+				if (flatten)
+				{
+					rHeight = minValue;
+				}
+				else
+				if (noise)
+				{
+					rHeight += (irr::os::Randomizer::randFloat() - 0.5f) * (CellSize);
+				}			
+				
+				changeDone = true;
+			}
+		}
+	}
+
+	// rebuild terrain
+
+	if (changeDone)
+	{
+		// update cached data depending on the heights
+
+		onTerrainHeightsChanged(tile.X - brushStart, tile.Y - brushStart, 
+								tile.X - brushStart + (int)brushSize, tile.Y - brushStart + (int)brushSize);
+
+		// move embedded meshes
+
+		adjustEmbeddedMeshHeights(embeddedMeshOldPositions, undo);
+
+		// update terrain
+
+		const int border = 2;
+		int brushSizeHalf = (int)(brushSize/2.0f);
+		updateMeshesFromTerrainData(tile.X - border - brushSizeHalf, tile.Y - border - brushSizeHalf, 
+								    tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);
+	}	
+}
+
+
+void CFlaceTerrainSceneNode::paintGrass(irr::core::vector2di tile, irr::f32 brushSize,
+										bool removeGrass, irr::video::ITexture* tex, 
+										irr::f32 width, irr::f32 height, IUndoManager* undo)
+{
+	const int border = 0;
+	int brushSizeHalf = (int)(brushSize/2.0f);
+	irr::core::rect<irr::s32> rectAffected(tile.X - border - brushSizeHalf, 
+											tile.Y - border - brushSizeHalf, 
+										   tile.X + brushSizeHalf + border + 1, tile.Y + brushSizeHalf + border + 1);	
+
+	bool changeDone = false;
+	irr::f32* pSnaphshotOld = 0;
+
+	// keep the order of the undo parts
+	finishTerrainEditStroke();
+
+	int nTexIndex = -1;
+	if (!removeGrass)
+	{
+		nTexIndex = findTextureIndexOrAddNewOne(tex);
+
+		if (nTexIndex == -1)
+			return;
+	}
+
+	if (removeGrass)
+	{
+		// remove grass, only the buckets of the tiles touched by the brush need to be searched
+
+		updateGrassBucketLayout();
+
+		const int startTileX = irr::core::clamp(rectAffected.UpperLeftCorner.X / CellsPerTileSide, 0, irr::core::max_(TileCountX-1, 0));
+		const int startTileY = irr::core::clamp(rectAffected.UpperLeftCorner.Y / CellsPerTileSide, 0, irr::core::max_(TileCountY-1, 0));
+		const int endTileX = irr::core::clamp(rectAffected.LowerRightCorner.X / CellsPerTileSide, 0, irr::core::max_(TileCountX-1, 0));
+		const int endTileY = irr::core::clamp(rectAffected.LowerRightCorner.Y / CellsPerTileSide, 0, irr::core::max_(TileCountY-1, 0));
+
+		for (int tileY=startTileY; tileY<=endTileY; ++tileY)
+		{
+			for (int tileX=startTileX; tileX<=endTileX; ++tileX)
+			{
+				irr::core::array<SGrassInstance>& bucket = GrassBuckets[getTerrainMeshIndex(tileX, tileY)];
+
+				for (int i=0; i<(int)bucket.size(); )
+				{
+					int cellX = (int)(bucket[i].PosX / CellSize);
+					int cellY = (int)(bucket[i].PosZ/ CellSize);
+
+					if (rectAffected.isPointInside(irr::core::position2di(cellX, cellY)))
+					{
+						if (undo && !pSnaphshotOld)
+							pSnaphshotOld = createTerrainGrassDataSnapshot();
+
+						changeDone = true;
+
+						// order inside a bucket doesn't matter, so simply move the last one here
+						bucket[i] = bucket.getLast();
+						bucket.erase(bucket.size()-1);
+
+						markGrassBatchDirty(getTerrainMeshIndex(tileX, tileY));
+					}
+					else
+						++i;
+				}
+			}
+		}
+	}
+	else
+	{
+		// add grass
+
+		int grassPatchesToAdd = (int)brushSize;
+
+		for (int g=0; g<grassPatchesToAdd; ++g)
+		{
+			if (undo && !pSnaphshotOld)
+				pSnaphshotOld = createTerrainGrassDataSnapshot();
+
+			changeDone = true;
+
+			irr::f32 posx = (rectAffected.UpperLeftCorner.X * CellSize) + ((irr::os::Randomizer::randFloat() * CellSize) * ((rectAffected.getWidth()-1)));
+			irr::f32 posy = (rectAffected.UpperLeftCorner.Y * CellSize) + ((irr::os::Randomizer::randFloat() * CellSize) * ((rectAffected.getHeight()-1)));
+
+			// add grass patch
+
+			SGrassInstance instance;
+			instance.PosX = posx;
+			instance.PosZ = posy;
+			instance.Height = height;
+			instance.Width = width;
+			instance.Rotation = (irr::os::Randomizer::rand() % 1000) / 500.0f;
+			instance.TextureIndex = nTexIndex;
+
+			addGrassInstance(instance);
+		}
+	}
+
+	if (changeDone)
+	{
+		if (undo)
+		{
+			irr::f32* pSnapsotNew = createTerrainGrassDataSnapshot();
+			undo->addUndoPartChangeTerrainGrassData(this, pSnaphshotOld, pSnapsotNew);
+		}
+
+		// the changed grass batches are rebuilt before rendering, the terrain tiles stay untouched
+	}	
+}
+
+void CFlaceTerrainSceneNode::getEmbeddedMeshPositionsInTerrain(irr::core::array<SOldMeshPositionsInTerrain>& outArr, irr::core::vector2di tile, irr::s32 brushSize)
+{
+	const int border = 1;
+	int brushSizeHalf = (int)(brushSize/2.0f);
+	irr::core::rect<irr::f32> rectAffected((irr::f32)(tile.X - border - brushSizeHalf) * CellSize, 
+										   (irr::f32)(tile.Y - border - brushSizeHalf) * CellSize, 
+										   (irr::f32)(tile.X + brushSizeHalf + border + 1) * CellSize,
+										   (irr::f32)(tile.Y + brushSizeHalf + border + 1) * CellSize);
+
+	for (int i=0; i<(int)TerrainTiles.size(); ++i)
+	{
+		if (TerrainTiles[i])
+		{
+			const core::list<ISceneNode*>& children = TerrainTiles[i]->getChildren();
+
+			for (core::list<ISceneNode*>::ConstIterator it = children.begin();
+				 it != children.end(); ++it)
+			{
+				irr::scene::ISceneNode* node = *it;
+
+				irr::core::position2df posInTerrain(node->getPosition().X - Displacement.X, node->getPosition().Z - Displacement.Z);
+
+				if (rectAffected.isPointInside(posInTerrain))
+				{
+					SOldMeshPositionsInTerrain pos;
+					pos.node = node;
+					pos.oldHeight = getExactTerrainHeightClampedAtPosition(node->getPosition().X - Displacement.X, node->getPosition().Z - Displacement.Z);
+
+					outArr.push_back(pos);
+				}				
+			}
+		}
+	}
+	
+}
+
+void CFlaceTerrainSceneNode::adjustEmbeddedMeshHeights(irr::core::array<SOldMeshPositionsInTerrain>& positions, IUndoManager* undo)
+{
+	for (int i=0; i<(int)positions.size(); ++i)
+	{
+		irr::scene::ISceneNode* node = positions[i].node;
+
+		irr::f32 newHeight = getExactTerrainHeightClampedAtPosition(node->getPosition().X - Displacement.X, node->getPosition().Z - Displacement.Z);
+		irr::f32 delta = positions[i].oldHeight - newHeight;
+
+		if (!irr::core::iszero(delta))
+		{			
+			irr::core::vector3df posnew = node->getPosition();
+			posnew.Y -= delta;
+
+			node->setPositionWithUndo(posnew, undo);
+		}		
+	}
+}
+
+void CFlaceTerrainSceneNode::resortChildIntoCorrectTerrainTileMesh(irr::scene::ISceneNode* node, IUndoManager* undo)
+{
+	if (!node)
+		return;
+
+	irr::core::vector3df pos = node->getPosition();
+
+	CFlaceMeshSceneNode* tileNode = getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(pos.X, pos.Z);
+	
+	if (tileNode && node->getParent() != tileNode)
+	{
+		node->grab();
+
+		node->getParent()->removeChild(node, undo);
+		tileNode->addChild(node, undo);
+
+		node->drop();
+	}
+}
+
+// called when the node and its children were read, so the node is able to link with its children if necessary
+void CFlaceTerrainSceneNode::onDeserializedWithChildren()
+{
+	clearCurrentTerrainMeshes();
+
+	for (int i=0; i<(int)TemporaryTerrainTilesIds.size(); ++i)
+	{
+		irr::s32 id = TemporaryTerrainTilesIds[i];
+		irr::scene::ISceneNode* node = getSceneManager()->getSceneNodeFromId(id, this);
+		if (node)
+			node->grab();
+
+		CFlaceMeshSceneNode* fmesh = (CFlaceMeshSceneNode*)node;
+		TerrainTiles.push_back(fmesh);
+	}
+
+	TemporaryTerrainTilesIds.clear();
+
+	if ((irr::s32)TerrainHeights.size() == CellCountX * CellCountY)
+		removeBakedGrassFromTileMeshes();
+
+	// the LOD index sets and the splat map are not stored in the file, recreate them if the terrain data 
+	// is available. Not done for lightmapped terrains, their vertex colors would be lost.
+
+	if ((LODLevelCount > 1 || UseSplatMap) && LightingType != ETLT_LIGHTMAP_VERTEX_COLORS &&
+		(irr::s32)TerrainHeights.size() == CellCountX * CellCountY && TerrainTiles.size() &&
+		TerrainTiles.linear_search(0) == -1)
+	{
+		updateMeshesFromTerrainData();
+	}
 }
\ No newline at end of file
@@ -1,247 +1,655 @@
-// Copyright (C) 2002-2014 Nikolaus Gebhardt
-// This file is part of the "Irrlicht Engine".
-// For conditions of distribution and use, see copyright notice in irrlicht.h
-
-#ifndef __C_FLACE_TERRAIN_SCENE_NODE_H_INCLUDED__
-#define __C_FLACE_TERRAIN_SCENE_NODE_H_INCLUDED__
-
-#include "ISceneNode.h"
-#include "EFlaceSceneNodeTypes.h"
-#include "S3DVertex.h"
-#include "IFlaceSerializationSupport.h"
-#include "CFlaceTerrainSceneNode.h"
-
-class CFlaceMeshSceneNode;
-
-//! Scene node which is a path. 
-class CFlaceTerrainSceneNode : public irr::scene::ISceneNode, public IFlaceSerializationSupport
-{
-public:
-
-	//! constructor
-	CFlaceTerrainSceneNode(IUndoManager* undo, irr::scene::ISceneNode* parent, irr::scene::ISceneManager* mgr, 
-		irr::video::IVideoDriver* driver, irr::s32 id);
-
-	~CFlaceTerrainSceneNode();
-
-	//! pre render event
-	virtual void OnRegisterSceneNode();
-
-	//! render
-	virtual void render();
-
-	//! returns the axis aligned bounding box of this node
-	virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const;
-	
-	//! Writes attributes of the scene node.
-	virtual void serializeAttributes(irr::io::IAttributes* out, irr::io::SAttributeReadWriteOptions* options=0) const;
-
-	//! Reads attributes of the scene node.
-	virtual void deserializeAttributes(irr::io::IAttributes* in, irr::io::SAttributeReadWriteOptions* options=0);
-
-	//! Returns type of the scene node
-	virtual irr::scene::ESCENE_NODE_TYPE getType() const { return (irr::scene::ESCENE_NODE_TYPE)EFSNT_FLACE_TERRAIN; }
-
-	//! Creates a clone of this scene node and its children.
-	virtual irr::scene::ISceneNode* clone(irr::scene::ISceneNode* newParent=0, irr::scene::ISceneManager* newManager=0, IUndoManager* undo=0);
-
-	//! serialize
-	void serialize(CFlaceSerializer* serializer);
-
-	//! deserialize
-	void deserialize(CFlaceDeserializer* deserializer);
-
-	// called when the node and its children were read, so the node is able to link with its children if necessary
-	virtual void onDeserializedWithChildren();
-
-	//! Returns the material based on the zero based index i.
-	virtual irr::video::SMaterial& getMaterial(irr::u32 num);
-
-	//! Get amount of materials used by this scene node.
-	virtual irr::u32 getMaterialCount() const;
-
-	//! returns the exact height of a position in the terrain, even if the position is not exactly at the vertex of a polygon. 
-	//! It is very fast for querying the height, as opposed to using Irrlicht's collision methods (which would have to iterate all triangles).
-	//! Also, if the position given is outside of the terrain, a height at the nearest border is returned.
-	irr::f32 getExactTerrainHeightClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY, irr::core::vector3df* outNormal=0);
-
-	struct STerrainData
-	{
-		irr::f32 Height;
-		irr::s32 UserSetTextureIndex;		// texture index set by the user
-
-		// runtime values
-		irr::s32 MainTextureIndex;			// when rendering, this is the first texture sent to the 3D driver
-		irr::s32 BlendingToTextureIndex;	// when rendering, this is the second texture sent to the 3D driver
-		irr::u8  BlendFactorPerVertex[4];
-	};
-
-	struct SGrassInstance
-	{
-		irr::f32 Height;
-		irr::f32 Width;
-		irr::f32 PosX;
-		irr::f32 PosZ;
-		irr::f32 Rotation;
-		irr::s32 TextureIndex;
-	};
-
-	struct STreeDistribution
-	{
-		irr::f32 percentOfTerrainCoveredWithThis;
-		irr::scene::IAnimatedMesh* Mesh;
-	};
-
-	struct SGrassDistribution
-	{
-		irr::f32 percentOfTerrainCoveredWithThis;
-		irr::video::ITexture* Texture;
-		irr::f32 height;
-		irr::f32 width;
-		irr::f32 maxPosHeight;
-	};
-
-	//! terrain to generate
-	//! topology: 1=hills 2=desert 3=flat
-	void generateTerrain(irr::s32 sideLen, irr::s32 cellSize, irr::s32 maxHeight, int topology, 
-		irr::video::ITexture* pTextureGrass, 
-		irr::video::ITexture* pTextureRock,
-		irr::video::ITexture* pTextureSand,
-		STreeDistribution* pTreeDistribution, irr::s32 nTreeDistributionCount,
-		SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount);
-
-	//! generates new terrain from heightmap
-	void loadHeightMap(irr::s32 sideLenX, irr::s32 sideLenY, irr::s32 cellSize, irr::f32* pData, 
-		irr::video::ITexture* pTextureGrass,
-		irr::video::ITexture* pTextureRock = 0,
-		irr::video::ITexture* pTextureSand = 0,
-		irr::video::ITexture* pGrassSpriteTexture = 0);
-
-	void distributeMeshes(irr::scene::IAnimatedMesh* tree, irr::f32 distribution, IUndoManager* undo=0, const irr::c8* basename="tree");
-
-	void replaceTexture(int idx, irr::video::ITexture* newtexture, IUndoManager* undo);
-	
-	// Robbo added
-	void setTextureHeights(irr::f32 tTexLow, irr::f32 tTexMed);
-	void calculateBlendingAll(int startCellX, int startCellY, int endCellX, int endCellY);
-	void setTextureBlend(int TexBlend);
-
-	enum E_TERRAIN_LIGHTING_TYPE
-	{
-		ETLT_NONE = 0,
-		ETLT_DYNAMIC,
-		ETLT_LIGHTMAP_VERTEX_COLORS,
-
-		ETLT_FORCE_32_BIT = 0x77ffffff
-	};
-
-	E_TERRAIN_LIGHTING_TYPE getLightingType();
-	void setLightingType(E_TERRAIN_LIGHTING_TYPE nType, IUndoManager* undo);
-
-	bool getSelectedTerrainTileFromScreenCoords(int x, int y, irr::core::vector2di& rOut);
-	void drawEditBrushSelection(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize);
-	void drawEditBrushSelectionRaiseTool(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize, irr::f32 additionalHeight, irr::f32 sphereFactor = 0.0f);
-	void drawEditBrushSelectionMountainValleyTool(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize, irr::f32 additionalHeight);
-	void paintTexture(int screenCoord2DX, int screenCoord2DY, irr::f32 brushSize, irr::video::ITexture* texture, IUndoManager* undo);
-	void raiseLowerTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 height, IUndoManager* undo, irr::f32 sphereFactor = 0.0f);
-	void mountainValleyTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 height, IUndoManager* undo);
-	void modifyTerrain(irr::core::vector2di tile, irr::f32 brushSize, bool smooth, bool noise, bool flatten, IUndoManager* undo);
-	void paintGrass(irr::core::vector2di tile, irr::f32 brushSize, bool removeGrass, irr::video::ITexture* tex, irr::f32 width, irr::f32 height, IUndoManager* undo);
-	
-	void resetTerrainDataFromSnapshot(irr::f32* pTerrainData);
-	irr::f32* createTerrainDataSnapshot();
-
-	void resetTerrainGrassDataFromSnapshot(irr::f32* pTerrainData);
-	irr::f32* createTerrainGrassDataSnapshot();
-
-	void resortChildIntoCorrectTerrainTileMesh(irr::scene::ISceneNode* node, IUndoManager* undo);
-
-	virtual irr::core::vector3df getDisplacement() { return Displacement; }
-	
-
-protected:
-
-	void recalculateBoundingBox();
-	void clearCurrentTerrainMeshes();
-	void clearCachedCollisionTrianglesFromTerrainMeshes();
-	void createCollisionTrianglesForTerrainMeshes();
-	void clearTerrainTextures();
-	void createTerrainSceneNodes();
-
-	void setThreeTexturesBasedOnHeight(); 
-	void generateGrass(SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount);
-
-	void updateMeshesFromTerrainData(int startCellX, int startCellY, int endCellX, int endCellY);
-	void updateMeshesFromTerrainData();
-
-	void calculateBlendingFactors(int startCellX, int startCellY, int endCellX, int endCellY);
-	void calculateBlendingFactors();
-
-	irr::scene::SMeshBuffer* getOrCreateMeshBuffer(irr::scene::SMesh* mesh, irr::s32 mainTextureIndex, 
-		irr::s32 blendingToTextureIndex, irr::s32 nWithFreeVertices, irr::s32 nWithFreeIndices, bool forGrass);
-		
-	void syncMaterials();
-	irr::s32 findTextureIndexOrAddNewOne(irr::video::ITexture* tex);
-	irr::s32 getTerrainMeshIndex(irr::s32 tileX, irr::s32 tileY);
-	irr::s32 getTerrainCellIndex(irr::s32 cellX, irr::s32 cellY);
-	irr::scene::SMesh* getTerrainTileMesh(irr::s32 tileX, irr::s32 tileY);
-	CFlaceMeshSceneNode* getTerrainTileMeshSceneNode(irr::s32 tileX, irr::s32 tileY);
-	CFlaceMeshSceneNode* getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(irr::f32 pixelX, irr::f32 pixelZ);
-	STerrainData* getTerrainData(irr::s32 globalCellX, irr::s32 globalCellY);
-	STerrainData* getTerrainDataClamped(irr::s32 globalCellX, irr::s32 globalCellY);
-	irr::f32 getTerrainDataHeightClamped(irr::s32 globalCellX, irr::s32 globalCellY);
-	irr::core::vector3df getTerrain3DPositionClamped(irr::s32 globalCellX, irr::s32 globalCellY);
-	
-	void getMinMaxHeightOfTerrainDataInBrush(irr::core::vector2di tile, irr::s32 brushSize, irr::f32& rOutMinValue, irr::f32& rOutMaxValue);
-
-	struct SOldMeshPositionsInTerrain
-	{
-		irr::f32 oldHeight;
-		irr::scene::ISceneNode* node;
-	};
-
-	void getEmbeddedMeshPositionsInTerrain(irr::core::array<SOldMeshPositionsInTerrain>& outArr, irr::core::vector2di tile, irr::s32 brushSize);
-	void adjustEmbeddedMeshHeights(irr::core::array<SOldMeshPositionsInTerrain>& positions, IUndoManager* undo);
-	
-	int SideLength;
-	int CellSize;
-	int TileSize;
-	int TileCountX;
-	int TileCountY;
-	int CellCountX;
-	int CellCountY;
-	int CellsPerTileSide;
-	int MaxHeight;
-	int texBlend;
-	float tTexHeightLow;
-	float tTexHeightMed;
-	E_TERRAIN_LIGHTING_TYPE LightingType;
-
-	irr::core::vector3df Displacement;
-
-	// user adjustable sizes
-	irr::f32 TextureScale;
-
-	// data for recreating the terrain (won't be saved for published apps to save space)
-
-	irr::core::array<irr::video::ITexture*> Textures;
-	irr::core::array<STerrainData> TerrainData;
-	irr::core::array<SGrassInstance> GrassInstances;
-	bool GrassUsesWind;
-
-	irr::core::aabbox3d<irr::f32> BBox;
-	irr::core::array<CFlaceMeshSceneNode*> TerrainTiles;
-	
-	// runtime
-	// material dummies
-	irr::core::array<irr::video::SMaterial> DummyMaterials;
-	irr::video::IVideoDriver* Driver;
-
-	// temporary and runtime
-	irr::core::array<irr::s32> TemporaryTerrainTilesIds; // only needed shortly after deserializing
-
-};
-
-
-#endif
-
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_SCENE_NODE_H_INCLUDED__
+#define __C_FLACE_TERRAIN_SCENE_NODE_H_INCLUDED__
+
+#include "ISceneNode.h"
+#include "EFlaceSceneNodeTypes.h"
+#include "S3DVertex.h"
+#include "IFlaceSerializationSupport.h"
+#include "CFlaceSharedCellArray.h"
+#include "CFlaceTerrainSceneNode.h"
+
+class CFlaceMeshSceneNode;
+class CFlaceTerrainTriangleSelector;
+class CFlaceTerrainTileBuildJob;
+
+const irr::s32 TERRAIN_MAX_LOD_LEVELS = 4;
+
+//! smallest allowed error in pixels for selecting the LOD level of a terrain tile
+const irr::f32 TERRAIN_MIN_LOD_SCREEN_ERROR = 0.1f;
+
+//! maximal amount of textures of a terrain, the texture index of a cell is stored in 8 bits
+const irr::s32 TERRAIN_MAX_TEXTURES = 256;
+
+//! paging regions and forest batches are only released when a bit farther away than their distance, so the ones 
+//! at the border don't get loaded and released again every frame when the camera moves a little.
+const irr::f32 TERRAIN_PAGING_RELEASE_FACTOR = 1.2f;
+
+//! Scene node which is a path. 
+class CFlaceTerrainSceneNode : public irr::scene::ISceneNode, public IFlaceSerializationSupport
+{
+public:
+
+	//! constructor
+	CFlaceTerrainSceneNode(IUndoManager* undo, irr::scene::ISceneNode* parent, irr::scene::ISceneManager* mgr, 
+		irr::video::IVideoDriver* driver, irr::s32 id);
+
+	~CFlaceTerrainSceneNode();
+
+	//! pre render event
+	virtual void OnRegisterSceneNode();
+
+	//! render
+	virtual void render();
+
+	//! returns the axis aligned bounding box of this node
+	virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const;
+	
+	//! Writes attributes of the scene node.
+	virtual void serializeAttributes(irr::io::IAttributes* out, irr::io::SAttributeReadWriteOptions* options=0) const;
+
+	//! Reads attributes of the scene node.
+	virtual void deserializeAttributes(irr::io::IAttributes* in, irr::io::SAttributeReadWriteOptions* options=0);
+
+	//! Returns type of the scene node
+	virtual irr::scene::ESCENE_NODE_TYPE getType() const { return (irr::scene::ESCENE_NODE_TYPE)EFSNT_FLACE_TERRAIN; }
+
+	//! Creates a clone of this scene node and its children.
+	virtual irr::scene::ISceneNode* clone(irr::scene::ISceneNode* newParent=0, irr::scene::ISceneManager* newManager=0, IUndoManager* undo=0);
+
+	//! serialize
+	void serialize(CFlaceSerializer* serializer);
+
+	//! deserialize
+	void deserialize(CFlaceDeserializer* deserializer);
+
+	// called when the node and its children were read, so the node is able to link with its children if necessary
+	virtual void onDeserializedWithChildren();
+
+	//! Returns the material based on the zero based index i.
+	virtual irr::video::SMaterial& getMaterial(irr::u32 num);
+
+	//! Get amount of materials used by this scene node.
+	virtual irr::u32 getMaterialCount() const;
+
+	//! returns the exact height of a position in the terrain, even if the position is not exactly at the vertex of a polygon. 
+	//! It is very fast for querying the height, as opposed to using Irrlicht's collision methods (which would have to iterate all triangles).
+	//! Also, if the position given is outside of the terrain, a height at the nearest border is returned.
+	//! outNormal receives the normalized face normal of the triangle, which faces downwards, if not 0.
+	irr::f32 getExactTerrainHeightClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY, irr::core::vector3df* outNormal=0);
+
+	//! Like getExactTerrainHeightClampedAtPosition(), but for many positions at once. positionsXZ has count pairs
+	//! of X and Z coordinates, outHeights receives count heights, and outNormals the upwards facing normals of the
+	//! terrain triangles if not 0. Uses SSE2 where available, this is a lot faster than querying single positions.
+	void getExactTerrainHeightsClampedAtPositions(const irr::f32* positionsXZ, irr::s32 count, irr::f32* outHeights, 
+		irr::core::vector3df* outNormals=0);
+
+	//! returns the smooth, upwards facing terrain normal at a position, interpolated from the cached vertex normals.
+	//! Like getExactTerrainHeightClampedAtPosition(), positions outside of the terrain are clamped to the border.
+	irr::core::vector3df getTerrainNormalClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY);
+
+	//! returns the slope of the terrain at a position in degrees, 0 is flat and 90 is a vertical wall.
+	irr::f32 getTerrainSlopeClampedAtPosition(irr::f32 globalPixelX, irr::f32 globalPixelY);
+
+	//! runtime blending values of a terrain cell, calculated from the texture indices set by the user.
+	//! When rendering, the texture set by the user is the first texture sent to the 3D driver.
+	struct STerrainCellBlending
+	{
+		irr::u8 BlendingToTextureIndex;		// when rendering, this is the second texture sent to the 3D driver
+		irr::u8 BlendFactorPerVertex[4];
+	};
+
+	struct SGrassInstance
+	{
+		irr::f32 Height;
+		irr::f32 Width;
+		irr::f32 PosX;
+		irr::f32 PosZ;
+		irr::f32 Rotation;
+		irr::s32 TextureIndex;
+	};
+
+	//! tree placed with distributeForest(), drawn by the terrain itself
+	struct SForestInstance
+	{
+		irr::s32 MeshIndex; // index into the meshes of the forest
+		irr::f32 PosX;
+		irr::f32 PosZ;
+		irr::f32 Rotation; // around the Y axis, in degrees
+		irr::f32 Scale;
+	};
+
+	struct STreeDistribution
+	{
+		irr::f32 percentOfTerrainCoveredWithThis;
+		irr::scene::IAnimatedMesh* Mesh;
+	};
+
+	struct SGrassDistribution
+	{
+		//! no coverage, and no limits for height and slope
+		void setDefaults()
+		{
+			percentOfTerrainCoveredWithThis = 0;
+			Texture = 0;
+			height = 0;
+			width = 0;
+			maxPosHeight = FLT_MAX;
+			minPosHeight = -FLT_MAX;
+			maxSlope = 90.0f;
+		}
+
+		irr::f32 percentOfTerrainCoveredWithThis;
+		irr::video::ITexture* Texture;
+		irr::f32 height;
+		irr::f32 width;
+		irr::f32 maxPosHeight;
+		irr::f32 minPosHeight;
+		irr::f32 maxSlope; // in degrees, 90 or 0 allow all slopes, so brace initialization without it has no limit
+	};
+
+	//! terrain to generate
+	//! topology: one of E_TERRAIN_TOPOLOGY (0=hills 1=desert 2=flat 3=fbm noise 4=ridged noise)
+	//! seed: the same seed always generates the same terrain, 0 for a random one
+	void generateTerrain(irr::s32 sideLen, irr::s32 cellSize, irr::s32 maxHeight, int topology, 
+		irr::video::ITexture* pTextureGrass, 
+		irr::video::ITexture* pTextureRock,
+		irr::video::ITexture* pTextureSand,
+		STreeDistribution* pTreeDistribution, irr::s32 nTreeDistributionCount,
+		SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount, irr::u32 seed=0);
+
+	//! generates new terrain from heightmap
+	void loadHeightMap(irr::s32 sideLenX, irr::s32 sideLenY, irr::s32 cellSize, irr::f32* pData, 
+		irr::video::ITexture* pTextureGrass,
+		irr::video::ITexture* pTextureRock = 0,
+		irr::video::ITexture* pTextureSand = 0,
+		irr::video::ITexture* pGrassSpriteTexture = 0);
+
+	//! generates new terrain from a height map file, without loading the whole file into memory first. The file is 
+	//! read in bands of rows, which are resampled to the cells on all cores, so even very large survey height maps 
+	//! can be imported. format: one of E_TERRAIN_HEIGHTMAP_FORMAT (0=8 bit raw 1=16 bit raw 2=16 bit big endian raw
+	//! 3=float raw 4=image, 8 bit only), rawWidth and rawHeight are the amount of heights of raw files. sideLen is the amount of 
+	//! cells per side of the terrain, 0 for one cell per height. heightScale converts the values of the file to heights.
+	//! filter: one of E_TERRAIN_HEIGHTMAP_FILTER (0=bilinear 1=bicubic). Returns false if the file couldn't be opened,
+	//! or couldn't be read completely, the missing heights are 0 then.
+	bool importHeightMap(const irr::c8* filename, int format, irr::s32 rawWidth, irr::s32 rawHeight, 
+		irr::s32 sideLen, irr::s32 cellSize, irr::f32 heightScale, int filter,
+		irr::video::ITexture* pTextureGrass,
+		irr::video::ITexture* pTextureRock = 0,
+		irr::video::ITexture* pTextureSand = 0,
+		irr::video::ITexture* pGrassSpriteTexture = 0);
+
+	void distributeMeshes(irr::scene::IAnimatedMesh* tree, irr::f32 distribution, IUndoManager* undo=0, const irr::c8* basename="tree");
+
+	//! places trees like distributeMeshes(), but as instances stored per tile in the terrain instead of one scene node 
+	//! per tree. The trees of a tile are merged into one mesh buffer per material and culled per tile, so forests of
+	//! many thousand trees cost only a few draw calls. The same seed always places the same trees, 0 for random ones.
+	void distributeForest(irr::scene::IAnimatedMesh* tree, irr::f32 distribution, irr::u32 seed=0);
+
+	//! removes all trees placed with distributeForest()
+	void clearForest();
+
+	//! returns the amount of trees placed with distributeForest()
+	irr::s32 getForestInstanceCount();
+
+	void replaceTexture(int idx, irr::video::ITexture* newtexture, IUndoManager* undo);
+	
+	// Robbo added
+	void setTextureHeights(irr::f32 tTexLow, irr::f32 tTexMed);
+	void calculateBlendingAll(int startCellX, int startCellY, int endCellX, int endCellY);
+	void setTextureBlend(int TexBlend);
+
+	enum E_TERRAIN_LIGHTING_TYPE
+	{
+		ETLT_NONE = 0,
+		ETLT_DYNAMIC,
+		ETLT_LIGHTMAP_VERTEX_COLORS,
+
+		ETLT_FORCE_32_BIT = 0x77ffffff
+	};
+
+	E_TERRAIN_LIGHTING_TYPE getLightingType();
+	void setLightingType(E_TERRAIN_LIGHTING_TYPE nType, IUndoManager* undo);
+
+	bool getSelectedTerrainTileFromScreenCoords(int x, int y, irr::core::vector2di& rOut);
+
+	//! returns the first point where a line hits the terrain surface, by walking through the cells of the height field.
+	//! Doesn't need triangle selectors. The line is in world space, and outCell receives the hit cell if not 0.
+	bool getTerrainCollisionPointWithLine(const irr::core::line3df& line, irr::core::vector3df& outPoint, 
+		irr::core::vector2di* outCell=0);
+
+	void drawEditBrushSelection(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize);
+	void drawEditBrushSelectionRaiseTool(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize, irr::f32 additionalHeight, irr::f32 sphereFactor = 0.0f);
+	void drawEditBrushSelectionMountainValleyTool(irr::core::vector2di tile, irr::video::SColor clr, irr::f32 brushSize, irr::f32 additionalHeight);
+	void paintTexture(int screenCoord2DX, int screenCoord2DY, irr::f32 brushSize, irr::video::ITexture* texture, IUndoManager* undo);
+	void raiseLowerTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 height, IUndoManager* undo, irr::f32 sphereFactor = 0.0f);
+	void mountainValleyTerrain(irr::core::vector2di tile, irr::f32 brushSize, irr::f32 height, IUndoManager* undo);
+	void modifyTerrain(irr::core::vector2di tile, irr::f32 brushSize, bool smooth, bool noise, bool flatten, IUndoManager* undo);
+	void paintGrass(irr::core::vector2di tile, irr::f32 brushSize, bool removeGrass, irr::video::ITexture* tex, irr::f32 width, irr::f32 height, IUndoManager* undo);
+	
+	//! restores the cells from a snapshot, either of the whole terrain or of the rectangle changed by an edit stroke
+	void resetTerrainDataFromSnapshot(irr::f32* pTerrainData);
+	irr::f32* createTerrainDataSnapshot();
+
+	//! the brushes record one undo part per stroke, with the cells of the changed rectangle before and after.
+	//! A stroke ends when calling this, which the editor should do when the mouse button is released. It also 
+	//! ends with any other change of the cells, with an undo, or when the brush wasn't used for a moment.
+	void finishTerrainEditStroke();
+
+	void resetTerrainGrassDataFromSnapshot(irr::f32* pTerrainData);
+	irr::f32* createTerrainGrassDataSnapshot();
+
+	void resortChildIntoCorrectTerrainTileMesh(irr::scene::ISceneNode* node, IUndoManager* undo);
+
+	virtual irr::core::vector3df getDisplacement() { return Displacement; }
+
+	//! sets the amount of LOD levels of the terrain tiles, 1 means LOD is disabled. Each level
+	//! uses half the resolution of the previous one, so with 4 levels, every 1/2/4/8 cells are used.
+	void setLODLevelCount(irr::s32 count);
+	irr::s32 getLODLevelCount() const { return LODLevelCount; }
+
+	//! sets the maximal error in pixels on the screen a lower LOD level of a terrain tile may cause
+	void setLODMaxScreenError(irr::f32 pixels) { LODMaxScreenError = irr::core::max_(pixels, TERRAIN_MIN_LOD_SCREEN_ERROR); }
+	irr::f32 getLODMaxScreenError() const { return LODMaxScreenError; }
+
+	//! sets the distance from the camera after which no grass is drawn anymore. 0 means unlimited.
+	void setGrassViewDistance(irr::f32 distance) { GrassViewDistance = irr::core::max_(distance, 0.0f); }
+	irr::f32 getGrassViewDistance() const { return GrassViewDistance; }
+
+	//! sets the width of the band before the grass view distance in which the grass gets thinned out
+	void setGrassFadeDistance(irr::f32 distance) { GrassFadeDistance = irr::core::max_(distance, 0.0f); }
+	irr::f32 getGrassFadeDistance() const { return GrassFadeDistance; }
+
+	//! sets the distance from the camera after which no forest trees are drawn anymore. 0 means unlimited.
+	//! Tiles farther away release their merged trees, so this also limits the memory used by large forests.
+	void setForestViewDistance(irr::f32 distance) { ForestViewDistance = irr::core::max_(distance, 0.0f); }
+	irr::f32 getForestViewDistance() const { return ForestViewDistance; }
+
+	//! sets the distance from the camera after which forest trees are drawn as impostors: one quad turned to the
+	//! camera, showing a picture of the tree rendered from the nearest of several sides. In the transitionDistance
+	//! before it, more and more trees of a tile switch to impostors. Each tree switches at once, they are not blended.
+	//! 0 disables impostors. They need render target textures, without them all trees are drawn in full.
+	void setForestImpostorDistance(irr::f32 distance, irr::f32 transitionDistance);
+	irr::f32 getForestImpostorDistance() const { return ForestImpostorDistance; }
+	irr::f32 getForestImpostorTransitionDistance() const { return ForestImpostorTransitionDistance; }
+
+	//! renders the impostor pictures of the forest meshes now instead of before they are first needed, like 
+	//! at load time. Returns if all of them are available.
+	bool bakeForestImpostors();
+
+	//! sets if the terrain is drawn with a splat map shader, which blends up to TERRAIN_SPLAT_MAX_LAYERS textures 
+	//! in one draw call per tile. The terrain falls back to blending two textures per mesh buffer if the driver 
+	//! doesn't support shaders, or if more different textures are painted onto the terrain than the shader can blend.
+	void setUseSplatMap(bool use);
+	bool getUseSplatMap() const { return UseSplatMap; }
+
+	//! returns if the splat map is currently used for drawing, see setUseSplatMap()
+	bool isUsingSplatMap() const { return SplatMap != 0; }
+
+	//! sets if the cells and the grass are saved as one compressed chunk. Files written like this have
+	//! no terrain for editors and players older than the chunk, disable it to save terrains readable by them.
+	void setCompressTerrainData(bool compress) { CompressTerrainData = compress; }
+	bool getCompressTerrainData() const { return CompressTerrainData; }
+
+	//! enables paging of the terrain geometry for very large terrains. The tiles are grouped into square regions
+	//! of regionSize x regionSize tiles, and only regions nearer to the camera than distance keep their meshes
+	//! and grass batches. Regions are meshed on a background thread when the camera comes near. If budgetMB
+	//! is not 0, far regions are released early to keep the geometry below that amount of megabytes. 
+	//! A regionSize of 0 disables paging. Lightmapped terrains are never paged, their vertex colors can't be recreated.
+	void setTerrainPaging(irr::s32 regionSize, irr::f32 distance, irr::s32 budgetMB);
+	irr::s32 getPagingRegionSize() const { return PagingRegionSize; }
+	irr::f32 getPagingDistance() const { return PagingDistance; }
+	irr::s32 getPagingMemoryBudget() const { return PagingMemoryBudget; }
+
+	//! returns the amount of bytes used by the geometry of the currently loaded paging regions
+	irr::s32 getPagedGeometryMemory();
+	
+
+protected:
+
+	void recalculateBoundingBox();
+	void clearCurrentTerrainMeshes();
+	void clearCachedCollisionTrianglesFromTerrainMeshes();
+	void clearCachedCollisionTrianglesFromTerrainTile(CFlaceMeshSceneNode* node);
+	void createCollisionTrianglesForTerrainMeshes();
+	void clearTerrainTextures();
+	void createTerrainSceneNodes();
+
+	void setThreeTexturesBasedOnHeight(); 
+	void beginHeightMapTerrain(irr::s32 sideLen, irr::s32 cellSize, irr::video::ITexture* pTextureGrass, 
+		irr::video::ITexture* pTextureRock, irr::video::ITexture* pTextureSand);
+	void finishHeightMapTerrain(bool useThreeTextures, irr::video::ITexture* pGrassSpriteTexture);
+	void generateGrass(SGrassDistribution* pGrassDistribution, irr::s32 nGrassDistributionCount, irr::u32 seed=0);
+	void addGrassInstance(const SGrassInstance& instance);
+	void clearGrassInstances();
+	irr::s32 getGrassInstanceCount();
+	irr::s32 getGrassBucketIndex(irr::f32 posX, irr::f32 posZ);
+	void updateGrassBucketLayout();
+	void markGrassBatchDirty(irr::s32 tileIndex);
+	void updateGrassBatch(irr::s32 tileIndex);
+	bool updateGrassBatches();
+	void clearGrassBatches();
+	void renderGrass(irr::video::IVideoDriver* driver, irr::scene::ICameraSceneNode* camera);
+	irr::f32 getGrassDensityForDistance(irr::f32 distance);
+	void removeBakedGrassFromTileMeshes();
+
+	irr::s32 findForestMeshIndexOrAddNewOne(irr::scene::IAnimatedMesh* mesh);
+	void addForestInstance(const SForestInstance& instance);
+	void updateForestBucketLayout();
+	void markForestBatchDirty(irr::s32 tileIndex);
+	void getForestInstanceOrder(irr::s32 tileIndex, irr::core::array<irr::s32>& outOrder);
+	void updateForestInstanceCounts(irr::s32 tileIndex);
+	irr::core::vector3df getForestInstancePosition(const SForestInstance& t, irr::scene::IMesh* mesh);
+	irr::scene::IMesh* getForestMesh(irr::s32 meshIndex);
+	void updateForestBatch(irr::s32 tileIndex);
+	void updateForestImpostorBatch(irr::s32 tileIndex, const irr::core::vector3df& camPos);
+	void releaseForestBatch(irr::s32 tileIndex);
+	bool updateForestBatches();
+	void clearForestBatches();
+	bool bakeForestImpostor(irr::s32 meshIndex);
+	void clearForestImpostors();
+	void renderForest(irr::video::IVideoDriver* driver, irr::scene::ICameraSceneNode* camera);
+	irr::f32 getForestImpostorPartForDistance(irr::f32 distance);
+	irr::f32 getTerrainTileDistanceXZ(irr::s32 tileIndex, const irr::core::vector3df& pos);
+	irr::f32 getTerrainTileAngleTo(irr::s32 tileIndex, const irr::core::vector3df& pos);
+
+	bool isPagingActive();
+	void updatePagingRegionLayout();
+	void updateTerrainPaging();
+	void finishTerrainPagingJob();
+	void cancelTerrainPaging();
+	void releaseTerrainPagingRegion(irr::s32 regionIndex);
+	bool isTerrainTileResident(irr::s32 tileIndex);
+	irr::s32 getPagingRegionIndexOfTile(irr::s32 tileIndex);
+	irr::f32 getPagingRegionDistance(irr::s32 regionIndex, const irr::core::vector3df& pos);
+	irr::s32 getPagingRegionMemory(irr::s32 regionIndex);
+
+	bool updateSplatMap(int startCellX, int startCellY, int endCellX, int endCellY);
+	bool addSplatLayers(irr::core::array<irr::s32>& layers, int startCellX, int startCellY, int endCellX, int endCellY);
+	void clearSplatMap();
+	irr::s32 getSplatLayer(const irr::core::array<irr::s32>& layers, irr::s32 textureIndex);
+
+	void updateMeshesFromTerrainData(int startCellX, int startCellY, int endCellX, int endCellY);
+	void updateMeshesFromTerrainData();
+
+	void calculateBlendingFactors(int startCellX, int startCellY, int endCellX, int endCellY);
+	void calculateBlendingFactors();
+	void calculateBlending(int startCellX, int startCellY, int endCellX, int endCellY, bool allWithBlend);
+
+	void onTerrainHeightsChanged(int startCellX, int startCellY, int endCellX, int endCellY);
+	void onTerrainHeightsChanged();
+	void updateTerrainNormals(int startCellX, int startCellY, int endCellX, int endCellY);
+	void updateHeightPyramid(int startCellX, int startCellY, int endCellX, int endCellY);
+	bool getTerrainHeightRange(int startCellX, int startCellY, int endCellX, int endCellY, irr::f32& outMin, irr::f32& outMax);
+	void addHeightPyramidRange(irr::s32 level, irr::s32 blockX, irr::s32 blockY, const irr::core::rect<irr::s32>& cells, 
+		irr::f32& outMin, irr::f32& outMax);
+	irr::core::vector3df getTerrainNormalClamped(irr::s32 globalCellX, irr::s32 globalCellY);
+
+	struct SMeshBufferLookup;
+
+	irr::scene::SMeshBuffer* getOrCreateMeshBuffer(irr::scene::SMesh* mesh, irr::s32 mainTextureIndex, 
+		irr::s32 blendingToTextureIndex, irr::s32 nWithFreeVertices, irr::s32 nWithFreeIndices, bool forGrass,
+		SMeshBufferLookup* lookup=0);
+	irr::scene::SMeshBuffer* createMeshBuffer(irr::scene::SMesh* mesh, irr::video::ITexture* tex1, 
+		irr::video::ITexture* tex2, bool forGrass);
+
+	irr::video::S3DVertex createTerrainVertex(irr::s32 globalCellX, irr::s32 globalCellY, irr::u8 blendFactor, irr::f32 heightOffset=0.0f);
+	irr::video::ITexture* getTerrainTexture(irr::s32 idx);
+		
+	void syncMaterials();
+	irr::s32 findTextureIndexOrAddNewOne(irr::video::ITexture* tex);
+	irr::s32 getTerrainMeshIndex(irr::s32 tileX, irr::s32 tileY);
+	irr::s32 getTerrainCellIndex(irr::s32 cellX, irr::s32 cellY);
+	irr::scene::SMesh* getTerrainTileMesh(irr::s32 tileX, irr::s32 tileY);
+	CFlaceMeshSceneNode* getTerrainTileMeshSceneNode(irr::s32 tileX, irr::s32 tileY);
+	CFlaceMeshSceneNode* getTerrainTileMeshSceneNodeFromGlobalPixelPosClamped(irr::f32 pixelX, irr::f32 pixelZ);
+	void writeTerrainDataChunk(CFlaceSerializer* serializer);
+	bool readTerrainDataChunk(CFlaceDeserializer* deserializer);
+	void writeForest(CFlaceSerializer* serializer);
+	bool readForest(CFlaceDeserializer* deserializer);
+	void resetTerrainCells();
+	void clearTerrainCells();
+	bool isValidTerrainCell(irr::s32 globalCellX, irr::s32 globalCellY);
+	irr::f32 getTerrainDataHeightClamped(irr::s32 globalCellX, irr::s32 globalCellY);
+	bool getTerrainTileHeightRange(irr::s32 tileX, irr::s32 tileY, irr::f32& outMin, irr::f32& outMax);
+	irr::core::vector3df getTerrain3DPositionClamped(irr::s32 globalCellX, irr::s32 globalCellY);
+	
+	void beginTerrainEditStamp(IUndoManager* undo, int startCellX, int startCellY, int endCellX, int endCellY);
+	void markTerrainEditStrokeCells(const irr::core::rect<irr::s32>& cells);
+	irr::s32 getTerrainEditStrokeCellIndex(irr::s32 x, irr::s32 y) const { return (y - EditStrokeCells.UpperLeftCorner.Y) * EditStrokeCells.getWidth() + x - EditStrokeCells.UpperLeftCorner.X; }
+	irr::f32* createTerrainDataSnapshot(const irr::core::rect<irr::s32>& cells);
+	void restoreTerrainCell(irr::s32 cellX, irr::s32 cellY, const irr::f32* snapshotCell);
+	
+	void getMinMaxHeightOfTerrainDataInBrush(irr::core::vector2di tile, irr::s32 brushSize, irr::f32& rOutMinValue, irr::f32& rOutMaxValue);
+
+	struct SOldMeshPositionsInTerrain
+	{
+		irr::f32 oldHeight;
+		irr::scene::ISceneNode* node;
+	};
+
+	// vertex of a tile grid, only created once per mesh buffer and blend factor
+	struct STileGridVertexRef
+	{
+		irr::s16 GridX;
+		irr::s16 GridY;
+		irr::u8 BlendFactor;
+		bool IsSkirt;
+	};
+
+	// texture pair used by cells of a tile, and the geometry collected for it while building the tile
+	struct STileBuildBuffer
+	{
+		irr::s32 MainTextureIndex;
+		irr::s32 BlendingToTextureIndex;
+		irr::s32 CellCount;
+		irr::core::array<irr::s32> GridVertexIndex; // index into Vertices per grid point, and per skirt point after that
+		irr::core::array<irr::u8> GridVertexBlend;
+		irr::core::array<STileGridVertexRef> Vertices;
+		irr::core::array<irr::s32> Indices[TERRAIN_MAX_LOD_LEVELS];
+	};
+
+	// index sets of all LOD levels of a terrain tile
+	struct STerrainTileLOD
+	{
+		irr::s32 LevelCount;
+		irr::s32 CurrentLevel;
+		irr::f32 GeometricError[TERRAIN_MAX_LOD_LEVELS]; // max height difference to the full resolution
+		irr::core::array<irr::scene::SMeshBuffer*> Buffers; // buffers of the tile mesh, grabbed
+		irr::core::array< irr::core::array<irr::u16> > Indices[TERRAIN_MAX_LOD_LEVELS]; // per level, per buffer
+	};
+
+	// lowest and highest height inside a part of the terrain
+	struct SHeightRange
+	{
+		irr::f32 Min;
+		irr::f32 Max;
+	};
+
+	enum E_PAGING_REGION_STATE
+	{
+		EPRS_RELEASED = 0,
+		EPRS_LOADING,
+		EPRS_RESIDENT
+	};
+
+	// square group of tiles, loaded and released as a whole when paging
+	struct SPagingRegion
+	{
+		E_PAGING_REGION_STATE State;
+		irr::s32 Memory; // bytes of geometry, updated while resident
+	};
+
+	// grass quads of a tile, rendered by the terrain node itself
+	struct SGrassBatch
+	{
+		irr::scene::SMesh* Mesh;
+		bool Dirty; // instances changed since the mesh was built
+	};
+
+	// instances of one mesh buffer of a forest batch
+	struct SForestBatchBuffer
+	{
+		irr::s32 MeshIndex; // forest mesh of the instances
+		irr::s32 FirstInstance; // counted per forest mesh, in the order of getForestInstanceOrder()
+		irr::u32 IndicesPerInstance;
+	};
+
+	// trees of a tile merged into mesh buffers, rendered by the terrain node itself
+	struct SForestBatch
+	{
+		irr::scene::SMesh* Mesh;
+		irr::core::array<SForestBatchBuffer> Buffers; // per mesh buffer of Mesh
+		bool Dirty; // instances or heights changed since the mesh was built
+		irr::scene::SMesh* ImpostorMesh; // the same trees as impostor quads
+		irr::core::array<SForestBatchBuffer> ImpostorBuffers;
+		irr::f32 ImpostorAngle; // direction from the tile to the camera the quads were turned to, in degrees
+		bool ImpostorDirty;
+		irr::core::array<irr::s32> InstancesPerMesh;
+	};
+
+	// views of a forest mesh from around it, for impostors
+	struct SForestImpostor
+	{
+		irr::video::ITexture* Atlas; // all views, a render target only if the driver can't read it back. 0 if not available
+		irr::f32 Radius; // half width of the quad
+		irr::f32 MinY; // bottom and top of the quad above the tree position
+		irr::f32 MaxY;
+		bool Baked; // tried to render the views
+	};
+
+	void releaseForestMeshBatch(SForestBatch& batch);
+	void releaseForestImpostorBatch(SForestBatch& batch);
+	void drawForestBatchPart(irr::video::IVideoDriver* driver, irr::scene::SMesh* mesh, const irr::core::array<SForestBatchBuffer>& buffers,
+		const irr::core::array<irr::s32>& instancesPerMesh, irr::f32 firstPart, irr::f32 lastPart);
+
+	// geometry of one texture pair of a tile, built on a worker thread
+	struct STileStagingBuffer
+	{
+		irr::s32 MainTextureIndex;
+		irr::s32 BlendingToTextureIndex;
+		irr::core::array<irr::video::S3DVertex> Vertices;
+		irr::core::array<irr::u16> Indices[TERRAIN_MAX_LOD_LEVELS];
+		irr::core::aabbox3df BoundingBox;
+	};
+
+	// geometry of a whole tile, built on a worker thread and then copied into the tile mesh
+	struct STerrainTileStaging
+	{
+		irr::s32 TileX;
+		irr::s32 TileY;
+		irr::s32 LevelCount;
+		irr::f32 GeometricError[TERRAIN_MAX_LOD_LEVELS];
+		irr::core::array<STileStagingBuffer> Buffers;
+	};
+
+	friend class CFlaceTerrainTileBuildJob;
+	friend class CFlaceTerrainBlendingJob;
+	friend class CFlaceTerrainTriangleSelector;
+
+	CFlaceTerrainTriangleSelector* createTerrainTriangleSelector(irr::s32 tileX, irr::s32 tileY, irr::scene::ISceneNode* node);
+	void onTriangleSelectorDeleted(CFlaceTerrainTriangleSelector* selector);
+	void detachTriangleSelectors();
+	bool getTerrainTileCollisionCells(irr::s32 tileX, irr::s32 tileY, irr::core::rect<irr::s32>& outCells);
+	irr::s32 getTerrainTriangles(const irr::core::rect<irr::s32>& cells, const irr::core::aabbox3df* box, 
+		irr::core::triangle3df* triangles, irr::s32 arraySize, const irr::core::matrix4& transform);
+
+	void buildTerrainTileStaging(STerrainTileStaging& staging);
+	void commitTerrainTileStaging(const STerrainTileStaging& staging, irr::scene::SMesh* mesh);
+	void applyTerrainTileStaging(STerrainTileStaging& staging);
+	irr::s32 addTileGridVertex(STileBuildBuffer& buf, irr::s32 gridX, irr::s32 gridY, irr::u8 blendFactor, bool skirt);
+	void addTileSkirt(STileBuildBuffer& buf, irr::s32 level, irr::s32 topVertex1, irr::s32 topVertex2);
+	irr::f32 calculateTileLODError(irr::s32 tileX, irr::s32 tileY, irr::s32 step);
+	void updateTerrainTileLODs();
+	void setTerrainTileLOD(irr::s32 tileIndex, irr::s32 level);
+	void clearTerrainTileLOD(STerrainTileLOD& lod);
+	void clearTerrainTileLODs();
+
+	void getEmbeddedMeshPositionsInTerrain(irr::core::array<SOldMeshPositionsInTerrain>& outArr, irr::core::vector2di tile, irr::s32 brushSize);
+	void adjustEmbeddedMeshHeights(irr::core::array<SOldMeshPositionsInTerrain>& positions, IUndoManager* undo);
+	
+	int SideLength;
+	int CellSize;
+	int TileSize;
+	int TileCountX;
+	int TileCountY;
+	int CellCountX;
+	int CellCountY;
+	int CellsPerTileSide;
+	int MaxHeight;
+	int texBlend;
+	float tTexHeightLow;
+	float tTexHeightMed;
+	E_TERRAIN_LIGHTING_TYPE LightingType;
+	irr::s32 LODLevelCount;
+	irr::f32 LODMaxScreenError;
+	irr::f32 GrassViewDistance;
+	irr::f32 GrassFadeDistance;
+	irr::f32 ForestViewDistance;
+	irr::f32 ForestImpostorDistance;
+	irr::f32 ForestImpostorTransitionDistance;
+	bool UseSplatMap;
+	bool CompressTerrainData;
+	irr::s32 PagingRegionSize; // tiles per side of a paging region, 0 if paging is disabled
+	irr::f32 PagingDistance;
+	irr::s32 PagingMemoryBudget; // in megabytes, 0 for unlimited
+
+	irr::core::vector3df Displacement;
+
+	// user adjustable sizes
+	irr::f32 TextureScale;
+
+	// data for recreating the terrain (won't be saved for published apps to save space)
+
+	irr::core::array<irr::video::ITexture*> Textures;
+	CFlaceSharedCellArray<irr::f32> TerrainHeights; // height per cell, pages shared with clones and equal loaded terrains
+	CFlaceSharedCellArray<irr::u8> TerrainTextureIndices; // texture index set by the user per cell, shared like TerrainHeights
+	CFlaceSharedCellArray<STerrainCellBlending> TerrainBlending; // runtime blending per cell, shared like TerrainHeights
+	CFlaceSharedCellArray<irr::core::vector3df> TerrainNormals; // per vertex normals, shared like TerrainHeights
+	irr::core::array< CFlaceSharedCellArray<SHeightRange> > HeightPyramid; // min/max heights, level 0 has the size of TerrainHeights
+	irr::core::array< irr::core::array<SGrassInstance> > GrassBuckets; // grass instances per tile, same layout as TerrainTiles
+	irr::core::array<SGrassBatch> GrassBatches; // expanded grass quads per tile, same layout as TerrainTiles
+	bool GrassUsesWind;
+	irr::core::array<irr::scene::IAnimatedMesh*> ForestMeshes; // meshes of the forest trees, grabbed, 0 if not loadable
+	irr::core::array< irr::core::array<SForestInstance> > ForestBuckets; // trees per tile, same layout as TerrainTiles
+	irr::core::array<SForestBatch> ForestBatches; // merged tree geometry per tile, same layout as TerrainTiles
+	irr::core::array<SForestImpostor> ForestImpostors; // same layout as ForestMeshes
+
+	irr::core::aabbox3d<irr::f32> BBox;
+	irr::core::array<CFlaceMeshSceneNode*> TerrainTiles;
+	irr::core::array<STerrainTileLOD> TileLODs; // same layout as TerrainTiles
+	irr::core::array<SHeightRange> TileHeightRanges; // same layout as TerrainTiles
+	irr::core::array<CFlaceTerrainTriangleSelector*> TriangleSelectors; // created for the tiles, not grabbed
+	irr::video::ITexture* SplatMap; // weights of the layers per grid point, 0 if not used
+	irr::core::array<irr::s32> SplatLayers; // texture index of each layer of the splat map
+	irr::core::array<SPagingRegion> PagingRegions; // row by row, PagingRegionCountX per row
+	irr::s32 PagingRegionCountX;
+	irr::s32 PagingRegionCountY;
+	irr::core::array<STerrainTileStaging> PagingStaging; // tiles of the region being meshed in the background
+	CFlaceTerrainTileBuildJob* PagingJob; // job meshing PagingLoadingRegion, 0 if none
+	irr::s32 PagingLoadingRegion;
+	
+	// runtime
+	// material dummies
+	irr::core::array<irr::video::SMaterial> DummyMaterials;
+	irr::video::IVideoDriver* Driver;
+
+	// temporary and runtime
+	irr::core::array<irr::s32> TemporaryTerrainTilesIds; // only needed shortly after deserializing
+
+	// edit stroke not yet recorded for undo
+	IUndoManager* EditStrokeUndo; // 0 if there is no stroke
+	irr::core::rect<irr::s32> EditStrokeCells;
+	irr::core::array<irr::f32> EditStrokeBefore; // height and texture index per cell of EditStrokeCells, row by row
+	irr::core::array<irr::u8> EditStrokeTouched; // 1 for each cell of EditStrokeCells a stamp was done on
+	irr::s32 EditStrokeTouchedCount; // amount of 1s in EditStrokeTouched
+	irr::u32 EditStrokeLastStampTime;
+
+};
+
+
+#endif
+
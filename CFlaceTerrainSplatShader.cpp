@@ -0,0 +1,372 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainSplatShader.h"
+#include "IGPUProgrammingServices.h"
+#include "IMaterialRendererServices.h"
+#include "SLight.h"
+#include "irrString.h"
+
+// Both languages use the same constants. Lights are separate constants and not arrays, because setting
+// arrays by name doesn't work the same way with all drivers. vLightPosN.w is 1 for point lights and 0
+// for directional lights, where xyz is the direction towards the light then.
+
+static const char* SplatVertexShaderHLSL =
+	"float4x4 mWorldViewProj;\n"\
+	"float4x4 mWorld;\n"\
+	"float4 vSplatTransform;\n"\
+	"float4 vAmbient;\n"\
+	"float4 vLighting;\n"\
+	"float4 vFog;\n"\
+	"float4 vLightPos0; float4 vLightColor0; float4 vLightAttenuation0;\n"\
+	"float4 vLightPos1; float4 vLightColor1; float4 vLightAttenuation1;\n"\
+	"float4 vLightPos2; float4 vLightColor2; float4 vLightAttenuation2;\n"\
+	"float4 vLightPos3; float4 vLightColor3; float4 vLightAttenuation3;\n"\
+	"struct VS_OUTPUT { float4 Position : POSITION; float4 Diffuse : COLOR0; float2 TexCoord : TEXCOORD0; float2 SplatCoord : TEXCOORD1; float Fog : TEXCOORD2; };\n"\
+	"float3 light(float3 p, float3 n, float4 lpos, float4 lcolor, float4 latt)\n"\
+	"{\n"\
+	"	float3 toLight = lpos.xyz - p * lpos.w;\n"\
+	"	float dist = max(length(toLight), 0.0001);\n"\
+	"	float att = lpos.w > 0.5 ? 1.0 / max(dot(latt.xyz, float3(1.0, dist, dist*dist)), 0.0001) : 1.0;\n"\
+	"	return lcolor.rgb * max(dot(n, toLight / dist), 0.0) * att;\n"\
+	"}\n"\
+	"VS_OUTPUT main(float4 pos : POSITION, float3 normal : NORMAL, float4 color : COLOR0, float2 tex : TEXCOORD0)\n"\
+	"{\n"\
+	"	VS_OUTPUT o;\n"\
+	"	o.Position = mul(pos, mWorldViewProj);\n"\
+	"	float3 p = mul(pos, mWorld).xyz;\n"\
+	"	float3 n = normalize(mul(normal, (float3x3)mWorld));\n"\
+	"	float3 l = vAmbient.rgb + light(p, n, vLightPos0, vLightColor0, vLightAttenuation0) + light(p, n, vLightPos1, vLightColor1, vLightAttenuation1)\n"\
+	"		+ light(p, n, vLightPos2, vLightColor2, vLightAttenuation2) + light(p, n, vLightPos3, vLightColor3, vLightAttenuation3);\n"\
+	"	l = lerp(float3(1.0, 1.0, 1.0), saturate(l), vLighting.x);\n"\
+	"	o.Diffuse = float4(l * color.rgb, 1.0);\n"\
+	"	o.TexCoord = tex;\n"\
+	"	o.SplatCoord = pos.xz * vSplatTransform.xy + vSplatTransform.zw;\n"\
+	"	float d = o.Position.w;\n"\
+	"	float f = vFog.w < 0.5 ? (vFog.y - d) / max(vFog.y - vFog.x, 0.0001) : (vFog.w < 1.5 ? exp(-vFog.z * d) : exp(-vFog.z * vFog.z * d * d));\n"\
+	"	o.Fog = vLighting.y > 0.5 ? saturate(f) : 1.0;\n"\
+	"	return o;\n"\
+	"}\n";
+
+static const char* SplatPixelShaderHLSL =
+	"sampler2D splatMap : register(s0);\n"\
+	"sampler2D layer0 : register(s1);\n"\
+	"sampler2D layer1 : register(s2);\n"\
+	"sampler2D layer2 : register(s3);\n"\
+	"#if LAYER_COUNT > 3\n"\
+	"sampler2D layer3 : register(s4);\n"\
+	"#endif\n"\
+	"float4 vFogColor;\n"\
+	"float4 main(float4 diffuse : COLOR0, float2 tex : TEXCOORD0, float2 splat : TEXCOORD1, float fog : TEXCOORD2) : COLOR0\n"\
+	"{\n"\
+	"	float4 w = tex2D(splatMap, splat);\n"\
+	"	w /= max(dot(w, float4(1.0, 1.0, 1.0, 1.0)), 0.001);\n"\
+	"	float3 c = tex2D(layer0, tex).rgb * w.r + tex2D(layer1, tex).rgb * w.g + tex2D(layer2, tex).rgb * w.b;\n"\
+	"#if LAYER_COUNT > 3\n"\
+	"	c += tex2D(layer3, tex).rgb * w.a;\n"\
+	"#endif\n"\
+	"	return float4(lerp(vFogColor.rgb, c * diffuse.rgb, fog), 1.0);\n"\
+	"}\n";
+
+static const char* SplatVertexShaderGLSL =
+	"uniform mat4 mWorld;\n"\
+	"uniform vec4 vSplatTransform;\n"\
+	"uniform vec4 vAmbient;\n"\
+	"uniform vec4 vLighting;\n"\
+	"uniform vec4 vFog;\n"\
+	"uniform vec4 vLightPos0; uniform vec4 vLightColor0; uniform vec4 vLightAttenuation0;\n"\
+	"uniform vec4 vLightPos1; uniform vec4 vLightColor1; uniform vec4 vLightAttenuation1;\n"\
+	"uniform vec4 vLightPos2; uniform vec4 vLightColor2; uniform vec4 vLightAttenuation2;\n"\
+	"uniform vec4 vLightPos3; uniform vec4 vLightColor3; uniform vec4 vLightAttenuation3;\n"\
+	"varying vec2 SplatCoord;\n"\
+	"varying float Fog;\n"\
+	"vec3 light(vec3 p, vec3 n, vec4 lpos, vec4 lcolor, vec4 latt)\n"\
+	"{\n"\
+	"	vec3 toLight = lpos.xyz - p * lpos.w;\n"\
+	"	float dist = max(length(toLight), 0.0001);\n"\
+	"	float att = lpos.w > 0.5 ? 1.0 / max(dot(latt.xyz, vec3(1.0, dist, dist*dist)), 0.0001) : 1.0;\n"\
+	"	return lcolor.rgb * max(dot(n, toLight / dist), 0.0) * att;\n"\
+	"}\n"\
+	"void main()\n"\
+	"{\n"\
+	"	gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"\
+	"	vec3 p = (mWorld * gl_Vertex).xyz;\n"\
+	"	vec3 n = normalize((mWorld * vec4(gl_Normal, 0.0)).xyz);\n"\
+	"	vec3 l = vAmbient.rgb + light(p, n, vLightPos0, vLightColor0, vLightAttenuation0) + light(p, n, vLightPos1, vLightColor1, vLightAttenuation1)\n"\
+	"		+ light(p, n, vLightPos2, vLightColor2, vLightAttenuation2) + light(p, n, vLightPos3, vLightColor3, vLightAttenuation3);\n"\
+	"	l = mix(vec3(1.0, 1.0, 1.0), clamp(l, 0.0, 1.0), vLighting.x);\n"\
+	"	gl_FrontColor = vec4(l * gl_Color.rgb, 1.0);\n"\
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"\
+	"	SplatCoord = gl_Vertex.xz * vSplatTransform.xy + vSplatTransform.zw;\n"\
+	"	float d = gl_Position.w;\n"\
+	"	float f = vFog.w < 0.5 ? (vFog.y - d) / max(vFog.y - vFog.x, 0.0001) : (vFog.w < 1.5 ? exp(-vFog.z * d) : exp(-vFog.z * vFog.z * d * d));\n"\
+	"	Fog = vLighting.y > 0.5 ? clamp(f, 0.0, 1.0) : 1.0;\n"\
+	"}\n";
+
+static const char* SplatPixelShaderGLSL =
+	"uniform sampler2D splatMap;\n"\
+	"uniform sampler2D layer0;\n"\
+	"uniform sampler2D layer1;\n"\
+	"uniform sampler2D layer2;\n"\
+	"#if LAYER_COUNT > 3\n"\
+	"uniform sampler2D layer3;\n"\
+	"#endif\n"\
+	"uniform vec4 vFogColor;\n"\
+	"varying vec2 SplatCoord;\n"\
+	"varying float Fog;\n"\
+	"void main()\n"\
+	"{\n"\
+	"	vec2 tex = gl_TexCoord[0].xy;\n"\
+	"	vec4 w = texture2D(splatMap, SplatCoord);\n"\
+	"	w /= max(dot(w, vec4(1.0, 1.0, 1.0, 1.0)), 0.001);\n"\
+	"	vec3 c = texture2D(layer0, tex).rgb * w.r + texture2D(layer1, tex).rgb * w.g + texture2D(layer2, tex).rgb * w.b;\n"\
+	"#if LAYER_COUNT > 3\n"\
+	"	c += texture2D(layer3, tex).rgb * w.a;\n"\
+	"#endif\n"\
+	"	gl_FragColor = vec4(mix(vFogColor.rgb, c * gl_Color.rgb, Fog), 1.0);\n"\
+	"}\n";
+
+
+CFlaceTerrainSplatShader::CFlaceTerrainSplatShader()
+: Driver(0), MaterialType(-1), CurrentSplatMap(-1), CurrentLighting(true), CurrentFog(false)
+{
+}
+
+
+CFlaceTerrainSplatShader* CFlaceTerrainSplatShader::getInstance()
+{
+	// never deleted, the material renderers of the driver may still reference it
+	static CFlaceTerrainSplatShader* instance = 0;
+
+	if (!instance)
+		instance = new CFlaceTerrainSplatShader();
+
+	return instance;
+}
+
+
+//! returns the material type of the splat shader for a driver, creates it when called the first time.
+irr::s32 CFlaceTerrainSplatShader::getMaterialType(irr::video::IVideoDriver* driver)
+{
+	CFlaceTerrainSplatShader* shader = getInstance();
+
+	if (!driver)
+		return -1;
+
+	if (shader->Driver == driver)
+		return shader->MaterialType;
+
+	shader->Driver = driver;
+	shader->MaterialType = -1;
+
+	irr::video::IGPUProgrammingServices* gpu = driver->getGPUProgrammingServices();
+
+	if (!gpu || TERRAIN_SPLAT_MAX_LAYERS < 3 ||
+		!driver->queryFeature(irr::video::EVDF_VERTEX_SHADER_2_0) ||
+		!driver->queryFeature(irr::video::EVDF_PIXEL_SHADER_2_0))
+		return -1;
+
+	const char* vertexShader = 0;
+	const char* pixelShader = 0;
+
+	if (driver->getDriverType() == irr::video::EDT_DIRECT3D9)
+	{
+		vertexShader = SplatVertexShaderHLSL;
+		pixelShader = SplatPixelShaderHLSL;
+	}
+	else
+	if (driver->getDriverType() == irr::video::EDT_OPENGL)
+	{
+		vertexShader = SplatVertexShaderGLSL;
+		pixelShader = SplatPixelShaderGLSL;
+	}
+	else
+		return -1;
+
+	irr::core::stringc strPixelShader = "#define LAYER_COUNT ";
+	strPixelShader += irr::core::stringc(TERRAIN_SPLAT_MAX_LAYERS);
+	strPixelShader += "\n";
+	strPixelShader += pixelShader;
+
+	shader->MaterialType = gpu->addHighLevelShaderMaterial(
+		vertexShader, "main", irr::video::EVST_VS_2_0,
+		strPixelShader.c_str(), "main", irr::video::EPST_PS_2_0,
+		shader, irr::video::EMT_SOLID, 0);
+
+	return shader->MaterialType;
+}
+
+
+//! sets how object space positions are mapped to the coordinates of a splat map
+void CFlaceTerrainSplatShader::setSplatMapInfo(irr::video::ITexture* splatMap, const irr::f32* scaleOffsetXZ,
+											   irr::scene::ISceneManager* smgr)
+{
+	CFlaceTerrainSplatShader* shader = getInstance();
+
+	SSplatMapInfo* info = 0;
+
+	for (int i=0; i<(int)shader->SplatMaps.size(); ++i)
+		if (shader->SplatMaps[i].SplatMap == splatMap)
+			info = &shader->SplatMaps[i];
+
+	if (!info)
+	{
+		shader->SplatMaps.push_back(SSplatMapInfo());
+		info = &shader->SplatMaps.getLast();
+		info->SplatMap = splatMap;
+	}
+
+	for (int i=0; i<4; ++i)
+		info->Transform[i] = scaleOffsetXZ[i];
+
+	info->SceneManager = smgr;
+}
+
+
+//! needs to be called before removing a splat map
+void CFlaceTerrainSplatShader::removeSplatMapInfo(irr::video::ITexture* splatMap)
+{
+	CFlaceTerrainSplatShader* shader = getInstance();
+
+	for (int i=0; i<(int)shader->SplatMaps.size(); ++i)
+		if (shader->SplatMaps[i].SplatMap == splatMap)
+		{
+			shader->SplatMaps.erase(i);
+			break;
+		}
+
+	shader->CurrentSplatMap = -1;
+}
+
+
+//! called by the driver when the material is set
+void CFlaceTerrainSplatShader::OnSetMaterial(const irr::video::SMaterial& material)
+{
+	CurrentSplatMap = -1;
+	CurrentLighting = material.Lighting;
+	CurrentFog = material.FogEnable;
+
+	for (int i=0; i<(int)SplatMaps.size(); ++i)
+		if (SplatMaps[i].SplatMap == material.getTexture(0))
+		{
+			CurrentSplatMap = i;
+			break;
+		}
+}
+
+
+//! called by the driver for setting the shader constants
+void CFlaceTerrainSplatShader::OnSetConstants(irr::video::IMaterialRendererServices* services, irr::s32 userData)
+{
+	irr::video::IVideoDriver* driver = services->getVideoDriver();
+
+	// matrices
+
+	irr::core::matrix4 world = driver->getTransform(irr::video::ETS_WORLD);
+	services->setVertexShaderConstant("mWorld", world.pointer(), 16);
+
+	if (driver->getDriverType() == irr::video::EDT_DIRECT3D9)
+	{
+		irr::core::matrix4 worldViewProj = driver->getTransform(irr::video::ETS_PROJECTION);
+		worldViewProj *= driver->getTransform(irr::video::ETS_VIEW);
+		worldViewProj *= world;
+		services->setVertexShaderConstant("mWorldViewProj", worldViewProj.pointer(), 16);
+	}
+	else
+	{
+		// GLSL samplers are set by texture unit
+
+		const char* samplers[5] = { "splatMap", "layer0", "layer1", "layer2", "layer3" };
+
+		for (int i=0; i<=TERRAIN_SPLAT_MAX_LAYERS; ++i)
+		{
+			irr::f32 unit = (irr::f32)i;
+			services->setPixelShaderConstant(samplers[i], &unit, 1);
+		}
+	}
+
+	// mapping to the splat map
+
+	irr::f32 splatTransform[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	irr::video::SColorf ambient(0.0f, 0.0f, 0.0f, 1.0f);
+
+	if (CurrentSplatMap >= 0 && CurrentSplatMap < (irr::s32)SplatMaps.size())
+	{
+		const SSplatMapInfo& info = SplatMaps[CurrentSplatMap];
+
+		for (int i=0; i<4; ++i)
+			splatTransform[i] = info.Transform[i];
+
+		if (info.SceneManager)
+			ambient = info.SceneManager->getAmbientLight();
+	}
+
+	services->setVertexShaderConstant("vSplatTransform", splatTransform, 4);
+	services->setVertexShaderConstant("vAmbient", &ambient.r, 4);
+
+	// lights
+
+	const irr::s32 lightCount = CurrentLighting ? irr::core::min_((irr::s32)driver->getDynamicLightCount(), 4) : 0;
+
+	for (int i=0; i<4; ++i)
+	{
+		irr::f32 pos[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+		irr::f32 color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		irr::f32 attenuation[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+		if (i < lightCount)
+		{
+			const irr::video::SLight& light = driver->getDynamicLight(i);
+
+			if (light.Type == irr::video::ELT_DIRECTIONAL)
+			{
+				pos[0] = -light.Direction.X;
+				pos[1] = -light.Direction.Y;
+				pos[2] = -light.Direction.Z;
+				pos[3] = 0.0f;
+			}
+			else
+			{
+				pos[0] = light.Position.X;
+				pos[1] = light.Position.Y;
+				pos[2] = light.Position.Z;
+				pos[3] = 1.0f;
+			}
+
+			color[0] = light.DiffuseColor.r;
+			color[1] = light.DiffuseColor.g;
+			color[2] = light.DiffuseColor.b;
+			color[3] = 1.0f;
+
+			attenuation[0] = light.Attenuation.X;
+			attenuation[1] = light.Attenuation.Y;
+			attenuation[2] = light.Attenuation.Z;
+		}
+
+		irr::core::stringc strIndex(i);
+		services->setVertexShaderConstant((irr::core::stringc("vLightPos") + strIndex).c_str(), pos, 4);
+		services->setVertexShaderConstant((irr::core::stringc("vLightColor") + strIndex).c_str(), color, 4);
+		services->setVertexShaderConstant((irr::core::stringc("vLightAttenuation") + strIndex).c_str(), attenuation, 4);
+	}
+
+	// fog
+
+	irr::video::SColor fogColor;
+	irr::video::E_FOG_TYPE fogType = irr::video::EFT_FOG_LINEAR;
+	irr::f32 fogParams[4] = { 0.0f, 1.0f, 0.0f, 0.0f };
+	bool pixelFog = false;
+	bool rangeFog = false;
+
+	driver->getFog(fogColor, fogType, fogParams[0], fogParams[1], fogParams[2], pixelFog, rangeFog);
+	fogParams[3] = fogType == irr::video::EFT_FOG_EXP ? 1.0f : (fogType == irr::video::EFT_FOG_EXP2 ? 2.0f : 0.0f);
+
+	irr::f32 lighting[4] = { CurrentLighting ? 1.0f : 0.0f, CurrentFog ? 1.0f : 0.0f, 0.0f, 0.0f };
+
+	irr::video::SColorf fogColorf(fogColor);
+
+	services->setVertexShaderConstant("vLighting", lighting, 4);
+	services->setVertexShaderConstant("vFog", fogParams, 4);
+	services->setPixelShaderConstant("vFogColor", &fogColorf.r, 4);
+}
+
@@ -0,0 +1,63 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_SPLAT_SHADER_H_INCLUDED__
+#define __C_FLACE_TERRAIN_SPLAT_SHADER_H_INCLUDED__
+
+#include "IShaderConstantSetCallBack.h"
+#include "IVideoDriver.h"
+#include "ISceneManager.h"
+#include "irrArray.h"
+
+//! maximal amount of textures blended by the splat shader. One texture of the material is the splat
+//! map itself, and it has 4 channels for weights, so with 4 textures per material only 3 layers are possible.
+const irr::s32 TERRAIN_SPLAT_MAX_LAYERS = irr::video::MATERIAL_MAX_TEXTURES - 1 < 4 ? irr::video::MATERIAL_MAX_TEXTURES - 1 : 4;
+
+//! Shader material drawing a terrain tile with several textures in one draw call. Texture 0 of the material
+//! is the splat map, with the weight of each layer in one channel (red, green, blue, alpha), the layer textures
+//! follow in textures 1 to TERRAIN_SPLAT_MAX_LAYERS. Lighting is done per vertex with up to 4 dynamic lights.
+class CFlaceTerrainSplatShader : public irr::video::IShaderConstantSetCallBack
+{
+public:
+
+	//! returns the material type of the splat shader for a driver, creates it when called the first time.
+	//! Returns -1 if the driver doesn't support the needed shaders.
+	static irr::s32 getMaterialType(irr::video::IVideoDriver* driver);
+
+	//! sets how object space positions are mapped to the coordinates of a splat map, as scale for x and z,
+	//! then offset for x and z. The scene manager is used for the ambient light.
+	static void setSplatMapInfo(irr::video::ITexture* splatMap, const irr::f32* scaleOffsetXZ, irr::scene::ISceneManager* smgr);
+
+	//! needs to be called before removing a splat map
+	static void removeSplatMapInfo(irr::video::ITexture* splatMap);
+
+	//! called by the driver when the material is set
+	virtual void OnSetMaterial(const irr::video::SMaterial& material);
+
+	//! called by the driver for setting the shader constants
+	virtual void OnSetConstants(irr::video::IMaterialRendererServices* services, irr::s32 userData);
+
+private:
+
+	CFlaceTerrainSplatShader();
+
+	struct SSplatMapInfo
+	{
+		irr::video::ITexture* SplatMap;
+		irr::f32 Transform[4];
+		irr::scene::ISceneManager* SceneManager;
+	};
+
+	static CFlaceTerrainSplatShader* getInstance();
+
+	irr::core::array<SSplatMapInfo> SplatMaps;
+	irr::video::IVideoDriver* Driver; // driver the material type was created for
+	irr::s32 MaterialType;
+	irr::s32 CurrentSplatMap; // index into SplatMaps of the material being drawn, or -1
+	bool CurrentLighting;
+	bool CurrentFog;
+};
+
+#endif
+
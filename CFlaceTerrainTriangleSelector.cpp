@@ -0,0 +1,119 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceTerrainTriangleSelector.h"
+#include "CFlaceTerrainSceneNode.h"
+#include "ISceneNode.h"
+
+//! constructor
+CFlaceTerrainTriangleSelector::CFlaceTerrainTriangleSelector(CFlaceTerrainSceneNode* terrain, irr::scene::ISceneNode* node,
+															 irr::s32 tileX, irr::s32 tileY)
+: Terrain(terrain), Node(node), TileX(tileX), TileY(tileY)
+{
+	#ifdef _DEBUG
+	setDebugName("CFlaceTerrainTriangleSelector");
+	#endif
+}
+
+
+//! destructor
+CFlaceTerrainTriangleSelector::~CFlaceTerrainTriangleSelector()
+{
+	if (Terrain)
+		Terrain->onTriangleSelectorDeleted(this);
+}
+
+
+//! returns the cells of the tile, 0 if the selector was detached or the tile doesn't exist anymore
+bool CFlaceTerrainTriangleSelector::getCells(irr::core::rect<irr::s32>& outCells) const
+{
+	return Terrain && Terrain->getTerrainTileCollisionCells(TileX, TileY, outCells);
+}
+
+
+//! returns the transformation from the coordinates of the terrain meshes to the wanted output coordinates
+irr::core::matrix4 CFlaceTerrainTriangleSelector::getTransformation(const irr::core::matrix4* transform) const
+{
+	irr::core::matrix4 mat;
+
+	if (transform)
+		mat = *transform;
+
+	if (Node)
+		mat *= Node->getAbsoluteTransformation();
+
+	return mat;
+}
+
+
+//! Returns amount of all available triangles in this selector
+irr::s32 CFlaceTerrainTriangleSelector::getTriangleCount() const
+{
+	irr::core::rect<irr::s32> cells;
+	if (!getCells(cells))
+		return 0;
+
+	return cells.getWidth() * cells.getHeight() * 2;
+}
+
+
+//! Gets all triangles.
+void CFlaceTerrainTriangleSelector::getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+												 irr::s32& outTriangleCount, const irr::core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+
+	irr::core::rect<irr::s32> cells;
+	if (getCells(cells))
+		outTriangleCount = Terrain->getTerrainTriangles(cells, 0, triangles, arraySize, getTransformation(transform));
+}
+
+
+//! Gets all triangles which lie within a specific bounding box.
+void CFlaceTerrainTriangleSelector::getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+												 irr::s32& outTriangleCount, const irr::core::aabbox3d<irr::f32>& box,
+												 const irr::core::matrix4* transform) const
+{
+	outTriangleCount = 0;
+
+	irr::core::rect<irr::s32> cells;
+	if (!getCells(cells))
+		return;
+
+	// move the box into the space of the terrain meshes
+
+	irr::core::aabbox3df localBox(box);
+
+	if (Node)
+	{
+		irr::core::matrix4 inverse;
+		if (Node->getAbsoluteTransformation().getInverse(inverse))
+			inverse.transformBoxEx(localBox);
+	}
+
+	outTriangleCount = Terrain->getTerrainTriangles(cells, &localBox, triangles, arraySize, getTransformation(transform));
+}
+
+
+//! Gets all triangles which have or may have contact with a 3d line.
+void CFlaceTerrainTriangleSelector::getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize,
+												 irr::s32& outTriangleCount, const irr::core::line3d<irr::f32>& line,
+												 const irr::core::matrix4* transform) const
+{
+	irr::core::aabbox3df box(line.start);
+	box.addInternalPoint(line.end);
+
+	getTriangles(triangles, arraySize, outTriangleCount, box, transform);
+}
+
+
+//! Creates a selector for the same terrain tile, but for another scene node
+irr::scene::ITriangleSelector* CFlaceTerrainTriangleSelector::createClone(irr::scene::ISceneNode* newNode)
+{
+	if (!Terrain)
+		return 0;
+
+	return Terrain->createTerrainTriangleSelector(TileX, TileY, newNode);
+}
+
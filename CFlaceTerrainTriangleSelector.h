@@ -0,0 +1,64 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_TERRAIN_TRIANGLE_SELECTOR_H_INCLUDED__
+#define __C_FLACE_TERRAIN_TRIANGLE_SELECTOR_H_INCLUDED__
+
+#include "ITriangleSelector.h"
+#include "rect.h"
+
+class CFlaceTerrainSceneNode;
+
+//! Triangle selector for one tile of a terrain. It doesn't store any triangles, but creates them from
+//! the height field of the terrain when queried, and only those inside the queried box or line.
+//! So it uses no memory for the triangles and stays valid when the terrain is edited.
+class CFlaceTerrainTriangleSelector : public irr::scene::ITriangleSelector
+{
+public:
+
+	//! constructor. node is the terrain tile scene node the triangles belong to, used for the transformation.
+	CFlaceTerrainTriangleSelector(CFlaceTerrainSceneNode* terrain, irr::scene::ISceneNode* node, irr::s32 tileX, irr::s32 tileY);
+
+	~CFlaceTerrainTriangleSelector();
+
+	//! Returns amount of all available triangles in this selector
+	virtual irr::s32 getTriangleCount() const;
+
+	//! Gets all triangles.
+	virtual void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize, irr::s32& outTriangleCount,
+		const irr::core::matrix4* transform=0) const;
+
+	//! Gets all triangles which lie within a specific bounding box.
+	virtual void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize, irr::s32& outTriangleCount,
+		const irr::core::aabbox3d<irr::f32>& box, const irr::core::matrix4* transform=0) const;
+
+	//! Gets all triangles which have or may have contact with a 3d line.
+	virtual void getTriangles(irr::core::triangle3df* triangles, irr::s32 arraySize, irr::s32& outTriangleCount,
+		const irr::core::line3d<irr::f32>& line, const irr::core::matrix4* transform=0) const;
+
+	//! Returns the scene node associated with a specific triangle
+	virtual const irr::scene::ISceneNode* getSceneNodeForTriangle(irr::u32 triangleIndex) const { return Node; }
+
+	//! Returns the scene node the triangles belong to
+	virtual irr::scene::ISceneNode* getRelatedSceneNode() const { return Node; }
+
+	//! Creates a selector for the same terrain tile, but for another scene node
+	virtual irr::scene::ITriangleSelector* createClone(irr::scene::ISceneNode* newNode);
+
+	//! called by the terrain when its tiles are removed, the selector returns no triangles anymore after this
+	void detachFromTerrain() { Terrain = 0; }
+
+private:
+
+	bool getCells(irr::core::rect<irr::s32>& outCells) const;
+	irr::core::matrix4 getTransformation(const irr::core::matrix4* transform) const;
+
+	CFlaceTerrainSceneNode* Terrain; // not grabbed, the terrain owns the tiles using this selector
+	irr::scene::ISceneNode* Node;
+	irr::s32 TileX;
+	irr::s32 TileY;
+};
+
+#endif
+
@@ -0,0 +1,341 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "CFlaceWorkerPool.h"
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+// returns the value after incrementing
+static long atomicIncrement(volatile long* value)
+{
+#ifdef WIN32
+	return InterlockedIncrement(value);
+#else
+	return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+
+static irr::s32 getProcessorCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (irr::s32)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (irr::s32)count : 1;
+#endif
+}
+
+
+//! constructor
+CFlaceWorkerPool::CFlaceWorkerPool(irr::s32 threadCount)
+: Threads(0), WorkerCount(0), CurrentJob(0), PartCount(0), NextPart(0),
+  PartsDone(0), ActiveWorkers(0), JobGeneration(0), Busy(false), Background(false), ShuttingDown(false)
+{
+	if (threadCount <= 0)
+		threadCount = getProcessorCount() - 1; // the calling thread works as well
+
+	// no need for more, and keeps the amount of memory used for stacks low on machines with many cores
+	if (threadCount > 15)
+		threadCount = 15;
+
+#ifdef WIN32
+	InitializeCriticalSection(&Mutex);
+	InitializeConditionVariable(&WorkAvailable);
+	InitializeConditionVariable(&JobDone);
+
+	if (threadCount > 0)
+	{
+		Threads = new HANDLE[threadCount];
+
+		for (int i=0; i<threadCount; ++i)
+		{
+			Threads[WorkerCount] = CreateThread(0, 0, workerThreadProc, this, 0, 0);
+			if (Threads[WorkerCount])
+				++WorkerCount;
+		}
+	}
+#else
+	pthread_mutex_init(&Mutex, 0);
+	pthread_cond_init(&WorkAvailable, 0);
+	pthread_cond_init(&JobDone, 0);
+
+	if (threadCount > 0)
+	{
+		Threads = new pthread_t[threadCount];
+
+		for (int i=0; i<threadCount; ++i)
+		{
+			if (pthread_create(&Threads[WorkerCount], 0, workerThreadProc, this) == 0)
+				++WorkerCount;
+		}
+	}
+#endif
+}
+
+
+//! destructor
+CFlaceWorkerPool::~CFlaceWorkerPool()
+{
+	lock();
+	ShuttingDown = true;
+	signalWork();
+	unlock();
+
+#ifdef WIN32
+	for (irr::u32 i=0; i<WorkerCount; ++i)
+	{
+		WaitForSingleObject(Threads[i], INFINITE);
+		CloseHandle(Threads[i]);
+	}
+
+	DeleteCriticalSection(&Mutex);
+#else
+	for (irr::u32 i=0; i<WorkerCount; ++i)
+		pthread_join(Threads[i], 0);
+
+	pthread_cond_destroy(&JobDone);
+	pthread_cond_destroy(&WorkAvailable);
+	pthread_mutex_destroy(&Mutex);
+#endif
+
+	delete [] Threads;
+}
+
+
+//! returns the pool shared by the whole application, creates it when called the first time
+CFlaceWorkerPool* CFlaceWorkerPool::getSharedPool()
+{
+	// intentionally never deleted: on process exit, the threads might already be
+	// terminated by the OS when static destructors run, and joining them would hang.
+	static CFlaceWorkerPool* sharedPool = 0;
+
+	if (!sharedPool)
+		sharedPool = new CFlaceWorkerPool();
+
+	return sharedPool;
+}
+
+
+//! runs all parts of a job on the worker threads and the calling thread
+void CFlaceWorkerPool::runParallel(IFlaceParallelJob* job, irr::s32 partCount)
+{
+	if (!job || partCount <= 0)
+		return;
+
+	lock();
+
+	if (Busy || !WorkerCount || partCount == 1)
+	{
+		// nested call or nothing to split, just run it here
+
+		unlock();
+
+		for (irr::s32 i=0; i<partCount; ++i)
+			job->runJobPart(i);
+
+		return;
+	}
+
+	beginJob(job, partCount);
+
+	unlock();
+
+	// work as well while waiting
+
+	irr::s32 done = runParts(job, partCount);
+
+	lock();
+
+	PartsDone += done;
+
+	// wait until all parts are done and no worker is touching the job anymore
+
+	while (PartsDone < PartCount || ActiveWorkers > 0)
+		waitForJobDone();
+
+	CurrentJob = 0;
+	Busy = false;
+
+	unlock();
+}
+
+
+//! starts all parts of a job on the worker threads and returns without waiting
+bool CFlaceWorkerPool::startInBackground(IFlaceParallelJob* job, irr::s32 partCount)
+{
+	if (!job || partCount <= 0)
+		return true;
+
+	lock();
+
+	if (Busy)
+	{
+		unlock();
+		return false;
+	}
+
+	if (!WorkerCount)
+	{
+		// nobody to give it to
+
+		unlock();
+
+		for (irr::s32 i=0; i<partCount; ++i)
+			job->runJobPart(i);
+
+		return true;
+	}
+
+	beginJob(job, partCount);
+	Background = true;
+
+	unlock();
+	return true;
+}
+
+
+//! returns true if a job started with startInBackground() is done, or isn't running at all
+bool CFlaceWorkerPool::isBackgroundJobDone(IFlaceParallelJob* job)
+{
+	lock();
+
+	const bool running = Background && CurrentJob == job;
+	const bool done = !running || (PartsDone >= PartCount && ActiveWorkers == 0);
+
+	if (running && done)
+	{
+		CurrentJob = 0;
+		Busy = false;
+		Background = false;
+	}
+
+	unlock();
+	return done;
+}
+
+
+//! waits until a job started with startInBackground() is done
+void CFlaceWorkerPool::waitForBackgroundJob(IFlaceParallelJob* job)
+{
+	lock();
+
+	if (Background && CurrentJob == job)
+	{
+		while (PartsDone < PartCount || ActiveWorkers > 0)
+			waitForJobDone();
+
+		CurrentJob = 0;
+		Busy = false;
+		Background = false;
+	}
+
+	unlock();
+}
+
+
+//! makes a job the current one and wakes up the workers, needs to be called with the mutex locked
+void CFlaceWorkerPool::beginJob(IFlaceParallelJob* job, irr::s32 partCount)
+{
+	Busy = true;
+	CurrentJob = job;
+	PartCount = partCount;
+	NextPart = 0;
+	PartsDone = 0;
+	++JobGeneration;
+	signalWork();
+}
+
+
+//! takes parts of the job until none are left, returns amount of parts done
+irr::s32 CFlaceWorkerPool::runParts(IFlaceParallelJob* job, irr::s32 partCount)
+{
+	irr::s32 done = 0;
+
+	while(true)
+	{
+		irr::s32 part = (irr::s32)atomicIncrement(&NextPart) - 1;
+		if (part >= partCount)
+			break;
+
+		job->runJobPart(part);
+		++done;
+	}
+
+	return done;
+}
+
+
+void CFlaceWorkerPool::workerMain()
+{
+	irr::u32 seenGeneration = 0;
+
+	lock();
+
+	while(true)
+	{
+		while (!ShuttingDown && (seenGeneration == JobGeneration || !CurrentJob))
+			waitForWork();
+
+		if (ShuttingDown)
+			break;
+
+		seenGeneration = JobGeneration;
+		IFlaceParallelJob* job = CurrentJob;
+		irr::s32 partCount = PartCount;
+		++ActiveWorkers;
+
+		unlock();
+
+		irr::s32 done = runParts(job, partCount);
+
+		lock();
+
+		PartsDone += done;
+		--ActiveWorkers;
+
+		if (PartsDone >= PartCount && ActiveWorkers == 0)
+			signalJobDone();
+	}
+
+	unlock();
+}
+
+
+#ifdef WIN32
+
+DWORD WINAPI CFlaceWorkerPool::workerThreadProc(LPVOID param)
+{
+	((CFlaceWorkerPool*)param)->workerMain();
+	return 0;
+}
+
+void CFlaceWorkerPool::lock() { EnterCriticalSection(&Mutex); }
+void CFlaceWorkerPool::unlock() { LeaveCriticalSection(&Mutex); }
+void CFlaceWorkerPool::waitForWork() { SleepConditionVariableCS(&WorkAvailable, &Mutex, INFINITE); }
+void CFlaceWorkerPool::waitForJobDone() { SleepConditionVariableCS(&JobDone, &Mutex, INFINITE); }
+void CFlaceWorkerPool::signalWork() { WakeAllConditionVariable(&WorkAvailable); }
+void CFlaceWorkerPool::signalJobDone() { WakeAllConditionVariable(&JobDone); }
+
+#else
+
+void* CFlaceWorkerPool::workerThreadProc(void* param)
+{
+	((CFlaceWorkerPool*)param)->workerMain();
+	return 0;
+}
+
+void CFlaceWorkerPool::lock() { pthread_mutex_lock(&Mutex); }
+void CFlaceWorkerPool::unlock() { pthread_mutex_unlock(&Mutex); }
+void CFlaceWorkerPool::waitForWork() { pthread_cond_wait(&WorkAvailable, &Mutex); }
+void CFlaceWorkerPool::waitForJobDone() { pthread_cond_wait(&JobDone, &Mutex); }
+void CFlaceWorkerPool::signalWork() { pthread_cond_broadcast(&WorkAvailable); }
+void CFlaceWorkerPool::signalJobDone() { pthread_cond_broadcast(&JobDone); }
+
+#endif
+
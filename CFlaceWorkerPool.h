@@ -0,0 +1,108 @@
+// Copyright (C) 2002-2014 Nikolaus Gebhardt
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_FLACE_WORKER_POOL_H_INCLUDED__
+#define __C_FLACE_WORKER_POOL_H_INCLUDED__
+
+#include "irrTypes.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//! Work which can be split into independent parts, to be run by the worker pool.
+class IFlaceParallelJob
+{
+public:
+
+	virtual ~IFlaceParallelJob() {}
+
+	//! called once for every part index from 0 to partCount-1. Can be called from any thread,
+	//! and parts are running at the same time, so they must not write to shared data.
+	virtual void runJobPart(irr::s32 partIndex) = 0;
+};
+
+
+//! Small pool of worker threads, used for splitting expensive work (like rebuilding terrain
+//! tiles) over all cores of the CPU. The threads are started once and sleep while no job is running.
+class CFlaceWorkerPool
+{
+public:
+
+	//! constructor. If threadCount is 0, one thread per additional core of the CPU is created
+	CFlaceWorkerPool(irr::s32 threadCount=0);
+
+	~CFlaceWorkerPool();
+
+	//! returns the pool shared by the whole application, creates it when called the first time
+	static CFlaceWorkerPool* getSharedPool();
+
+	//! runs all parts of a job on the worker threads and the calling thread, and returns when all
+	//! parts are done. If called while another job is running (for example from inside a job part),
+	//! the parts are simply run on the calling thread.
+	void runParallel(IFlaceParallelJob* job, irr::s32 partCount);
+
+	//! starts all parts of a job on the worker threads and returns without waiting, for work which
+	//! may take several frames. Returns false if the pool is busy, then the job is not started.
+	//! Without worker threads, the job is run on the calling thread before returning.
+	//! While the job runs, runParallel() runs the parts of other jobs on the calling thread.
+	bool startInBackground(IFlaceParallelJob* job, irr::s32 partCount);
+
+	//! returns true if a job started with startInBackground() is done, or isn't running at all.
+	//! Needs to be called until it returns true, the pool only is free again after that.
+	bool isBackgroundJobDone(IFlaceParallelJob* job);
+
+	//! waits until a job started with startInBackground() is done
+	void waitForBackgroundJob(IFlaceParallelJob* job);
+
+	//! returns amount of threads working on a job, including the calling thread
+	irr::s32 getThreadCount() const { return (irr::s32)WorkerCount + 1; }
+
+private:
+
+	void lock();
+	void unlock();
+	void waitForWork();
+	void waitForJobDone();
+	void signalWork();
+	void signalJobDone();
+
+	irr::s32 runParts(IFlaceParallelJob* job, irr::s32 partCount);
+	void beginJob(IFlaceParallelJob* job, irr::s32 partCount);
+	void workerMain();
+
+#ifdef WIN32
+	static DWORD WINAPI workerThreadProc(LPVOID param);
+
+	CRITICAL_SECTION Mutex;
+	CONDITION_VARIABLE WorkAvailable;
+	CONDITION_VARIABLE JobDone;
+	HANDLE* Threads;
+#else
+	static void* workerThreadProc(void* param);
+
+	pthread_mutex_t Mutex;
+	pthread_cond_t WorkAvailable;
+	pthread_cond_t JobDone;
+	pthread_t* Threads;
+#endif
+
+	irr::u32 WorkerCount;
+
+	// current job, protected by the mutex
+	IFlaceParallelJob* CurrentJob;
+	irr::s32 PartCount;
+	volatile long NextPart;
+	irr::s32 PartsDone;
+	irr::s32 ActiveWorkers;
+	irr::u32 JobGeneration;
+	bool Busy;
+	bool Background; // current job was started with startInBackground()
+	bool ShuttingDown;
+};
+
+#endif
+